@@ -0,0 +1,87 @@
+/*
+ * MIT License
+ * 
+ * Copyright (c) 2020 Eli Reed
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/*
+ * This file describes the waveform cache: a tag in a reserved region of the MCP2210's
+ * EEPROM recording which image the SRAM was last loaded with, so a redeploy of the
+ * same image can skip the upload.
+ *
+ * The tag lives at CACHE_EEPROM_ADDR (the top 32 bytes of the EEPROM):
+ *
+ *   byte 0       CACHE_TAG_MAGIC, anything else means "no tag"
+ *   bytes 1-4    start address (little-endian)
+ *   bytes 5-8    number of words (little-endian)
+ *   bytes 9-16   FNV-1a 64 hash of the words (little-endian)
+ *   byte 17      XOR of bytes 1-16
+ *
+ * The tag is cleared before any SRAM write and only written back once an upload has
+ * finished without errors, so an interrupted upload never leaves a matching tag. SRAM
+ * doesn't survive a power cycle but the EEPROM does, so a matching tag is confirmed by
+ * reading a few words back before the upload is skipped.
+ */
+
+#ifndef CACHE_H_
+#define CACHE_H_
+
+#include <stdbool.h>  // for bool type
+#include <stdint.h>   // for fixed-width integer types
+
+// HIDAPI
+#include "hidapi/hidapi.h"
+
+// project libraries
+#include "dds-host/image.h"
+
+#define CACHE_EEPROM_ADDR     0xE0
+#define CACHE_TAG_SIZE        18
+#define CACHE_TAG_MAGIC       0xC5
+
+// how many SRAM words are read back to confirm a matching tag
+#define CACHE_SPOT_CHECKS     3
+
+typedef struct image_tag_st {
+  unsigned int startAddr;
+  unsigned int numWords;
+  uint64_t hash;
+} ImageTag;
+
+// computes the tag 'numWords' words loaded at 'startAddr' would have
+void Cache_TagWords(const unsigned int *words, unsigned int startAddr, unsigned int numWords, ImageTag *tag);
+
+// reads the tag from the EEPROM. Returns false if there isn't a valid one.
+bool Cache_ReadTag(hid_device *handle, ImageTag *tag);
+
+// writes 'tag' to the EEPROM, skipping bytes that already match.
+// Returns false on failure, true otherwise.
+bool Cache_WriteTag(hid_device *handle, const ImageTag *tag);
+
+// clears the tag, if there is one. Call before writing to SRAM.
+// Returns false on failure, true otherwise.
+bool Cache_Invalidate(hid_device *handle);
+
+// returns true if the SRAM is tagged with 'image' loaded at address 0 and a spot
+// check of the SRAM agrees
+bool Cache_HoldsImage(hid_device *handle, const SRAMImage *image);
+
+#endif  // CACHE_H_
@@ -22,7 +22,11 @@
  * SOFTWARE.
  */
 
+#ifndef CPLD_H_
+#define CPLD_H_
+
 #include <stdbool.h>
+#include <stdint.h>
 
 // HIDAPI
 #include "hidapi/hidapi.h"
@@ -37,8 +41,30 @@
 
 #define SRAM_DATA_SIZE          4
 
+// fills in the SRAM_PACKET_SIZE-byte SPI packet that reads or writes 'addr'
+void CPLD_EncodePacket(uint8_t *packet, unsigned int addr, bool read, unsigned int data);
+
+// sets the SPI settings the SRAM needs (CS_MEM on GP1, 7-byte transactions),
+// leaving the SPI mode alone
+void CPLD_SRAMSpiSettings(MCP2210SPITransferSettings *spiSettings);
+
+// points the MCP2210 at the SRAM. 'spiSettings' is left ready to hand to
+// MCP2210_SpiDataTransfer(). Returns false on failure, true otherwise.
+bool CPLD_SetupBus(hid_device *handle, MCP2210SPITransferSettings *spiSettings);
+
 // writes to a memory location on the SRAM
 bool CPLD_WriteSRAMAddress(hid_device *handle, unsigned int addr, unsigned int txData);
 
 // reads from a memory location on the SRAM
-bool CPLD_ReadSRAMAddress(hid_device *handle, unsigned int addr, unsigned int *rxData);
\ No newline at end of file
+bool CPLD_ReadSRAMAddress(hid_device *handle, unsigned int addr, unsigned int *rxData);
+
+// writes 'count' words to consecutive SRAM addresses starting at 'startAddr'. The
+// MCP2210 is set up for the SRAM once rather than once per word. Returns the number
+// of words that failed to write.
+unsigned int CPLD_WriteSRAM(hid_device *handle, unsigned int startAddr, const unsigned int *txData, unsigned int count);
+
+// reads 'count' words from consecutive SRAM addresses starting at 'startAddr'.
+// Returns false on failure, true otherwise.
+bool CPLD_ReadSRAM(hid_device *handle, unsigned int startAddr, unsigned int *rxData, unsigned int count);
+
+#endif  // CPLD_H_
@@ -0,0 +1,84 @@
+/*
+ * MIT License
+ * 
+ * Copyright (c) 2020 Eli Reed
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/*
+ * This file describes precompiled DAC configuration profiles.
+ *
+ * A profile is a DAC config CSV that has already been parsed and validated, along with
+ * the SPI frames that apply it: every run of consecutive registers split into bursts
+ * of up to 4, so loading one is a single bus setup plus one transaction per frame.
+ * Profiles are stored as (integers little-endian):
+ *
+ *   bytes 0-7      DACPROFILE_MAGIC, the last byte being the version
+ *   bytes 8-11     register mask
+ *   bytes 12-40    register values, 0 where the mask bit is clear
+ *   byte 41        number of frames
+ *   6 bytes each   frame length, then the frame padded to 5 bytes
+ *   8 bytes        FNV-1a 64 hash of everything before it
+ *
+ * Host_ConfigureDevices() accepts a profile anywhere it accepts a DAC config CSV.
+ */
+
+#ifndef DAC_PROFILE_H_
+#define DAC_PROFILE_H_
+
+#include <stdbool.h>  // for bool type
+
+// project libraries
+#include "dds-host/dac5687.h"
+
+#define DACPROFILE_MAGIC          "DDSDACP\x01"
+#define DACPROFILE_MAGIC_LEN      8
+
+// a single-register run per frame is the worst case
+#define DACPROFILE_MAX_FRAMES     DAC5687_NUM_REGISTERS
+
+typedef struct dac_profile_st {
+  DAC5687RegisterMap map;
+  unsigned int numFrames;
+  DAC5687Frame frames[DACPROFILE_MAX_FRAMES];
+} DACProfile;
+
+// builds the frames for 'map' into 'profile'. Returns false if the map includes a
+// factory-use register, true otherwise.
+bool DACProfile_Compile(const DAC5687RegisterMap *map, DACProfile *profile);
+
+// parses and validates a DAC config CSV, then compiles it.
+// Returns false on failure, true otherwise.
+bool DACProfile_CompileCSV(const char *csvFileName, DACProfile *profile);
+
+// writes 'profile' to 'fileName'. Returns false on failure, true otherwise.
+bool DACProfile_Save(const char *fileName, const DACProfile *profile);
+
+// reads a profile, checking its hash and that its frames really are the ones its
+// register map compiles to. Returns false on failure, true otherwise.
+bool DACProfile_Load(const char *fileName, DACProfile *profile);
+
+// returns true if 'fileName' starts with the profile magic
+bool DACProfile_IsProfile(const char *fileName);
+
+// writes the whole profile to the DAC. Returns false on failure, true otherwise.
+bool DACProfile_Apply(hid_device *handle, const DACProfile *profile);
+
+#endif  // DAC_PROFILE_H_
@@ -0,0 +1,77 @@
+/*
+ * MIT License
+ * 
+ * Copyright (c) 2020 Eli Reed
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/*
+ * This file describes DAC register snapshots: everything the host may read from a
+ * DAC5687, captured in one batched pass and stored compactly so boards can be checked
+ * against a config, or against each other, later.
+ *
+ * A snapshot is stored as (integers little-endian):
+ *
+ *   bytes 0-7      DACSNAPSHOT_MAGIC, the last byte being the version
+ *   bytes 8-15     when it was taken, in seconds since the epoch
+ *   bytes 16-19    register mask
+ *   bytes 20-48    register values, 0 where the mask bit is clear
+ *   bytes 49-56    FNV-1a 64 hash of everything before it
+ */
+
+#ifndef DAC_SNAPSHOT_H_
+#define DAC_SNAPSHOT_H_
+
+#include <stdbool.h>  // for bool type
+#include <stdio.h>    // for FILE
+#include <time.h>     // for time_t
+
+// HIDAPI
+#include "hidapi/hidapi.h"
+
+// project libraries
+#include "dds-host/dac5687.h"
+
+#define DACSNAPSHOT_MAGIC         "DDSDACS\x01"
+#define DACSNAPSHOT_MAGIC_LEN     8
+
+// reads every register the host may read into 'map'.
+// Returns false on failure, true otherwise.
+bool DACSnapshot_Take(hid_device *handle, DAC5687RegisterMap *map);
+
+// writes 'map', taken at 'taken', to 'fileName'. Returns false on failure, true otherwise.
+bool DACSnapshot_Save(const char *fileName, const DAC5687RegisterMap *map, time_t taken);
+
+// reads a snapshot, checking its hash, and sets 'taken' if it isn't NULL.
+// Returns false on failure, true otherwise.
+bool DACSnapshot_Load(const char *fileName, DAC5687RegisterMap *map, time_t *taken);
+
+// returns true if 'fileName' starts with the snapshot magic
+bool DACSnapshot_IsSnapshot(const char *fileName);
+
+// loads the registers a snapshot, DAC profile or DAC config CSV names into 'map',
+// whichever 'fileName' turns out to be. Returns false on failure, true otherwise.
+bool DACSnapshot_LoadAny(const char *fileName, DAC5687RegisterMap *map);
+
+// writes a line to 'out' for every register in 'expected' whose value in 'actual'
+// differs or is missing, and returns how many there were
+unsigned int DACSnapshot_Diff(const DAC5687RegisterMap *expected, const DAC5687RegisterMap *actual, FILE *out);
+
+#endif  // DAC_SNAPSHOT_H_
@@ -60,8 +60,46 @@ typedef enum dac5687_reg_t {
   DACTest = 0x1C,
 } DAC5687Address;
 
+// the register file runs from 0x00 to 0x1C
+#define DAC5687_NUM_REGISTERS   0x1D
+
+// A set of register values. Bit N of 'mask' is set if 'values[N]' is meaningful.
+typedef struct dac5687_register_map_st {
+  unsigned char values[DAC5687_NUM_REGISTERS];
+  uint32_t mask;
+} DAC5687RegisterMap;
+
+// mask of every register the host may read or write (everything but 0x08 and 0x1A)
+#define DAC5687_WRITABLE_MASK   (((1UL << DAC5687_NUM_REGISTERS) - 1) & ~(1UL << 0x08) & ~(1UL << 0x1A))
+
+// the longest SPI frame: an instruction byte and 4 register bytes
+#define DAC5687_MAX_FRAME_BYTES 5
+
+// A precomputed SPI transaction: the instruction byte followed by the register bytes
+typedef struct dac5687_frame_st {
+  unsigned char len;
+  unsigned char bytes[DAC5687_MAX_FRAME_BYTES];
+} DAC5687Frame;
+
 bool DAC5687_Configure(CSVFile *file, hid_device *handle);
 
+// validates a DAC config CSV and collects it into 'map' without touching the device.
+// Later rows override earlier ones, so the map only holds each register's final value;
+// if 'repeated' is not NULL it gets the mask of registers written more than once, whose
+// intermediate writes only DAC5687_Configure applies. Returns false on failure, true otherwise.
+bool DAC5687_ParseConfig(CSVFile *file, DAC5687RegisterMap *map, uint32_t *repeated);
+
+// reads every register in 'mask' into 'map', batching consecutive registers into
+// bursts after a single bus setup. Returns false on failure, true otherwise.
+bool DAC5687_ReadRegisterMap(hid_device *handle, uint32_t mask, DAC5687RegisterMap *map);
+
+// writes every register in 'map->mask', batching consecutive registers into bursts
+// after a single bus setup. Returns false on failure, true otherwise.
+bool DAC5687_WriteRegisterMap(hid_device *handle, const DAC5687RegisterMap *map);
+
+// hashes the registers in 'map->mask' and their values
+uint64_t DAC5687_Fingerprint(const DAC5687RegisterMap *map);
+
 bool DAC5687_WriteRegister(hid_device *handle, DAC5687Address addr, unsigned char txByte);
 
 bool DAC5687_WriteRegisters(hid_device *handle, DAC5687Address startAddr, unsigned char *txBytes, unsigned int bytes);
@@ -70,6 +108,97 @@ bool DAC5687_ReadRegister(hid_device *handle, DAC5687Address addr, unsigned char
 
 bool DAC5687_ReadRegisters(hid_device *handle, DAC5687Address startAddr, unsigned char *rxBytes, unsigned int bytes);
 
+// writes 'count' consecutive registers starting at 'startAddr' using as few bursts as
+// possible. The range must not include a factory-use register.
+bool DAC5687_WriteRegisterRange(hid_device *handle, DAC5687Address startAddr, const unsigned char *txBytes, unsigned int count);
+
+// reads 'count' consecutive registers starting at 'startAddr' using as few bursts as
+// possible. The range must not include a factory-use register.
+bool DAC5687_ReadRegisterRange(hid_device *handle, DAC5687Address startAddr, unsigned char *rxBytes, unsigned int count);
+
+// fills in the frame that writes 'count' (1 to 4) registers starting at 'startAddr'
+void DAC5687_EncodeWriteFrame(DAC5687Frame *frame, unsigned int startAddr, const unsigned char *bytes, unsigned int count);
+
+// sends 'numFrames' precomputed register writes in order, setting the bus up once.
+// Frames that aren't writes or that touch a factory-use register are rejected before
+// anything is sent. Returns false on failure, true otherwise.
+bool DAC5687_WriteFrames(hid_device *handle, const DAC5687Frame *frames, unsigned int numFrames);
+
+// A host-side copy of the register file. Bit N of 'known.mask' is set once register N
+// has been read or written; bit N of 'dirty' is set while its shadow value hasn't
+// been sent to the DAC yet.
+typedef struct dac5687_shadow_st {
+  DAC5687RegisterMap known;
+  uint32_t dirty;
+} DAC5687Shadow;
+
+// empties a shadow: nothing known, nothing dirty
+void DAC5687_InitShadow(DAC5687Shadow *shadow);
+
+// reads every register in 'mask' back into the shadow with batched reads, discarding
+// any unflushed changes to them. Returns false on failure, true otherwise.
+bool DAC5687_Resync(hid_device *handle, DAC5687Shadow *shadow, uint32_t mask);
+
+// sets the bits of 'reg' selected by 'mask' to those of 'value' in the shadow only,
+// marking it dirty if that changes it. Unless 'mask' is 0xFF the register has to be
+// known. Returns false on failure, true otherwise.
+bool DAC5687_UpdateBits(DAC5687Shadow *shadow, DAC5687Address reg, unsigned char mask, unsigned char value);
+
+// sends every dirty register in as few bursts as possible, bridging gaps with known
+// clean registers where that saves a transaction, and marks them clean.
+// Returns false on failure (leaving them dirty), true otherwise.
+bool DAC5687_Flush(hid_device *handle, DAC5687Shadow *shadow);
+
+// frames a retune can take: the frequency word, the phase word and the latch
+#define DAC5687_NCO_MAX_FRAMES  3
+
+// State for retuning the NCO: the clock it runs at, what it was last told and how
+// the bus was last left
+typedef struct dac5687_nco_st {
+  // the NCO clock in Hz; tuning words are fractions of it
+  double refClockHz;
+  // if 'latch' is set, 'syncCntl' is written to SyncCntl after the tuning words so they
+  // take effect together. Take it from the DAC config in use.
+  bool latch;
+  unsigned char syncCntl;
+
+  // NCOFreq1-4 and NCOPhase0-1 as last encoded; only changed words are resent
+  DAC5687Shadow shadow;
+
+  // the bus is only set up again if something else has touched the chip settings
+  MCP2210SPITransferSettings spiSettings;
+  hid_device *busHandle;
+  unsigned long long busChipSettingsWrites;
+  unsigned long long busLinkErrors;
+} DAC5687NCO;
+
+// starts retuning an NCO clocked at 'refClockHz', without a latch. Nothing is
+// assumed about the registers, so the first retune writes every word.
+void DAC5687_InitNCO(DAC5687NCO *nco, double refClockHz);
+
+// the 32-bit frequency word for 'freqHz' (negative frequencies wrap, as in the NCO)
+uint32_t DAC5687_NCOFrequencyWord(const DAC5687NCO *nco, double freqHz);
+
+// the 16-bit phase word for 'phase' radians
+uint16_t DAC5687_NCOPhaseWord(double phase);
+
+// encodes the frames that retune the NCO to 'freqHz' and 'phase' radians into 'frames'
+// and returns how many there are. Only words that differ from the last encoded ones
+// are included, so encode and send retunes in the same order.
+unsigned int DAC5687_EncodeNCO(DAC5687NCO *nco, double freqHz, double phase, DAC5687Frame *frames);
+
+// sets the bus up for NCO writes unless it still is from the last send, so the next
+// send is just its transfers. Returns false on failure, true otherwise.
+bool DAC5687_ReadyNCO(hid_device *handle, DAC5687NCO *nco);
+
+// sends frames from DAC5687_EncodeNCO(), setting the bus up only if it has to.
+// Returns false on failure (after which every word is resent), true otherwise.
+bool DAC5687_SendNCO(hid_device *handle, DAC5687NCO *nco, const DAC5687Frame *frames, unsigned int numFrames);
+
+// retunes the NCO: DAC5687_EncodeNCO() then DAC5687_SendNCO().
+// Returns false on failure, true otherwise.
+bool DAC5687_SetNCO(hid_device *handle, DAC5687NCO *nco, double freqHz, double phase);
+
 bool DAC5687_Init(hid_device **handle);
 
 #endif  // DAC5687_H_
\ No newline at end of file
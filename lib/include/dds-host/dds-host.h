@@ -22,7 +22,242 @@
  * SOFTWARE.
  */
 
+/*
+ * This file describes dds-host's modes. dds-host.c handles the board configuration and
+ * the options every mode shares; each mode in src/modes/ owns the rest of its options,
+ * parses and checks them, and does its part of the run.
+ */
+
 #ifndef DDS_HOST_H_
 #define DDS_HOST_H_
 
+#include <stdbool.h>  // for bool type
+#include <stddef.h>   // for size_t
+#include <getopt.h>   // for struct option
+#include <time.h>     // for struct timespec
+
+// HIDAPI
+#include "hidapi/hidapi.h"
+
+// project libraries
+#include "dds-host/image.h"
+#include "dds-host/mcp2210-sim.h"
+#include "dds-host/synth.h"
+
+// most --nco frequencies one run can step through
+#define MAX_RETUNES   16
+
+// --data, --synth and how the words are placed and uploaded (src/modes/upload.c)
+typedef struct upload_options_st {
+  const char *dataFileName;
+  // upload even if the board's cache tag says it already holds the image
+  bool force;
+  // patch a range: write 'count' rows of the data starting at row 'sourceOffset' to
+  // SRAM starting at 'sramOffset'. A 'count' of 0 means the rest of the data.
+  unsigned int sramOffset;
+  unsigned int sourceOffset;
+  unsigned int count;
+  // generate the data instead of reading it: the --synth spec and everything it implies
+  const char *synthSpec;
+  SynthParams synth;
+  // checkpoint file that lets an interrupted upload resume
+  const char *journalFileName;
+  // print upload progress every this many milliseconds, then a JSON summary
+  unsigned int progressMs;
+} UploadOptions;
+
+// batch mode: run every operation in a script against one open device (src/modes/script.c)
+typedef struct script_options_st {
+  const char *scriptFileName;
+} ScriptOptions;
+
+// run everything against a simulated MCP2210 and predict how long it would take
+// (src/modes/dry-run.c)
+typedef struct dry_run_options_st {
+  bool dryRun;
+  unsigned int reportLatencyUs;
+  // drop the simulated link after this many reports, for a moment or, with
+  // 'simulateUnplug', for good
+  unsigned long long simulateDrop;
+  bool simulateUnplug;
+  // start from the simulated board saved here, and save it again after
+  const char *simStateFileName;
+} DryRunOptions;
+
+// client mode: submit jobs to a running dds-hostd instead of opening the device
+// (src/modes/client.c)
+typedef struct client_options_st {
+  const char *socketPath;
+  // register and readback jobs
+  const char *dacWrite;
+  const char *dacRead;
+  const char *sramRead;
+  bool stats;
+} ClientOptions;
+
+// compiled report streams (src/modes/replay.c)
+typedef struct replay_options_st {
+  // compile the upload into a report stream at this path and exit
+  const char *compileUploadFileName;
+  // upload by replaying this report stream instead of --data
+  const char *replayFileName;
+} ReplayOptions;
+
+// upload through the parse/encode/USB pipeline, streaming --data instead of loading it,
+// with at most 'memoryBudget' bytes of pipeline buffers (0 for the default)
+// (src/modes/pipeline.c)
+typedef struct pipeline_options_st {
+  bool pipeline;
+  size_t memoryBudget;
+} PipelineOptions;
+
+// upload the words another process writes into a shared-memory ring (src/modes/shm.c)
+typedef struct shm_options_st {
+  const char *shmName;
+} ShmOptions;
+
+// retune the NCO once the board is configured (src/modes/nco.c)
+typedef struct nco_options_st {
+  // to each of these in turn, timing each
+  unsigned int numRetunes;
+  double retuneFreqs[MAX_RETUNES];
+  double retunePhases[MAX_RETUNES];
+  double refClockHz;
+  // write this to SyncCntl after each retune to latch it
+  bool ncoLatch;
+  unsigned char ncoSyncCntl;
+  // then play this hop plan, or this sweep, and write per-step timing to 'hopLogFileName'
+  const char *hopFileName;
+  const char *sweepSpec;
+  const char *hopLogFileName;
+} NCOOptions;
+
+// last of all, snapshot the DAC registers to 'dumpFileName' and/or compare them with the
+// config, profile or snapshot 'diffFileName'. With 'fromSnapshotFileName' the registers
+// come from that snapshot instead of the board. (src/modes/snapshot.c)
+typedef struct snapshot_options_st {
+  const char *dumpFileName;
+  const char *diffFileName;
+  const char *fromSnapshotFileName;
+} SnapshotOptions;
+
+// everything we were asked to do on the command line
+typedef struct options_st {
+  const char *dacFileName;
+  const char *mcpFileName;
+  // rewrite the whole config even if the board already matches it
+  bool cold;
+  // compile --dac-config into a binary profile at this path and exit
+  const char *profileFileName;
+  // time report round trips on the attached device before anything else
+  unsigned int calibrateReports;
+  // record every HID report to this file for dds-trace
+  const char *traceFileName;
+  // run the USB I/O at SCHED_FIFO 'realtimePriority' with memory locked, pinned to
+  // 'realtimeCpu' unless that's REALTIME_NO_CPU, and report round trip jitter
+  bool realtime;
+  int realtimeCpu;
+  int realtimePriority;
+
+  UploadOptions upload;
+  ScriptOptions script;
+  DryRunOptions dryRun;
+  ClientOptions client;
+  ReplayOptions replay;
+  PipelineOptions pipeline;
+  ShmOptions shm;
+  NCOOptions nco;
+  SnapshotOptions snapshot;
+} Options;
+
+// A mode's share of the command line. dds-host gathers every mode's 'longOpts' into one
+// table, hands each option found to the mode that owns it, then checks every mode.
+typedef struct dds_host_mode_st {
+  // ends with an all-zero entry. Every 'val' is unique across the modes.
+  const struct option *longOpts;
+  // usage lines, ending with NULL
+  const char * const *usage;
+  // fills in the mode's defaults before any option is parsed
+  void (*defaults)(Options *opts);
+  // parses the option whose 'val' is 'opt'. Returns false if 'arg' is bad.
+  bool (*parseOption)(int opt, const char *arg, Options *opts);
+  // checks the mode's options against everything else on the command line.
+  // Returns false, having said why, if they don't go together.
+  bool (*check)(const Options *opts);
+} DDSHostMode;
+
+extern const DDSHostMode UploadMode;
+extern const DDSHostMode ScriptMode;
+extern const DDSHostMode DryRunMode;
+extern const DDSHostMode ClientMode;
+extern const DDSHostMode ReplayMode;
+extern const DDSHostMode PipelineMode;
+extern const DDSHostMode ShmMode;
+extern const DDSHostMode NCOMode;
+extern const DDSHostMode SnapshotMode;
+
+// nanoseconds from 'start' to 'end'
+unsigned long long DDSHost_ElapsedNs(const struct timespec *start, const struct timespec *end);
+
+// whether there's SRAM data to upload, from a file or the synthesizer
+bool UploadMode_HasData(const Options *opts);
+
+// whether there's an upload to do, of SRAM data, a compiled report stream or a ring
+bool UploadMode_HasUpload(const Options *opts);
+
+// whether the upload only covers part of the SRAM
+bool UploadMode_IsPatch(const Options *opts);
+
+// loads the rows of the data file selected by --source-offset and --count, or
+// synthesizes the --synth waveform, and checks the words fit in SRAM from --offset
+// on. Returns NULL on failure.
+SRAMImage * UploadMode_LoadData(const Options *opts);
+
+// uploads 'image' from --offset on, with live progress and a JSON summary on stdout
+// if asked for. A whole-image upload is skipped if the board's cache tag says it
+// already holds 'image', unless --force was given. If the device drops off the bus
+// it's reopened ('sim', if not NULL, stands in for it), so '*handle' may change.
+// Returns the number of words that failed to write.
+unsigned int UploadMode_Upload(hid_device **handle, const SRAMImage *image, const Options *opts, MCP2210Sim *sim);
+
+// does everything a real run would, but against a simulated MCP2210, then prints how
+// many reports each phase needed and how long they'd take at the given latency.
+// Returns EXIT_SUCCESS or EXIT_FAILURE.
+int DryRunMode_Run(const Options *opts);
+
+// submits every requested job to dds-hostd. Returns EXIT_SUCCESS or EXIT_FAILURE.
+int ClientMode_Run(const Options *opts);
+
+// uploads the --replay report stream, tagging the SRAM with it like any other upload.
+// Returns the number of words that failed to write.
+unsigned int ReplayMode_Upload(hid_device *handle, const Options *opts);
+
+// compiles the --data or --synth upload into a report stream.
+// Returns EXIT_SUCCESS or EXIT_FAILURE.
+int ReplayMode_Compile(const Options *opts);
+
+// uploads --data or --synth through the pipeline, reading the data file as it goes
+// rather than loading or even counting it first, then reports the peak RSS. The SRAM
+// is tagged as with any other upload, but there's no image up front to check the tag
+// against, so it's always written. Returns the number of words that failed to write.
+unsigned int PipelineMode_Upload(hid_device *handle, const Options *opts);
+
+// uploads the words another process writes into the --shm ring, straight out of the
+// mapping, until it says it's finished. Returns the number of words that failed to write.
+unsigned int ShmMode_Upload(hid_device *handle, const Options *opts);
+
+// whether the NCO is to be retuned, once per --nco frequency or on a hop timeline
+bool NCOMode_Requested(const Options *opts);
+
+// does every NCO retune we were asked for, in order
+bool NCOMode_Run(hid_device *handle, const Options *opts);
+
+// whether the DAC registers are to be dumped or compared once everything else is done
+bool SnapshotMode_Requested(const Options *opts);
+
+// snapshots the DAC registers (from the board, or from --from-snapshot if 'handle' is
+// NULL) and saves and/or compares them as asked. Returns false on failure or if any
+// register differs, true otherwise.
+bool SnapshotMode_Run(hid_device *handle, const Options *opts);
+
 #endif  // DDS_HOST_H_
@@ -0,0 +1,128 @@
+/*
+ * MIT License
+ * 
+ * Copyright (c) 2020 Eli Reed
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/*
+ * This file describes the device context: everything the host library needs to drive
+ * one board, kept together behind a lock so several threads of one program (or several
+ * boards at once) can share the library without clobbering each other's transfers.
+ *
+ * Each DDSDevice owns its HID handle (or simulator), a shadow of the DAC5687 registers,
+ * a lock and its own statistics. Every call takes the lock, puts the SPI and chip select
+ * settings it needs on the bus and finishes its reports before letting go, so one
+ * thread's DAC write can never land between another's SRAM settings and data. Uploads
+ * let go between chunks of PROGRESS_CHUNK_WORDS words, so a register write waiting on a
+ * long upload is delayed by one chunk rather than the whole image.
+ *
+ * What the MCP2210 layer keeps per process (the report counters, trace and jitter, see
+ * dds-host/mcp2210.h) is still shared, so traces and counters cover every device.
+ */
+
+#ifndef DEVICE_H_
+#define DEVICE_H_
+
+#include <stdbool.h>  // for bool type
+
+// HIDAPI
+#include "hidapi/hidapi.h"
+
+// project libraries
+#include "dds-host/dac5687.h"
+#include "dds-host/progress.h"
+
+typedef struct dds_device_st DDSDevice;
+
+// Everything a device context has counted since it was opened
+typedef struct dds_device_stats_st {
+  // calls that took the lock, counting each upload chunk once
+  unsigned long long operations;
+  // ...of which found it already held by another thread
+  unsigned long long contended;
+  // time spent holding the lock
+  unsigned long long busyNs;
+  // time spent waiting for it
+  unsigned long long waitNs;
+  // SRAM words written and read
+  unsigned long long wordsWritten;
+  unsigned long long wordsRead;
+  // SRAM words that failed to write
+  unsigned long long wordsFailed;
+} DDSDeviceStats;
+
+// a sequence of calls to run against 'handle' without other threads getting in between
+typedef bool (*DDSDeviceOp)(hid_device *handle, void *ctx);
+
+// opens the board whose MCP2210 has the USB serial number 'serial', or the first one
+// found if 'serial' is NULL. Returns NULL on failure.
+DDSDevice * DDSDevice_Open(const char *serial);
+
+// opens a simulated board (see dds-host/mcp2210-sim.h) answering every report after
+// 'reportLatencyUs' of virtual time. Each call makes a new, blank board, up to
+// MCP2210_MAX_TRANSPORTS at once. Returns NULL on failure.
+DDSDevice * DDSDevice_OpenSim(unsigned int reportLatencyUs);
+
+// closes the board and frees 'dev'. No other thread may still be using it.
+void DDSDevice_Close(DDSDevice *dev);
+
+// configures the DAC5687 and MCP2210 from the files named, as dds-host does.
+// Returns false on failure, true otherwise.
+bool DDSDevice_Configure(DDSDevice *dev, const char *dacFileName, const char *mcpFileName, bool cold);
+
+// writes 'count' words to SRAM starting at 'startAddr'. An upload starting at address 0
+// that fully succeeds, and that no other upload overlapped, is tagged in the EEPROM
+// like dds-host's (see dds-host/cache.h). If 'progress' isn't NULL, it's updated every
+// chunk. Returns the number of words that failed to write.
+unsigned int DDSDevice_Upload(DDSDevice *dev, unsigned int startAddr, const unsigned int *words,
+                              unsigned int count, Progress *progress);
+
+// called between upload chunks with how many words have gone out so far. Returning
+// false stops the upload there.
+typedef bool (*DDSDeviceContinue)(void *ctx, unsigned int done);
+
+// like DDSDevice_Upload(), but asks 'keepGoing' (if not NULL) before every chunk. A
+// stopped upload isn't tagged, and counts the words it never sent as failed.
+unsigned int DDSDevice_UploadUntil(DDSDevice *dev, unsigned int startAddr, const unsigned int *words,
+                                   unsigned int count, Progress *progress,
+                                   DDSDeviceContinue keepGoing, void *ctx);
+
+// reads 'count' SRAM words starting at 'startAddr' into 'words'.
+// Returns false on failure, true otherwise.
+bool DDSDevice_ReadSRAM(DDSDevice *dev, unsigned int startAddr, unsigned int *words, unsigned int count);
+
+// writes 'count' DAC5687 registers starting at 'startAddr', skipping any the device
+// context already knows hold those values. Returns false on failure, true otherwise.
+bool DDSDevice_WriteDAC(DDSDevice *dev, DAC5687Address startAddr, const unsigned char *bytes, unsigned int count);
+
+// reads 'count' DAC5687 registers starting at 'startAddr' from the chip.
+// Returns false on failure, true otherwise.
+bool DDSDevice_ReadDAC(DDSDevice *dev, DAC5687Address startAddr, unsigned char *bytes, unsigned int count);
+
+// runs 'op' with the lock held, for sequences the calls above don't cover. 'op' may
+// write anything, so the device context forgets what it knew about the board.
+// Returns what 'op' returned.
+bool DDSDevice_Run(DDSDevice *dev, DDSDeviceOp op, void *ctx);
+
+// copies the device context's counters into 'stats'
+void DDSDevice_GetStats(DDSDevice *dev, DDSDeviceStats *stats);
+
+#endif  // DEVICE_H_
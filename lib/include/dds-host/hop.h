@@ -0,0 +1,106 @@
+/*
+ * MIT License
+ * 
+ * Copyright (c) 2020 Eli Reed
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/*
+ * This file describes timed NCO hops: a plan of (time offset, frequency, phase) steps
+ * played out against the monotonic clock, with every step's SPI frames encoded before
+ * the clock starts so the timeline only ever waits and sends.
+ *
+ * A plan file has one step per line, blank lines and '#' comments aside:
+ *
+ *   <offset in us from the start>,<frequency in Hz>[,<phase in degrees>]
+ *
+ * Offsets must not decrease. A step that can't be sent on time is sent as soon as
+ * possible and the ones after it keep their planned times, so one slow step doesn't
+ * shift the rest of the timeline.
+ */
+
+#ifndef HOP_H_
+#define HOP_H_
+
+#include <stdbool.h>  // for bool type
+#include <stdio.h>    // for FILE
+
+// HIDAPI
+#include "hidapi/hidapi.h"
+
+// project libraries
+#include "dds-host/dac5687.h"
+#include "dds-host/realtime.h"
+
+typedef struct hop_step_st {
+  // when to send, from the start of the run
+  unsigned long long offsetNs;
+  double freqHz;
+  double phase;  // radians
+
+  // filled in by Hop_Encode()
+  unsigned int numFrames;
+  DAC5687Frame frames[DAC5687_NCO_MAX_FRAMES];
+
+  // filled in by Hop_Run(): how far behind plan the step started and finished sending
+  unsigned long long startLateNs;
+  unsigned long long doneLateNs;
+} HopStep;
+
+typedef struct hop_plan_st {
+  unsigned int numSteps;
+  HopStep *steps;
+} HopPlan;
+
+// what a run looked like against its plan
+typedef struct hop_stats_st {
+  unsigned int stepsSent;
+  // steps that finished sending after the next step was due
+  unsigned int overruns;
+  // lateness of each step's first frame, and of its last frame's answer
+  Jitter startLate;
+  Jitter doneLate;
+} HopStats;
+
+// reads a plan file. Returns NULL on failure.
+HopPlan * Hop_Load(const char *fileName);
+
+// makes a plan of 'numSteps' steps from 'startHz' to 'endHz' in equal frequency
+// steps, 'dwellNs' apart. Returns NULL on failure.
+HopPlan * Hop_CreateSweep(double startHz, double endHz, unsigned int numSteps, unsigned long long dwellNs);
+
+// releases a plan
+void Hop_Free(HopPlan *plan);
+
+// encodes every step's frames as 'nco' would send them in order, starting from its
+// current state, so do it after any other retunes. 'nco' itself isn't changed.
+void Hop_Encode(HopPlan *plan, const DAC5687NCO *nco);
+
+// sets the bus up and then plays the encoded plan on 'nco', stopping at the first
+// failure or once Host_RequestCancel() has been called. 'nco' ends up as the last
+// step sent left it. Returns false on failure,
+// true otherwise; either way 'stats' describes the steps that were sent.
+bool Hop_Run(hid_device *handle, DAC5687NCO *nco, HopPlan *plan, HopStats *stats);
+
+// writes one CSV line per sent step: planned offset, start and finish lateness (us)
+// and frame count
+void Hop_PrintSteps(const HopPlan *plan, const HopStats *stats, FILE *out);
+
+#endif  // HOP_H_
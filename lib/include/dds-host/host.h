@@ -0,0 +1,110 @@
+/*
+ * MIT License
+ * 
+ * Copyright (c) 2020 Eli Reed
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/*
+ * This file describes the host-level operations shared by dds-host and dds-hostd.
+ */
+
+#ifndef HOST_H_
+#define HOST_H_
+
+#include <stdbool.h>
+
+// HIDAPI
+#include "hidapi/hidapi.h"
+
+// project libraries
+#include "dds-host/image.h"
+#include "dds-host/progress.h"
+
+// configures the DAC from 'dacFileName' and applies the MCP2210 chip settings.
+// Unless 'cold' is set, the current DAC registers and chip settings are read back
+// first and only what differs from the config is written. A cold configure writes
+// every row of the config in file order. 'dacFileName' may also be a precompiled
+// profile (see dds-host/dac-profile.h), which a cold configure applies in the fewest
+// transactions. Returns false on failure, true otherwise.
+bool Host_ConfigureDevices(hid_device *handle, const char *dacFileName, const char *mcpFileName, bool cold);
+
+// writes 'count' words to consecutive SRAM addresses starting at 'startAddr'.
+// Returns the number of words that failed to write.
+unsigned int Host_WriteWords(hid_device *handle, unsigned int startAddr,
+                              const unsigned int *words, unsigned int count);
+
+// writes an entire image to SRAM starting at address 0. If 'progress' isn't NULL,
+// it's updated every PROGRESS_CHUNK_WORDS words.
+// Returns the number of words that failed to write.
+unsigned int Host_UploadImage(hid_device *handle, const SRAMImage *image, Progress *progress);
+
+// writes 'count' words to SRAM starting at 'startAddr', leaving the rest of the SRAM
+// alone. If 'progress' isn't NULL, it's updated every PROGRESS_CHUNK_WORDS words.
+// Returns the number of words that failed to write.
+unsigned int Host_UploadRange(hid_device *handle, unsigned int startAddr,
+                              const unsigned int *words, unsigned int count, Progress *progress);
+
+// words written between journal checkpoints and cancellation checks
+#define HOST_CHECKPOINT_WORDS     64
+
+// times a checkpoint's worth of words is retried before the upload gives up
+#define HOST_MAX_RETRIES          5
+
+// how long a dropped device gets to come back
+#define HOST_REOPEN_ATTEMPTS      20
+#define HOST_REOPEN_DELAY_MS      500
+
+// An upload that survives the device dropping off the bus
+typedef struct upload_job_st {
+  unsigned int startAddr;
+  const unsigned int *words;
+  unsigned int count;
+  // records progress so a later run can resume, or NULL to not journal
+  const char *journalFileName;
+  // if not NULL, reapplied (warm) after the device has been reopened
+  const char *dacFileName;
+  const char *mcpFileName;
+  // reopens the device after a drop. NULL means MCP2210_Init().
+  hid_device * (*reopen)(void *ctx);
+  void *reopenCtx;
+  // how many times to try reopening it, 0 for HOST_REOPEN_ATTEMPTS
+  unsigned int reopenAttempts;
+  // if not NULL, updated every HOST_CHECKPOINT_WORDS words
+  Progress *progress;
+} UploadJob;
+
+// writes job->count words to SRAM starting at job->startAddr, HOST_CHECKPOINT_WORDS
+// at a time. A checkpoint that fails is retried; if the MCP2210 stopped answering
+// (see MCP2210Counters.linkErrors) '*handle' is closed, reopened and reconfigured
+// first, so '*handle' may change and is NULL if the device never came back. With a
+// journal, confirmed words are recorded as they go and a later call with the same
+// journal and words skips them. Stops early, cancelling the SPI transfer, once
+// Host_RequestCancel() has been called. Returns the number of words not written.
+unsigned int Host_UploadResumable(hid_device **handle, const UploadJob *job);
+
+// asks a running Host_UploadResumable() to stop at its next checkpoint.
+// Safe to call from a signal handler.
+void Host_RequestCancel(void);
+
+// returns true if Host_RequestCancel() has been called
+bool Host_CancelRequested(void);
+
+#endif  // HOST_H_
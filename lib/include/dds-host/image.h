@@ -0,0 +1,76 @@
+/*
+ * MIT License
+ * 
+ * Copyright (c) 2020 Eli Reed
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef IMAGE_H_
+#define IMAGE_H_
+
+#include <stdbool.h>
+
+#include "dds-host/util/csv.h"
+
+// An SRAM image: the 32-bit words destined for consecutive SRAM addresses
+typedef struct sram_image_st {
+  unsigned int *words;
+  unsigned int numWords;
+} SRAMImage;
+
+// reads an image out of an open data CSV. the CSV may be N x 1 (4 bytes per
+// column), N x 2 (2 bytes per column) or N x 4 (1 byte per column). Returns
+// NULL on failure.
+SRAMImage * Image_FromCSV(CSVFile *file);
+
+// reads 'count' rows starting at row 'firstRow' (counting from 0) out of an open
+// data CSV, in a single pass over the file. Returns NULL on failure.
+SRAMImage * Image_FromCSVRange(CSVFile *file, unsigned long long firstRow, unsigned int count);
+
+// opens and reads the data CSV at 'fileName'. Returns NULL on failure.
+SRAMImage * Image_Load(const char *fileName);
+
+// opens the data CSV at 'fileName' and reads 'count' rows from row 'firstRow'
+// (counting from 0). A 'count' of 0 reads to the end. Returns NULL on failure.
+SRAMImage * Image_LoadRange(const char *fileName, unsigned long long firstRow, unsigned int count);
+
+// Reads a data CSV a few rows at a time, for uploads that never hold the whole image.
+// The file is read once, front to back, and its rows are never counted up front.
+typedef struct image_reader_st ImageReader;
+
+// opens the data CSV at 'fileName' to read 'count' rows from row 'firstRow' (counting
+// from 0). A 'count' of 0 reads to the end of the file, ignoring trailing blank lines.
+// Returns NULL on failure.
+ImageReader * Image_OpenReader(const char *fileName, unsigned long long firstRow, unsigned int count);
+
+// parses up to 'max' more rows into 'words' and sets 'got' to how many; 0 means the
+// range is done. Returns false on failure, true otherwise.
+bool Image_Read(ImageReader *reader, unsigned int *words, unsigned int max, unsigned int *got);
+
+// returns how many rows the reader's range covers, or 0 if it runs to the end of the file
+unsigned int Image_ReaderRows(const ImageReader *reader);
+
+// closes a reader
+void Image_CloseReader(ImageReader *reader);
+
+// releases resources associated with an image
+void Image_Free(SRAMImage *image);
+
+#endif  // IMAGE_H_
@@ -0,0 +1,120 @@
+/*
+ * MIT License
+ * 
+ * Copyright (c) 2020 Eli Reed
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/*
+ * This file describes the binary protocol spoken between dds-host and dds-hostd
+ * over a UNIX-domain stream socket.
+ *
+ * Every message is a 16-byte little-endian header followed by 'payloadLen' bytes:
+ *
+ *   bytes 0-1   magic (0xDD5A)
+ *   byte  2     operation (IPCOp)
+ *   byte  3     status: 0x00 on success in replies, 0 in requests
+ *   bytes 4-7   arg0
+ *   bytes 8-11  arg1
+ *   bytes 12-15 payloadLen
+ *
+ * The daemon answers every request with exactly one reply carrying the same operation.
+ */
+
+#ifndef IPC_H_
+#define IPC_H_
+
+#include <stdint.h>   // for fixed-width integer types
+#include <stdbool.h>  // for bool type
+
+// project libraries
+#include "dds-host/cpld.h"
+
+#define IPC_MAGIC                   0xDD5A
+
+#define IPC_HEADER_LEN              16
+
+// an upload of the whole SRAM is the largest payload we ever carry
+#define IPC_MAX_PAYLOAD             ((SRAM_MAX_ADDRESS + 1) * SRAM_DATA_SIZE)
+
+#define IPC_DEFAULT_SOCKET          "/tmp/dds-hostd.sock"
+
+// the daemon's socket is only open to its owner and group
+#define IPC_SOCKET_MODE             0660
+
+// reply status codes
+#define IPC_OK                      0x00
+#define IPC_FAILED                  0x01
+#define IPC_BAD_REQUEST             0x02
+
+// All jobs understood by dds-hostd
+typedef enum ipc_op_t {
+  // no-op, used to check the daemon is alive
+  IPCPing = 0x01,
+  // arg0 = start address, payload = 32-bit words. reply arg0 = failed words
+  IPCUpload = 0x02,
+  // arg0 = start address, arg1 = word count. reply payload = 32-bit words
+  IPCReadSRAM = 0x03,
+  // arg0 = start register, payload = 1-4 register bytes
+  IPCWriteDAC = 0x04,
+  // arg0 = start register, arg1 = register count (1-4). reply payload = register bytes
+  IPCReadDAC = 0x05,
+  // reply payload = 32-bit words: jobs, mean and max queueing delay (us) and
+  // preemptions for the control class, then the same for the bulk class
+  IPCStats = 0x06,
+  // arg0 = start address, payload = shared-memory ring name (see shm-ring.h).
+  // reply arg0 = failed words, arg1 = words uploaded
+  IPCUploadShm = 0x07,
+} IPCOp;
+
+typedef struct ipc_header_st {
+  uint16_t magic;
+  uint8_t op;
+  uint8_t status;
+  uint32_t arg0;
+  uint32_t arg1;
+  uint32_t payloadLen;
+} IPCHeader;
+
+// creates, binds and listens on a UNIX socket at 'path', readable and writable by
+// its owner and group only. Fails if another daemon is still answering at 'path';
+// a socket file nobody answers on is replaced. Returns the listening fd, or -1 on
+// failure.
+int IPC_Listen(const char *path);
+
+// connects to the daemon listening at 'path'. Returns the fd, or -1 on failure.
+int IPC_Connect(const char *path);
+
+// sends a header and its payload. Returns false on failure, true otherwise.
+bool IPC_Send(int fd, const IPCHeader *header, const void *payload);
+
+// receives a header and, if it has one, its payload into a newly allocated buffer
+// placed in '*payload' (the caller frees it). Returns false on failure or EOF.
+bool IPC_Receive(int fd, IPCHeader *header, uint8_t **payload);
+
+// sends a request and waits for its reply. Returns false on failure, true otherwise.
+bool IPC_Transact(int fd, const IPCHeader *request, const void *payload,
+                  IPCHeader *reply, uint8_t **replyPayload);
+
+// packs/unpacks 32-bit words to/from the little-endian wire format
+void IPC_PackWords(uint8_t *out, const unsigned int *words, unsigned int count);
+void IPC_UnpackWords(unsigned int *out, const uint8_t *in, unsigned int count);
+
+#endif  // IPC_H_
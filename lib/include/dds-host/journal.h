@@ -0,0 +1,61 @@
+/*
+ * MIT License
+ * 
+ * Copyright (c) 2020 Eli Reed
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/*
+ * This file describes the upload journal: a small file on the host recording which
+ * image an upload is writing and how many of its words the board has confirmed, so an
+ * interrupted upload can pick up where it left off instead of starting over.
+ *
+ * The journal is a single line of text, rewritten in place at every checkpoint:
+ *
+ *   ddsjournal 1 <start addr, hex> <words> <FNV-1a 64 hash, hex> <words confirmed>
+ *
+ * The image is identified the same way the EEPROM cache tag identifies it (see
+ * dds-host/cache.h), so a journal left by a different image is simply ignored.
+ */
+
+#ifndef JOURNAL_H_
+#define JOURNAL_H_
+
+#include <stdbool.h>  // for bool type
+
+// project libraries
+#include "dds-host/cache.h"
+
+typedef struct journal_st Journal;
+
+// opens the journal at 'fileName' for the image described by 'tag', creating it if
+// it doesn't exist. 'done' is set to the number of words a previous run confirmed,
+// or 0 if the journal was for another image. Returns NULL on failure.
+Journal * Journal_Open(const char *fileName, const ImageTag *tag, unsigned int *done);
+
+// records that the first 'done' words of the image have been written.
+// Returns false on failure, true otherwise.
+bool Journal_Checkpoint(Journal *journal, unsigned int done);
+
+// closes the journal. If 'finished' is set the upload is complete and the file is
+// removed; otherwise it's left for the next run to resume from.
+void Journal_Close(Journal *journal, bool finished);
+
+#endif  // JOURNAL_H_
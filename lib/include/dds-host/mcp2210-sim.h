@@ -0,0 +1,114 @@
+/*
+ * MIT License
+ * 
+ * Copyright (c) 2020 Eli Reed
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/*
+ * This file describes a software stand-in for the MCP2210 and everything on its SPI bus.
+ *
+ * The simulator answers the command set used by mcp2210.c from its own copy of the
+ * chip's settings, GPIO, EEPROM and NVRAM, and routes SPI data transfers to models of
+ * the CPLD's SRAM (CS_MEM on GP1) and the DAC5687's register file (CS_DAC on GP0).
+ *
+ * Time is modelled rather than measured: every report advances a virtual clock by the
+ * configured per-report latency, and an SPI transfer finishes once its chip-select
+ * delays and bits have been clocked out at the configured bit rate. Until then, data
+ * transfer reports are answered "started, no data yet" and the host has to poll again.
+ * Optionally the simulator also sleeps for the latency so it can stand in for the real
+ * device in wall-clock benchmarks.
+ */
+
+#ifndef MCP2210_SIM_H_
+#define MCP2210_SIM_H_
+
+#include <stdbool.h>  // for bool type
+#include <stdint.h>   // for fixed-width integer types
+
+// HIDAPI
+#include "hidapi/hidapi.h"
+
+// project libraries
+#include "dds-host/mcp2210.h"
+
+// one 1 ms full-speed interrupt frame out, one back
+#define MCP2210SIM_DEFAULT_LATENCY_US   2000
+
+// Everything the simulator has counted since it was created
+typedef struct mcp2210_sim_stats_st {
+  // report pairs of every kind
+  unsigned long long reports;
+  // get/set SPI, chip and NVRAM settings reports
+  unsigned long long settingsReports;
+  // SpiDataTransfer reports, including polls
+  unsigned long long spiReports;
+  // SpiDataTransfer reports answered before the transfer finished
+  unsigned long long busyPolls;
+  // data bytes clocked out on the SPI bus
+  unsigned long long spiBytes;
+  // completed SPI transactions
+  unsigned long long spiTransactions;
+  // time on the virtual clock
+  unsigned long long elapsedNs;
+} MCP2210SimStats;
+
+typedef struct mcp2210_sim_st MCP2210Sim;
+
+// creates a simulated MCP2210 with blank SRAM, DAC registers and EEPROM.
+// Returns NULL on failure.
+MCP2210Sim * MCP2210Sim_Create(unsigned int reportLatencyUs);
+
+// releases a simulator. Its handle must already be closed.
+void MCP2210Sim_Destroy(MCP2210Sim *sim);
+
+// routes the mcp2210.c interface to the simulator and returns the handle to use with
+// it (close it with MCP2210_Close() as usual). Returns NULL on failure.
+hid_device * MCP2210Sim_Open(MCP2210Sim *sim);
+
+// makes the link drop once 'reports' more reports have been answered: every report
+// after that fails, as if the device had been unplugged, until MCP2210Sim_Open() is
+// called again. The SRAM and DAC models keep their contents.
+void MCP2210Sim_DropLinkAfter(MCP2210Sim *sim, unsigned long long reports);
+
+// if 'realtime' is set, every report also sleeps for the per-report latency
+void MCP2210Sim_SetRealtime(MCP2210Sim *sim, bool realtime);
+
+// answers a single 64-byte report. Usable directly as an MCP2210Transport.
+int MCP2210Sim_Transact(void *sim, const uint8_t *txBuf, uint8_t *rxBuf);
+
+// copies the simulator's counters into 'stats'
+void MCP2210Sim_GetStats(const MCP2210Sim *sim, MCP2210SimStats *stats);
+
+// saves what the board keeps while it stays powered (SRAM, DAC registers, EEPROM and
+// NVRAM) to 'fileName', so a later run can pick up the same board.
+// Returns false on failure, true otherwise.
+bool MCP2210Sim_SaveState(const MCP2210Sim *sim, const char *fileName);
+
+// replaces the board's SRAM, DAC registers, EEPROM and NVRAM with those saved in
+// 'fileName'. Returns false (leaving the board alone) on failure, true otherwise.
+bool MCP2210Sim_LoadState(MCP2210Sim *sim, const char *fileName);
+
+// direct access to the device models
+unsigned int * MCP2210Sim_SRAM(MCP2210Sim *sim);
+unsigned char * MCP2210Sim_DACRegisters(MCP2210Sim *sim);
+unsigned char * MCP2210Sim_EEPROM(MCP2210Sim *sim);
+
+#endif  // MCP2210_SIM_H_
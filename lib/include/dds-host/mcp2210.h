@@ -38,6 +38,12 @@
 #define VID                         0x04D8
 #define PID                         0x00DE
 
+// the MCP2210 USB serial number is at most 20 characters (its USB string descriptor)
+#define MCP2210_MAX_SERIAL_LEN      20
+
+// how many handles MCP2210_SetTransport() can reroute at once
+#define MCP2210_MAX_TRANSPORTS      16
+
 // MCP2210 Access Control modes
 #define UNPROTECTED                 0x00
 #define PROTECTED                   0x40
@@ -155,13 +161,64 @@ typedef struct mcp2210_spi_transfer_settings_st {
   uint8_t SPIMode;
 } MCP2210SPITransferSettings;
 
+// A replacement for the hidapi round trip: sends the 64-byte report in 'txBuf' and
+// places the 64-byte reply in 'rxBuf'. Returns a negative value on failure.
+typedef int (*MCP2210Transport)(void *ctx, const uint8_t *txBuf, uint8_t *rxBuf);
+
+// Routes every report for 'handle' through 'transport' instead of hidapi, for up to
+// MCP2210_MAX_TRANSPORTS handles at once; passing a NULL transport removes the route.
+// 'handle' only needs to be a unique non-NULL pointer.
+// Returns false if there's no room for another route, true otherwise.
+bool MCP2210_SetTransport(hid_device *handle, MCP2210Transport transport, void *ctx);
+
+// Running totals across every handle, safe to read from any thread
+typedef struct mcp2210_counters_st {
+  // report round trips, including ones that failed
+  unsigned long long reports;
+  // SPI data reports resent because the chip was busy (0xF8)
+  unsigned long long busyRetries;
+  // reports that couldn't be sent or answered at all, e.g. because the device
+  // dropped off the bus. A change means the handle should be reopened.
+  unsigned long long linkErrors;
+  // writes to the current (not power-up) chip settings. Chip selects only move
+  // when these are written, so an unchanged count means the bus hasn't moved.
+  unsigned long long chipSettingsWrites;
+} MCP2210Counters;
+
+// copies the running report counters into 'counters'
+void MCP2210_GetCounters(MCP2210Counters *counters);
+
+// Records every report round trip to 'trace' (a TraceFile, see dds-host/trace.h)
+// until called again with NULL. The caller still owns 'trace'.
+struct trace_file_st;
+void MCP2210_SetTrace(struct trace_file_st *trace);
+
+// Adds the time of every report round trip to 'jitter' (a Jitter, see
+// dds-host/realtime.h) until called again with NULL. The caller still owns 'jitter'.
+struct jitter_st;
+void MCP2210_SetJitter(struct jitter_st *jitter);
+
 // Initializes the MCP2210. Places a hid_device handle in 'out'.
 // Returns false on failure, true otherwise.
 hid_device * MCP2210_Init();
 
-// Releases the MCP2210 and associated memory.
+// Like MCP2210_Init(), but opens the MCP2210 whose USB serial number is 'serial'
+// (the first one found if 'serial' is NULL), for hosts with several boards attached.
+// Returns NULL on failure.
+hid_device * MCP2210_Open(const char *serial);
+
+// Releases the MCP2210 and associated memory. HIDAPI itself is released along with
+// the last handle still open, so any thread may close its board while others keep theirs.
 void MCP2210_Close(hid_device *handle);
 
+// sends the prebuilt 64-byte report 'txBuf' and places the reply in 'rxBuf', counted,
+// traced and timed like any other report. Returns -1 on failure, otherwise the status
+// byte of the reply.
+int MCP2210_Transact(hid_device *handle, const uint8_t *txBuf, uint8_t *rxBuf);
+
+// fills in the 64-byte report MCP2210_WriteSpiSettings() would send
+void MCP2210_EncodeSpiSettings(uint8_t *report, const MCP2210SPITransferSettings *newSettings, bool vm);
+
 // updates spi transfer settings. if 'vm' is false, updates NVRAM settings.
 // otherwise, updates ram settings. Returns false if write fails, true otherwise.
 int MCP2210_WriteSpiSettings(hid_device *handle, const MCP2210SPITransferSettings *newSettings, bool vm);
@@ -208,7 +265,7 @@ int MCP2210_WriteGPIODirections(hid_device *handle, uint16_t newGPIODirections);
 int MCP2210_ReadGPIODirections(hid_device *handle, uint16_t *currentGPIODirections);
 
 // writes to an MCP2210 EEPROM location. returns false if the write fails, true otherwise.
-int MCP2210_WriteEERPOM(hid_device *handle, unsigned char addr, unsigned char byte);
+int MCP2210_WriteEEPROM(hid_device *handle, unsigned char addr, unsigned char byte);
 
 // reads from an MCP2210 EEPROM location. returns false if the read fails, true otherwise. 
 int MCP2210_ReadEEPROM(hid_device *handle, unsigned char addr, unsigned char *byte);
@@ -0,0 +1,105 @@
+/*
+ * MIT License
+ * 
+ * Copyright (c) 2020 Eli Reed
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/*
+ * This file describes the pipelined uploader: an SRAM upload split into three stages,
+ * each on its own thread, so parsing and packet encoding overlap the USB round trips
+ * instead of taking turns with them.
+ *
+ *   parse    pulls words from a PipelineRead source (e.g. an ImageReader) and hashes them
+ *   encode   turns each word into the report that writes it (see ReportStream_EncodeWord())
+ *   usb      sends the reports, on the calling thread, after sending the SPI settings
+ *            once for the whole upload
+ *
+ * The stages are joined by single-producer single-consumer rings of PIPELINE_RING_SLOTS
+ * preallocated batches, synchronised with nothing but acquire/release indices. A stage
+ * that finds its output ring full waits for the next one to catch up, so a slow bus
+ * holds back the parser instead of letting it read ahead without bound. The rings are
+ * all the pipeline buffers, so a memory budget is met by shrinking the batches.
+ */
+
+#ifndef PIPELINE_H_
+#define PIPELINE_H_
+
+#include <stdio.h>    // for FILE
+#include <stdbool.h>  // for bool type
+#include <stddef.h>   // for size_t
+#include <stdint.h>   // for fixed-width integer types
+
+// HIDAPI
+#include "hidapi/hidapi.h"
+
+// project libraries
+#include "dds-host/cache.h"
+#include "dds-host/progress.h"
+
+// words per batch handed between stages when there's no memory budget
+#define PIPELINE_BATCH_WORDS    64
+// largest batch a memory budget can buy; bigger ones only add latency
+#define PIPELINE_MAX_BATCH_WORDS  4096
+// batches per ring, a power of two
+#define PIPELINE_RING_SLOTS     8
+
+// fills 'words' with up to 'max' more words and sets 'got' to how many; 0 means the
+// source is done. Returns false on failure, true otherwise.
+typedef bool (*PipelineRead)(void *ctx, unsigned int *words, unsigned int max, unsigned int *got);
+
+typedef struct pipeline_stage_stats_st {
+  unsigned long long batches;
+  unsigned long long words;
+  // time spent working
+  uint64_t busyNs;
+  // time spent waiting for the previous stage to hand over a batch
+  uint64_t starvedNs;
+  // time spent waiting for the next stage to free a slot
+  uint64_t blockedNs;
+} PipelineStageStats;
+
+typedef struct pipeline_stats_st {
+  uint64_t elapsedNs;
+  PipelineStageStats parse;
+  PipelineStageStats encode;
+  PipelineStageStats usb;
+  unsigned int failed;
+  // the cache tag of everything the source produced
+  ImageTag tag;
+  // how the buffers were sized
+  unsigned int batchWords;
+  size_t bufferBytes;
+} PipelineStats;
+
+// returns the bytes of ring buffers batches of 'batchWords' words take
+size_t Pipeline_BufferBytes(unsigned int batchWords);
+
+// writes the words from 'read' to consecutive SRAM addresses from 'startAddr', adding
+// each batch to 'progress' if it isn't NULL, and fills in 'stats'. The ring buffers are
+// kept within 'memoryBudget' bytes, or sized for PIPELINE_BATCH_WORDS if it's 0.
+// Returns false if the upload didn't finish or any word failed, true otherwise.
+bool Pipeline_Upload(hid_device *handle, unsigned int startAddr, PipelineRead read, void *ctx,
+                     size_t memoryBudget, Progress *progress, PipelineStats *stats);
+
+// prints how busy each stage was and where the time went
+void Pipeline_PrintStats(const PipelineStats *stats, FILE *out);
+
+#endif  // PIPELINE_H_
@@ -0,0 +1,57 @@
+/*
+ * MIT License
+ * 
+ * Copyright (c) 2020 Eli Reed
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/*
+ * This file describes live progress reporting for long SRAM uploads.
+ *
+ * Writers call Progress_Add() once per chunk of words, never per word. A separate
+ * thread wakes up at a fixed interval and prints words written, words and HID
+ * reports per second, an ETA and error/retry counts to stderr, so the upload loop
+ * itself never waits on the terminal. Progress_Finish() prints a one-line JSON
+ * summary for scripts and CI to pick up.
+ */
+
+#ifndef PROGRESS_H_
+#define PROGRESS_H_
+
+#include <stdio.h>  // for FILE
+
+#define PROGRESS_DEFAULT_INTERVAL_MS    1000
+
+// how many words uploads write between progress updates
+#define PROGRESS_CHUNK_WORDS            256
+
+typedef struct progress_st Progress;
+
+// starts reporting on an upload of 'totalWords' words every 'intervalMs' milliseconds.
+// A 'totalWords' of 0 means the size isn't known. Returns NULL on failure.
+Progress * Progress_Start(unsigned int totalWords, unsigned int intervalMs);
+
+// records that 'words' more words were written, 'failed' of which failed
+void Progress_Add(Progress *progress, unsigned int words, unsigned int failed);
+
+// stops the reporting thread, writes the JSON summary to 'summary' and frees 'progress'
+void Progress_Finish(Progress *progress, FILE *summary);
+
+#endif  // PROGRESS_H_
@@ -0,0 +1,87 @@
+/*
+ * MIT License
+ * 
+ * Copyright (c) 2020 Eli Reed
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/*
+ * This file describes the opt-in real-time mode for the thread that talks to the
+ * MCP2210, and the report round trip jitter histogram it's judged by.
+ *
+ * Real time here means the usual Linux recipe: every page of the process locked in
+ * RAM so the I/O loop never takes a page fault, SCHED_FIFO so ordinary work on the
+ * host can't preempt it, and optionally a dedicated core. All of it needs root or
+ * CAP_SYS_NICE/CAP_IPC_LOCK.
+ */
+
+#ifndef REALTIME_H_
+#define REALTIME_H_
+
+#include <stdbool.h>  // for bool type
+#include <stdio.h>    // for FILE
+#include <pthread.h>  // for pthread_t
+
+// SCHED_FIFO priority used unless told otherwise: above the kernel's default
+// threaded IRQ handlers (50) would starve the USB controller, so stay just below
+#define REALTIME_DEFAULT_PRIORITY   49
+
+// don't pin the thread to a core
+#define REALTIME_NO_CPU             -1
+
+// round trips are bucketed by the microsecond up to this many; slower ones all land
+// in the last bucket, though the maximum is still exact
+#define JITTER_BUCKETS              4096
+
+// A histogram of durations, such as report round trips. Lives in static or
+// preallocated memory so recording never allocates.
+typedef struct jitter_st {
+  unsigned long long count;
+  unsigned long long totalNs;
+  unsigned long long minNs;
+  unsigned long long maxNs;
+  // sum of squared round trips in us^2, for the standard deviation
+  double sumSquaresUs;
+  unsigned long long buckets[JITTER_BUCKETS];
+} Jitter;
+
+// locks every current and future page of the process in RAM.
+// Returns false on failure, true otherwise.
+bool Realtime_LockMemory(void);
+
+// gives 'thread' SCHED_FIFO 'priority' and, unless 'cpu' is REALTIME_NO_CPU, pins it to
+// 'cpu'. Threads it creates afterwards inherit both. Returns false on failure, true otherwise.
+bool Realtime_SetThread(pthread_t thread, int cpu, int priority);
+
+// puts the calling thread back to normal time-sharing on any core if it inherited
+// SCHED_FIFO, e.g. a housekeeping thread started by a real-time one
+void Realtime_ResetThread(void);
+
+// empties 'jitter', touching all of it so it's resident before the hot path needs it
+void Jitter_Reset(Jitter *jitter);
+
+// adds one duration of 'ns' nanoseconds
+void Jitter_Record(Jitter *jitter, unsigned long long ns);
+
+// prints the count, min, mean, percentiles, max and standard deviation, each line
+// prefixed with 'label'
+void Jitter_Print(const Jitter *jitter, const char *label, FILE *out);
+
+#endif  // REALTIME_H_
@@ -0,0 +1,110 @@
+/*
+ * MIT License
+ * 
+ * Copyright (c) 2020 Eli Reed
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/*
+ * This file describes compiled uploads: an SRAM upload turned ahead of time into the
+ * exact 64-byte MCP2210 reports that perform it, so uploading it again is nothing but
+ * sending reports. There's no CSV to parse, no packets to encode and no settings to
+ * build; only busy replies and SPI engine polls are handled on the way.
+ *
+ * A report stream is stored as (integers little-endian):
+ *
+ *   bytes 0-7      REPORTSTREAM_MAGIC, the last byte being the version
+ *   bytes 8-11     SRAM start address
+ *   bytes 12-15    number of words
+ *   bytes 16-23    FNV-1a 64 hash of the words, as in the cache tag
+ *   bytes 24-31    FNV-1a 64 hash of the reports
+ *   bytes 32-39    FNV-1a 64 hash of bytes 0-31
+ *   then the SPI settings write, MCP2210_REPORT_LEN bytes
+ *   then for each word, the SpiDataTransfer report carrying its SRAM packet
+ *
+ * The settings report is built for SPI mode 0. Before replaying, the bus is set up
+ * for the SRAM as usual and the stream is refused if the board's settings don't
+ * produce the same settings report. The settings are sent once, and every word after
+ * them is a single report.
+ */
+
+#ifndef REPORT_STREAM_H_
+#define REPORT_STREAM_H_
+
+#include <stdbool.h>  // for bool type
+#include <stdint.h>   // for fixed-width integer types
+#include <stddef.h>   // for size_t
+
+// HIDAPI
+#include "hidapi/hidapi.h"
+
+// project libraries
+#include "dds-host/cache.h"
+#include "dds-host/mcp2210.h"
+#include "dds-host/progress.h"
+
+#define REPORTSTREAM_MAGIC            "DDSRPTS\x02"
+#define REPORTSTREAM_MAGIC_LEN        8
+#define REPORTSTREAM_HEADER_LEN       40
+#define REPORTSTREAM_REPORTS_PER_WORD 1
+#define REPORTSTREAM_WORD_LEN         (REPORTSTREAM_REPORTS_PER_WORD * MCP2210_REPORT_LEN)
+
+typedef struct report_stream_st {
+  // where the words go and what they hash to
+  ImageTag tag;
+  // the settings report, then REPORTSTREAM_REPORTS_PER_WORD * tag.numWords reports,
+  // mapped from the file
+  const uint8_t *settings;
+  const uint8_t *reports;
+  void *mapping;
+  size_t mappingLen;
+} ReportStream;
+
+// fills in the settings report that goes before the words, for a board in 'spiMode'
+void ReportStream_SettingsReport(uint8_t *report, uint8_t spiMode);
+
+// fills in the REPORTSTREAM_WORD_LEN bytes of reports that write 'word' to SRAM
+// address 'addr'
+void ReportStream_EncodeWord(uint8_t *reports, unsigned int addr, unsigned int word);
+
+// sends the settings report from ReportStream_SettingsReport(), which every word sent
+// after it relies on. Returns false on failure, true otherwise.
+bool ReportStream_SendSettings(hid_device *handle, const uint8_t *settings);
+
+// sends one word's reports from ReportStream_EncodeWord() on a bus already set up for
+// the SRAM and sent the settings. Returns false on failure, true otherwise.
+bool ReportStream_SendWord(hid_device *handle, const uint8_t *reports);
+
+// compiles writing 'count' words to SRAM from 'startAddr' into a report stream at
+// 'fileName'. Returns false on failure, true otherwise.
+bool ReportStream_Compile(const char *fileName, unsigned int startAddr, const unsigned int *words, unsigned int count);
+
+// maps a report stream and checks its hashes. Returns NULL on failure.
+ReportStream * ReportStream_Open(const char *fileName);
+
+// sets the bus up for the SRAM and sends every report in 'stream', adding each word to
+// 'progress' if it isn't NULL. Stops early once Host_RequestCancel() has been called.
+// Returns the number of words not written.
+unsigned int ReportStream_Replay(hid_device *handle, const ReportStream *stream, Progress *progress);
+
+// unmaps and releases a report stream
+void ReportStream_Close(ReportStream *stream);
+
+#endif  // REPORT_STREAM_H_
@@ -0,0 +1,109 @@
+/*
+ * MIT License
+ * 
+ * Copyright (c) 2020 Eli Reed
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/*
+ * This file describes a transfer scheduler that owns a hid_device and runs jobs
+ * against it on a single worker thread.
+ *
+ * Jobs belong to one of two priority classes. Control jobs (DAC register reads and
+ * writes) always run before bulk jobs (SRAM uploads and readbacks). Bulk jobs run in
+ * slices of at most 'sliceRecords' SRAM records, and the scheduler checks for queued
+ * control jobs between slices. A control job therefore waits at most one slice.
+ */
+
+#ifndef SCHEDULER_H_
+#define SCHEDULER_H_
+
+#include <stdbool.h>  // for bool type
+#include <time.h>     // for struct timespec
+
+// HIDAPI
+#include "hidapi/hidapi.h"
+
+// default number of SRAM records a bulk job may write before it can be preempted
+#define SCHEDULER_DEFAULT_SLICE     16
+
+// Job priority classes, highest priority first
+typedef enum transfer_class_t {
+  ControlClass = 0,
+  BulkClass = 1,
+} TransferClass;
+
+#define NUM_TRANSFER_CLASSES        2
+
+typedef struct transfer_job_st TransferJob;
+
+// A unit of work submitted to the scheduler.
+struct transfer_job_st {
+  TransferClass cls;
+
+  // performs the next slice of the job, touching at most 'maxRecords' SRAM records.
+  // Sets '*done' once the job has nothing left to do. Returns false on failure,
+  // which also ends the job.
+  bool (*step)(hid_device *handle, void *arg, unsigned int maxRecords, bool *done);
+  void *arg;
+
+  // filled in by the scheduler
+  bool ok;
+  bool finished;
+  bool started;
+  struct timespec submitted;
+  TransferJob *next;
+};
+
+// Per-class queueing statistics
+typedef struct scheduler_stats_st {
+  // jobs that have started running
+  unsigned long long jobs;
+  // time between submission and the first slice, summed over all jobs
+  unsigned long long totalQueueNs;
+  unsigned long long maxQueueNs;
+  // bulk only: times a control job ran in the middle of a bulk job
+  unsigned long long preemptions;
+} SchedulerStats;
+
+typedef struct scheduler_st Scheduler;
+
+// starts a scheduler and its worker thread. Returns NULL on failure.
+Scheduler * Scheduler_Create(hid_device *handle, unsigned int sliceRecords);
+
+// runs the worker thread, the only one that touches the device, at SCHED_FIFO
+// 'priority', pinned to 'cpu' unless that's REALTIME_NO_CPU (see dds-host/realtime.h).
+// Returns false on failure, true otherwise.
+bool Scheduler_SetRealtime(Scheduler *sched, int cpu, int priority);
+
+// submits a job and blocks until it finishes. Returns the job's result.
+bool Scheduler_Run(Scheduler *sched, TransferJob *job);
+
+// copies the statistics for a priority class into 'stats'
+void Scheduler_GetStats(Scheduler *sched, TransferClass cls, SchedulerStats *stats);
+
+// stops the worker thread once the running slice finishes. Queued jobs, and any
+// submitted afterwards, fail. Safe to call while other threads are in Scheduler_Run().
+void Scheduler_Stop(Scheduler *sched);
+
+// stops the scheduler and releases it. No other thread may be using it.
+void Scheduler_Destroy(Scheduler *sched);
+
+#endif  // SCHEDULER_H_
@@ -0,0 +1,52 @@
+/*
+ * MIT License
+ * 
+ * Copyright (c) 2020 Eli Reed
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/*
+ * This file describes dds-host's batch script mode. A script is a text file with one
+ * operation per line; blank lines and anything after a '#' are ignored.
+ *
+ *   dac-write <reg> <byte> [<byte> ...]   write consecutive DAC registers
+ *   dac-read <reg> [<count>]              print consecutive DAC registers
+ *   load <data file> [<addr>]             write a data CSV to SRAM starting at <addr>
+ *   verify <data file> [<addr>]           read SRAM back and compare it with a data CSV
+ *   gpio <value>                          set the MCP2210 GPIO pin values
+ *   sleep <ms>                            wait
+ *
+ * Registers, bytes, addresses and GPIO values are base-16; counts and times are base-10.
+ * The whole script (including every data file) is parsed before the device is touched.
+ */
+
+#ifndef SCRIPT_H_
+#define SCRIPT_H_
+
+#include <stdbool.h>
+
+// HIDAPI
+#include "hidapi/hidapi.h"
+
+// runs every operation in the script at 'fileName' against an open device.
+// Stops at the first failing operation. Returns false on failure, true otherwise.
+bool Script_Run(hid_device *handle, const char *fileName);
+
+#endif  // SCRIPT_H_
@@ -0,0 +1,98 @@
+/*
+ * MIT License
+ * 
+ * Copyright (c) 2020 Eli Reed
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/*
+ * This file describes the shared-memory waveform ring: a POSIX shared memory object
+ * (or any mappable file, such as a memfd's /proc/<pid>/fd/<n>) through which another
+ * process hands SRAM words straight to dds-host or dds-hostd, with no CSV in between.
+ *
+ * The object is laid out as follows, in the machine's own byte order since both ends
+ * run on it:
+ *
+ *   bytes 0-7       SHMRING_MAGIC, the last byte being the version
+ *   bytes 8-11      capacity: how many words the ring holds, a power of two
+ *   bytes 12-15     flags: SHMRING_FINISHED once the producer has written its last word
+ *   bytes 64-71     head: words written so far
+ *   bytes 128-135   tail: words read so far
+ *   bytes 192-      the ring: word i lives at index i % capacity
+ *
+ * The producer writes words at head, never more than capacity ahead of tail, then
+ * publishes them by storing the new head with release semantics; it sets
+ * SHMRING_FINISHED after its last head store. The consumer loads head with acquire
+ * semantics, reads the words where they lie and then stores the new tail with
+ * release semantics to give the space back.
+ */
+
+#ifndef SHM_RING_H_
+#define SHM_RING_H_
+
+#include <stdbool.h>  // for bool type
+#include <stdint.h>   // for fixed-width integer types
+
+#define SHMRING_MAGIC           "DDSSHMR\x01"
+#define SHMRING_MAGIC_LEN       8
+#define SHMRING_HEADER_LEN      192
+
+#define SHMRING_FINISHED        0x1
+
+// biggest ring we'll map, a whole SRAM's worth of words many times over
+#define SHMRING_MAX_CAPACITY    (1U << 26)
+
+typedef struct shm_ring_st ShmRing;
+
+// creates the ring 'name' with room for 'capacity' words (a power of two). Any old ring
+// of that name is unlinked first rather than truncated, so processes still mapping it
+// keep a whole object. Names with a '/' after the first character are file paths,
+// anything else is a POSIX shared memory name. Returns NULL on failure.
+ShmRing * ShmRing_Create(const char *name, unsigned int capacity);
+
+// maps the existing ring 'name', named as for ShmRing_Create(). Returns NULL on failure.
+ShmRing * ShmRing_Open(const char *name);
+
+// producer: copies 'count' words into the ring, waiting for room as needed.
+// Returns false if the ring was already finished, true otherwise.
+bool ShmRing_Write(ShmRing *ring, const unsigned int *words, unsigned int count);
+
+// producer: marks the last word written
+void ShmRing_Finish(ShmRing *ring);
+
+// consumer: waits up to 'timeoutUs' for unread words, points 'words' at the next run
+// of them, in place in the ring, and sets 'count' to how many there are in a row (0 if
+// none arrived in time). Returns false if the ring is corrupt, true otherwise.
+bool ShmRing_Peek(ShmRing *ring, unsigned int timeoutUs, const unsigned int **words, unsigned int *count);
+
+// consumer: gives the first 'count' words from ShmRing_Peek() back to the producer
+void ShmRing_Consume(ShmRing *ring, unsigned int count);
+
+// consumer: returns true once the producer has finished and every word has been read
+bool ShmRing_Drained(const ShmRing *ring);
+
+// unmaps the ring. The object itself stays until ShmRing_Unlink() removes it.
+void ShmRing_Close(ShmRing *ring);
+
+// removes the ring 'name', named as for ShmRing_Create(). Mappings that are still open
+// stay valid until they're closed. Returns false on failure, true otherwise.
+bool ShmRing_Unlink(const char *name);
+
+#endif  // SHM_RING_H_
@@ -0,0 +1,95 @@
+/*
+ * MIT License
+ * 
+ * Copyright (c) 2020 Eli Reed
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/*
+ * This file describes the built-in waveform generator: tones, multitone sets and
+ * linear or logarithmic chirps, computed straight into SRAM words.
+ *
+ * Every word holds an I/Q pair laid out like the data columns gen_dac_data.py writes:
+ * the I sample (most significant byte first) then the Q sample (most significant byte
+ * first), both 16-bit offset binary. Q is I delayed by 'iqPhase' radians, so the
+ * default of pi/2 gives I = sin, Q = cos as gen_dac_data.py does.
+ */
+
+#ifndef SYNTH_H_
+#define SYNTH_H_
+
+#include <stdbool.h>  // for bool type
+
+// project libraries
+#include "dds-host/image.h"
+
+#define SYNTH_MAX_TONES       16
+
+typedef enum synth_kind_t {
+  SynthTone,
+  SynthMultitone,
+  SynthLinearChirp,
+  SynthLogChirp,
+} SynthKind;
+
+typedef struct synth_params_st {
+  SynthKind kind;
+  unsigned int numSamples;
+  // samples per second; frequencies are in Hz at this rate. 1 makes them cycles/sample.
+  double sampleRate;
+  // peak of the whole waveform as a fraction of full scale
+  double amplitude;
+  // phase of Q relative to I, in radians
+  double iqPhase;
+
+  // tones: frequency, relative amplitude and starting phase (radians) of each
+  unsigned int numTones;
+  double freqs[SYNTH_MAX_TONES];
+  double weights[SYNTH_MAX_TONES];
+  double phases[SYNTH_MAX_TONES];
+
+  // chirps sweep from startFreq to endFreq over the whole waveform
+  double startFreq;
+  double endFreq;
+} SynthParams;
+
+// fills in defaults: no tones, 131072 samples at 1 sample/s, full scale, I/Q in quadrature
+void Synth_Defaults(SynthParams *params);
+
+// parses a waveform description into 'params' (keeping its other fields):
+//   tone:<freq>[@<phase degrees>]
+//   multitone:<freq>[*<weight>][@<phase degrees>],<freq>...
+//   chirp:<start freq>:<end freq>
+//   logchirp:<start freq>:<end freq>
+// Returns false on failure, true otherwise.
+bool Synth_ParseSpec(const char *spec, SynthParams *params);
+
+// computes params->numSamples words into 'words'. Returns false if the parameters
+// are invalid, true otherwise.
+bool Synth_Generate(const SynthParams *params, unsigned int *words);
+
+// allocates an image and generates it. Returns NULL on failure.
+SRAMImage * Synth_CreateImage(const SynthParams *params);
+
+// packs 16-bit offset-binary I and Q samples into an SRAM word, in the byte order
+// gen_dac_data.py writes them
+unsigned int Synth_Pack(unsigned int i, unsigned int q);
+
+#endif  // SYNTH_H_
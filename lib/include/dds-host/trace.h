@@ -0,0 +1,80 @@
+/*
+ * MIT License
+ * 
+ * Copyright (c) 2020 Eli Reed
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/*
+ * This file describes the binary HID trace format written by 'dds-host --trace' and
+ * read by dds-trace.
+ *
+ * A trace is a 16-byte header followed by one fixed-size record per report round
+ * trip. All integers are little-endian.
+ *
+ *   header:  "DDSTRACE" (8 bytes), uint32 version, uint32 record size
+ *   record:  uint64 start (ns since the trace was opened, CLOCK_MONOTONIC)
+ *            uint32 duration (ns from sending the report to having the reply)
+ *            int32  result (what GenericWriteRead() returned)
+ *            64 bytes sent, 64 bytes received
+ */
+
+#ifndef TRACE_H_
+#define TRACE_H_
+
+#include <stdbool.h>  // for bool type
+#include <stdint.h>   // for fixed-width integer types
+
+// project libraries
+#include "dds-host/mcp2210.h"
+
+#define TRACE_VERSION         1
+#define TRACE_HEADER_SIZE     16
+#define TRACE_RECORD_SIZE     (16 + 2 * MCP2210_REPORT_LEN)
+
+typedef struct trace_record_st {
+  uint64_t startNs;
+  uint32_t durationNs;
+  int32_t result;
+  uint8_t tx[MCP2210_REPORT_LEN];
+  uint8_t rx[MCP2210_REPORT_LEN];
+} TraceRecord;
+
+typedef struct trace_file_st TraceFile;
+
+// creates 'fileName' and writes the header. Returns NULL on failure.
+TraceFile * Trace_Create(const char *fileName);
+
+// opens an existing trace for reading. Returns NULL on failure.
+TraceFile * Trace_Open(const char *fileName);
+
+// nanoseconds since the trace was created, on the clock records are stamped with
+uint64_t Trace_Now(const TraceFile *trace);
+
+// appends a record. Returns false on failure, true otherwise.
+bool Trace_Write(TraceFile *trace, const TraceRecord *record);
+
+// reads the next record. Returns false at the end of the trace or on failure.
+bool Trace_Read(TraceFile *trace, TraceRecord *record);
+
+// flushes and closes a trace
+void Trace_Close(TraceFile *trace);
+
+#endif  // TRACE_H_
@@ -40,6 +40,10 @@ typedef struct csv_file_st {
 // in this interface
 CSVFile * CSV_Open(const char * fileName);
 
+// opens a CSV file to be read front to back in one pass. Only the first record
+// is read up front, so numRows is left 0.
+CSVFile * CSV_OpenStream(const char * fileName);
+
 // releases resources associated with input file
 bool CSV_Close(CSVFile *file);
 
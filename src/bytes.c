@@ -0,0 +1,43 @@
+/*
+ * MIT License
+ * 
+ * Copyright (c) 2020 Eli Reed
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <stdint.h>   // for fixed-width integer types
+
+#include "dds-host/util/bytes.h"
+
+void Bytes_PutLE(uint8_t *buf, uint64_t value, unsigned int bytes) {
+  unsigned int i;
+  for (i = 0; i < bytes; i++) {
+    buf[i] = (uint8_t)((value >> (8 * i)) & 0xFF);
+  }
+}
+
+uint64_t Bytes_GetLE(const uint8_t *buf, unsigned int bytes) {
+  uint64_t value = 0;
+  unsigned int i;
+  for (i = 0; i < bytes; i++) {
+    value |= (uint64_t)buf[i] << (8 * i);
+  }
+  return value;
+}
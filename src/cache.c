@@ -0,0 +1,158 @@
+/*
+ * MIT License
+ * 
+ * Copyright (c) 2020 Eli Reed
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <stdio.h>    // for fprintf()
+#include <stdbool.h>  // for bool type
+#include <stdint.h>   // for fixed-width integer types
+#include <string.h>   // for memset()
+
+// HIDAPI
+#include "hidapi/hidapi.h"
+
+// project libraries
+#include "dds-host/cache.h"
+#include "dds-host/cpld.h"
+#include "dds-host/image.h"
+#include "dds-host/mcp2210.h"
+#include "dds-host/util/bytes.h"
+#include "dds-host/util/hash.h"
+
+static void Cache_Encode(const ImageTag *tag, uint8_t *buf) {
+  unsigned int i;
+
+  buf[0] = CACHE_TAG_MAGIC;
+  Bytes_PutLE(&buf[1], tag->startAddr, 4);
+  Bytes_PutLE(&buf[5], tag->numWords, 4);
+  Bytes_PutLE(&buf[9], tag->hash, 8);
+
+  buf[17] = 0;
+  for (i = 1; i < 17; i++) {
+    buf[17] ^= buf[i];
+  }
+}
+
+static bool Cache_Decode(const uint8_t *buf, ImageTag *tag) {
+  uint8_t check = 0;
+  unsigned int i;
+
+  for (i = 1; i < 17; i++) {
+    check ^= buf[i];
+  }
+  if (buf[0] != CACHE_TAG_MAGIC || buf[17] != check) {
+    return false;
+  }
+
+  memset(tag, 0, sizeof(*tag));
+  tag->startAddr = (unsigned int)Bytes_GetLE(&buf[1], 4);
+  tag->numWords = (unsigned int)Bytes_GetLE(&buf[5], 4);
+  tag->hash = Bytes_GetLE(&buf[9], 8);
+  return true;
+}
+
+void Cache_TagWords(const unsigned int *words, unsigned int startAddr, unsigned int numWords, ImageTag *tag) {
+  tag->startAddr = startAddr;
+  tag->numWords = numWords;
+  tag->hash = Hash_FNV1a64(HASH_FNV1A64_INIT, words, numWords * sizeof(unsigned int));
+}
+
+bool Cache_ReadTag(hid_device *handle, ImageTag *tag) {
+  uint8_t buf[CACHE_TAG_SIZE];
+  unsigned int i;
+
+  // the magic byte first, so a board without a tag costs one report
+  for (i = 0; i < CACHE_TAG_SIZE; i++) {
+    if (MCP2210_ReadEEPROM(handle, CACHE_EEPROM_ADDR + i, &buf[i]) != 0x00) {
+      fprintf(stderr, "ReadTag()->ReadEEPROM() failed\n");
+      return false;
+    }
+    if (i == 0 && buf[0] != CACHE_TAG_MAGIC) {
+      return false;
+    }
+  }
+  return Cache_Decode(buf, tag);
+}
+
+bool Cache_WriteTag(hid_device *handle, const ImageTag *tag) {
+  uint8_t buf[CACHE_TAG_SIZE];
+  Cache_Encode(tag, buf);
+
+  // the magic byte goes last, so a half-written tag never reads as valid
+  unsigned int i;
+  for (i = CACHE_TAG_SIZE; i-- > 0;) {
+    uint8_t current;
+    if (MCP2210_ReadEEPROM(handle, CACHE_EEPROM_ADDR + i, &current) != 0x00) {
+      fprintf(stderr, "WriteTag()->ReadEEPROM() failed\n");
+      return false;
+    }
+    // the EEPROM wears out, so leave bytes that are already right alone
+    if (current != buf[i] && MCP2210_WriteEEPROM(handle, CACHE_EEPROM_ADDR + i, buf[i]) != 0x00) {
+      fprintf(stderr, "WriteTag()->WriteEEPROM() failed\n");
+      return false;
+    }
+  }
+  return true;
+}
+
+bool Cache_Invalidate(hid_device *handle) {
+  uint8_t magic;
+
+  if (MCP2210_ReadEEPROM(handle, CACHE_EEPROM_ADDR, &magic) != 0x00) {
+    fprintf(stderr, "Invalidate()->ReadEEPROM() failed\n");
+    return false;
+  }
+
+  if (magic == CACHE_TAG_MAGIC && MCP2210_WriteEEPROM(handle, CACHE_EEPROM_ADDR, 0xFF) != 0x00) {
+    fprintf(stderr, "Invalidate()->WriteEEPROM() failed\n");
+    return false;
+  }
+  return true;
+}
+
+bool Cache_HoldsImage(hid_device *handle, const SRAMImage *image) {
+  if (image == NULL || image->numWords == 0) {
+    return false;
+  }
+
+  ImageTag wanted, current;
+  Cache_TagWords(image->words, 0, image->numWords, &wanted);
+
+  if (!Cache_ReadTag(handle, &current) || current.startAddr != wanted.startAddr ||
+      current.numWords != wanted.numWords || current.hash != wanted.hash) {
+    return false;
+  }
+
+  // the tag survives a power cycle but the SRAM doesn't, so check the first and last
+  // words and a few in between
+  unsigned int i;
+  for (i = 0; i < CACHE_SPOT_CHECKS; i++) {
+    unsigned int addr = (CACHE_SPOT_CHECKS > 1) ?
+        (unsigned int)((unsigned long long)(image->numWords - 1) * i / (CACHE_SPOT_CHECKS - 1)) : 0;
+    unsigned int word;
+    if (!CPLD_ReadSRAM(handle, addr, &word, 1) || word != image->words[addr]) {
+      fprintf(stderr, "SRAM doesn't match its cache tag at %05x, reloading\n", addr);
+      return false;
+    }
+  }
+  return true;
+}
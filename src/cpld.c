@@ -36,61 +36,52 @@
 // CPLD
 #include "dds-host/cpld.h"
 
-bool CPLD_WriteSRAMAddress(hid_device *handle, unsigned int addr, unsigned int txData) {
-  if (handle == NULL) {
-    fprintf(stderr, "handle can't be null\n");
-    return false;
-  }
-
-  if (addr > SRAM_MAX_ADDRESS) {
-    fprintf(stderr, "addr is out of range\n");
-    return false;
-  }
-
-  uint8_t txBytes[SRAM_PACKET_SIZE];
-  uint8_t rxBytes[SRAM_PACKET_SIZE];
-
-  memset(txBytes, 0, sizeof(txBytes));
-  memset(rxBytes, 0, sizeof(rxBytes));
-
-  txBytes[0] = (uint8_t)((addr & 0x03) << 6);
-  txBytes[1] = (uint8_t)((addr & 0x1FC) >> 2);
-  txBytes[2] = (uint8_t)((addr & 0xFE00) >> 10);
-  memcpy(&txBytes[3], &txData, sizeof(txData));
-
-  MCP2210SPITransferSettings spiSettings = {0};
-
-  if (MCP2210_ReadSpiSettings(handle, &spiSettings, true) < 0) {
-    fprintf(stderr, "WriteSRAMAddress()->ReadSpiSettings() failed\n");
-    return false;
-  }
+void CPLD_EncodePacket(uint8_t *packet, unsigned int addr, bool read, unsigned int data) {
+  // the instruction cycle
+  packet[0] = (uint8_t)(((addr & 0x03) << 6) | (read ? 0x01 : 0x00));
+  packet[1] = (uint8_t)((addr & 0x1FC) >> 2);
+  packet[2] = (uint8_t)((addr & 0xFE00) >> 10);
+
+  // the data cycle, ignored by the CPLD on a read
+  memcpy(&packet[3], &data, SRAM_DATA_SIZE);
+}
 
+void CPLD_SRAMSpiSettings(MCP2210SPITransferSettings *spiSettings) {
   // number of bytes in the transfer + 1 for the instruction cycle
-  spiSettings.bitRate = 3000000;
+  spiSettings->bitRate = 3000000;
 
-  spiSettings.bytesPerTransaction = SRAM_PACKET_SIZE;
+  spiSettings->bytesPerTransaction = SRAM_PACKET_SIZE;
 
-  spiSettings.csToDataDelay = 0x01;
+  spiSettings->csToDataDelay = 0x01;
 
-  spiSettings.dataToDataDelay = 0x00;
+  spiSettings->dataToDataDelay = 0x00;
 
-  spiSettings.lastDataToCSDelay = 0x01;
+  spiSettings->lastDataToCSDelay = 0x01;
 
   // CS_MEM is high when idle
-  spiSettings.idleCSValue = 0x0002;
+  spiSettings->idleCSValue = 0x0002;
 
   // CS_MEM is low when active
-  spiSettings.activeCSValue = 0x0000;
+  spiSettings->activeCSValue = 0x0000;
+}
+
+bool CPLD_SetupBus(hid_device *handle, MCP2210SPITransferSettings *spiSettings) {
+  if (MCP2210_ReadSpiSettings(handle, spiSettings, true) < 0) {
+    fprintf(stderr, "SetupBus()->ReadSpiSettings() failed\n");
+    return false;
+  }
+
+  CPLD_SRAMSpiSettings(spiSettings);
 
-  if (MCP2210_WriteSpiSettings(handle, &spiSettings, true) < 0) {
-    fprintf(stderr, "WriteSRAMAddress()->WriteSpiSettings() failed\n");
+  if (MCP2210_WriteSpiSettings(handle, spiSettings, true) < 0) {
+    fprintf(stderr, "SetupBus()->WriteSpiSettings() failed\n");
     return false;
   }
 
   MCP2210ChipSettings chipSettings = {0};
 
   if (MCP2210_ReadChipSettings(handle, &chipSettings, true) < 0) {
-    fprintf(stderr, "WriteSRAMAddress()->ReadChipSettings() failed\n");
+    fprintf(stderr, "SetupBus()->ReadChipSettings() failed\n");
     return false;
   }
 
@@ -102,12 +93,51 @@ bool CPLD_WriteSRAMAddress(hid_device *handle, unsigned int addr, unsigned int t
   chipSettings.defaultGPIOValue = 0xFFFF;
 
   if (MCP2210_WriteChipSettings(handle, &chipSettings, true) < 0) {
-    fprintf(stderr, "WriteSRAMAddress()->WriteChipSettings() failed\n");
+    fprintf(stderr, "SetupBus()->WriteChipSettings() failed\n");
+    return false;
+  }
+  return true;
+}
+
+// transfers a single SRAM packet on a bus that has already been set up
+static bool CPLD_Transfer(hid_device *handle, MCP2210SPITransferSettings *spiSettings,
+                          unsigned int addr, bool read, unsigned int *data) {
+  uint8_t txBytes[SRAM_PACKET_SIZE];
+  uint8_t rxBytes[SRAM_PACKET_SIZE];
+
+  memset(rxBytes, 0, sizeof(rxBytes));
+
+  CPLD_EncodePacket(txBytes, addr, read, read ? 0 : *data);
+
+  if (MCP2210_SpiDataTransfer(handle, SRAM_PACKET_SIZE, txBytes, rxBytes, spiSettings) < 0) {
+    return false;
+  }
+
+  if (read) {
+    memcpy(data, &rxBytes[3], SRAM_DATA_SIZE);
+  }
+  return true;
+}
+
+bool CPLD_WriteSRAMAddress(hid_device *handle, unsigned int addr, unsigned int txData) {
+  if (handle == NULL) {
+    fprintf(stderr, "handle can't be null\n");
+    return false;
+  }
+
+  if (addr > SRAM_MAX_ADDRESS) {
+    fprintf(stderr, "addr is out of range\n");
+    return false;
+  }
+
+  MCP2210SPITransferSettings spiSettings = {0};
+
+  if (!CPLD_SetupBus(handle, &spiSettings)) {
     return false;
   }
 
   // attempt the data transfer
-  if (MCP2210_SpiDataTransfer(handle, SRAM_PACKET_SIZE, txBytes, rxBytes, &spiSettings) < 0) {
+  if (!CPLD_Transfer(handle, &spiSettings, addr, false, &txData)) {
     fprintf(stderr, "WriteSRAMAddress()->SpiDataTransfer() failed\n");
     return false;
   }
@@ -125,72 +155,86 @@ bool CPLD_ReadSRAMAddress(hid_device *handle, unsigned int addr, unsigned int *r
     return false;
   }
 
-  uint8_t txBytes[SRAM_PACKET_SIZE];
-  uint8_t rxBytes[SRAM_PACKET_SIZE];
-
-  memset(txBytes, 0, sizeof(txBytes));
-  memset(rxBytes, 0, sizeof(rxBytes));
-
-  // construct the instruction cycle
-  txBytes[0] = (uint8_t)(((addr & 0x03) << 6) | 0x01);
-  txBytes[1] = (uint8_t)((addr & 0x1FC) >> 2);
-  txBytes[2] = (uint8_t)((addr & 0xFE00) >> 10);
+  if (rxData == NULL) {
+    fprintf(stderr, "rxData can't be null\n");
+    return false;
+  }
 
   MCP2210SPITransferSettings spiSettings = {0};
 
-  if (MCP2210_ReadSpiSettings(handle, &spiSettings, true) < 0) {
-    fprintf(stderr, "WriteSRAMAddress()->ReadSpiSettings() failed\n");
+  if (!CPLD_SetupBus(handle, &spiSettings)) {
     return false;
   }
 
-  // number of bytes in the transfer + 1 for the instruction cycle
-  spiSettings.bitRate = 3000000;
+  // attempt the data transfer
+  if (!CPLD_Transfer(handle, &spiSettings, addr, true, rxData)) {
+    fprintf(stderr, "ReadSRAMAddress()->SpiDataTransfer() failed\n");
+    return false;
+  }
+  return true;
+}
 
-  spiSettings.bytesPerTransaction = SRAM_PACKET_SIZE;
+unsigned int CPLD_WriteSRAM(hid_device *handle, unsigned int startAddr, const unsigned int *txData, unsigned int count) {
+  if (handle == NULL || txData == NULL) {
+    fprintf(stderr, "handle and txData can't be null\n");
+    return count;
+  }
 
-  spiSettings.csToDataDelay = 0x01;
+  if (startAddr > SRAM_MAX_ADDRESS || count > SRAM_MAX_ADDRESS + 1 - startAddr) {
+    fprintf(stderr, "range is out of range\n");
+    return count;
+  }
 
-  spiSettings.dataToDataDelay = 0x00;
+  if (count == 0) {
+    return 0;
+  }
 
-  spiSettings.lastDataToCSDelay = 0x01;
+  // the bus only needs to be set up once for the whole range
+  MCP2210SPITransferSettings spiSettings = {0};
 
-  // CS_MEM is high when idle
-  spiSettings.idleCSValue = 0x0002;
+  if (!CPLD_SetupBus(handle, &spiSettings)) {
+    return count;
+  }
 
-  // CS_MEM is low when active
-  spiSettings.activeCSValue = 0x0000;
+  unsigned int i;
+  unsigned int failures = 0;
+  for (i = 0; i < count; i++) {
+    unsigned int word = txData[i];
+    if (!CPLD_Transfer(handle, &spiSettings, startAddr + i, false, &word)) {
+      fprintf(stderr, "WriteSRAM() failed for addr: %u\n", startAddr + i);
+      failures++;
+    }
+  }
+  return failures;
+}
 
-  if (MCP2210_WriteSpiSettings(handle, &spiSettings, true) < 0) {
-    fprintf(stderr, "WriteSRAMAddress()->WriteSpiSettings() failed\n");
+bool CPLD_ReadSRAM(hid_device *handle, unsigned int startAddr, unsigned int *rxData, unsigned int count) {
+  if (handle == NULL || rxData == NULL) {
+    fprintf(stderr, "handle and rxData can't be null\n");
     return false;
   }
 
-  MCP2210ChipSettings chipSettings = {0};
-
-  if (MCP2210_ReadChipSettings(handle, &chipSettings, true) < 0) {
-    fprintf(stderr, "WriteSRAMAddress()->ReadChipSettings() failed\n");
+  if (startAddr > SRAM_MAX_ADDRESS || count > SRAM_MAX_ADDRESS + 1 - startAddr) {
+    fprintf(stderr, "range is out of range\n");
     return false;
   }
 
-  chipSettings.gp0Designation = GPIO;
-  chipSettings.gp1Designation = CS;
-  chipSettings.gp5Designation = DF;
+  if (count == 0) {
+    return true;
+  }
 
-  chipSettings.defaultGPIODirection = 0x0000;
-  chipSettings.defaultGPIOValue = 0xFFFF;
+  MCP2210SPITransferSettings spiSettings = {0};
 
-  if (MCP2210_WriteChipSettings(handle, &chipSettings, true) < 0) {
-    fprintf(stderr, "WriteSRAMAddress()->WriteChipSettings() failed\n");
+  if (!CPLD_SetupBus(handle, &spiSettings)) {
     return false;
   }
 
-  // attempt the data transfer
-  if (MCP2210_SpiDataTransfer(handle, SRAM_PACKET_SIZE, txBytes, rxBytes, &spiSettings) < 0) {
-    fprintf(stderr, "WriteSRAMAddress()->SpiDataTransfer() failed\n");
-    return false;
+  unsigned int i;
+  for (i = 0; i < count; i++) {
+    if (!CPLD_Transfer(handle, &spiSettings, startAddr + i, true, &rxData[i])) {
+      fprintf(stderr, "ReadSRAM() failed for addr: %u\n", startAddr + i);
+      return false;
+    }
   }
-
-  // extract the data we read
-  memcpy(rxData, &rxBytes[3], SRAM_DATA_SIZE);
   return true;
-}
\ No newline at end of file
+}
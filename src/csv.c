@@ -64,6 +64,36 @@ CSVFile * CSV_Open(const char * fileName) {
   return file;
 }
 
+CSVFile * CSV_OpenStream(const char * fileName) {
+  FILE * fp = fopen(fileName, "r");
+
+  if (fp == NULL) {
+    perror("CSV_OpenStream() failed");
+    return NULL;
+  }
+
+  CSVFile * file = (CSVFile *)malloc(sizeof(CSVFile));
+
+  if (file == NULL) {
+    fprintf(stderr, "Failed to allocate CSVFile\n");
+    fclose(fp);
+    return NULL;
+  }
+
+  // only the first record is read; the rows are left for the caller to find
+  file->fp = fp;
+  file->numCols = CSV_NumCols(file);
+  file->numRows = 0;
+
+  if (fseek(file->fp, 0, SEEK_SET) != 0) {
+    perror("CSV_OpenStream() failed");
+    CSV_Close(file);
+    return NULL;
+  }
+
+  return file;
+}
+
 bool CSV_Close(CSVFile *file) {
   if (file == NULL) {
     fprintf(stderr, "CSV_Close()-> can't free a NULL pointer!\n");
@@ -129,20 +159,25 @@ static unsigned long long CSV_NumRows(CSVFile * file) {
     return 0;
   }
 
-  // simply count the number of new lines in the file
-  char c;
+  // count the new lines in the file, plus a last row that doesn't end in one
+  int c;
+  int last = '\n';
   unsigned long long rows = 0;
 
+  if (fseek(file->fp, 0, SEEK_SET) != 0) {
+    return 0;
+  }
+
   while ((c = fgetc(file->fp)) != EOF) {
     if (c == '\n') {
       rows++;
     }
+    last = c;
   }
-  if (c == EOF) {
+  if (last != '\n') {
     rows++;
-    return rows;
   }
-  return 0;
+  return rows;
 }
 
 static unsigned long long CSV_NumCols(CSVFile *file) {
@@ -151,16 +186,19 @@ static unsigned long long CSV_NumCols(CSVFile *file) {
     return 0;
   }
 
-  // simply count the number of commas in the first record
-  char c;
+  // simply count the number of commas in the first record, which may also be
+  // the last line of the file
+  int c;
+  bool empty = true;
   unsigned long long cols = 0;
 
-  while ((c = fgetc(file->fp)) != '\n') {
+  while ((c = fgetc(file->fp)) != '\n' && c != EOF) {
+    empty = false;
     if (c == ',') {
       cols++;
     }
   }
-  if (c == '\n') {
+  if (c == '\n' || !empty) {
     cols++;
     return cols;
   }
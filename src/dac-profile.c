@@ -0,0 +1,214 @@
+/*
+ * MIT License
+ * 
+ * Copyright (c) 2020 Eli Reed
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <stdio.h>    // for fopen(), fread(), fwrite()
+#include <stdbool.h>  // for bool type
+#include <stdint.h>   // for fixed-width integer types
+#include <string.h>   // for memcmp(), memset()
+
+// HIDAPI
+#include "hidapi/hidapi.h"
+
+// project libraries
+#include "dds-host/dac-profile.h"
+#include "dds-host/dac5687.h"
+#include "dds-host/util/csv.h"
+#include "dds-host/util/bytes.h"
+#include "dds-host/util/hash.h"
+
+// magic, mask, values, frame count
+#define DACPROFILE_HEADER_LEN     (DACPROFILE_MAGIC_LEN + 4 + DAC5687_NUM_REGISTERS + 1)
+#define DACPROFILE_FRAME_LEN      (1 + DAC5687_MAX_FRAME_BYTES)
+#define DACPROFILE_MAX_LEN        (DACPROFILE_HEADER_LEN + DACPROFILE_MAX_FRAMES * DACPROFILE_FRAME_LEN + 8)
+
+bool DACProfile_Compile(const DAC5687RegisterMap *map, DACProfile *profile) {
+  if (map == NULL || profile == NULL) {
+    fprintf(stderr, "map and profile can't be null\n");
+    return false;
+  }
+
+  if (map->mask & ~DAC5687_WRITABLE_MASK) {
+    fprintf(stderr, "map includes factory use only registers\n");
+    return false;
+  }
+
+  memset(profile, 0, sizeof(*profile));
+  profile->map.mask = map->mask;
+
+  // every run of consecutive registers becomes as few 4-register bursts as it can
+  unsigned int addr = 0;
+  while (addr < DAC5687_NUM_REGISTERS) {
+    if (!(map->mask & (1UL << addr))) {
+      addr++;
+      continue;
+    }
+    profile->map.values[addr] = map->values[addr];
+
+    unsigned int count = 1;
+    while (count < 4 && addr + count < DAC5687_NUM_REGISTERS && (map->mask & (1UL << (addr + count)))) {
+      profile->map.values[addr + count] = map->values[addr + count];
+      count++;
+    }
+
+    DAC5687_EncodeWriteFrame(&profile->frames[profile->numFrames++], addr, &map->values[addr], count);
+    addr += count;
+  }
+  return true;
+}
+
+bool DACProfile_CompileCSV(const char *csvFileName, DACProfile *profile) {
+  CSVFile *file = CSV_Open(csvFileName);
+
+  if (file == NULL) {
+    return false;
+  }
+
+  DAC5687RegisterMap map;
+  uint32_t repeated;
+  bool ok = DAC5687_ParseConfig(file, &map, &repeated);
+
+  // a profile writes each register once, so it can't replay a config that depends on write order
+  if (ok && repeated != 0) {
+    fprintf(stderr, "%s writes register %#x more than once; it can only be applied with --cold\n",
+            csvFileName, (unsigned int)__builtin_ctz(repeated));
+    ok = false;
+  }
+
+  ok = ok && DACProfile_Compile(&map, profile);
+  CSV_Close(file);
+  return ok;
+}
+
+bool DACProfile_Save(const char *fileName, const DACProfile *profile) {
+  if (fileName == NULL || profile == NULL) {
+    fprintf(stderr, "fileName and profile can't be null\n");
+    return false;
+  }
+
+  uint8_t buf[DACPROFILE_MAX_LEN];
+  memcpy(buf, DACPROFILE_MAGIC, DACPROFILE_MAGIC_LEN);
+  Bytes_PutLE(&buf[DACPROFILE_MAGIC_LEN], profile->map.mask, 4);
+  memcpy(&buf[DACPROFILE_MAGIC_LEN + 4], profile->map.values, DAC5687_NUM_REGISTERS);
+  buf[DACPROFILE_HEADER_LEN - 1] = (uint8_t)profile->numFrames;
+
+  unsigned int len = DACPROFILE_HEADER_LEN;
+  unsigned int i;
+  for (i = 0; i < profile->numFrames; i++) {
+    buf[len] = profile->frames[i].len;
+    memcpy(&buf[len + 1], profile->frames[i].bytes, DAC5687_MAX_FRAME_BYTES);
+    len += DACPROFILE_FRAME_LEN;
+  }
+
+  Bytes_PutLE(&buf[len], Hash_FNV1a64(HASH_FNV1A64_INIT, buf, len), 8);
+  len += 8;
+
+  FILE *file = fopen(fileName, "wb");
+
+  if (file == NULL) {
+    fprintf(stderr, "Failed to create profile %s\n", fileName);
+    return false;
+  }
+
+  bool ok = fwrite(buf, 1, len, file) == len;
+  ok = (fclose(file) == 0) && ok;
+
+  if (!ok) {
+    fprintf(stderr, "Failed to write profile %s\n", fileName);
+  }
+  return ok;
+}
+
+bool DACProfile_Load(const char *fileName, DACProfile *profile) {
+  if (fileName == NULL || profile == NULL) {
+    fprintf(stderr, "fileName and profile can't be null\n");
+    return false;
+  }
+
+  FILE *file = fopen(fileName, "rb");
+
+  if (file == NULL) {
+    fprintf(stderr, "Failed to open profile %s\n", fileName);
+    return false;
+  }
+
+  // one byte more than the largest profile, to catch trailing junk
+  uint8_t buf[DACPROFILE_MAX_LEN + 1];
+  size_t len = fread(buf, 1, sizeof(buf), file);
+  fclose(file);
+
+  if (len < DACPROFILE_HEADER_LEN + 8 || memcmp(buf, DACPROFILE_MAGIC, DACPROFILE_MAGIC_LEN) != 0) {
+    fprintf(stderr, "%s isn't a DAC profile\n", fileName);
+    return false;
+  }
+
+  unsigned int numFrames = buf[DACPROFILE_HEADER_LEN - 1];
+  size_t bodyLen = DACPROFILE_HEADER_LEN + numFrames * DACPROFILE_FRAME_LEN;
+  if (numFrames > DACPROFILE_MAX_FRAMES || len != bodyLen + 8 ||
+      Bytes_GetLE(&buf[bodyLen], 8) != Hash_FNV1a64(HASH_FNV1A64_INIT, buf, bodyLen)) {
+    fprintf(stderr, "DAC profile %s is corrupt\n", fileName);
+    return false;
+  }
+
+  DAC5687RegisterMap map;
+  map.mask = (uint32_t)Bytes_GetLE(&buf[DACPROFILE_MAGIC_LEN], 4);
+  memcpy(map.values, &buf[DACPROFILE_MAGIC_LEN + 4], DAC5687_NUM_REGISTERS);
+
+  // the frames are what actually gets sent, so they have to agree with the map
+  if (!DACProfile_Compile(&map, profile) || profile->numFrames != numFrames) {
+    fprintf(stderr, "DAC profile %s doesn't match its register map\n", fileName);
+    return false;
+  }
+
+  unsigned int i;
+  for (i = 0; i < numFrames; i++) {
+    const uint8_t *frame = &buf[DACPROFILE_HEADER_LEN + i * DACPROFILE_FRAME_LEN];
+    if (frame[0] != profile->frames[i].len || memcmp(&frame[1], profile->frames[i].bytes, DAC5687_MAX_FRAME_BYTES) != 0) {
+      fprintf(stderr, "DAC profile %s doesn't match its register map\n", fileName);
+      return false;
+    }
+  }
+  return true;
+}
+
+bool DACProfile_IsProfile(const char *fileName) {
+  FILE *file = fopen(fileName, "rb");
+
+  if (file == NULL) {
+    return false;
+  }
+
+  uint8_t magic[DACPROFILE_MAGIC_LEN];
+  bool isProfile = fread(magic, 1, sizeof(magic), file) == sizeof(magic) &&
+                   memcmp(magic, DACPROFILE_MAGIC, DACPROFILE_MAGIC_LEN) == 0;
+  fclose(file);
+  return isProfile;
+}
+
+bool DACProfile_Apply(hid_device *handle, const DACProfile *profile) {
+  if (profile == NULL) {
+    fprintf(stderr, "profile can't be null\n");
+    return false;
+  }
+  return DAC5687_WriteFrames(handle, profile->frames, profile->numFrames);
+}
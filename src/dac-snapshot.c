@@ -0,0 +1,186 @@
+/*
+ * MIT License
+ * 
+ * Copyright (c) 2020 Eli Reed
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <stdio.h>    // for fopen(), fread(), fwrite(), fprintf()
+#include <stdbool.h>  // for bool type
+#include <stdint.h>   // for fixed-width integer types
+#include <string.h>   // for memcmp(), memcpy()
+#include <time.h>     // for time_t
+
+// HIDAPI
+#include "hidapi/hidapi.h"
+
+// project libraries
+#include "dds-host/dac-snapshot.h"
+#include "dds-host/dac-profile.h"
+#include "dds-host/dac5687.h"
+#include "dds-host/util/csv.h"
+#include "dds-host/util/bytes.h"
+#include "dds-host/util/hash.h"
+
+// magic, time, mask, values
+#define DACSNAPSHOT_BODY_LEN      (DACSNAPSHOT_MAGIC_LEN + 8 + 4 + DAC5687_NUM_REGISTERS)
+#define DACSNAPSHOT_LEN           (DACSNAPSHOT_BODY_LEN + 8)
+
+bool DACSnapshot_Take(hid_device *handle, DAC5687RegisterMap *map) {
+  // three runs (0x00-0x07, 0x09-0x19, 0x1B-0x1C), so eight bursts after one bus setup
+  return DAC5687_ReadRegisterMap(handle, DAC5687_WRITABLE_MASK, map);
+}
+
+bool DACSnapshot_Save(const char *fileName, const DAC5687RegisterMap *map, time_t taken) {
+  if (fileName == NULL || map == NULL) {
+    fprintf(stderr, "fileName and map can't be null\n");
+    return false;
+  }
+
+  uint8_t buf[DACSNAPSHOT_LEN];
+  memcpy(buf, DACSNAPSHOT_MAGIC, DACSNAPSHOT_MAGIC_LEN);
+  Bytes_PutLE(&buf[DACSNAPSHOT_MAGIC_LEN], (uint64_t)taken, 8);
+  Bytes_PutLE(&buf[DACSNAPSHOT_MAGIC_LEN + 8], map->mask, 4);
+
+  unsigned int addr;
+  for (addr = 0; addr < DAC5687_NUM_REGISTERS; addr++) {
+    buf[DACSNAPSHOT_MAGIC_LEN + 12 + addr] = (map->mask & (1UL << addr)) ? map->values[addr] : 0;
+  }
+  Bytes_PutLE(&buf[DACSNAPSHOT_BODY_LEN], Hash_FNV1a64(HASH_FNV1A64_INIT, buf, DACSNAPSHOT_BODY_LEN), 8);
+
+  FILE *file = fopen(fileName, "wb");
+
+  if (file == NULL) {
+    fprintf(stderr, "Failed to create snapshot %s\n", fileName);
+    return false;
+  }
+
+  bool ok = fwrite(buf, 1, sizeof(buf), file) == sizeof(buf);
+  ok = (fclose(file) == 0) && ok;
+
+  if (!ok) {
+    fprintf(stderr, "Failed to write snapshot %s\n", fileName);
+  }
+  return ok;
+}
+
+bool DACSnapshot_Load(const char *fileName, DAC5687RegisterMap *map, time_t *taken) {
+  if (fileName == NULL || map == NULL) {
+    fprintf(stderr, "fileName and map can't be null\n");
+    return false;
+  }
+
+  FILE *file = fopen(fileName, "rb");
+
+  if (file == NULL) {
+    fprintf(stderr, "Failed to open snapshot %s\n", fileName);
+    return false;
+  }
+
+  // one byte more than a snapshot, to catch trailing junk
+  uint8_t buf[DACSNAPSHOT_LEN + 1];
+  size_t len = fread(buf, 1, sizeof(buf), file);
+  fclose(file);
+
+  if (len < DACSNAPSHOT_MAGIC_LEN || memcmp(buf, DACSNAPSHOT_MAGIC, DACSNAPSHOT_MAGIC_LEN) != 0) {
+    fprintf(stderr, "%s isn't a DAC snapshot\n", fileName);
+    return false;
+  }
+
+  if (len != DACSNAPSHOT_LEN ||
+      Bytes_GetLE(&buf[DACSNAPSHOT_BODY_LEN], 8) != Hash_FNV1a64(HASH_FNV1A64_INIT, buf, DACSNAPSHOT_BODY_LEN)) {
+    fprintf(stderr, "DAC snapshot %s is corrupt\n", fileName);
+    return false;
+  }
+
+  map->mask = (uint32_t)Bytes_GetLE(&buf[DACSNAPSHOT_MAGIC_LEN + 8], 4);
+  memcpy(map->values, &buf[DACSNAPSHOT_MAGIC_LEN + 12], DAC5687_NUM_REGISTERS);
+
+  if (map->mask & ~DAC5687_WRITABLE_MASK) {
+    fprintf(stderr, "DAC snapshot %s includes factory use only registers\n", fileName);
+    return false;
+  }
+
+  if (taken != NULL) {
+    *taken = (time_t)Bytes_GetLE(&buf[DACSNAPSHOT_MAGIC_LEN], 8);
+  }
+  return true;
+}
+
+bool DACSnapshot_IsSnapshot(const char *fileName) {
+  FILE *file = fopen(fileName, "rb");
+
+  if (file == NULL) {
+    return false;
+  }
+
+  uint8_t magic[DACSNAPSHOT_MAGIC_LEN];
+  bool isSnapshot = fread(magic, 1, sizeof(magic), file) == sizeof(magic) &&
+                    memcmp(magic, DACSNAPSHOT_MAGIC, DACSNAPSHOT_MAGIC_LEN) == 0;
+  fclose(file);
+  return isSnapshot;
+}
+
+bool DACSnapshot_LoadAny(const char *fileName, DAC5687RegisterMap *map) {
+  if (DACSnapshot_IsSnapshot(fileName)) {
+    return DACSnapshot_Load(fileName, map, NULL);
+  }
+
+  if (DACProfile_IsProfile(fileName)) {
+    DACProfile profile;
+    if (!DACProfile_Load(fileName, &profile)) {
+      return false;
+    }
+    *map = profile.map;
+    return true;
+  }
+
+  CSVFile *file = CSV_Open(fileName);
+
+  if (file == NULL) {
+    return false;
+  }
+
+  // only each register's final value matters when comparing against the board
+  bool ok = DAC5687_ParseConfig(file, map, NULL);
+  CSV_Close(file);
+  return ok;
+}
+
+unsigned int DACSnapshot_Diff(const DAC5687RegisterMap *expected, const DAC5687RegisterMap *actual, FILE *out) {
+  unsigned int differences = 0;
+  unsigned int addr;
+
+  for (addr = 0; addr < DAC5687_NUM_REGISTERS; addr++) {
+    if (!(expected->mask & (1UL << addr))) {
+      continue;
+    }
+
+    if (!(actual->mask & (1UL << addr))) {
+      fprintf(out, "%02x: expected %02x, not captured\n", addr, expected->values[addr]);
+      differences++;
+    } else if (actual->values[addr] != expected->values[addr]) {
+      fprintf(out, "%02x: expected %02x, found %02x (bits %02x differ)\n", addr, expected->values[addr],
+              actual->values[addr], expected->values[addr] ^ actual->values[addr]);
+      differences++;
+    }
+  }
+  return differences;
+}
@@ -27,6 +27,7 @@
 #include <stdbool.h>  // for bool type
 #include <string.h>   // for memcpy()
 #include <unistd.h>   // for usleep()
+#include <math.h>     // for floor(), llround()
 
 // HIDAPI
 #include "hidapi/hidapi.h"
@@ -35,6 +36,7 @@
 #include "dds-host/mcp2210.h"
 #include "dds-host/dac5687.h"
 #include "dds-host/util/csv.h"
+#include "dds-host/util/hash.h"
 
 bool DAC5687_Configure(CSVFile *file, hid_device *handle) {
   if (file == NULL) {
@@ -91,44 +93,40 @@ bool DAC5687_Configure(CSVFile *file, hid_device *handle) {
   return true;
 }
 
-bool DAC5687_WriteRegister(hid_device *handle, DAC5687Address addr, unsigned char txByte) {
-  if (handle == NULL) {
-    fprintf(stderr, "dev must not be null\n");
-    return false;
-  }
-
-  if (addr == 0x08 || addr == 0x1A || addr >= 0x1D) {
-    fprintf(stderr, "can't write to address %x# as it's for factory use only\n", addr);
-    return false;
-  }
+// returns true if 'addr' is reserved for factory use
+static bool DAC5687_IsFactoryRegister(unsigned int addr) {
+  return addr == 0x08 || addr == 0x1A || addr >= 0x1D;
+}
 
+// points the MCP2210 at the DAC: CS_DAC on GP0, 'bytes'-byte transactions.
+// 'spiSettings' is left ready to hand to MCP2210_SpiDataTransfer().
+static bool DAC5687_SetupBus(hid_device *handle, MCP2210SPITransferSettings *spiSettings, unsigned int bytes) {
   // get current SPI settings
-  MCP2210SPITransferSettings spiSettings = {0};
-  if (MCP2210_ReadSpiSettings(handle, &spiSettings, true) < 0) {
-    fprintf(stderr, "WriteRegister()->ReadSpiSettings() failed\n");
+  if (MCP2210_ReadSpiSettings(handle, spiSettings, true) < 0) {
+    fprintf(stderr, "SetupBus()->ReadSpiSettings() failed\n");
     return false;
   }
 
   // number of bytes in the transfer + 1 for the instruction cycle
-  spiSettings.bitRate = 3000000;
+  spiSettings->bitRate = 3000000;
 
-  spiSettings.bytesPerTransaction = 2;
+  spiSettings->bytesPerTransaction = bytes;
 
-  spiSettings.csToDataDelay = 0x01;
+  spiSettings->csToDataDelay = 0x01;
 
-  spiSettings.dataToDataDelay = 0x00;
+  spiSettings->dataToDataDelay = 0x00;
 
-  spiSettings.lastDataToCSDelay = 0x01;
+  spiSettings->lastDataToCSDelay = 0x01;
   // CS_DAC is high when idle
-  spiSettings.idleCSValue = 0x0003;
+  spiSettings->idleCSValue = 0x0003;
 
   // CS_DAC is low when active
-  spiSettings.activeCSValue = 0x0002;
+  spiSettings->activeCSValue = 0x0002;
 
   MCP2210ChipSettings chipSettings = {0};
 
   if (MCP2210_ReadChipSettings(handle, &chipSettings, true) < 0) {
-    fprintf(stderr, "WriteSRAMAddress()->ReadChipSettings() failed\n");
+    fprintf(stderr, "SetupBus()->ReadChipSettings() failed\n");
     return false;
   }
 
@@ -140,154 +138,243 @@ bool DAC5687_WriteRegister(hid_device *handle, DAC5687Address addr, unsigned cha
   chipSettings.defaultGPIOValue = 0xFFFF;
 
   if (MCP2210_WriteChipSettings(handle, &chipSettings, true) < 0) {
-    fprintf(stderr, "WriteSRAMAddress()->WriteChipSettings() failed\n");
+    fprintf(stderr, "SetupBus()->WriteChipSettings() failed\n");
     return false;
   }
-  
-  // construct the instruction cycle byte
-  unsigned char instrByte = (addr & 0x1F);
+  return true;
+}
+
+// the instruction cycle byte: read bit, register count - 1, start address
+static unsigned char DAC5687_Instruction(unsigned int startAddr, unsigned int count, bool read) {
+  unsigned char instrByte = (startAddr & 0x1F) | (((count - 1) & 0x03) << 5);
+  if (read) {
+    instrByte |= (0x1 << 7);
+  }
+  return instrByte;
+}
 
-  unsigned char spiTxBytes[2] = {instrByte, txByte};
-  unsigned char rxBuf[2];
+// transfers one instruction cycle plus up to 4 register bytes on a bus that
+// has already been set up
+static bool DAC5687_Burst(hid_device *handle, MCP2210SPITransferSettings *spiSettings,
+                          unsigned int startAddr, unsigned char *bytes, unsigned int count, bool read) {
+  unsigned char instrByte = DAC5687_Instruction(startAddr, count, read);
 
-  if (MCP2210_SpiDataTransfer(handle, 2, spiTxBytes, rxBuf, &spiSettings) < 0) {
-    fprintf(stderr, "WriteRegister() failed\n");
+  unsigned char spiTxBytes[5];
+  unsigned char rxBuf[5];
+
+  spiTxBytes[0] = instrByte;
+  if (read) {
+    memset(&spiTxBytes[1], 0, count);
+  } else {
+    memcpy(&spiTxBytes[1], bytes, count);
+  }
+  memset(rxBuf, 0, sizeof(rxBuf));
+
+  if (MCP2210_SpiDataTransfer(handle, count + 1, spiTxBytes, rxBuf, spiSettings) < 0) {
     return false;
-  } 
+  }
+
+  if (read) {
+    memcpy(bytes, &rxBuf[1], count);
+  }
   return true;
 }
 
-bool DAC5687_WriteRegisters(hid_device *handle, DAC5687Address startAddr, unsigned char *txBytes, unsigned int bytes) {
+// walks [startAddr, startAddr + count) in bursts of up to 4 registers on a bus that
+// has already been set up
+static bool DAC5687_BurstRange(hid_device *handle, MCP2210SPITransferSettings *spiSettings,
+                               unsigned int startAddr, unsigned char *bytes, unsigned int count, bool read) {
+  unsigned int done = 0;
+  while (done < count) {
+    unsigned int burst = count - done;
+    if (burst > 4) {
+      burst = 4;
+    }
+
+    if (!DAC5687_Burst(handle, spiSettings, startAddr + done, &bytes[done], burst, read)) {
+      fprintf(stderr, "Range() failed at register %#x\n", startAddr + done);
+      return false;
+    }
+    done += burst;
+  }
+  return true;
+}
+
+// checks and walks [startAddr, startAddr + count) in bursts of up to 4 registers
+static bool DAC5687_Range(hid_device *handle, unsigned int startAddr, unsigned char *bytes,
+                          unsigned int count, bool read) {
   if (handle == NULL) {
     fprintf(stderr, "handle can't be null\n");
     return false;
   }
 
-  if (txBytes == NULL) {
-    fprintf(stderr, "txBytes must not be null\n");
+  if (bytes == NULL) {
+    fprintf(stderr, "bytes must not be null\n");
     return false;
   }
 
-  if (bytes > 4) {
-    fprintf(stderr, "can't write more than 4 more registers\n");
-    return false;
+  unsigned int addr;
+  for (addr = startAddr; addr < startAddr + count; addr++) {
+    if (DAC5687_IsFactoryRegister(addr)) {
+      fprintf(stderr, "range intersects with factory use only register %#x\n", addr);
+      return false;
+    }
   }
 
-  if (startAddr == 0x08 || startAddr == 0x1A || startAddr >= 0x1D) {
-    fprintf(stderr, "can't write to address %x# as it's for factory use only\n", startAddr);
+  if (count == 0) {
+    return true;
+  }
+
+  MCP2210SPITransferSettings spiSettings = {0};
+
+  if (!DAC5687_SetupBus(handle, &spiSettings, count > 4 ? 5 : count + 1)) {
     return false;
   }
+  return DAC5687_BurstRange(handle, &spiSettings, startAddr, bytes, count, read);
+}
 
-  if (bytes > (0x08 - startAddr) || bytes > (0x1A - startAddr) || bytes > (0x1D - startAddr)) {
-    fprintf(stderr, "write intersects with factory use only register\n");
+bool DAC5687_ParseConfig(CSVFile *file, DAC5687RegisterMap *map, uint32_t *repeated) {
+  if (file == NULL || map == NULL) {
+    fprintf(stderr, "file and map can't be null\n");
     return false;
   }
 
-  // get current SPI settings
-  MCP2210SPITransferSettings spiSettings = {0};
-  if (MCP2210_ReadSpiSettings(handle, &spiSettings, true) < 0) {
-    fprintf(stderr, "WriteRegisters()->ReadSpiSettings() failed\n");
+  if (file->numCols != 2) {
+    fprintf(stderr, "the config specified may not be valid.\n");
     return false;
   }
 
-  // number of bytes in the transfer + 1 for the instruction cycle
-  spiSettings.bitRate = 3000000;
+  memset(map, 0, sizeof(*map));
 
-  spiSettings.bytesPerTransaction = bytes + 1;
+  if (repeated != NULL) {
+    *repeated = 0;
+  }
 
-  spiSettings.csToDataDelay = 0x01;
+  unsigned long long row;
+  for (row = 1; row <= file->numRows; row++) {
+    char *addrStr = CSV_ReadElement(file, row, 1);
+    char *dataStr = CSV_ReadElement(file, row, 2);
 
-  spiSettings.dataToDataDelay = 0x00;
+    // naively check for problems
+    if ((addrStr == NULL) || (strlen(addrStr) != 2)) {
+      fprintf(stderr, "specified address is invalid at Row: %lld\n", row);
+      free(addrStr);
+      free(dataStr);
+      return false;
+    }
 
-  spiSettings.lastDataToCSDelay = 0x01;
-  // CS_DAC is high when idle
-  spiSettings.idleCSValue = 0x0003;
+    if ((dataStr == NULL) || (strlen(dataStr) != 2)) {
+      fprintf(stderr, "specified data is invalid at Row: %lld\n", row);
+      free(addrStr);
+      free(dataStr);
+      return false;
+    }
 
-  // CS_DAC is low when active
-  spiSettings.activeCSValue = 0x0002;
+    int addr = (int)strtol(addrStr, NULL, 16);
+    int data = (int)strtol(dataStr, NULL, 16);
 
-  // construct the instruction cycle byte
-  unsigned int writeBytes = bytes - 1;
-  unsigned char instrByte = (startAddr & 0x1F) | ((writeBytes & 0x03) << 5);
+    free(addrStr);
+    free(dataStr);
 
-  unsigned char spiTxBytes[bytes + 1];
-  unsigned char rxBuf[bytes + 1];
+    if (DAC5687_IsFactoryRegister(addr)) {
+      fprintf(stderr, "address %#x at Row: %lld is for factory use only\n", addr, row);
+      return false;
+    }
 
-  spiTxBytes[0] = instrByte;
-  memcpy(&spiTxBytes[1], txBytes, bytes);
-  memset(rxBuf, 0, sizeof(rxBuf));
+    if ((map->mask & (1UL << addr)) && repeated != NULL) {
+      *repeated |= (1UL << addr);
+    }
 
-  if (MCP2210_SpiDataTransfer(handle, sizeof(spiTxBytes), spiTxBytes, rxBuf, &spiSettings) < 0) {
-    fprintf(stderr, "WriteRegisters() failed\n");
-    return false;
-  } 
+    map->values[addr] = (unsigned char)(data & 0xFF);
+    map->mask |= (1UL << addr);
+  }
   return true;
 }
 
-bool DAC5687_ReadRegister(hid_device *handle, DAC5687Address addr, unsigned char *rxByte) {
+bool DAC5687_WriteRegister(hid_device *handle, DAC5687Address addr, unsigned char txByte) {
   if (handle == NULL) {
     fprintf(stderr, "dev must not be null\n");
     return false;
   }
 
-  if (rxByte == NULL) {
-    fprintf(stderr, "output byte can't be null\n");
+  if (DAC5687_IsFactoryRegister(addr)) {
+    fprintf(stderr, "can't write to address %x# as it's for factory use only\n", addr);
     return false;
   }
 
-  // get current SPI settings
   MCP2210SPITransferSettings spiSettings = {0};
-  if (MCP2210_ReadSpiSettings(handle, &spiSettings, true) < 0) {
-    fprintf(stderr, "WriteRegister()->ReadSpiSettings() failed\n");
+
+  if (!DAC5687_SetupBus(handle, &spiSettings, 2)) {
     return false;
   }
 
-  // number of bytes in the transfer + 1 for the instruction cycle
-  spiSettings.bitRate = 3000000;
+  if (!DAC5687_Burst(handle, &spiSettings, addr, &txByte, 1, false)) {
+    fprintf(stderr, "WriteRegister() failed\n");
+    return false;
+  }
+  return true;
+}
 
-  spiSettings.bytesPerTransaction = 2;
+bool DAC5687_WriteRegisters(hid_device *handle, DAC5687Address startAddr, unsigned char *txBytes, unsigned int bytes) {
+  if (handle == NULL) {
+    fprintf(stderr, "handle can't be null\n");
+    return false;
+  }
 
-  spiSettings.csToDataDelay = 0x01;
+  if (txBytes == NULL) {
+    fprintf(stderr, "txBytes must not be null\n");
+    return false;
+  }
 
-  spiSettings.dataToDataDelay = 0x00;
+  if (bytes == 0 || bytes > 4) {
+    fprintf(stderr, "can only write 1 to 4 registers\n");
+    return false;
+  }
 
-  spiSettings.lastDataToCSDelay = 0x01;
-  // CS_DAC is high when idle
-  spiSettings.idleCSValue = 0x0003;
+  if (DAC5687_IsFactoryRegister(startAddr)) {
+    fprintf(stderr, "can't write to address %x# as it's for factory use only\n", startAddr);
+    return false;
+  }
 
-  // CS_DAC is low when active
-  spiSettings.activeCSValue = 0x0002;
+  if (bytes > (0x08 - startAddr) || bytes > (0x1A - startAddr) || bytes > (0x1D - startAddr)) {
+    fprintf(stderr, "write intersects with factory use only register\n");
+    return false;
+  }
 
-  MCP2210ChipSettings chipSettings = {0};
+  MCP2210SPITransferSettings spiSettings = {0};
 
-  if (MCP2210_ReadChipSettings(handle, &chipSettings, true) < 0) {
-    fprintf(stderr, "WriteSRAMAddress()->ReadChipSettings() failed\n");
+  if (!DAC5687_SetupBus(handle, &spiSettings, bytes + 1)) {
     return false;
   }
 
-  chipSettings.gp0Designation = CS;
-  chipSettings.gp1Designation = GPIO;
-  chipSettings.gp5Designation = DF;
+  if (!DAC5687_Burst(handle, &spiSettings, startAddr, txBytes, bytes, false)) {
+    fprintf(stderr, "WriteRegisters() failed\n");
+    return false;
+  }
+  return true;
+}
 
-  chipSettings.defaultGPIODirection = 0x0000;
-  chipSettings.defaultGPIOValue = 0xFFFF;
+bool DAC5687_ReadRegister(hid_device *handle, DAC5687Address addr, unsigned char *rxByte) {
+  if (handle == NULL) {
+    fprintf(stderr, "dev must not be null\n");
+    return false;
+  }
 
-  if (MCP2210_WriteChipSettings(handle, &chipSettings, true) < 0) {
-    fprintf(stderr, "WriteSRAMAddress()->WriteChipSettings() failed\n");
+  if (rxByte == NULL) {
+    fprintf(stderr, "output byte can't be null\n");
     return false;
   }
-  
-  // construct the instruction cycle byte
-  unsigned char instrByte = (0x1 << 7) | (addr & 0x1F);
 
-  unsigned char spiTxBytes[2] = {instrByte, 0x00};
-  unsigned char rxBuf[2];
+  MCP2210SPITransferSettings spiSettings = {0};
+
+  if (!DAC5687_SetupBus(handle, &spiSettings, 2)) {
+    return false;
+  }
 
-  if (MCP2210_SpiDataTransfer(handle, sizeof(spiTxBytes), spiTxBytes, rxBuf, &spiSettings) < 0) {
+  if (!DAC5687_Burst(handle, &spiSettings, addr, rxByte, 1, true)) {
     fprintf(stderr, "RegisterRead() failed\n");
     return false;
   }
-  *rxByte = rxBuf[1];
   return true;
 }
 
@@ -302,12 +389,12 @@ bool DAC5687_ReadRegisters(hid_device *handle, DAC5687Address startAddr, unsigne
     return false;
   }
 
-  if (bytes > 4) {
-    fprintf(stderr, "can't read more than 4 more registers\n");
+  if (bytes == 0 || bytes > 4) {
+    fprintf(stderr, "can only read 1 to 4 registers\n");
     return false;
   }
 
-  if (startAddr == 0x08 || startAddr == 0x1A || startAddr >= 0x1D) {
+  if (DAC5687_IsFactoryRegister(startAddr)) {
     fprintf(stderr, "can't read from address %x# as it's for factory use only\n", startAddr);
     return false;
   }
@@ -317,45 +404,400 @@ bool DAC5687_ReadRegisters(hid_device *handle, DAC5687Address startAddr, unsigne
     return false;
   }
 
-  // get current SPI settings
   MCP2210SPITransferSettings spiSettings = {0};
-  if (MCP2210_ReadSpiSettings(handle, &spiSettings, true) < 0) {
-    fprintf(stderr, "ReadRegisters()->ReadSpiSettings() failed\n");
+
+  if (!DAC5687_SetupBus(handle, &spiSettings, bytes + 1)) {
     return false;
   }
 
-  // number of bytes in the transfer + 1 for the instruction cycle
-  spiSettings.bitRate = 3000000;
+  memset(rxBytes, 0, bytes);
 
-  spiSettings.bytesPerTransaction = bytes + 1;
+  if (!DAC5687_Burst(handle, &spiSettings, startAddr, rxBytes, bytes, true)) {
+    fprintf(stderr, "ReadRegisters() failed\n");
+    return false;
+  }
+  return true;
+}
 
-  spiSettings.csToDataDelay = 0x01;
+bool DAC5687_WriteRegisterRange(hid_device *handle, DAC5687Address startAddr, const unsigned char *txBytes, unsigned int count) {
+  return DAC5687_Range(handle, startAddr, (unsigned char *)txBytes, count, false);
+}
 
-  spiSettings.dataToDataDelay = 0x00;
+bool DAC5687_ReadRegisterRange(hid_device *handle, DAC5687Address startAddr, unsigned char *rxBytes, unsigned int count) {
+  return DAC5687_Range(handle, startAddr, rxBytes, count, true);
+}
 
-  spiSettings.lastDataToCSDelay = 0x01;
+// reads or writes every run of consecutive registers in 'mask' in as few bursts as
+// it allows, setting the bus up once for all of them
+static bool DAC5687_ForEachRun(hid_device *handle, uint32_t mask, unsigned char *values, bool read) {
+  if (handle == NULL) {
+    fprintf(stderr, "handle can't be null\n");
+    return false;
+  }
 
-  // CS_DAC is high when idle
-  spiSettings.idleCSValue = 0x0003;
+  if (mask == 0) {
+    return true;
+  }
 
-  // CS_DAC is low when active
-  spiSettings.activeCSValue = 0x0002;
-  
-  // construct the instruction cycle byte
-  unsigned char readBytes = bytes - 1;
-  unsigned char instrByte = (0x1 << 7) | (startAddr & 0x1F) | ((readBytes & 0x03) << 5);
+  MCP2210SPITransferSettings spiSettings = {0};
 
-  unsigned char spiTxBytes[bytes + 1];
-  unsigned char rxBuf[bytes + 1];
+  if (!DAC5687_SetupBus(handle, &spiSettings, DAC5687_MAX_FRAME_BYTES)) {
+    return false;
+  }
 
-  spiTxBytes[0] = instrByte;
-  memset(&spiTxBytes[1], 0, bytes);
-  memset(rxBytes, 0, sizeof(rxBuf));
+  unsigned int addr = 0;
+  while (addr < DAC5687_NUM_REGISTERS) {
+    if (!(mask & (1UL << addr))) {
+      addr++;
+      continue;
+    }
 
-  if (MCP2210_SpiDataTransfer(handle, sizeof(spiTxBytes), spiTxBytes, rxBuf, &spiSettings) < 0) {
-    fprintf(stderr, "ReadRegisters() failed\n");
+    unsigned int end = addr;
+    while (end < DAC5687_NUM_REGISTERS && (mask & (1UL << end))) {
+      end++;
+    }
+
+    if (!DAC5687_BurstRange(handle, &spiSettings, addr, &values[addr], end - addr, read)) {
+      return false;
+    }
+    addr = end;
+  }
+  return true;
+}
+
+bool DAC5687_ReadRegisterMap(hid_device *handle, uint32_t mask, DAC5687RegisterMap *map) {
+  if (map == NULL) {
+    fprintf(stderr, "map can't be null\n");
+    return false;
+  }
+
+  if (mask & ~DAC5687_WRITABLE_MASK) {
+    fprintf(stderr, "mask includes factory use only registers\n");
+    return false;
+  }
+
+  memset(map, 0, sizeof(*map));
+
+  if (!DAC5687_ForEachRun(handle, mask, map->values, true)) {
+    return false;
+  }
+  map->mask = mask;
+  return true;
+}
+
+bool DAC5687_WriteRegisterMap(hid_device *handle, const DAC5687RegisterMap *map) {
+  if (map == NULL) {
+    fprintf(stderr, "map can't be null\n");
+    return false;
+  }
+
+  if (map->mask & ~DAC5687_WRITABLE_MASK) {
+    fprintf(stderr, "map includes factory use only registers\n");
+    return false;
+  }
+
+  unsigned char values[DAC5687_NUM_REGISTERS];
+  memcpy(values, map->values, sizeof(values));
+  return DAC5687_ForEachRun(handle, map->mask, values, false);
+}
+
+uint64_t DAC5687_Fingerprint(const DAC5687RegisterMap *map) {
+  uint64_t hash = Hash_FNV1a64(HASH_FNV1A64_INIT, &map->mask, sizeof(map->mask));
+  unsigned int addr;
+  for (addr = 0; addr < DAC5687_NUM_REGISTERS; addr++) {
+    if (map->mask & (1UL << addr)) {
+      hash = Hash_FNV1a64(hash, &map->values[addr], 1);
+    }
+  }
+  return hash;
+}
+
+void DAC5687_EncodeWriteFrame(DAC5687Frame *frame, unsigned int startAddr, const unsigned char *bytes, unsigned int count) {
+  frame->len = (unsigned char)(count + 1);
+  frame->bytes[0] = DAC5687_Instruction(startAddr, count, false);
+  memset(&frame->bytes[1], 0, DAC5687_MAX_FRAME_BYTES - 1);
+  memcpy(&frame->bytes[1], bytes, count);
+}
+
+// checks a frame is a write of 1-4 registers that doesn't touch a factory register
+static bool DAC5687_IsValidWriteFrame(const DAC5687Frame *frame) {
+  if (frame->len < 2 || frame->len > DAC5687_MAX_FRAME_BYTES || (frame->bytes[0] & 0x80)) {
+    return false;
+  }
+
+  unsigned int count = ((frame->bytes[0] >> 5) & 0x03) + 1;
+  unsigned int startAddr = frame->bytes[0] & 0x1F;
+  if (count != frame->len - 1u) {
+    return false;
+  }
+
+  unsigned int addr;
+  for (addr = startAddr; addr < startAddr + count; addr++) {
+    if (DAC5687_IsFactoryRegister(addr)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool DAC5687_WriteFrames(hid_device *handle, const DAC5687Frame *frames, unsigned int numFrames) {
+  if (handle == NULL || frames == NULL) {
+    fprintf(stderr, "handle and frames can't be null\n");
+    return false;
+  }
+
+  unsigned int i;
+  unsigned int maxLen = 0;
+  for (i = 0; i < numFrames; i++) {
+    if (!DAC5687_IsValidWriteFrame(&frames[i])) {
+      fprintf(stderr, "frame %u isn't a valid register write\n", i);
+      return false;
+    }
+    maxLen = frames[i].len > maxLen ? frames[i].len : maxLen;
+  }
+
+  if (numFrames == 0) {
+    return true;
+  }
+
+  // one bus setup for the lot; each transfer sets its own length
+  MCP2210SPITransferSettings spiSettings = {0};
+
+  if (!DAC5687_SetupBus(handle, &spiSettings, maxLen)) {
+    return false;
+  }
+
+  for (i = 0; i < numFrames; i++) {
+    unsigned char txBytes[DAC5687_MAX_FRAME_BYTES];
+    unsigned char rxBytes[DAC5687_MAX_FRAME_BYTES];
+    memcpy(txBytes, frames[i].bytes, frames[i].len);
+
+    if (MCP2210_SpiDataTransfer(handle, frames[i].len, txBytes, rxBytes, &spiSettings) < 0) {
+      fprintf(stderr, "WriteFrames() failed at frame %u\n", i);
+      return false;
+    }
+  }
+  return true;
+}
+
+void DAC5687_InitShadow(DAC5687Shadow *shadow) {
+  memset(shadow, 0, sizeof(*shadow));
+}
+
+bool DAC5687_Resync(hid_device *handle, DAC5687Shadow *shadow, uint32_t mask) {
+  if (shadow == NULL) {
+    fprintf(stderr, "shadow can't be null\n");
+    return false;
+  }
+
+  DAC5687RegisterMap current;
+
+  if (!DAC5687_ReadRegisterMap(handle, mask, &current)) {
+    return false;
+  }
+
+  unsigned int addr;
+  for (addr = 0; addr < DAC5687_NUM_REGISTERS; addr++) {
+    if (mask & (1UL << addr)) {
+      shadow->known.values[addr] = current.values[addr];
+    }
+  }
+  shadow->known.mask |= mask;
+  shadow->dirty &= ~mask;
+  return true;
+}
+
+bool DAC5687_UpdateBits(DAC5687Shadow *shadow, DAC5687Address reg, unsigned char mask, unsigned char value) {
+  if (shadow == NULL) {
+    fprintf(stderr, "shadow can't be null\n");
+    return false;
+  }
+
+  if (DAC5687_IsFactoryRegister(reg)) {
+    fprintf(stderr, "can't write to address %#x as it's for factory use only\n", reg);
+    return false;
+  }
+
+  bool known = (shadow->known.mask & (1UL << reg)) != 0;
+  if (!known && mask != 0xFF) {
+    fprintf(stderr, "register %#x hasn't been read yet, resync it first\n", reg);
+    return false;
+  }
+
+  unsigned char old = shadow->known.values[reg];
+  unsigned char updated = (unsigned char)((old & ~mask) | (value & mask));
+
+  if (!known || updated != old) {
+    shadow->known.values[reg] = updated;
+    shadow->known.mask |= (1UL << reg);
+    shadow->dirty |= (1UL << reg);
+  }
+  return true;
+}
+
+// encodes the dirty registers of 'shadow' into 'frames', returning how many it took
+static unsigned int DAC5687_EncodeDirty(const DAC5687Shadow *shadow, DAC5687Frame *frames) {
+  unsigned int numFrames = 0;
+
+  // start a burst at the lowest dirty register not yet covered and stretch it over
+  // known registers to the last dirty one within reach. Greedy is optimal here since
+  // every burst can cover at most 4 registers.
+  unsigned int addr = 0;
+  while (addr < DAC5687_NUM_REGISTERS) {
+    if (!(shadow->dirty & (1UL << addr))) {
+      addr++;
+      continue;
+    }
+
+    unsigned int count = 1;
+    unsigned int reach;
+    for (reach = 1; reach < 4 && addr + reach < DAC5687_NUM_REGISTERS; reach++) {
+      uint32_t bit = 1UL << (addr + reach);
+      if (!(shadow->known.mask & bit) || DAC5687_IsFactoryRegister(addr + reach)) {
+        break;
+      }
+      if (shadow->dirty & bit) {
+        count = reach + 1;
+      }
+    }
+
+    DAC5687_EncodeWriteFrame(&frames[numFrames++], addr, &shadow->known.values[addr], count);
+    addr += count;
+  }
+  return numFrames;
+}
+
+bool DAC5687_Flush(hid_device *handle, DAC5687Shadow *shadow) {
+  if (shadow == NULL) {
+    fprintf(stderr, "shadow can't be null\n");
+    return false;
+  }
+
+  DAC5687Frame frames[DAC5687_NUM_REGISTERS];
+  unsigned int numFrames = DAC5687_EncodeDirty(shadow, frames);
+
+  if (numFrames == 0) {
+    return true;
+  }
+
+  if (!DAC5687_WriteFrames(handle, frames, numFrames)) {
+    return false;
+  }
+  shadow->dirty = 0;
+  return true;
+}
+
+void DAC5687_InitNCO(DAC5687NCO *nco, double refClockHz) {
+  memset(nco, 0, sizeof(*nco));
+  nco->refClockHz = refClockHz;
+  DAC5687_InitShadow(&nco->shadow);
+}
+
+uint32_t DAC5687_NCOFrequencyWord(const DAC5687NCO *nco, double freqHz) {
+  double cycles = freqHz / nco->refClockHz;
+  cycles -= floor(cycles);
+  return (uint32_t)llround(cycles * 4294967296.0);
+}
+
+uint16_t DAC5687_NCOPhaseWord(double phase) {
+  double turns = phase / (2 * M_PI);
+  turns -= floor(turns);
+  return (uint16_t)lround(turns * 65536.0);
+}
+
+unsigned int DAC5687_EncodeNCO(DAC5687NCO *nco, double freqHz, double phase, DAC5687Frame *frames) {
+  uint32_t freqWord = DAC5687_NCOFrequencyWord(nco, freqHz);
+  uint16_t phaseWord = DAC5687_NCOPhaseWord(phase);
+
+  // least significant byte first
+  unsigned int i;
+  for (i = 0; i < 4; i++) {
+    DAC5687_UpdateBits(&nco->shadow, NCOFreq1 + i, 0xFF, (unsigned char)(freqWord >> (8 * i)));
+  }
+  for (i = 0; i < 2; i++) {
+    DAC5687_UpdateBits(&nco->shadow, NCOPhase0 + i, 0xFF, (unsigned char)(phaseWord >> (8 * i)));
+  }
+
+  // the six registers are consecutive, so this is at most one 4-byte and one 2-byte burst
+  unsigned int numFrames = DAC5687_EncodeDirty(&nco->shadow, frames);
+  nco->shadow.dirty = 0;
+
+  if (numFrames > 0 && nco->latch) {
+    DAC5687_EncodeWriteFrame(&frames[numFrames++], SyncCntl, &nco->syncCntl, 1);
+  }
+  return numFrames;
+}
+
+bool DAC5687_ReadyNCO(hid_device *handle, DAC5687NCO *nco) {
+  if (handle == NULL || nco == NULL) {
+    fprintf(stderr, "handle and nco can't be null\n");
+    return false;
+  }
+
+  MCP2210Counters counters;
+  MCP2210_GetCounters(&counters);
+
+  // nothing has moved the chip selects since we pointed them at the DAC
+  if (nco->busHandle == handle && counters.linkErrors == nco->busLinkErrors &&
+      counters.chipSettingsWrites == nco->busChipSettingsWrites) {
+    return true;
+  }
+
+  nco->busHandle = NULL;
+  if (!DAC5687_SetupBus(handle, &nco->spiSettings, DAC5687_MAX_FRAME_BYTES)) {
+    DAC5687_InitShadow(&nco->shadow);
     return false;
   }
-  memcpy(rxBytes, &rxBuf[1], bytes);
+
+  MCP2210_GetCounters(&counters);
+  nco->busHandle = handle;
+  nco->busChipSettingsWrites = counters.chipSettingsWrites;
+  nco->busLinkErrors = counters.linkErrors;
   return true;
-}
\ No newline at end of file
+}
+
+bool DAC5687_SendNCO(hid_device *handle, DAC5687NCO *nco, const DAC5687Frame *frames, unsigned int numFrames) {
+  if (handle == NULL || nco == NULL || frames == NULL) {
+    fprintf(stderr, "handle, nco and frames can't be null\n");
+    return false;
+  }
+
+  if (numFrames == 0) {
+    return true;
+  }
+
+  if (!DAC5687_ReadyNCO(handle, nco)) {
+    return false;
+  }
+
+  unsigned int i;
+  for (i = 0; i < numFrames; i++) {
+    unsigned char txBytes[DAC5687_MAX_FRAME_BYTES];
+    unsigned char rxBytes[DAC5687_MAX_FRAME_BYTES];
+    memcpy(txBytes, frames[i].bytes, frames[i].len);
+
+    if (MCP2210_SpiDataTransfer(handle, frames[i].len, txBytes, rxBytes, &nco->spiSettings) < 0) {
+      fprintf(stderr, "SendNCO() failed at frame %u\n", i);
+      // we don't know what made it, so resend everything next time
+      DAC5687_InitShadow(&nco->shadow);
+      nco->busHandle = NULL;
+      return false;
+    }
+  }
+
+  MCP2210Counters counters;
+  MCP2210_GetCounters(&counters);
+  nco->busLinkErrors = counters.linkErrors;
+  return true;
+}
+
+bool DAC5687_SetNCO(hid_device *handle, DAC5687NCO *nco, double freqHz, double phase) {
+  if (nco == NULL) {
+    fprintf(stderr, "nco can't be null\n");
+    return false;
+  }
+
+  DAC5687Frame frames[DAC5687_NCO_MAX_FRAMES];
+  unsigned int numFrames = DAC5687_EncodeNCO(nco, freqHz, phase, frames);
+  return DAC5687_SendNCO(handle, nco, frames, numFrames);
+}
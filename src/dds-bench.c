@@ -0,0 +1,457 @@
+/*
+ * MIT License
+ * 
+ * Copyright (c) 2020 Eli Reed
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/*
+ * dds-bench measures the host side of dds-host without the board attached.
+ *
+ * Micro-benchmarks time CSV parsing, SRAM packet encoding and MCP2210 report
+ * building in isolation. Macro-benchmarks run whole image uploads and DAC
+ * configurations against the simulated MCP2210 (see dds-host/mcp2210-sim.h) and
+ * report both the host CPU time and the time the simulator predicts at the given
+ * per-report latency.
+ *
+ * Results are printed as JSON with a fixed set of keys in a fixed order, one
+ * result per line, so two runs can be compared with diff.
+ */
+
+// C
+#include <stdio.h>    // for printf()
+#include <stdbool.h>  // for bool type
+#include <stdlib.h>   // for exit(), malloc(), free()
+#include <stdint.h>   // for fixed-width integer types
+#include <string.h>   // for memset()
+#include <getopt.h>   // for getopt_long()
+#include <unistd.h>   // for unlink(), dup2()
+#include <fcntl.h>    // for open()
+#include <time.h>     // for clock_gettime()
+
+// HIDAPI
+#include "hidapi/hidapi.h"
+
+// project libraries
+#include "dds-host/host.h"
+#include "dds-host/image.h"
+#include "dds-host/mcp2210.h"
+#include "dds-host/mcp2210-sim.h"
+#include "dds-host/cpld.h"
+#include "dds-host/util/csv.h"
+
+// bump whenever a key or a benchmark's meaning changes
+#define BENCH_FORMAT_VERSION    1
+
+// every benchmark repeats until it has run for at least this long
+#define BENCH_MIN_NS            200000000ULL
+
+// ...but never more than this many times
+#define BENCH_MAX_ITERATIONS    100000
+
+typedef struct bench_options_st {
+  unsigned int reportLatencyUs;
+  // make the simulator sleep out its latency, so wall-clock numbers mean something
+  bool realtime;
+  // words per upload in the upload benchmark
+  unsigned int uploadWords;
+} BenchOptions;
+
+// one iteration of a benchmark. Returns the number of operations it performed, or 0
+// on failure.
+typedef unsigned long long (*BenchFn)(void *arg);
+
+static bool firstResult = true;
+
+static unsigned long long Bench_Now() {
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (unsigned long long)now.tv_sec * 1000000000ULL + (unsigned long long)now.tv_nsec;
+}
+
+// runs 'fn' until BENCH_MIN_NS has passed and prints the result. 'sim' is the
+// simulator 'fn' talks to, if any, so its modelled time can be included. Returns false if 'fn' failed.
+static bool Bench_Run(const char *name, unsigned int param, const char *unit,
+                      BenchFn fn, void *arg, MCP2210Sim *sim) {
+  MCP2210SimStats before, after;
+  memset(&before, 0, sizeof(before));
+  memset(&after, 0, sizeof(after));
+
+  if (sim != NULL) {
+    MCP2210Sim_GetStats(sim, &before);
+  }
+
+  MCP2210Counters countersBefore, countersAfter;
+  MCP2210_GetCounters(&countersBefore);
+
+  unsigned long long iterations = 0, ops = 0;
+  unsigned long long start = Bench_Now(), elapsed = 0;
+  do {
+    unsigned long long done = fn(arg);
+    if (done == 0) {
+      fprintf(stderr, "benchmark %s (%u) failed\n", name, param);
+      return false;
+    }
+    ops += done;
+    iterations++;
+    elapsed = Bench_Now() - start;
+  } while (elapsed < BENCH_MIN_NS && iterations < BENCH_MAX_ITERATIONS);
+
+  MCP2210_GetCounters(&countersAfter);
+
+  if (sim != NULL) {
+    MCP2210Sim_GetStats(sim, &after);
+  }
+
+  printf("%s    {\"name\": \"%s\", \"param\": %u, \"unit\": \"%s\", \"iterations\": %llu, "
+         "\"ops\": %llu, \"ns_per_op\": %.1f, \"ops_per_second\": %.1f, "
+         "\"reports_per_op\": %.3f, \"simulated_us_per_op\": %.3f}",
+         firstResult ? "" : ",\n", name, param, unit, iterations, ops,
+         (double)elapsed / ops, ops * 1e9 / elapsed,
+         (double)(countersAfter.reports - countersBefore.reports) / ops,
+         (after.elapsedNs - before.elapsedNs) / 1e3 / ops);
+  fflush(stdout);
+  firstResult = false;
+  return true;
+}
+
+// writes a temporary CSV. 'row' is given a buffer and the row index and fills in one
+// line. Returns false on failure; 'fileName' holds the name to unlink() otherwise.
+static bool Bench_WriteCSV(char *fileName, unsigned int rows,
+                           void (*row)(char *line, size_t len, unsigned int i)) {
+  strcpy(fileName, "/tmp/dds-bench-XXXXXX");
+  int fd = mkstemp(fileName);
+
+  if (fd < 0) {
+    perror("mkstemp() failed");
+    return false;
+  }
+
+  FILE *fp = fdopen(fd, "w");
+  if (fp == NULL) {
+    perror("fdopen() failed");
+    close(fd);
+    unlink(fileName);
+    return false;
+  }
+
+  char line[64];
+  unsigned int i;
+  for (i = 0; i < rows; i++) {
+    row(line, sizeof(line), i);
+    fputs(line, fp);
+  }
+  fclose(fp);
+  return true;
+}
+
+static void Bench_DataRow(char *line, size_t len, unsigned int i) {
+  snprintf(line, len, "%x,%x,%x,%x\n", i & 0xFF, (i >> 8) & 0xFF, (i * 7) & 0xFF, (i * 13) & 0xFF);
+}
+
+// every writable register below the factory block, in address order
+static void Bench_DACRow(char *line, size_t len, unsigned int i) {
+  unsigned int addr = i + 1;
+  if (addr >= 0x08) {
+    addr++;
+  }
+  snprintf(line, len, "%02x,%02x\n", addr, (addr * 37) & 0xFF);
+}
+
+#define BENCH_DAC_ROWS    0x18
+
+/* Micro-benchmarks */
+
+static unsigned long long Bench_ParseCSV(void *arg) {
+  const char *fileName = (const char *)arg;
+  CSVFile *file = CSV_Open(fileName);
+
+  if (file == NULL) {
+    return 0;
+  }
+
+  // the same access pattern Image_FromCSV() uses
+  unsigned long long row, col;
+  for (row = 1; row <= file->numRows; row++) {
+    for (col = 1; col <= file->numCols; col++) {
+      free(CSV_ReadElement(file, row, col));
+    }
+  }
+
+  unsigned long long rows = file->numRows;
+  CSV_Close(file);
+  return rows;
+}
+
+#define BENCH_ENCODE_PACKETS    (SRAM_MAX_ADDRESS + 1)
+
+// keeps the compiler from optimising the encoding away
+static volatile uint8_t encodeSink;
+
+static unsigned long long Bench_EncodePackets(void *arg) {
+  uint8_t packet[SRAM_PACKET_SIZE];
+  uint8_t acc = 0;
+  unsigned int addr;
+
+  for (addr = 0; addr < BENCH_ENCODE_PACKETS; addr++) {
+    CPLD_EncodePacket(packet, addr, false, addr * 2654435761U);
+    acc ^= packet[0] ^ packet[2] ^ packet[6];
+  }
+  encodeSink = acc;
+  return BENCH_ENCODE_PACKETS;
+}
+
+// answers every report instantly, completing SPI transfers in one report, so only the
+// host's own cost of building and parsing reports is measured
+static int Bench_NullTransport(void *ctx, const uint8_t *txBuf, uint8_t *rxBuf) {
+  memset(rxBuf, 0, MCP2210_REPORT_LEN);
+  rxBuf[0] = txBuf[0];
+  if (txBuf[0] == SpiDataTransfer) {
+    rxBuf[2] = txBuf[1];
+    rxBuf[3] = 0x10;
+    memcpy(&rxBuf[4], &txBuf[4], txBuf[1]);
+  }
+  return MCP2210_REPORT_LEN;
+}
+
+#define BENCH_REPORT_BATCH    10000
+
+static unsigned long long Bench_BuildTransfers(void *arg) {
+  hid_device *handle = (hid_device *)arg;
+  MCP2210SPITransferSettings spi = {0};
+  uint8_t txBytes[SRAM_PACKET_SIZE], rxBytes[SRAM_PACKET_SIZE];
+  unsigned int i;
+
+  spi.bitRate = 3000000;
+  for (i = 0; i < BENCH_REPORT_BATCH; i++) {
+    CPLD_EncodePacket(txBytes, i, false, i);
+    if (MCP2210_SpiDataTransfer(handle, SRAM_PACKET_SIZE, txBytes, rxBytes, &spi) < 0) {
+      return 0;
+    }
+  }
+  return BENCH_REPORT_BATCH;
+}
+
+static unsigned long long Bench_BuildSettings(void *arg) {
+  hid_device *handle = (hid_device *)arg;
+  MCP2210SPITransferSettings spi = {0};
+  unsigned int i;
+
+  for (i = 0; i < BENCH_REPORT_BATCH; i++) {
+    spi.bitRate = 3000000 + i;
+    if (MCP2210_WriteSpiSettings(handle, &spi, true) != 0x00) {
+      return 0;
+    }
+  }
+  return BENCH_REPORT_BATCH;
+}
+
+/* Macro-benchmarks against the simulator */
+
+typedef struct bench_upload_st {
+  hid_device *handle;
+  SRAMImage image;
+} BenchUpload;
+
+static unsigned long long Bench_Upload(void *arg) {
+  BenchUpload *upload = (BenchUpload *)arg;
+
+  if (Host_UploadImage(upload->handle, &upload->image, NULL) != 0) {
+    return 0;
+  }
+  return upload->image.numWords;
+}
+
+typedef struct bench_configure_st {
+  hid_device *handle;
+  const char *dacFileName;
+  bool cold;
+} BenchConfigure;
+
+static unsigned long long Bench_Configure(void *arg) {
+  BenchConfigure *configure = (BenchConfigure *)arg;
+
+  if (!Host_ConfigureDevices(configure->handle, configure->dacFileName,
+                             configure->dacFileName, configure->cold)) {
+    return 0;
+  }
+  return 1;
+}
+
+static bool Bench_Micro() {
+  static const unsigned int csvRows[] = {64, 256, 1024, 4096};
+  bool ok = true;
+  unsigned int i;
+
+  for (i = 0; ok && i < sizeof(csvRows) / sizeof(csvRows[0]); i++) {
+    char fileName[32];
+    if (!Bench_WriteCSV(fileName, csvRows[i], Bench_DataRow)) {
+      return false;
+    }
+    ok = Bench_Run("csv_parse", csvRows[i], "row", Bench_ParseCSV, fileName, NULL);
+    unlink(fileName);
+  }
+
+  ok = ok && Bench_Run("sram_encode", SRAM_PACKET_SIZE, "packet", Bench_EncodePackets, NULL, NULL);
+
+  // any unique pointer will do as the handle
+  static char nullDevice;
+  hid_device *handle = (hid_device *)&nullDevice;
+  MCP2210_SetTransport(handle, Bench_NullTransport, NULL);
+  ok = ok && Bench_Run("report_spi_transfer", SRAM_PACKET_SIZE, "transfer", Bench_BuildTransfers, handle, NULL);
+  ok = ok && Bench_Run("report_spi_settings", 0, "report", Bench_BuildSettings, handle, NULL);
+  MCP2210_SetTransport(handle, NULL, NULL);
+  return ok;
+}
+
+static bool Bench_Macro(const BenchOptions *opts) {
+  MCP2210Sim *sim = MCP2210Sim_Create(opts->reportLatencyUs);
+
+  if (sim == NULL) {
+    return false;
+  }
+  MCP2210Sim_SetRealtime(sim, opts->realtime);
+
+  hid_device *handle = MCP2210Sim_Open(sim);
+  bool ok = true;
+
+  BenchUpload upload;
+  upload.handle = handle;
+  upload.image.numWords = opts->uploadWords;
+  upload.image.words = (unsigned int *)malloc(opts->uploadWords * sizeof(unsigned int));
+  if (upload.image.words == NULL) {
+    fprintf(stderr, "Failed to allocate upload image\n");
+    ok = false;
+  } else {
+    unsigned int i;
+    for (i = 0; i < opts->uploadWords; i++) {
+      upload.image.words[i] = i * 2654435761U;
+    }
+    ok = Bench_Run("upload", opts->uploadWords, "word", Bench_Upload, &upload, sim);
+    free(upload.image.words);
+  }
+
+  char dacFileName[32];
+  if (ok && Bench_WriteCSV(dacFileName, BENCH_DAC_ROWS, Bench_DACRow)) {
+    BenchConfigure configure;
+    configure.handle = handle;
+    configure.dacFileName = dacFileName;
+
+    // the cold runs leave the simulated board configured, so the warm runs find a match
+    configure.cold = true;
+    ok = Bench_Run("configure_cold", BENCH_DAC_ROWS, "configuration", Bench_Configure, &configure, sim);
+    configure.cold = false;
+    if (ok) {
+      // every warm run says "board already configured" on stderr; keep that out of the way
+      fflush(stderr);
+      int savedStderr = dup(STDERR_FILENO);
+      int devNull = open("/dev/null", O_WRONLY);
+      if (savedStderr >= 0 && devNull >= 0) {
+        dup2(devNull, STDERR_FILENO);
+      }
+      ok = Bench_Run("configure_warm", BENCH_DAC_ROWS, "configuration", Bench_Configure, &configure, sim);
+      if (savedStderr >= 0 && devNull >= 0) {
+        dup2(savedStderr, STDERR_FILENO);
+      }
+      if (savedStderr >= 0) {
+        close(savedStderr);
+      }
+      if (devNull >= 0) {
+        close(devNull);
+      }
+      if (!ok) {
+        fprintf(stderr, "benchmark configure_warm failed\n");
+      }
+    }
+    unlink(dacFileName);
+  } else {
+    ok = false;
+  }
+
+  MCP2210_Close(handle);
+  MCP2210Sim_Destroy(sim);
+  return ok;
+}
+
+static void PrintUsage() {
+  fprintf(stderr, "Usage: ./bin/dds-bench [--report-latency <us>] [--realtime] [--upload-words <n>]\n");
+}
+
+static bool ParseArgs(int argc, char *argv[], BenchOptions *opts) {
+  static const struct option longOpts[] = {
+    {"report-latency", required_argument, NULL, 'L'},
+    {"realtime", no_argument, NULL, 't'},
+    {"upload-words", required_argument, NULL, 'w'},
+    {NULL, 0, NULL, 0},
+  };
+
+  memset(opts, 0, sizeof(*opts));
+  opts->reportLatencyUs = MCP2210SIM_DEFAULT_LATENCY_US;
+  opts->uploadWords = 4096;
+
+  int opt;
+  char *end;
+  while ((opt = getopt_long(argc, argv, "", longOpts, NULL)) != -1) {
+    switch (opt) {
+      case ('L'):
+        opts->reportLatencyUs = (unsigned int)strtoul(optarg, &end, 10);
+        if (*end != '\0') {
+          fprintf(stderr, "bad --report-latency: %s\n", optarg);
+          return false;
+        }
+        break;
+      case ('t'):
+        opts->realtime = true;
+        break;
+      case ('w'):
+        opts->uploadWords = (unsigned int)strtoul(optarg, &end, 10);
+        if (*end != '\0' || opts->uploadWords == 0 || opts->uploadWords > SRAM_MAX_ADDRESS + 1) {
+          fprintf(stderr, "bad --upload-words: %s\n", optarg);
+          return false;
+        }
+        break;
+      default:
+        return false;
+    }
+  }
+
+  if (optind != argc) {
+    fprintf(stderr, "unexpected argument: %s\n", argv[optind]);
+    return false;
+  }
+  return true;
+}
+
+int main(int argc, char *argv[]) {
+  BenchOptions opts;
+
+  if (!ParseArgs(argc, argv, &opts)) {
+    PrintUsage();
+    return EXIT_FAILURE;
+  }
+
+  printf("{\n  \"version\": %d,\n  \"report_latency_us\": %u,\n  \"realtime\": %s,\n  \"results\": [\n",
+         BENCH_FORMAT_VERSION, opts.reportLatencyUs, opts.realtime ? "true" : "false");
+
+  bool ok = Bench_Micro() && Bench_Macro(&opts);
+
+  printf("\n  ]\n}\n");
+  return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -26,185 +26,453 @@
 #include <stdio.h>  // for printf()
 #include <stdbool.h>  // for bool type
 #include <stdlib.h> // for exit()
-#include <unistd.h> // for getopt()
+#include <getopt.h> // for getopt_long()
 #include <string.h> // for memset()
+#include <time.h>   // for clock_gettime()
+#include <signal.h> // for sigaction()
+#include <pthread.h> // for pthread_self()
 
 // HIDAPI
 #include "hidapi/hidapi.h"
 
 // project libraries
 #include "dds-host/dds-host.h"
+#include "dds-host/host.h"
+#include "dds-host/image.h"
+#include "dds-host/realtime.h"
+#include "dds-host/trace.h"
+#include "dds-host/script.h"
 #include "dds-host/mcp2210.h"
 #include "dds-host/dac5687.h"
-#include "dds-host/cpld.h"
-#include "dds-host/util/csv.h"
+#include "dds-host/dac-profile.h"
 
-static void PrintUsage() {
-  fprintf(stderr, "Usage: ./bin/dds-host --dac-config <filename> --mcp-config <filename> --data <filename>\n");
+// number of round trips --calibrate times if not told otherwise
+#define DEFAULT_CALIBRATION_REPORTS   200
+
+// most options all the modes have between them
+#define MAX_OPTIONS   64
+
+// the board itself, and what every mode does to it: configuration, calibration,
+// tracing and real-time I/O
+static const struct option deviceOpts[] = {
+  {"dac-config", required_argument, NULL, 'd'},
+  {"mcp-config", required_argument, NULL, 'm'},
+  {"cold", no_argument, NULL, 'c'},
+  {"compile-profile", required_argument, NULL, 'B'},
+  {"calibrate", optional_argument, NULL, 'C'},
+  {"trace", required_argument, NULL, 'T'},
+  {"realtime-io", optional_argument, NULL, 'I'},
+  {"rt-priority", required_argument, NULL, 'p'},
+  {NULL, 0, NULL, 0},
+};
+
+static const char * const deviceUsage[] = {
+  "Usage: ./bin/dds-host --dac-config <filename> --mcp-config <filename> [--cold] --data <filename>",
+  "                      [--offset <addr>] [--count <words>] [--source-offset <row>]",
+  "                      [--force] [--progress[=<ms>]] [--trace <filename>] [--journal <filename>]",
+  "                      [--realtime-io[=<cpu>] [--rt-priority <1-99>]]",
+  "       ./bin/dds-host --calibrate[=<reports>] [--dry-run ...]",
+  "       ./bin/dds-host --dac-config <filename> --compile-profile <filename>",
+  NULL,
+};
+
+static void DeviceMode_Defaults(Options *opts) {
+  opts->realtimeCpu = REALTIME_NO_CPU;
+  opts->realtimePriority = REALTIME_DEFAULT_PRIORITY;
 }
 
-static bool CheckArgs(int argc, char *argv[]) {
-  // we expect the args: --dac-config <filename> --mcp2210-config <filename> --data <filename>
-  // TODO: make CLI more flexible
-  if (argc != 7) {
-    fprintf(stderr, "Not enough args: %d\n", argc);
-    return false;
+static bool DeviceMode_ParseOption(int opt, const char *arg, Options *opts) {
+  char *end;
+
+  switch (opt) {
+    case ('d'):
+      opts->dacFileName = arg;
+      break;
+    case ('m'):
+      opts->mcpFileName = arg;
+      break;
+    case ('c'):
+      opts->cold = true;
+      break;
+    case ('B'):
+      opts->profileFileName = arg;
+      break;
+    case ('C'):
+      opts->calibrateReports = DEFAULT_CALIBRATION_REPORTS;
+      if (arg != NULL) {
+        opts->calibrateReports = (unsigned int)strtoul(arg, &end, 10);
+        if (*end != '\0' || opts->calibrateReports == 0) {
+          fprintf(stderr, "bad --calibrate: %s\n", arg);
+          return false;
+        }
+      }
+      break;
+    case ('T'):
+      opts->traceFileName = arg;
+      break;
+    case ('I'):
+      opts->realtime = true;
+      if (arg != NULL) {
+        opts->realtimeCpu = (int)strtol(arg, &end, 10);
+        if (*end != '\0' || opts->realtimeCpu < 0) {
+          fprintf(stderr, "bad --realtime-io: %s\n", arg);
+          return false;
+        }
+      }
+      break;
+    case ('p'):
+      opts->realtimePriority = (int)strtol(arg, &end, 10);
+      if (*end != '\0' || opts->realtimePriority < 1 || opts->realtimePriority > 99) {
+        fprintf(stderr, "bad --rt-priority: %s\n", arg);
+        return false;
+      }
+      break;
+    default:
+      return false;
+  }
+  return true;
+}
+
+// checked after every mode, so only what's left to say about the board is said here
+static bool DeviceMode_Check(const Options *opts) {
+  // none of these need the board configured, or even attached
+  if (opts->snapshot.fromSnapshotFileName != NULL || opts->replay.compileUploadFileName != NULL ||
+      opts->client.socketPath != NULL) {
+    return true;
+  }
+
+  // calibrating on its own is fine; anything else needs the usual inputs
+  if (opts->calibrateReports > 0 && !opts->dryRun.dryRun && opts->script.scriptFileName == NULL &&
+      opts->dacFileName == NULL && opts->mcpFileName == NULL && !UploadMode_HasUpload(opts) &&
+      !NCOMode_Requested(opts) && !SnapshotMode_Requested(opts)) {
+    return true;
   }
 
-  if (strcmp(argv[1], "--dac-config") != 0) {
+  // the script mode has already checked its configuration
+  if (opts->script.scriptFileName != NULL) {
+    return true;
+  }
+
+  // checking the registers on their own needs no configuration, but it's all or nothing
+  if (SnapshotMode_Requested(opts) && !UploadMode_HasUpload(opts) && !NCOMode_Requested(opts)) {
+    if ((opts->dacFileName == NULL) != (opts->mcpFileName == NULL)) {
+      fprintf(stderr, "--dac-config and --mcp-config must be given together\n");
+      return false;
+    }
+    return true;
+  }
+
+  if (opts->dacFileName == NULL) {
     fprintf(stderr, "missing dac config file option\n");
     return false;
   }
 
-  if (strcmp(argv[3], "--mcp-config") != 0) {
+  if (opts->mcpFileName == NULL) {
     fprintf(stderr, "missing mcp config file option\n");
     return false;
   }
 
-  if (strcmp(argv[5], "--data") != 0) {
+  if (!UploadMode_HasUpload(opts) && !NCOMode_Requested(opts)) {
     fprintf(stderr, "missing data file option\n");
     return false;
   }
   return true;
 }
 
-static bool ConfigureDevices(hid_device *handle, char *dacFileName, char *mcpFileName) {
-  CSVFile *dacConfigFile = CSV_Open(dacFileName);
-  CSVFile *mcpConfigFile = CSV_Open(mcpFileName);
+static const DDSHostMode DeviceMode = {
+  deviceOpts,
+  deviceUsage,
+  DeviceMode_Defaults,
+  DeviceMode_ParseOption,
+  DeviceMode_Check,
+};
 
-  if (dacConfigFile == NULL) {
-    return false;
+// every mode, in the order their usage is printed and their options are checked. The
+// board's options are checked after all the others.
+static const DDSHostMode * const modes[] = {
+  &DeviceMode,
+  &UploadMode,
+  &ShmMode,
+  &ReplayMode,
+  &PipelineMode,
+  &DryRunMode,
+  &NCOMode,
+  &SnapshotMode,
+  &ClientMode,
+  &ScriptMode,
+};
+
+#define NUM_MODES   (sizeof(modes) / sizeof(modes[0]))
+
+static void PrintUsage() {
+  unsigned int i, j;
+  for (i = 0; i < NUM_MODES; i++) {
+    for (j = 0; modes[i]->usage[j] != NULL; j++) {
+      fprintf(stderr, "%s\n", modes[i]->usage[j]);
+    }
   }
+}
 
-  if (mcpConfigFile == NULL) {
-    return false;
+// the mode that owns the option whose 'val' is 'opt', or NULL if none does
+static const DDSHostMode * FindMode(int opt) {
+  unsigned int i, j;
+  for (i = 0; i < NUM_MODES; i++) {
+    for (j = 0; modes[i]->longOpts[j].name != NULL; j++) {
+      if (modes[i]->longOpts[j].val == opt) {
+        return modes[i];
+      }
+    }
   }
+  return NULL;
+}
 
-  // configure the DAC first
-  if (!DAC5687_Configure(dacConfigFile, handle)) {
-    CSV_Close(mcpConfigFile);
-    CSV_Close(dacConfigFile);
-    return false;
+static bool ParseArgs(int argc, char *argv[], Options *opts) {
+  static struct option longOpts[MAX_OPTIONS + 1];
+  unsigned int numOpts = 0;
+  unsigned int i, j;
+
+  memset(opts, 0, sizeof(*opts));
+  for (i = 0; i < NUM_MODES; i++) {
+    for (j = 0; modes[i]->longOpts[j].name != NULL && numOpts < MAX_OPTIONS; j++) {
+      longOpts[numOpts++] = modes[i]->longOpts[j];
+    }
+    if (modes[i]->defaults != NULL) {
+      modes[i]->defaults(opts);
+    }
   }
+  memset(&longOpts[numOpts], 0, sizeof(longOpts[numOpts]));
 
-  // TODO: use a config file
-  // configure MCP2210 Chip settings
-  MCP2210ChipSettings chipSettings = {0};
-  chipSettings.gp0Designation = CS;
-  chipSettings.gp1Designation = CS;
-  chipSettings.gp3Designation = DF;
-  // leave the rest of pins as GPIOs
-  chipSettings.chipSettings = 0x00;
-  chipSettings.defaultGPIODirection = 0x0000;
-  chipSettings.defaultGPIOValue = 0xFFFF;
-
-  if (MCP2210_WriteChipSettings(handle, &chipSettings, true) < 0) {
-    CSV_Close(mcpConfigFile);
-    CSV_Close(dacConfigFile);
+  int opt;
+  while ((opt = getopt_long(argc, argv, "", longOpts, NULL)) != -1) {
+    const DDSHostMode *mode = FindMode(opt);
+    if (mode == NULL || !mode->parseOption(opt, optarg, opts)) {
+      return false;
+    }
+  }
+
+  if (optind != argc) {
+    fprintf(stderr, "unexpected argument: %s\n", argv[optind]);
     return false;
   }
 
-  // clean up
-  CSV_Close(mcpConfigFile);
-  CSV_Close(dacConfigFile);
-  return true;
+  // compiling a profile doesn't touch the board, so nothing else applies
+  if (opts->profileFileName != NULL) {
+    if (opts->dacFileName == NULL) {
+      fprintf(stderr, "--compile-profile needs --dac-config\n");
+      return false;
+    }
+    return true;
+  }
+
+  for (i = 1; i < NUM_MODES; i++) {
+    if (!modes[i]->check(opts)) {
+      return false;
+    }
+  }
+  return DeviceMode.check(opts);
 }
 
-int main(int argc, char *argv[]) {
-  if (!CheckArgs(argc, argv)) {
-    PrintUsage();
-    return EXIT_FAILURE;
+unsigned long long DDSHost_ElapsedNs(const struct timespec *start, const struct timespec *end) {
+  return (unsigned long long)(end->tv_sec - start->tv_sec) * 1000000000ULL +
+         (unsigned long long)end->tv_nsec - (unsigned long long)start->tv_nsec;
+}
+
+// times 'reports' GetChipStatus round trips on the attached device and stores the
+// mean in 'latencyUs'. That's the per-report latency --dry-run should be given.
+static bool Calibrate(hid_device *handle, unsigned int reports, unsigned int *latencyUs) {
+  unsigned long long total = 0, min = ~0ULL, max = 0;
+  unsigned int i;
+
+  for (i = 0; i < reports; i++) {
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    if (MCP2210_ReadChipStatus(handle) < 0) {
+      fprintf(stderr, "Calibrate()->ReadChipStatus() failed\n");
+      return false;
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    unsigned long long ns = DDSHost_ElapsedNs(&start, &end);
+    total += ns;
+    min = ns < min ? ns : min;
+    max = ns > max ? ns : max;
   }
 
+  *latencyUs = (unsigned int)((total / reports + 500) / 1000);
+  printf("calibration: %u reports, mean %llu us, min %llu us, max %llu us\n",
+         reports, total / reports / 1000, min / 1000, max / 1000);
+  printf("calibration: use --report-latency %u\n", *latencyUs);
+  return true;
+}
+
+// configures the board and runs the script or upload we were given
+static int RunDevice(const Options *opts) {
    // attempt to open an attached HID
   hid_device *handle = MCP2210_Init();
 
   if (handle == NULL) {
-    hid_exit();
     return EXIT_FAILURE;
   }
 
-  if (!ConfigureDevices(handle, argv[2], argv[4])) {
+  if (opts->dacFileName != NULL && !Host_ConfigureDevices(handle, opts->dacFileName, opts->mcpFileName, opts->cold)) {
     MCP2210_Close(handle);
     return EXIT_FAILURE;
   }
-  
-  CSVFile *dataFile = CSV_Open(argv[6]);
 
-  if (dataFile == NULL) {
+  if (opts->script.scriptFileName != NULL) {
+    bool ok = Script_Run(handle, opts->script.scriptFileName);
     MCP2210_Close(handle);
-    return EXIT_FAILURE;
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
   }
 
+  unsigned int failed = 0;
+
   // write SRAM data in whatever format we've been given
-  unsigned long long row, col;
-  unsigned int addr = 0;
-
-  switch (dataFile->numCols) {
-    case (4):
-    {
-      // 1 byte per column
-      for (row = 1; row <= dataFile->numRows; row++) {
-        unsigned int txData = 0;
-        for (col = 1; col <= dataFile->numCols; col++) {
-          // read the first byte and shift it in
-          const char * elem = CSV_ReadElement(dataFile, row, col);
-          unsigned int byteAsInt = (unsigned int) strtol(elem, NULL, 16);
-          free(elem);
-          txData |= ((byteAsInt && 0xFF) << (col - 1) * 8);
-        }
-        if (!CPLD_WriteSRAMAddress(handle, addr, txData)) {
-          fprintf(stderr, "WriteSRAMAddress() failed for addr: %d\n", addr);
-        }
-        addr++;
-      }
-      break;
+  if (opts->replay.replayFileName != NULL) {
+    failed = ReplayMode_Upload(handle, opts);
+  } else if (opts->shm.shmName != NULL) {
+    failed = ShmMode_Upload(handle, opts);
+  } else if (opts->pipeline.pipeline) {
+    failed = PipelineMode_Upload(handle, opts);
+  } else if (UploadMode_HasData(opts)) {
+    SRAMImage *image = UploadMode_LoadData(opts);
+
+    if (image == NULL) {
+      MCP2210_Close(handle);
+      return EXIT_FAILURE;
     }
-    case (2):
-    {
-      // 2 bytes per column
-      for (row = 1; row <= dataFile->numRows; row++) {
-        unsigned int txData = 0;
-        for (col = 1; col <= dataFile->numCols; col++) {
-          // read the first byte and shift it in
-          const char * elem = CSV_ReadElement(dataFile, row, col);
-          unsigned int byteAsInt = (unsigned int) strtol(elem, NULL, 16);
-          free(elem);
-          txData |= ((byteAsInt && 0xFF) << (col - 1) * 16);
-        }
-        if (!CPLD_WriteSRAMAddress(handle, addr, txData)) {
-          fprintf(stderr, "WriteSRAMAddress() failed for addr: %d\n", addr);
-        }
-        addr++;
-      }
-      break;
+
+    failed = UploadMode_Upload(&handle, image, opts, NULL);
+    Image_Free(image);
+  }
+
+  bool ok = failed == 0;
+  if (ok && NCOMode_Requested(opts)) {
+    ok = handle != NULL && NCOMode_Run(handle, opts);
+  }
+
+  if (ok && SnapshotMode_Requested(opts)) {
+    ok = handle != NULL && SnapshotMode_Run(handle, opts);
+  }
+
+  if (handle != NULL) {
+    MCP2210_Close(handle);
+  }
+  return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+// compiles --dac-config into a profile and says how much it saves
+static int CompileProfile(const Options *opts) {
+  DACProfile profile;
+
+  if (!DACProfile_CompileCSV(opts->dacFileName, &profile) || !DACProfile_Save(opts->profileFileName, &profile)) {
+    return EXIT_FAILURE;
+  }
+
+  unsigned int registers = 0;
+  unsigned int addr;
+  for (addr = 0; addr < DAC5687_NUM_REGISTERS; addr++) {
+    registers += (profile.map.mask >> addr) & 1;
+  }
+  printf("%s: %u registers in %u SPI frames\n", opts->profileFileName, registers, profile.numFrames);
+  return EXIT_SUCCESS;
+}
+
+
+// report round trips seen by --realtime-io, static so recording them never allocates
+static Jitter jitter;
+
+// locks memory and makes this thread, which does all the USB I/O, real-time. Threads
+// started afterwards (hidapi's reader among them) inherit the policy and core.
+static bool EnterRealtime(const Options *opts) {
+  Jitter_Reset(&jitter);
+
+  if (!Realtime_LockMemory() || !Realtime_SetThread(pthread_self(), opts->realtimeCpu, opts->realtimePriority)) {
+    fprintf(stderr, "couldn't enter real-time mode (this needs root or CAP_SYS_NICE and CAP_IPC_LOCK)\n");
+    return false;
+  }
+
+  MCP2210_SetJitter(&jitter);
+  return true;
+}
+
+static void OnInterrupt(int sig) {
+  (void)sig;
+  Host_RequestCancel();
+}
+
+int main(int argc, char *argv[]) {
+  Options opts;
+
+  if (!ParseArgs(argc, argv, &opts)) {
+    PrintUsage();
+    return EXIT_FAILURE;
+  }
+
+  if (opts.profileFileName != NULL) {
+    return CompileProfile(&opts);
+  }
+
+  if (opts.replay.compileUploadFileName != NULL) {
+    return ReplayMode_Compile(&opts);
+  }
+
+  if (opts.snapshot.fromSnapshotFileName != NULL) {
+    return SnapshotMode_Run(NULL, &opts) ? EXIT_SUCCESS : EXIT_FAILURE;
+  }
+
+  if (opts.client.socketPath != NULL) {
+    return ClientMode_Run(&opts);
+  }
+
+  if (opts.realtime && !EnterRealtime(&opts)) {
+    return EXIT_FAILURE;
+  }
+
+  if (opts.calibrateReports > 0) {
+    hid_device *handle = MCP2210_Init();
+    if (handle == NULL) {
+        return EXIT_FAILURE;
     }
-    case (1):
-    {
-      // 4 bytes per column
-      for (row = 1; row <= dataFile->numRows; row++) {
-        unsigned int txData = 0;
-        const char * elem = CSV_ReadElement(dataFile, row, 1);
-        unsigned int byteAsInt = (unsigned int) strtol(elem, NULL, 16);
-        free(elem);
-        txData |= ((byteAsInt && 0xFF) << (col - 1) * 16);
-        if (!CPLD_WriteSRAMAddress(handle, addr, txData)) {
-          fprintf(stderr, "WriteSRAMAddress() failed for addr: %d\n", addr);
-        }
-        addr++;
-      }
-      break;
+    bool ok = Calibrate(handle, opts.calibrateReports, &opts.dryRun.reportLatencyUs);
+    MCP2210_Close(handle);
+    if (!ok) {
+      return EXIT_FAILURE;
     }
-    default:
-    {
-      fprintf(stderr, "Data in the csv isn't formatted correctly. Check README for formatting notes.\n");
-      CSV_Close(dataFile);
-      MCP2210_Close(handle);
+    if (!UploadMode_HasUpload(&opts) && opts.script.scriptFileName == NULL && !NCOMode_Requested(&opts) &&
+        !SnapshotMode_Requested(&opts)) {
+      return EXIT_SUCCESS;
+    }
+  }
+
+  // everything from here on is traced, whether it goes to the board or the simulator
+  TraceFile *trace = NULL;
+  if (opts.traceFileName != NULL) {
+    trace = Trace_Create(opts.traceFileName);
+    if (trace == NULL) {
       return EXIT_FAILURE;
     }
+    MCP2210_SetTrace(trace);
   }
 
-  CSV_Close(dataFile);
-  MCP2210_Close(handle);
-  return EXIT_SUCCESS;
-}
\ No newline at end of file
+  // Ctrl-C stops an upload at its next checkpoint, leaving it resumable; a second
+  // one kills us as usual
+  struct sigaction action;
+  memset(&action, 0, sizeof(action));
+  action.sa_handler = OnInterrupt;
+  action.sa_flags = SA_RESETHAND;
+  sigaction(SIGINT, &action, NULL);
+
+  int res = opts.dryRun.dryRun ? DryRunMode_Run(&opts) : RunDevice(&opts);
+
+  if (trace != NULL) {
+    MCP2210_SetTrace(NULL);
+    Trace_Close(trace);
+  }
+
+  if (opts.realtime) {
+    MCP2210_SetJitter(NULL);
+    Jitter_Print(&jitter, "report jitter", stderr);
+  }
+  return res;
+}
@@ -0,0 +1,636 @@
+/*
+ * MIT License
+ * 
+ * Copyright (c) 2020 Eli Reed
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/*
+ * dds-hostd owns the MCP2210 for as long as it runs. It opens and configures the
+ * board once, then serves upload, register-write and readback jobs submitted by
+ * 'dds-host --socket' over a UNIX-domain socket (see dds-host/ipc.h).
+ *
+ * Every client gets its own thread, but only the scheduler's worker touches the
+ * device. DAC register jobs are control-class and preempt SRAM jobs between slices.
+ * Uploads can also come from a shared-memory ring (see dds-host/shm-ring.h) that the
+ * daemon maps and writes from directly.
+ */
+
+// C
+#include <stdio.h>    // for printf()
+#include <stdbool.h>  // for bool type
+#include <stdlib.h>   // for exit(), free()
+#include <string.h>   // for memset(), memcpy()
+#include <time.h>     // for clock_gettime()
+#include <signal.h>   // for sigaction()
+#include <errno.h>    // for errno
+#include <getopt.h>   // for getopt_long()
+#include <unistd.h>   // for close(), unlink()
+#include <pthread.h>  // for pthread_create()
+#include <sys/socket.h> // for accept()
+
+// HIDAPI
+#include "hidapi/hidapi.h"
+
+// project libraries
+#include "dds-host/host.h"
+#include "dds-host/cache.h"
+#include "dds-host/ipc.h"
+#include "dds-host/scheduler.h"
+#include "dds-host/realtime.h"
+#include "dds-host/mcp2210.h"
+#include "dds-host/dac5687.h"
+#include "dds-host/cpld.h"
+#include "dds-host/shm-ring.h"
+
+// how long one slice of a shared-memory upload waits for the producer
+#define SHM_STEP_WAIT_US      1000
+// and how long the producer can go quiet before the upload is abandoned
+#define SHM_IDLE_TIMEOUT_S    10
+#define SHM_MAX_NAME          255
+
+static volatile sig_atomic_t stopRequested = 0;
+
+static Scheduler *scheduler = NULL;
+
+// round trips seen by the worker with --realtime-io
+static Jitter jitter;
+static bool realtime = false;
+
+// state for an SRAM upload or readback job
+typedef struct sram_job_st {
+  unsigned int startAddr;
+  unsigned int count;
+  unsigned int *words;
+  unsigned int next;
+  unsigned int failures;
+} SRAMJob;
+
+// state for an upload from a shared-memory ring
+typedef struct shm_job_st {
+  ShmRing *ring;
+  unsigned int startAddr;
+  unsigned int next;
+  unsigned int failures;
+  bool invalidated;
+  // when the producer last handed over a word, to give up on one that's gone quiet
+  struct timespec lastWord;
+} ShmJob;
+
+// state for a DAC register job
+typedef struct dac_job_st {
+  DAC5687Address addr;
+  unsigned char bytes[4];
+  unsigned int count;
+  bool read;
+} DACJob;
+
+static void HandleSignal(int sig) {
+  stopRequested = 1;
+}
+
+static void PrintUsage() {
+  fprintf(stderr, "Usage: ./bin/dds-hostd --dac-config <filename> --mcp-config <filename> [--cold] [--socket <path>] [--slice <records>]\n");
+  fprintf(stderr, "                       [--realtime-io[=<cpu>] [--rt-priority <1-99>]]\n");
+}
+
+static bool UploadStep(hid_device *handle, void *arg, unsigned int maxRecords, bool *done) {
+  SRAMJob *job = (SRAMJob *)arg;
+  unsigned int count = job->count - job->next;
+  if (count > maxRecords) {
+    count = maxRecords;
+  }
+
+  // whatever the cache tag says the SRAM holds is about to stop being true
+  if (job->next == 0 && !Cache_Invalidate(handle)) {
+    return false;
+  }
+
+  job->failures += Host_WriteWords(handle, job->startAddr + job->next, &job->words[job->next], count);
+  job->next += count;
+  *done = (job->next == job->count);
+  return true;
+}
+
+static bool ShmStep(hid_device *handle, void *arg, unsigned int maxRecords, bool *done) {
+  ShmJob *job = (ShmJob *)arg;
+
+  if (!job->invalidated) {
+    if (!Cache_Invalidate(handle)) {
+      return false;
+    }
+    job->invalidated = true;
+  }
+
+  // wait only briefly, so control jobs don't queue behind a slow producer
+  const unsigned int *words;
+  unsigned int count;
+  if (!ShmRing_Peek(job->ring, SHM_STEP_WAIT_US, &words, &count)) {
+    return false;
+  }
+
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+
+  if (count == 0) {
+    *done = ShmRing_Drained(job->ring);
+    if (!*done && now.tv_sec - job->lastWord.tv_sec >= SHM_IDLE_TIMEOUT_S) {
+      fprintf(stderr, "shm upload: no words for %d s, giving up\n", SHM_IDLE_TIMEOUT_S);
+      return false;
+    }
+    return true;
+  }
+
+  if (count > maxRecords) {
+    count = maxRecords;
+  }
+  if (count > SRAM_MAX_ADDRESS + 1 - job->startAddr - job->next) {
+    fprintf(stderr, "shm upload: the ring holds more words than fit in SRAM from %05x\n", job->startAddr);
+    return false;
+  }
+
+  job->failures += Host_WriteWords(handle, job->startAddr + job->next, words, count);
+  ShmRing_Consume(job->ring, count);
+  job->next += count;
+  job->lastWord = now;
+  *done = ShmRing_Drained(job->ring);
+  return true;
+}
+
+static bool ReadSRAMStep(hid_device *handle, void *arg, unsigned int maxRecords, bool *done) {
+  SRAMJob *job = (SRAMJob *)arg;
+  unsigned int count = job->count - job->next;
+  if (count > maxRecords) {
+    count = maxRecords;
+  }
+
+  if (!CPLD_ReadSRAM(handle, job->startAddr + job->next, &job->words[job->next], count)) {
+    return false;
+  }
+  job->next += count;
+  *done = (job->next == job->count);
+  return true;
+}
+
+static bool DACStep(hid_device *handle, void *arg, unsigned int maxRecords, bool *done) {
+  DACJob *job = (DACJob *)arg;
+  *done = true;
+
+  if (job->read) {
+    if (job->count == 1) {
+      return DAC5687_ReadRegister(handle, job->addr, job->bytes);
+    }
+    return DAC5687_ReadRegisters(handle, job->addr, job->bytes, job->count);
+  }
+
+  if (job->count == 1) {
+    return DAC5687_WriteRegister(handle, job->addr, job->bytes[0]);
+  }
+  return DAC5687_WriteRegisters(handle, job->addr, job->bytes, job->count);
+}
+
+static void HandleUpload(const IPCHeader *req, const uint8_t *payload, IPCHeader *reply) {
+  unsigned int count = req->payloadLen / SRAM_DATA_SIZE;
+
+  if ((req->payloadLen % SRAM_DATA_SIZE) != 0 || count == 0 ||
+      req->arg0 > SRAM_MAX_ADDRESS || count > SRAM_MAX_ADDRESS + 1 - req->arg0) {
+    reply->status = IPC_BAD_REQUEST;
+    return;
+  }
+
+  SRAMJob sramJob = {0};
+  sramJob.startAddr = req->arg0;
+  sramJob.count = count;
+  sramJob.words = (unsigned int *)malloc(count * sizeof(unsigned int));
+  if (sramJob.words == NULL) {
+    reply->status = IPC_FAILED;
+    return;
+  }
+  IPC_UnpackWords(sramJob.words, payload, count);
+
+  TransferJob job = {0};
+  job.cls = BulkClass;
+  job.step = UploadStep;
+  job.arg = &sramJob;
+
+  bool ok = Scheduler_Run(scheduler, &job);
+
+  // words the job never got to count as failures too
+  reply->arg0 = sramJob.failures + (count - sramJob.next);
+  reply->status = (ok && reply->arg0 == 0) ? IPC_OK : IPC_FAILED;
+  free(sramJob.words);
+}
+
+static void HandleUploadShm(const IPCHeader *req, const uint8_t *payload, IPCHeader *reply) {
+  char name[SHM_MAX_NAME + 1];
+
+  if (req->payloadLen == 0 || req->payloadLen > SHM_MAX_NAME || req->arg0 > SRAM_MAX_ADDRESS) {
+    reply->status = IPC_BAD_REQUEST;
+    return;
+  }
+  memcpy(name, payload, req->payloadLen);
+  name[req->payloadLen] = '\0';
+
+  ShmJob shmJob = {0};
+  shmJob.ring = ShmRing_Open(name);
+  if (shmJob.ring == NULL) {
+    reply->status = IPC_FAILED;
+    return;
+  }
+  shmJob.startAddr = req->arg0;
+  clock_gettime(CLOCK_MONOTONIC, &shmJob.lastWord);
+
+  TransferJob job = {0};
+  job.cls = BulkClass;
+  job.step = ShmStep;
+  job.arg = &shmJob;
+
+  bool ok = Scheduler_Run(scheduler, &job);
+
+  reply->arg0 = shmJob.failures;
+  reply->arg1 = shmJob.next;
+  reply->status = (ok && reply->arg0 == 0) ? IPC_OK : IPC_FAILED;
+  ShmRing_Close(shmJob.ring);
+}
+
+// returns the reply payload, which the caller frees
+static uint8_t * HandleReadSRAM(const IPCHeader *req, IPCHeader *reply) {
+  unsigned int count = req->arg1;
+
+  if (count == 0 || req->arg0 > SRAM_MAX_ADDRESS || count > SRAM_MAX_ADDRESS + 1 - req->arg0) {
+    reply->status = IPC_BAD_REQUEST;
+    return NULL;
+  }
+
+  SRAMJob sramJob = {0};
+  sramJob.startAddr = req->arg0;
+  sramJob.count = count;
+  sramJob.words = (unsigned int *)calloc(count, sizeof(unsigned int));
+  uint8_t *out = (uint8_t *)malloc(count * SRAM_DATA_SIZE);
+  if (sramJob.words == NULL || out == NULL) {
+    free(sramJob.words);
+    free(out);
+    reply->status = IPC_FAILED;
+    return NULL;
+  }
+
+  TransferJob job = {0};
+  job.cls = BulkClass;
+  job.step = ReadSRAMStep;
+  job.arg = &sramJob;
+
+  if (!Scheduler_Run(scheduler, &job)) {
+    free(sramJob.words);
+    free(out);
+    reply->status = IPC_FAILED;
+    return NULL;
+  }
+
+  IPC_PackWords(out, sramJob.words, count);
+  free(sramJob.words);
+  reply->payloadLen = count * SRAM_DATA_SIZE;
+  return out;
+}
+
+static void HandleWriteDAC(const IPCHeader *req, const uint8_t *payload, IPCHeader *reply) {
+  if (req->payloadLen == 0 || req->payloadLen > 4) {
+    reply->status = IPC_BAD_REQUEST;
+    return;
+  }
+
+  DACJob dacJob = {0};
+  dacJob.addr = (DAC5687Address)req->arg0;
+  dacJob.count = req->payloadLen;
+  memcpy(dacJob.bytes, payload, req->payloadLen);
+
+  TransferJob job = {0};
+  job.cls = ControlClass;
+  job.step = DACStep;
+  job.arg = &dacJob;
+
+  reply->status = Scheduler_Run(scheduler, &job) ? IPC_OK : IPC_FAILED;
+}
+
+static uint8_t * HandleReadDAC(const IPCHeader *req, IPCHeader *reply) {
+  if (req->arg1 == 0 || req->arg1 > 4) {
+    reply->status = IPC_BAD_REQUEST;
+    return NULL;
+  }
+
+  DACJob dacJob = {0};
+  dacJob.addr = (DAC5687Address)req->arg0;
+  dacJob.count = req->arg1;
+  dacJob.read = true;
+
+  TransferJob job = {0};
+  job.cls = ControlClass;
+  job.step = DACStep;
+  job.arg = &dacJob;
+
+  if (!Scheduler_Run(scheduler, &job)) {
+    reply->status = IPC_FAILED;
+    return NULL;
+  }
+
+  uint8_t *out = (uint8_t *)malloc(dacJob.count);
+  if (out == NULL) {
+    reply->status = IPC_FAILED;
+    return NULL;
+  }
+  memcpy(out, dacJob.bytes, dacJob.count);
+  reply->payloadLen = dacJob.count;
+  return out;
+}
+
+static uint8_t * HandleStats(IPCHeader *reply) {
+  // per class: jobs, mean queueing delay (us), max queueing delay (us), preemptions
+  unsigned int words[NUM_TRANSFER_CLASSES * 4];
+  TransferClass cls;
+  for (cls = ControlClass; cls < NUM_TRANSFER_CLASSES; cls++) {
+    SchedulerStats stats;
+    Scheduler_GetStats(scheduler, cls, &stats);
+    words[cls * 4] = (unsigned int)stats.jobs;
+    words[cls * 4 + 1] = stats.jobs ? (unsigned int)(stats.totalQueueNs / stats.jobs / 1000) : 0;
+    words[cls * 4 + 2] = (unsigned int)(stats.maxQueueNs / 1000);
+    words[cls * 4 + 3] = (unsigned int)stats.preemptions;
+  }
+
+  uint8_t *out = (uint8_t *)malloc(sizeof(words));
+  if (out == NULL) {
+    reply->status = IPC_FAILED;
+    return NULL;
+  }
+  IPC_PackWords(out, words, NUM_TRANSFER_CLASSES * 4);
+  reply->payloadLen = sizeof(words);
+  return out;
+}
+
+// serves a single client until it disconnects
+static void * ServeClient(void *arg) {
+  int fd = (int)(long)arg;
+  IPCHeader req;
+  uint8_t *payload;
+
+  while (!stopRequested && IPC_Receive(fd, &req, &payload)) {
+    IPCHeader reply;
+    memset(&reply, 0, sizeof(reply));
+    reply.op = req.op;
+    reply.status = IPC_OK;
+
+    uint8_t *replyPayload = NULL;
+
+    switch (req.op) {
+      case (IPCPing):
+        break;
+      case (IPCUpload):
+        HandleUpload(&req, payload, &reply);
+        break;
+      case (IPCUploadShm):
+        HandleUploadShm(&req, payload, &reply);
+        break;
+      case (IPCReadSRAM):
+        replyPayload = HandleReadSRAM(&req, &reply);
+        break;
+      case (IPCWriteDAC):
+        HandleWriteDAC(&req, payload, &reply);
+        break;
+      case (IPCReadDAC):
+        replyPayload = HandleReadDAC(&req, &reply);
+        break;
+      case (IPCStats):
+        replyPayload = HandleStats(&reply);
+        break;
+      default:
+        fprintf(stderr, "unknown op %#x\n", req.op);
+        reply.status = IPC_BAD_REQUEST;
+        break;
+    }
+    free(payload);
+
+    bool sent = IPC_Send(fd, &reply, replyPayload);
+    free(replyPayload);
+    if (!sent) {
+      break;
+    }
+  }
+  close(fd);
+  return NULL;
+}
+
+// starts a detached thread for a new client. signals stay with the main thread.
+static bool SpawnClient(int fd) {
+  sigset_t block, old;
+  sigemptyset(&block);
+  sigaddset(&block, SIGINT);
+  sigaddset(&block, SIGTERM);
+  pthread_sigmask(SIG_BLOCK, &block, &old);
+
+  pthread_attr_t attr;
+  pthread_attr_init(&attr);
+  pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+
+  pthread_t thread;
+  int res = pthread_create(&thread, &attr, ServeClient, (void *)(long)fd);
+
+  pthread_attr_destroy(&attr);
+  pthread_sigmask(SIG_SETMASK, &old, NULL);
+
+  if (res != 0) {
+    fprintf(stderr, "failed to start client thread\n");
+    return false;
+  }
+  return true;
+}
+
+static void PrintStats() {
+  static const char *names[NUM_TRANSFER_CLASSES] = {"control", "bulk"};
+  TransferClass cls;
+  for (cls = ControlClass; cls < NUM_TRANSFER_CLASSES; cls++) {
+    SchedulerStats stats;
+    Scheduler_GetStats(scheduler, cls, &stats);
+    fprintf(stderr, "dds-hostd: %-7s jobs: %llu mean wait: %llu us max wait: %llu us preemptions: %llu\n",
+            names[cls], stats.jobs, stats.jobs ? stats.totalQueueNs / stats.jobs / 1000 : 0,
+            stats.maxQueueNs / 1000, stats.preemptions);
+  }
+
+  if (realtime) {
+    Jitter_Print(&jitter, "dds-hostd: report jitter", stderr);
+  }
+}
+
+int main(int argc, char *argv[]) {
+  static const struct option longOpts[] = {
+    {"dac-config", required_argument, NULL, 'd'},
+    {"mcp-config", required_argument, NULL, 'm'},
+    {"cold", no_argument, NULL, 'c'},
+    {"socket", required_argument, NULL, 's'},
+    {"slice", required_argument, NULL, 'S'},
+    {"realtime-io", optional_argument, NULL, 'I'},
+    {"rt-priority", required_argument, NULL, 'p'},
+    {NULL, 0, NULL, 0},
+  };
+
+  const char *dacFileName = NULL;
+  const char *mcpFileName = NULL;
+  const char *socketPath = IPC_DEFAULT_SOCKET;
+  unsigned int sliceRecords = SCHEDULER_DEFAULT_SLICE;
+  bool cold = false;
+  int realtimeCpu = REALTIME_NO_CPU;
+  int realtimePriority = REALTIME_DEFAULT_PRIORITY;
+
+  int opt;
+  while ((opt = getopt_long(argc, argv, "", longOpts, NULL)) != -1) {
+    switch (opt) {
+      case ('d'):
+        dacFileName = optarg;
+        break;
+      case ('m'):
+        mcpFileName = optarg;
+        break;
+      case ('c'):
+        cold = true;
+        break;
+      case ('s'):
+        socketPath = optarg;
+        break;
+      case ('S'):
+        sliceRecords = (unsigned int)strtoul(optarg, NULL, 10);
+        break;
+      case ('I'):
+        realtime = true;
+        if (optarg != NULL) {
+          realtimeCpu = (int)strtol(optarg, NULL, 10);
+        }
+        break;
+      case ('p'):
+        realtimePriority = (int)strtol(optarg, NULL, 10);
+        break;
+      default:
+        PrintUsage();
+        return EXIT_FAILURE;
+    }
+  }
+
+  if (dacFileName == NULL || mcpFileName == NULL || sliceRecords == 0 ||
+      realtimeCpu < REALTIME_NO_CPU || realtimePriority < 1 || realtimePriority > 99) {
+    PrintUsage();
+    return EXIT_FAILURE;
+  }
+
+  // no SA_RESTART, so a signal kicks us out of accept()
+  struct sigaction sa;
+  memset(&sa, 0, sizeof(sa));
+  sa.sa_handler = HandleSignal;
+  sigaction(SIGINT, &sa, NULL);
+  sigaction(SIGTERM, &sa, NULL);
+  signal(SIGPIPE, SIG_IGN);
+
+  // the socket is claimed before the board is touched, so a second daemon gives up
+  // before it can reconfigure the board under the first one
+  int listenFd = IPC_Listen(socketPath);
+
+  if (listenFd < 0) {
+    return EXIT_FAILURE;
+  }
+
+  // hidapi's reader thread starts in MCP2210_Init() and inherits our policy, so it's
+  // real-time too; we go back to normal afterwards and only the worker joins it
+  if (realtime) {
+    Jitter_Reset(&jitter);
+    if (!Realtime_LockMemory() || !Realtime_SetThread(pthread_self(), realtimeCpu, realtimePriority)) {
+      fprintf(stderr, "dds-hostd: couldn't enter real-time mode\n");
+      close(listenFd);
+      unlink(socketPath);
+      return EXIT_FAILURE;
+    }
+  }
+
+  hid_device *handle = MCP2210_Init();
+
+  if (realtime) {
+    Realtime_ResetThread();
+  }
+
+  if (handle == NULL) {
+    close(listenFd);
+    unlink(socketPath);
+    return EXIT_FAILURE;
+  }
+
+  if (!Host_ConfigureDevices(handle, dacFileName, mcpFileName, cold)) {
+    close(listenFd);
+    unlink(socketPath);
+    MCP2210_Close(handle);
+    return EXIT_FAILURE;
+  }
+
+  // keep the worker thread from taking our signals
+  sigset_t block, old;
+  sigemptyset(&block);
+  sigaddset(&block, SIGINT);
+  sigaddset(&block, SIGTERM);
+  pthread_sigmask(SIG_BLOCK, &block, &old);
+  scheduler = Scheduler_Create(handle, sliceRecords);
+  pthread_sigmask(SIG_SETMASK, &old, NULL);
+
+  if (scheduler == NULL) {
+    close(listenFd);
+    unlink(socketPath);
+    MCP2210_Close(handle);
+    return EXIT_FAILURE;
+  }
+
+  if (realtime) {
+    if (!Scheduler_SetRealtime(scheduler, realtimeCpu, realtimePriority)) {
+      Scheduler_Stop(scheduler);
+      close(listenFd);
+      unlink(socketPath);
+      MCP2210_Close(handle);
+      return EXIT_FAILURE;
+    }
+    MCP2210_SetJitter(&jitter);
+  }
+
+  fprintf(stderr, "dds-hostd: listening on %s\n", socketPath);
+
+  while (!stopRequested) {
+    int fd = accept(listenFd, NULL, NULL);
+    if (fd < 0) {
+      if (errno != EINTR) {
+        perror("accept() failed");
+      }
+      continue;
+    }
+    if (!SpawnClient(fd)) {
+      close(fd);
+    }
+  }
+
+  close(listenFd);
+  unlink(socketPath);
+
+  // client threads may still be waiting on jobs, so the scheduler is stopped
+  // (failing their jobs) but not freed before we exit
+  Scheduler_Stop(scheduler);
+  MCP2210_SetJitter(NULL);
+  PrintStats();
+  MCP2210_Close(handle);
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,491 @@
+/*
+ * MIT License
+ * 
+ * Copyright (c) 2020 Eli Reed
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/*
+ * dds-trace reads a trace recorded with 'dds-host --trace' (see dds-host/trace.h)
+ * and explains where the time went: per-command counts and latencies, phases (runs
+ * of DAC or SRAM traffic and the settings reports that set them up), idle gaps
+ * between round trips, and settings reports that didn't change anything.
+ *
+ * With --replay, every recorded report is also sent to the simulated MCP2210 (see
+ * dds-host/mcp2210-sim.h) and its replies are compared with the recorded ones.
+ */
+
+// C
+#include <stdio.h>    // for printf()
+#include <stdbool.h>  // for bool type
+#include <stdlib.h>   // for exit(), realloc(), free()
+#include <stdint.h>   // for fixed-width integer types
+#include <string.h>   // for memset(), memcmp()
+#include <getopt.h>   // for getopt_long()
+
+// HIDAPI
+#include "hidapi/hidapi.h"
+
+// project libraries
+#include "dds-host/mcp2210.h"
+#include "dds-host/mcp2210-sim.h"
+#include "dds-host/trace.h"
+
+// gaps between round trips longer than this are listed
+#define DEFAULT_GAP_US        1000
+
+// how many of the largest gaps and replay mismatches to print
+#define MAX_LISTED            5
+
+// sizes of the settings payloads that follow the 4-byte report header
+#define SPI_SETTINGS_LEN      17
+#define CHIP_SETTINGS_LEN     15
+
+typedef struct trace_options_st {
+  const char *traceFileName;
+  bool sequence;
+  unsigned int gapUs;
+  bool replay;
+  unsigned int reportLatencyUs;
+} TraceOptions;
+
+typedef struct command_stats_st {
+  unsigned long long count;
+  unsigned long long totalNs;
+  unsigned long long maxNs;
+} CommandStats;
+
+// a run of reports aimed at one SPI device, including the setup before it
+typedef struct phase_st {
+  const char *target;
+  unsigned long long first;
+  unsigned long long reports;
+  unsigned long long transfers;
+  unsigned long long busyPolls;
+  uint64_t startNs;
+  uint64_t endNs;
+} Phase;
+
+typedef struct gap_st {
+  unsigned long long index;
+  uint64_t ns;
+} Gap;
+
+// everything gathered in one pass over the trace
+typedef struct analysis_st {
+  unsigned long long reports;
+  uint64_t firstNs;
+  uint64_t endNs;
+  uint64_t busyNs;
+  CommandStats commands[256];
+
+  Phase *phases;
+  unsigned int numPhases;
+  // reports since the last SPI transfer, not yet assigned to a phase
+  Phase pending;
+  bool havePending;
+
+  unsigned long long gaps;
+  uint64_t gapNs;
+  Gap largest[MAX_LISTED];
+
+  // the MCP2210's settings as far as the trace shows them
+  uint8_t spi[SPI_SETTINGS_LEN];
+  bool spiKnown;
+  uint8_t chip[CHIP_SETTINGS_LEN];
+  bool chipKnown;
+  unsigned long long redundantWrites, redundantReads;
+  uint64_t redundantNs;
+  unsigned long long settingsReports;
+
+  // replay results
+  MCP2210Sim *sim;
+  unsigned long long statusMismatches, dataMismatches;
+} Analysis;
+
+static const char * CommandName(uint8_t cmd) {
+  switch (cmd) {
+    case (GetNVRAMSettings): return "GetNVRAMSettings";
+    case (SetNVRAMSettings): return "SetNVRAMSettings";
+    case (GetCurrentSpiSettings): return "GetCurrentSpiSettings";
+    case (SetCurrentSpiSettings): return "SetCurrentSpiSettings";
+    case (GetCurrentChipSettings): return "GetCurrentChipSettings";
+    case (SetCurrentChipSettings): return "SetCurrentChipSettings";
+    case (GetCurrentGPIOPinDir): return "GetCurrentGPIOPinDir";
+    case (SetCurrentGPIOPinDir): return "SetCurrentGPIOPinDir";
+    case (GetCurrentGPIOPinVal): return "GetCurrentGPIOPinVal";
+    case (SetCurrentGPIOPinVal): return "SetCurrentGPIOPinVal";
+    case (ReadEEPROM): return "ReadEEPROM";
+    case (WriteEEPROM): return "WriteEEPROM";
+    case (GetCurrentInterruptCount): return "GetCurrentInterruptCount";
+    case (SpiDataTransfer): return "SpiDataTransfer";
+    case (CancelSpiDataTransfer): return "CancelSpiDataTransfer";
+    case (ReleaseSpiBus): return "ReleaseSpiBus";
+    case (GetChipStatus): return "GetChipStatus";
+    case (SendPassword): return "SendPassword";
+    default: return "unknown";
+  }
+}
+
+// which device the current SPI settings select: a GP pin that idles high and is
+// driven low during the transfer
+static const char * SpiTarget(const Analysis *a) {
+  if (!a->spiKnown) {
+    return "spi";
+  }
+  uint16_t idle = a->spi[4] | (a->spi[5] << 8);
+  uint16_t active = a->spi[6] | (a->spi[7] << 8);
+  if ((idle & 0x02) && !(active & 0x02)) {
+    return "sram";
+  }
+  if ((idle & 0x01) && !(active & 0x01)) {
+    return "dac";
+  }
+  return "spi";
+}
+
+static bool AppendPhase(Analysis *a, const Phase *phase) {
+  Phase *phases = (Phase *)realloc(a->phases, (a->numPhases + 1) * sizeof(Phase));
+  if (phases == NULL) {
+    fprintf(stderr, "Failed to allocate phases\n");
+    return false;
+  }
+  a->phases = phases;
+  a->phases[a->numPhases++] = *phase;
+  return true;
+}
+
+// adds one report to the phase it belongs to. Settings and other reports wait in
+// 'pending' until the next SPI transfer shows which device they were setting up.
+static bool TrackPhase(Analysis *a, const TraceRecord *record, bool transfer, bool busy) {
+  if (!a->havePending) {
+    memset(&a->pending, 0, sizeof(a->pending));
+    a->pending.first = a->reports;
+    a->pending.startNs = record->startNs;
+    a->havePending = true;
+  }
+  a->pending.reports++;
+  a->pending.endNs = record->startNs + record->durationNs;
+  a->pending.transfers += transfer ? 1 : 0;
+  a->pending.busyPolls += busy ? 1 : 0;
+
+  if (record->tx[0] != SpiDataTransfer) {
+    return true;
+  }
+
+  const char *target = SpiTarget(a);
+  Phase *current = a->numPhases > 0 ? &a->phases[a->numPhases - 1] : NULL;
+
+  if (current != NULL && strcmp(current->target, target) == 0) {
+    current->reports += a->pending.reports;
+    current->transfers += a->pending.transfers;
+    current->busyPolls += a->pending.busyPolls;
+    current->endNs = a->pending.endNs;
+  } else {
+    a->pending.target = target;
+    if (!AppendPhase(a, &a->pending)) {
+      return false;
+    }
+  }
+  a->havePending = false;
+  return true;
+}
+
+static void TrackGap(Analysis *a, uint64_t gapNs, unsigned long long index, unsigned int gapUs) {
+  if (gapNs < gapUs * 1000ULL) {
+    return;
+  }
+  a->gaps++;
+  a->gapNs += gapNs;
+
+  // keep the largest few, biggest first
+  unsigned int i;
+  for (i = 0; i < MAX_LISTED; i++) {
+    if (gapNs > a->largest[i].ns) {
+      memmove(&a->largest[i + 1], &a->largest[i], (MAX_LISTED - 1 - i) * sizeof(Gap));
+      a->largest[i].index = index;
+      a->largest[i].ns = gapNs;
+      break;
+    }
+  }
+}
+
+// returns true if 'record' re-sent or re-read settings the trace already shows
+static bool TrackSettings(Analysis *a, const TraceRecord *record) {
+  const uint8_t *tx = record->tx, *rx = record->rx;
+  bool redundant = false;
+
+  switch (tx[0]) {
+    case (SetCurrentSpiSettings):
+      redundant = a->spiKnown && memcmp(a->spi, &tx[4], SPI_SETTINGS_LEN) == 0;
+      memcpy(a->spi, &tx[4], SPI_SETTINGS_LEN);
+      a->spiKnown = record->result == 0x00;
+      break;
+    case (GetCurrentSpiSettings):
+      redundant = a->spiKnown;
+      memcpy(a->spi, &rx[4], SPI_SETTINGS_LEN);
+      a->spiKnown = record->result == 0x00;
+      break;
+    case (SetCurrentChipSettings):
+      redundant = a->chipKnown && memcmp(a->chip, &tx[4], CHIP_SETTINGS_LEN) == 0;
+      memcpy(a->chip, &tx[4], CHIP_SETTINGS_LEN);
+      a->chipKnown = record->result == 0x00;
+      break;
+    case (GetCurrentChipSettings):
+      redundant = a->chipKnown;
+      memcpy(a->chip, &rx[4], CHIP_SETTINGS_LEN);
+      a->chipKnown = record->result == 0x00;
+      break;
+    default:
+      return false;
+  }
+
+  a->settingsReports++;
+  if (redundant) {
+    if (tx[0] == SetCurrentSpiSettings || tx[0] == SetCurrentChipSettings) {
+      a->redundantWrites++;
+    } else {
+      a->redundantReads++;
+    }
+    a->redundantNs += record->durationNs;
+  }
+  return redundant;
+}
+
+// sends the recorded report to the simulator and compares the replies
+static void Replay(Analysis *a, const TraceRecord *record) {
+  uint8_t rx[MCP2210_REPORT_LEN];
+  MCP2210Sim_Transact(a->sim, record->tx, rx);
+
+  bool statusDiffers = rx[1] != record->rx[1];
+  bool dataDiffers = false;
+
+  if (!statusDiffers && record->tx[0] == SpiDataTransfer) {
+    dataDiffers = rx[2] != record->rx[2] || rx[3] != record->rx[3] ||
+                  memcmp(&rx[4], &record->rx[4], rx[2] <= 60 ? rx[2] : 60) != 0;
+  }
+
+  if (statusDiffers) {
+    a->statusMismatches++;
+  } else if (dataDiffers) {
+    a->dataMismatches++;
+  }
+
+  if ((statusDiffers || dataDiffers) && a->statusMismatches + a->dataMismatches <= MAX_LISTED) {
+    printf("replay: report %llu (%s) recorded status %02x len %u engine %02x, "
+           "simulated status %02x len %u engine %02x\n",
+           a->reports, CommandName(record->tx[0]), record->rx[1], record->rx[2], record->rx[3],
+           rx[1], rx[2], rx[3]);
+  }
+}
+
+static bool Analyze(const TraceOptions *opts, Analysis *a) {
+  TraceFile *trace = Trace_Open(opts->traceFileName);
+
+  if (trace == NULL) {
+    return false;
+  }
+
+  TraceRecord record;
+  bool ok = true;
+  while (ok && Trace_Read(trace, &record)) {
+    uint8_t cmd = record.tx[0];
+    uint64_t endNs = record.startNs + record.durationNs;
+
+    if (a->reports == 0) {
+      a->firstNs = record.startNs;
+    } else if (record.startNs > a->endNs) {
+      TrackGap(a, record.startNs - a->endNs, a->reports, opts->gapUs);
+    }
+
+    CommandStats *stats = &a->commands[cmd];
+    stats->count++;
+    stats->totalNs += record.durationNs;
+    stats->maxNs = record.durationNs > stats->maxNs ? record.durationNs : stats->maxNs;
+    a->busyNs += record.durationNs;
+
+    bool redundant = TrackSettings(a, &record);
+
+    bool transfer = cmd == SpiDataTransfer && record.result == 0x00 && record.rx[3] == 0x10;
+    bool busy = cmd == SpiDataTransfer && (record.result == 0xF8 ||
+                (record.result == 0x00 && record.rx[3] == 0x20));
+    ok = TrackPhase(a, &record, transfer, busy);
+
+    if (opts->sequence) {
+      printf("%8llu %12.3f ms %8.1f us  %-24s %02x", a->reports, record.startNs / 1e6,
+             record.durationNs / 1e3, CommandName(cmd), record.result & 0xFF);
+      if (cmd == SpiDataTransfer) {
+        printf("  %s tx %u rx %u engine %02x", SpiTarget(a), record.tx[1], record.rx[2], record.rx[3]);
+      }
+      printf("%s\n", redundant ? "  (redundant)" : "");
+    }
+
+    if (opts->replay) {
+      Replay(a, &record);
+    }
+
+    a->endNs = endNs;
+    a->reports++;
+  }
+
+  // trailing reports that never led to a transfer get a phase of their own
+  if (ok && a->havePending) {
+    a->pending.target = "other";
+    ok = AppendPhase(a, &a->pending);
+  }
+
+  Trace_Close(trace);
+  return ok;
+}
+
+static void PrintAnalysis(const TraceOptions *opts, const Analysis *a) {
+  uint64_t spanNs = a->reports > 0 ? a->endNs - a->firstNs : 0;
+
+  printf("trace: %llu reports over %.3f s (%.3f s in round trips, %.3f s between them)\n",
+         a->reports, spanNs / 1e9, a->busyNs / 1e9, (spanNs - a->busyNs) / 1e9);
+
+  printf("\ncommands:\n");
+  printf("  %-24s %10s %12s %10s %10s\n", "command", "count", "total ms", "mean us", "max us");
+  unsigned int cmd;
+  for (cmd = 0; cmd < 256; cmd++) {
+    const CommandStats *stats = &a->commands[cmd];
+    if (stats->count == 0) {
+      continue;
+    }
+    printf("  %-24s %10llu %12.3f %10.1f %10.1f\n", CommandName((uint8_t)cmd), stats->count,
+           stats->totalNs / 1e6, stats->totalNs / 1e3 / stats->count, stats->maxNs / 1e3);
+  }
+
+  printf("\nphases:\n");
+  printf("  %-6s %10s %10s %10s %10s %12s %12s\n",
+         "target", "first", "reports", "transfers", "busy", "start ms", "duration ms");
+  unsigned int i;
+  for (i = 0; i < a->numPhases; i++) {
+    const Phase *phase = &a->phases[i];
+    printf("  %-6s %10llu %10llu %10llu %10llu %12.3f %12.3f\n", phase->target, phase->first,
+           phase->reports, phase->transfers, phase->busyPolls,
+           (phase->startNs - a->firstNs) / 1e6, (phase->endNs - phase->startNs) / 1e6);
+  }
+
+  printf("\nidle gaps over %u us: %llu, %.3f ms in total\n", opts->gapUs, a->gaps, a->gapNs / 1e6);
+  for (i = 0; i < MAX_LISTED && a->largest[i].ns > 0; i++) {
+    printf("  %.3f ms before report %llu\n", a->largest[i].ns / 1e6, a->largest[i].index);
+  }
+
+  printf("\nredundant settings: %llu of %llu settings reports (%llu writes, %llu reads), %.3f ms\n",
+         a->redundantWrites + a->redundantReads, a->settingsReports,
+         a->redundantWrites, a->redundantReads, a->redundantNs / 1e6);
+
+  if (opts->replay) {
+    MCP2210SimStats stats;
+    MCP2210Sim_GetStats(a->sim, &stats);
+    printf("\nreplay at %u us per report: %llu status mismatches, %llu data mismatches, "
+           "predicted %.3f s vs %.3f s recorded\n",
+           opts->reportLatencyUs, a->statusMismatches, a->dataMismatches,
+           stats.elapsedNs / 1e9, spanNs / 1e9);
+  }
+}
+
+static void PrintUsage() {
+  fprintf(stderr, "Usage: ./bin/dds-trace [--sequence] [--gap-us <us>] [--replay [--report-latency <us>]] <trace>\n");
+}
+
+static bool ParseArgs(int argc, char *argv[], TraceOptions *opts) {
+  static const struct option longOpts[] = {
+    {"sequence", no_argument, NULL, 's'},
+    {"gap-us", required_argument, NULL, 'g'},
+    {"replay", no_argument, NULL, 'r'},
+    {"report-latency", required_argument, NULL, 'L'},
+    {NULL, 0, NULL, 0},
+  };
+
+  memset(opts, 0, sizeof(*opts));
+  opts->gapUs = DEFAULT_GAP_US;
+  opts->reportLatencyUs = MCP2210SIM_DEFAULT_LATENCY_US;
+
+  int opt;
+  char *end;
+  while ((opt = getopt_long(argc, argv, "", longOpts, NULL)) != -1) {
+    switch (opt) {
+      case ('s'):
+        opts->sequence = true;
+        break;
+      case ('g'):
+        opts->gapUs = (unsigned int)strtoul(optarg, &end, 10);
+        if (*end != '\0') {
+          fprintf(stderr, "bad --gap-us: %s\n", optarg);
+          return false;
+        }
+        break;
+      case ('r'):
+        opts->replay = true;
+        break;
+      case ('L'):
+        opts->reportLatencyUs = (unsigned int)strtoul(optarg, &end, 10);
+        if (*end != '\0') {
+          fprintf(stderr, "bad --report-latency: %s\n", optarg);
+          return false;
+        }
+        break;
+      default:
+        return false;
+    }
+  }
+
+  if (optind != argc - 1) {
+    fprintf(stderr, "expected exactly one trace file\n");
+    return false;
+  }
+  opts->traceFileName = argv[optind];
+  return true;
+}
+
+int main(int argc, char *argv[]) {
+  TraceOptions opts;
+
+  if (!ParseArgs(argc, argv, &opts)) {
+    PrintUsage();
+    return EXIT_FAILURE;
+  }
+
+  Analysis *a = (Analysis *)calloc(1, sizeof(Analysis));
+  if (a == NULL) {
+    fprintf(stderr, "Failed to allocate Analysis\n");
+    return EXIT_FAILURE;
+  }
+
+  if (opts.replay) {
+    a->sim = MCP2210Sim_Create(opts.reportLatencyUs);
+    if (a->sim == NULL) {
+      free(a);
+      return EXIT_FAILURE;
+    }
+  }
+
+  bool ok = Analyze(&opts, a);
+  if (ok) {
+    PrintAnalysis(&opts, a);
+  }
+
+  MCP2210Sim_Destroy(a->sim);
+  free(a->phases);
+  free(a);
+  return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,317 @@
+/*
+ * MIT License
+ * 
+ * Copyright (c) 2020 Eli Reed
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/*
+ * dds-uhid registers a virtual MCP2210 with the kernel through /dev/uhid and answers
+ * its reports with the simulated MCP2210, CPLD SRAM and DAC5687 (see
+ * dds-host/mcp2210-sim.h). To hidapi's hidraw backend it looks like a board on the
+ * USB bus with the MCP2210's VID and PID, so dds-host built against hidapi-hidraw
+ * runs unmodified against it, through the kernel and hidapi, with no board attached.
+ *
+ * Every report can be held back by a fixed latency to stand in for the USB frame time.
+ * Whatever dds-host measures beyond that is the cost of the I/O stack itself.
+ */
+
+// C
+#include <stdio.h>    // for printf()
+#include <stdbool.h>  // for bool type
+#include <stdlib.h>   // for strtoul()
+#include <stdint.h>   // for fixed-width integer types
+#include <string.h>   // for memset(), memcpy(), strncpy(), strerror()
+#include <errno.h>    // for errno
+#include <fcntl.h>    // for open()
+#include <unistd.h>   // for read(), write(), close()
+#include <signal.h>   // for sigaction()
+#include <getopt.h>   // for getopt_long()
+
+// Linux
+#include <linux/uhid.h>
+
+// project libraries
+#include "dds-host/mcp2210.h"
+#include "dds-host/mcp2210-sim.h"
+
+#define UHID_PATH             "/dev/uhid"
+#define DEFAULT_SERIAL        "DDSUHID0"
+
+// the MCP2210's own report descriptor: one vendor-defined 64-byte report each way,
+// with no report IDs
+static const uint8_t reportDescriptor[] = {
+  0x06, 0x00, 0xFF,   // Usage Page (Vendor Defined 0xFF00)
+  0x09, 0x01,         // Usage (0x01)
+  0xA1, 0x01,         // Collection (Application)
+  0x19, 0x01,         //   Usage Minimum (0x01)
+  0x29, 0x40,         //   Usage Maximum (0x40)
+  0x15, 0x00,         //   Logical Minimum (0)
+  0x26, 0xFF, 0x00,   //   Logical Maximum (255)
+  0x75, 0x08,         //   Report Size (8)
+  0x95, 0x40,         //   Report Count (64)
+  0x81, 0x00,         //   Input (Data, Array, Absolute)
+  0x19, 0x01,         //   Usage Minimum (0x01)
+  0x29, 0x40,         //   Usage Maximum (0x40)
+  0x91, 0x00,         //   Output (Data, Array, Absolute)
+  0xC0,               // End Collection
+};
+
+typedef struct uhid_options_st {
+  const char *serial;
+  unsigned int reportLatencyUs;
+  bool verbose;
+} UhidOptions;
+
+// set by the signal handler; the blocking read() returns EINTR right after
+static volatile sig_atomic_t stopRequested = 0;
+
+static void Stop(int sig) {
+  (void)sig;
+  stopRequested = 1;
+}
+
+static bool SendEvent(int fd, const struct uhid_event *ev) {
+  ssize_t res = write(fd, ev, sizeof(*ev));
+  if (res != (ssize_t) sizeof(*ev)) {
+    fprintf(stderr, "write to %s failed: %s\n", UHID_PATH, res < 0 ? strerror(errno) : "short write");
+    return false;
+  }
+  return true;
+}
+
+static bool CreateDevice(int fd, const UhidOptions *opts) {
+  struct uhid_event ev;
+  memset(&ev, 0, sizeof(ev));
+
+  ev.type = UHID_CREATE2;
+  strncpy((char *) ev.u.create2.name, "Microchip Technology Inc. MCP2210 (dds-uhid)",
+          sizeof(ev.u.create2.name) - 1);
+  strncpy((char *) ev.u.create2.phys, "dds-uhid", sizeof(ev.u.create2.phys) - 1);
+  // hidraw reports this as the USB serial number
+  strncpy((char *) ev.u.create2.uniq, opts->serial, sizeof(ev.u.create2.uniq) - 1);
+  ev.u.create2.rd_size = sizeof(reportDescriptor);
+  ev.u.create2.bus = BUS_USB;
+  ev.u.create2.vendor = VID;
+  ev.u.create2.product = PID;
+  ev.u.create2.version = 0x0002;
+  memcpy(ev.u.create2.rd_data, reportDescriptor, sizeof(reportDescriptor));
+
+  return SendEvent(fd, &ev);
+}
+
+// answers one output report with an input report
+static bool AnswerOutput(int fd, MCP2210Sim *sim, const struct uhid_output_req *output) {
+  uint8_t txBuf[MCP2210_REPORT_LEN] = {0};
+  const uint8_t *data = output->data;
+  size_t size = output->size;
+
+  // hidapi sends the command as the first byte, but a writer that prefixes report ID 0
+  // sends one more
+  if (size == MCP2210_REPORT_LEN + 1 && data[0] == 0x00) {
+    data++;
+    size--;
+  }
+  memcpy(txBuf, data, size < MCP2210_REPORT_LEN ? size : MCP2210_REPORT_LEN);
+
+  struct uhid_event ev;
+  memset(&ev, 0, sizeof(ev));
+  ev.type = UHID_INPUT2;
+  ev.u.input2.size = MCP2210_REPORT_LEN;
+
+  if (MCP2210Sim_Transact(sim, txBuf, ev.u.input2.data) < 0) {
+    // the simulator dropped the link, so the reader just times out like it would
+    return true;
+  }
+  return SendEvent(fd, &ev);
+}
+
+// the MCP2210 has no feature reports, so refuse any GET_REPORT/SET_REPORT
+static bool RefuseReport(int fd, const struct uhid_event *req) {
+  struct uhid_event ev;
+  memset(&ev, 0, sizeof(ev));
+
+  if (req->type == UHID_GET_REPORT) {
+    ev.type = UHID_GET_REPORT_REPLY;
+    ev.u.get_report_reply.id = req->u.get_report.id;
+    ev.u.get_report_reply.err = EIO;
+  } else {
+    ev.type = UHID_SET_REPORT_REPLY;
+    ev.u.set_report_reply.id = req->u.set_report.id;
+    ev.u.set_report_reply.err = EIO;
+  }
+  return SendEvent(fd, &ev);
+}
+
+// handles events until a signal arrives or the kernel goes away
+static bool Serve(int fd, MCP2210Sim *sim, const UhidOptions *opts) {
+  while (!stopRequested) {
+    struct uhid_event ev;
+    ssize_t res = read(fd, &ev, sizeof(ev));
+
+    if (res < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      fprintf(stderr, "read from %s failed: %s\n", UHID_PATH, strerror(errno));
+      return false;
+    }
+
+    if (res == 0) {
+      fprintf(stderr, "%s closed\n", UHID_PATH);
+      return false;
+    }
+
+    bool ok = true;
+    switch (ev.type) {
+      case UHID_OUTPUT:
+        ok = AnswerOutput(fd, sim, &ev.u.output);
+        break;
+      case UHID_GET_REPORT:
+      case UHID_SET_REPORT:
+        ok = RefuseReport(fd, &ev);
+        break;
+      case UHID_OPEN:
+      case UHID_CLOSE:
+        if (opts->verbose) {
+          fprintf(stderr, "device %s\n", ev.type == UHID_OPEN ? "opened" : "closed");
+        }
+        break;
+      default:
+        // UHID_START/UHID_STOP need nothing from us
+        break;
+    }
+
+    if (!ok) {
+      return false;
+    }
+  }
+  return true;
+}
+
+static void PrintStats(const MCP2210Sim *sim) {
+  MCP2210SimStats stats;
+  MCP2210Sim_GetStats(sim, &stats);
+
+  printf("{\"reports\": %llu, \"settings_reports\": %llu, \"spi_reports\": %llu, "
+         "\"busy_polls\": %llu, \"spi_bytes\": %llu, \"spi_transactions\": %llu}\n",
+         stats.reports, stats.settingsReports, stats.spiReports,
+         stats.busyPolls, stats.spiBytes, stats.spiTransactions);
+}
+
+static void PrintUsage() {
+  fprintf(stderr, "Usage: ./bin/dds-uhid [--serial <serial>] [--report-latency <us>] [--verbose]\n");
+}
+
+static bool ParseArgs(int argc, char *argv[], UhidOptions *opts) {
+  static const struct option longOpts[] = {
+    {"serial", required_argument, NULL, 's'},
+    {"report-latency", required_argument, NULL, 'L'},
+    {"verbose", no_argument, NULL, 'v'},
+    {NULL, 0, NULL, 0},
+  };
+
+  memset(opts, 0, sizeof(*opts));
+  opts->serial = DEFAULT_SERIAL;
+
+  int opt;
+  char *end;
+  while ((opt = getopt_long(argc, argv, "", longOpts, NULL)) != -1) {
+    switch (opt) {
+      case ('s'):
+        if (strlen(optarg) == 0 || strlen(optarg) > MCP2210_MAX_SERIAL_LEN) {
+          fprintf(stderr, "bad --serial: %s (1 to %d characters)\n", optarg, MCP2210_MAX_SERIAL_LEN);
+          return false;
+        }
+        opts->serial = optarg;
+        break;
+      case ('L'):
+        opts->reportLatencyUs = (unsigned int)strtoul(optarg, &end, 10);
+        if (*end != '\0') {
+          fprintf(stderr, "bad --report-latency: %s\n", optarg);
+          return false;
+        }
+        break;
+      case ('v'):
+        opts->verbose = true;
+        break;
+      default:
+        return false;
+    }
+  }
+
+  if (optind != argc) {
+    fprintf(stderr, "unexpected argument: %s\n", argv[optind]);
+    return false;
+  }
+  return true;
+}
+
+int main(int argc, char *argv[]) {
+  UhidOptions opts;
+
+  if (!ParseArgs(argc, argv, &opts)) {
+    PrintUsage();
+    return EXIT_FAILURE;
+  }
+
+  MCP2210Sim *sim = MCP2210Sim_Create(opts.reportLatencyUs);
+  if (sim == NULL) {
+    return EXIT_FAILURE;
+  }
+  // hold every report back for real, not just on the virtual clock
+  MCP2210Sim_SetRealtime(sim, opts.reportLatencyUs > 0);
+
+  int fd = open(UHID_PATH, O_RDWR | O_CLOEXEC);
+  if (fd < 0) {
+    fprintf(stderr, "couldn't open %s: %s (is the uhid module loaded?)\n", UHID_PATH, strerror(errno));
+    MCP2210Sim_Destroy(sim);
+    return EXIT_FAILURE;
+  }
+
+  if (!CreateDevice(fd, &opts)) {
+    close(fd);
+    MCP2210Sim_Destroy(sim);
+    return EXIT_FAILURE;
+  }
+
+  // no SA_RESTART, so a signal kicks us out of read()
+  struct sigaction sa;
+  memset(&sa, 0, sizeof(sa));
+  sa.sa_handler = Stop;
+  sigaction(SIGINT, &sa, NULL);
+  sigaction(SIGTERM, &sa, NULL);
+
+  fprintf(stderr, "virtual MCP2210 %04x:%04x serial %s ready, %u us per report\n",
+          VID, PID, opts.serial, opts.reportLatencyUs);
+
+  bool ok = Serve(fd, sim, &opts);
+
+  // closing the fd destroys the device, but say so explicitly
+  struct uhid_event ev;
+  memset(&ev, 0, sizeof(ev));
+  ev.type = UHID_DESTROY;
+  SendEvent(fd, &ev);
+  close(fd);
+
+  PrintStats(sim);
+  MCP2210Sim_Destroy(sim);
+  return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,339 @@
+/*
+ * MIT License
+ * 
+ * Copyright (c) 2020 Eli Reed
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <stdio.h>    // for fprintf()
+#include <stdlib.h>   // for malloc(), free()
+#include <stdbool.h>  // for bool type
+#include <string.h>   // for memset()
+#include <pthread.h>  // for pthread_mutex_t
+#include <time.h>     // for clock_gettime()
+
+// HIDAPI
+#include "hidapi/hidapi.h"
+
+// project libraries
+#include "dds-host/device.h"
+#include "dds-host/host.h"
+#include "dds-host/mcp2210.h"
+#include "dds-host/mcp2210-sim.h"
+#include "dds-host/cpld.h"
+#include "dds-host/cache.h"
+
+struct dds_device_st {
+  hid_device *handle;
+  // the simulator behind 'handle', if it's simulated
+  MCP2210Sim *sim;
+
+  pthread_mutex_t lock;
+  // when the current holder took the lock
+  unsigned long long heldSince;
+
+  // what the DAC5687 registers are known to hold
+  DAC5687Shadow shadow;
+  // bumped by every SRAM write, so an upload can tell whether another overlapped it
+  unsigned long long sramEpoch;
+
+  DDSDeviceStats stats;
+};
+
+static unsigned long long DDSDevice_Now(void) {
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (unsigned long long) now.tv_sec * 1000000000ULL + (unsigned long long) now.tv_nsec;
+}
+
+static void DDSDevice_Lock(DDSDevice *dev) {
+  unsigned long long start = DDSDevice_Now();
+  bool contended = pthread_mutex_trylock(&dev->lock) != 0;
+  if (contended) {
+    pthread_mutex_lock(&dev->lock);
+  }
+
+  dev->heldSince = DDSDevice_Now();
+  dev->stats.operations++;
+  if (contended) {
+    dev->stats.contended++;
+    dev->stats.waitNs += dev->heldSince - start;
+  }
+}
+
+static void DDSDevice_Unlock(DDSDevice *dev) {
+  dev->stats.busyNs += DDSDevice_Now() - dev->heldSince;
+  pthread_mutex_unlock(&dev->lock);
+}
+
+static DDSDevice * DDSDevice_Create(hid_device *handle, MCP2210Sim *sim) {
+  DDSDevice *dev = malloc(sizeof(DDSDevice));
+  if (dev == NULL) {
+    fprintf(stderr, "couldn't allocate device context\n");
+    return NULL;
+  }
+  memset(dev, 0, sizeof(*dev));
+
+  if (pthread_mutex_init(&dev->lock, NULL) != 0) {
+    fprintf(stderr, "couldn't create device lock\n");
+    free(dev);
+    return NULL;
+  }
+
+  dev->handle = handle;
+  dev->sim = sim;
+  DAC5687_InitShadow(&dev->shadow);
+  return dev;
+}
+
+DDSDevice * DDSDevice_Open(const char *serial) {
+  hid_device *handle = MCP2210_Open(serial);
+
+  if (handle == NULL) {
+    return NULL;
+  }
+
+  DDSDevice *dev = DDSDevice_Create(handle, NULL);
+  if (dev == NULL) {
+    MCP2210_Close(handle);
+  }
+  return dev;
+}
+
+DDSDevice * DDSDevice_OpenSim(unsigned int reportLatencyUs) {
+  MCP2210Sim *sim = MCP2210Sim_Create(reportLatencyUs);
+  hid_device *handle = (sim != NULL) ? MCP2210Sim_Open(sim) : NULL;
+  DDSDevice *dev = (handle != NULL) ? DDSDevice_Create(handle, sim) : NULL;
+
+  if (dev == NULL) {
+    if (handle != NULL) {
+      MCP2210_Close(handle);
+    }
+    if (sim != NULL) {
+      MCP2210Sim_Destroy(sim);
+    }
+  }
+  return dev;
+}
+
+void DDSDevice_Close(DDSDevice *dev) {
+  if (dev == NULL) {
+    return;
+  }
+
+  MCP2210_Close(dev->handle);
+  if (dev->sim != NULL) {
+    MCP2210Sim_Destroy(dev->sim);
+  }
+
+  pthread_mutex_destroy(&dev->lock);
+  free(dev);
+}
+
+bool DDSDevice_Configure(DDSDevice *dev, const char *dacFileName, const char *mcpFileName, bool cold) {
+  if (dev == NULL) {
+    fprintf(stderr, "device can't be null\n");
+    return false;
+  }
+
+  DDSDevice_Lock(dev);
+  bool ok = Host_ConfigureDevices(dev->handle, dacFileName, mcpFileName, cold);
+  // a cold configure resets the DAC and either kind may have failed halfway
+  DAC5687_InitShadow(&dev->shadow);
+  DDSDevice_Unlock(dev);
+  return ok;
+}
+
+unsigned int DDSDevice_Upload(DDSDevice *dev, unsigned int startAddr, const unsigned int *words,
+                              unsigned int count, Progress *progress) {
+  return DDSDevice_UploadUntil(dev, startAddr, words, count, progress, NULL, NULL);
+}
+
+unsigned int DDSDevice_UploadUntil(DDSDevice *dev, unsigned int startAddr, const unsigned int *words,
+                                   unsigned int count, Progress *progress,
+                                   DDSDeviceContinue keepGoing, void *ctx) {
+  if (dev == NULL || words == NULL) {
+    fprintf(stderr, "device and words can't be null\n");
+    return count;
+  }
+
+  if (count == 0) {
+    return 0;
+  }
+
+  // clear the tag before the first word goes out so a partial upload never matches
+  DDSDevice_Lock(dev);
+  unsigned long long epoch = ++dev->sramEpoch;
+  bool ok = Cache_Invalidate(dev->handle);
+  DDSDevice_Unlock(dev);
+
+  if (!ok) {
+    fprintf(stderr, "couldn't clear the image tag, not uploading\n");
+    return count;
+  }
+
+  // let other threads in between chunks
+  unsigned long long seen = epoch;
+  bool overlapped = false;
+  unsigned int failed = 0;
+  unsigned int i;
+  for (i = 0; i < count; i += PROGRESS_CHUNK_WORDS) {
+    if (keepGoing != NULL && !keepGoing(ctx, i)) {
+      // the rest never went out, and what did isn't a whole image
+      return failed + (count - i);
+    }
+
+    unsigned int chunk = count - i;
+    if (chunk > PROGRESS_CHUNK_WORDS) {
+      chunk = PROGRESS_CHUNK_WORDS;
+    }
+
+    DDSDevice_Lock(dev);
+    if (dev->sramEpoch != seen) {
+      // another writer got in since our last chunk and may already have tagged its
+      // image, which this chunk can overwrite: clear the tag first, and bump the epoch
+      // so a writer still going doesn't tag afterwards either
+      overlapped = true;
+      if (!Cache_Invalidate(dev->handle)) {
+        DDSDevice_Unlock(dev);
+        fprintf(stderr, "couldn't clear the image tag, stopping the upload\n");
+        return failed + (count - i);
+      }
+      seen = ++dev->sramEpoch;
+    }
+    unsigned int chunkFailed = Host_WriteWords(dev->handle, startAddr + i, &words[i], chunk);
+    dev->stats.wordsWritten += chunk - chunkFailed;
+    dev->stats.wordsFailed += chunkFailed;
+    DDSDevice_Unlock(dev);
+
+    if (progress != NULL) {
+      Progress_Add(progress, chunk, chunkFailed);
+    }
+    failed += chunkFailed;
+  }
+
+  if (failed == 0 && startAddr == 0 && !overlapped) {
+    ImageTag tag;
+    Cache_TagWords(words, startAddr, count, &tag);
+
+    DDSDevice_Lock(dev);
+    if (dev->sramEpoch == epoch && !Cache_WriteTag(dev->handle, &tag)) {
+      fprintf(stderr, "couldn't write the image tag, the next upload won't be skipped\n");
+    }
+    DDSDevice_Unlock(dev);
+  }
+  return failed;
+}
+
+bool DDSDevice_ReadSRAM(DDSDevice *dev, unsigned int startAddr, unsigned int *words, unsigned int count) {
+  if (dev == NULL || words == NULL) {
+    fprintf(stderr, "device and words can't be null\n");
+    return false;
+  }
+
+  DDSDevice_Lock(dev);
+  bool ok = CPLD_ReadSRAM(dev->handle, startAddr, words, count);
+  if (ok) {
+    dev->stats.wordsRead += count;
+  }
+  DDSDevice_Unlock(dev);
+  return ok;
+}
+
+bool DDSDevice_WriteDAC(DDSDevice *dev, DAC5687Address startAddr, const unsigned char *bytes, unsigned int count) {
+  if (dev == NULL || bytes == NULL) {
+    fprintf(stderr, "device and bytes can't be null\n");
+    return false;
+  }
+
+  if (count == 0 || startAddr + count > DAC5687_NUM_REGISTERS) {
+    fprintf(stderr, "registers %#x-%#x are out of range\n", startAddr, startAddr + count - 1);
+    return false;
+  }
+
+  DDSDevice_Lock(dev);
+
+  bool ok = true;
+  unsigned int i;
+  for (i = 0; i < count && ok; i++) {
+    ok = DAC5687_UpdateBits(&dev->shadow, startAddr + i, 0xFF, bytes[i]);
+  }
+
+  // only the registers that changed go out
+  ok = ok && DAC5687_Flush(dev->handle, &dev->shadow);
+
+  if (!ok) {
+    // some of the shadow's values may never have reached the chip
+    DAC5687_InitShadow(&dev->shadow);
+  }
+  DDSDevice_Unlock(dev);
+  return ok;
+}
+
+bool DDSDevice_ReadDAC(DDSDevice *dev, DAC5687Address startAddr, unsigned char *bytes, unsigned int count) {
+  if (dev == NULL || bytes == NULL) {
+    fprintf(stderr, "device and bytes can't be null\n");
+    return false;
+  }
+
+  if (count == 0 || startAddr + count > DAC5687_NUM_REGISTERS) {
+    fprintf(stderr, "registers %#x-%#x are out of range\n", startAddr, startAddr + count - 1);
+    return false;
+  }
+
+  DDSDevice_Lock(dev);
+  bool ok = DAC5687_ReadRegisterRange(dev->handle, startAddr, bytes, count);
+
+  if (ok) {
+    // what was just read is what later writes can skip
+    unsigned int i;
+    for (i = 0; i < count; i++) {
+      dev->shadow.known.values[startAddr + i] = bytes[i];
+      dev->shadow.known.mask |= 1UL << (startAddr + i);
+    }
+  }
+  DDSDevice_Unlock(dev);
+  return ok;
+}
+
+bool DDSDevice_Run(DDSDevice *dev, DDSDeviceOp op, void *ctx) {
+  if (dev == NULL || op == NULL) {
+    fprintf(stderr, "device and op can't be null\n");
+    return false;
+  }
+
+  DDSDevice_Lock(dev);
+  bool ok = op(dev->handle, ctx);
+  DAC5687_InitShadow(&dev->shadow);
+  dev->sramEpoch++;
+  DDSDevice_Unlock(dev);
+  return ok;
+}
+
+void DDSDevice_GetStats(DDSDevice *dev, DDSDeviceStats *stats) {
+  if (dev == NULL || stats == NULL) {
+    fprintf(stderr, "device and stats can't be null\n");
+    return;
+  }
+
+  pthread_mutex_lock(&dev->lock);
+  *stats = dev->stats;
+  pthread_mutex_unlock(&dev->lock);
+}
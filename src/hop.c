@@ -0,0 +1,271 @@
+/*
+ * MIT License
+ * 
+ * Copyright (c) 2020 Eli Reed
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <stdio.h>    // for fopen(), fgets(), fprintf()
+#include <stdlib.h>   // for malloc(), realloc(), strtod()
+#include <stdbool.h>  // for bool type
+#include <string.h>   // for strchr(), strtok()
+#include <math.h>     // for M_PI
+#include <time.h>     // for clock_gettime(), clock_nanosleep()
+#include <errno.h>    // for EINTR
+#include <sys/prctl.h> // for prctl()
+
+// HIDAPI
+#include "hidapi/hidapi.h"
+
+// project libraries
+#include "dds-host/hop.h"
+#include "dds-host/host.h"
+#include "dds-host/dac5687.h"
+#include "dds-host/realtime.h"
+
+#define MAX_HOP_LINE          256
+
+static unsigned long long Hop_Now(void) {
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (unsigned long long)now.tv_sec * 1000000000ULL + (unsigned long long)now.tv_nsec;
+}
+
+// sleeps until the monotonic clock reads 'ns', however many signals arrive meanwhile
+static void Hop_SleepUntil(unsigned long long ns) {
+  struct timespec when;
+  when.tv_sec = (time_t)(ns / 1000000000ULL);
+  when.tv_nsec = (long)(ns % 1000000000ULL);
+  while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &when, NULL) == EINTR && !Host_CancelRequested()) {
+  }
+}
+
+// appends a step to 'plan', growing it as needed. Returns false on failure.
+static bool Hop_Append(HopPlan *plan, unsigned int *capacity, unsigned long long offsetNs,
+                       double freqHz, double phase) {
+  if (plan->numSteps == *capacity) {
+    *capacity = *capacity ? *capacity * 2 : 64;
+    HopStep *steps = (HopStep *)realloc(plan->steps, *capacity * sizeof(HopStep));
+    if (steps == NULL) {
+      fprintf(stderr, "Failed to allocate hop plan\n");
+      return false;
+    }
+    plan->steps = steps;
+  }
+
+  HopStep *step = &plan->steps[plan->numSteps++];
+  memset(step, 0, sizeof(*step));
+  step->offsetNs = offsetNs;
+  step->freqHz = freqHz;
+  step->phase = phase;
+  return true;
+}
+
+HopPlan * Hop_Load(const char *fileName) {
+  FILE *fp = fopen(fileName, "r");
+
+  if (fp == NULL) {
+    perror("Hop_Load() failed");
+    return NULL;
+  }
+
+  HopPlan *plan = (HopPlan *)calloc(1, sizeof(HopPlan));
+  if (plan == NULL) {
+    fprintf(stderr, "Failed to allocate hop plan\n");
+    fclose(fp);
+    return NULL;
+  }
+
+  unsigned int capacity = 0;
+  unsigned int lineNum = 0;
+  char buf[MAX_HOP_LINE];
+
+  while (fgets(buf, sizeof(buf), fp) != NULL) {
+    lineNum++;
+
+    // everything after a '#' is a comment
+    char *comment = strchr(buf, '#');
+    if (comment != NULL) {
+      *comment = '\0';
+    }
+
+    char *fields[3];
+    unsigned int numFields = 0;
+    char *tok;
+    for (tok = strtok(buf, ", \t\r\n"); tok != NULL; tok = strtok(NULL, ", \t\r\n")) {
+      if (numFields == 3) {
+        numFields++;
+        break;
+      }
+      fields[numFields++] = tok;
+    }
+
+    if (numFields == 0) {
+      continue;
+    }
+
+    char *end0, *end1 = NULL, *end2 = NULL;
+    double offsetUs = strtod(fields[0], &end0);
+    double freqHz = numFields > 1 ? strtod(fields[1], &end1) : 0;
+    double phaseDeg = numFields > 2 ? strtod(fields[2], &end2) : 0;
+
+    bool ok = numFields >= 2 && numFields <= 3 && *end0 == '\0' && *end1 == '\0' &&
+              (end2 == NULL || *end2 == '\0') && offsetUs >= 0;
+    unsigned long long offsetNs = ok ? (unsigned long long)(offsetUs * 1000.0 + 0.5) : 0;
+
+    if (ok && plan->numSteps > 0 && offsetNs < plan->steps[plan->numSteps - 1].offsetNs) {
+      fprintf(stderr, "%s:%u: step goes back in time\n", fileName, lineNum);
+      ok = false;
+    } else if (!ok) {
+      fprintf(stderr, "%s:%u: expected <offset us>,<frequency Hz>[,<phase degrees>]\n", fileName, lineNum);
+    }
+
+    if (!ok || !Hop_Append(plan, &capacity, offsetNs, freqHz, phaseDeg * M_PI / 180.0)) {
+      fclose(fp);
+      Hop_Free(plan);
+      return NULL;
+    }
+  }
+  fclose(fp);
+
+  if (plan->numSteps == 0) {
+    fprintf(stderr, "%s: no hop steps\n", fileName);
+    Hop_Free(plan);
+    return NULL;
+  }
+  return plan;
+}
+
+HopPlan * Hop_CreateSweep(double startHz, double endHz, unsigned int numSteps, unsigned long long dwellNs) {
+  if (numSteps == 0) {
+    fprintf(stderr, "a sweep needs at least one step\n");
+    return NULL;
+  }
+
+  HopPlan *plan = (HopPlan *)calloc(1, sizeof(HopPlan));
+  if (plan == NULL) {
+    fprintf(stderr, "Failed to allocate hop plan\n");
+    return NULL;
+  }
+
+  unsigned int capacity = 0;
+  unsigned int i;
+  for (i = 0; i < numSteps; i++) {
+    double freqHz = numSteps == 1 ? startHz : startHz + (endHz - startHz) * i / (numSteps - 1);
+    if (!Hop_Append(plan, &capacity, i * dwellNs, freqHz, 0)) {
+      Hop_Free(plan);
+      return NULL;
+    }
+  }
+  return plan;
+}
+
+void Hop_Free(HopPlan *plan) {
+  if (plan != NULL) {
+    free(plan->steps);
+    free(plan);
+  }
+}
+
+void Hop_Encode(HopPlan *plan, const DAC5687NCO *nco) {
+  // each step only carries the words that differ from the step before, so encode
+  // them in order on a copy
+  DAC5687NCO encoder = *nco;
+
+  unsigned int i;
+  for (i = 0; i < plan->numSteps; i++) {
+    HopStep *step = &plan->steps[i];
+    step->numFrames = DAC5687_EncodeNCO(&encoder, step->freqHz, step->phase, step->frames);
+  }
+}
+
+bool Hop_Run(hid_device *handle, DAC5687NCO *nco, HopPlan *plan, HopStats *stats) {
+  stats->stepsSent = 0;
+  stats->overruns = 0;
+  Jitter_Reset(&stats->startLate);
+  Jitter_Reset(&stats->doneLate);
+
+  // where the frames were encoded from, to bring 'nco' up to date afterwards
+  DAC5687NCO encoder = *nco;
+
+  // bus setup is the slow part and doesn't belong on the timeline
+  if (!DAC5687_ReadyNCO(handle, nco)) {
+    return false;
+  }
+
+  // the default 50 us of timer slack would be most of our lateness; SCHED_FIFO
+  // threads have none anyway
+  int slack = prctl(PR_GET_TIMERSLACK, 0, 0, 0, 0);
+  prctl(PR_SET_TIMERSLACK, 1, 0, 0, 0);
+
+  unsigned long long start = Hop_Now();
+  unsigned int i;
+
+  for (i = 0; i < plan->numSteps; i++) {
+    HopStep *step = &plan->steps[i];
+    unsigned long long due = start + step->offsetNs;
+
+    Hop_SleepUntil(due);
+    if (Host_CancelRequested()) {
+      fprintf(stderr, "hop run cancelled after %u of %u steps\n", i, plan->numSteps);
+      break;
+    }
+
+    unsigned long long sent = Hop_Now();
+    if (!DAC5687_SendNCO(handle, nco, step->frames, step->numFrames)) {
+      // SendNCO() has already forgotten what the registers hold
+      fprintf(stderr, "Hop_Run() failed at step %u\n", i);
+      prctl(PR_SET_TIMERSLACK, slack, 0, 0, 0);
+      return false;
+    }
+    unsigned long long done = Hop_Now();
+
+    step->startLateNs = sent > due ? sent - due : 0;
+    step->doneLateNs = done - due;
+    Jitter_Record(&stats->startLate, step->startLateNs);
+    Jitter_Record(&stats->doneLate, step->doneLateNs);
+    stats->stepsSent++;
+
+    if (i + 1 < plan->numSteps && done > start + plan->steps[i + 1].offsetNs) {
+      stats->overruns++;
+    }
+  }
+
+  prctl(PR_SET_TIMERSLACK, slack, 0, 0, 0);
+
+  // the registers now hold what the sent steps encoded
+  for (i = 0; i < stats->stepsSent; i++) {
+    DAC5687Frame frames[DAC5687_NCO_MAX_FRAMES];
+    DAC5687_EncodeNCO(&encoder, plan->steps[i].freqHz, plan->steps[i].phase, frames);
+  }
+  nco->shadow = encoder.shadow;
+  return stats->stepsSent == plan->numSteps;
+}
+
+void Hop_PrintSteps(const HopPlan *plan, const HopStats *stats, FILE *out) {
+  fprintf(out, "step,offset_us,start_late_us,done_late_us,frames\n");
+
+  unsigned int i;
+  for (i = 0; i < stats->stepsSent && i < plan->numSteps; i++) {
+    const HopStep *step = &plan->steps[i];
+    fprintf(out, "%u,%.3f,%.3f,%.3f,%u\n", i, step->offsetNs / 1000.0,
+            step->startLateNs / 1000.0, step->doneLateNs / 1000.0, step->numFrames);
+  }
+}
@@ -0,0 +1,364 @@
+/*
+ * MIT License
+ * 
+ * Copyright (c) 2020 Eli Reed
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <stdio.h>    // for fprintf()
+#include <stdbool.h>  // for bool type
+#include <stdint.h>   // for fixed-width integer types
+#include <string.h>   // for memset()
+#include <signal.h>   // for sig_atomic_t
+#include <time.h>     // for nanosleep()
+
+// HIDAPI
+#include "hidapi/hidapi.h"
+
+// project libraries
+#include "dds-host/host.h"
+#include "dds-host/mcp2210.h"
+#include "dds-host/dac5687.h"
+#include "dds-host/dac-profile.h"
+#include "dds-host/cpld.h"
+#include "dds-host/image.h"
+#include "dds-host/cache.h"
+#include "dds-host/journal.h"
+#include "dds-host/progress.h"
+#include "dds-host/util/csv.h"
+#include "dds-host/util/hash.h"
+
+// the chip settings dds-host leaves the MCP2210 in once it's configured
+static void Host_DesiredChipSettings(MCP2210ChipSettings *chipSettings) {
+  // TODO: use a config file
+  memset(chipSettings, 0, sizeof(*chipSettings));
+  chipSettings->gp0Designation = CS;
+  chipSettings->gp1Designation = CS;
+  chipSettings->gp3Designation = DF;
+  // leave the rest of pins as GPIOs
+  chipSettings->chipSettings = 0x00;
+  chipSettings->defaultGPIODirection = 0x0000;
+  chipSettings->defaultGPIOValue = 0xFFFF;
+}
+
+// hashes the chip settings fields the MCP2210 reports back (not the password)
+static uint64_t Host_ChipSettingsFingerprint(const MCP2210ChipSettings *chipSettings) {
+  uint8_t fields[] = {
+    chipSettings->gp0Designation, chipSettings->gp1Designation, chipSettings->gp2Designation,
+    chipSettings->gp3Designation, chipSettings->gp4Designation, chipSettings->gp5Designation,
+    chipSettings->gp6Designation, chipSettings->gp7Designation, chipSettings->gp8Designation,
+    (uint8_t)(chipSettings->defaultGPIOValue & 0xFF), (uint8_t)((chipSettings->defaultGPIOValue & 0xFF00) >> 8),
+    (uint8_t)(chipSettings->defaultGPIODirection & 0xFF), (uint8_t)((chipSettings->defaultGPIODirection & 0xFF00) >> 8),
+    chipSettings->chipSettings, chipSettings->chipAccessControl,
+  };
+  return Hash_FNV1a64(HASH_FNV1A64_INIT, fields, sizeof(fields));
+}
+
+// combines the DAC register and chip settings fingerprints
+static uint64_t Host_Fingerprint(const DAC5687RegisterMap *map, const MCP2210ChipSettings *chipSettings) {
+  uint64_t chipPrint = Host_ChipSettingsFingerprint(chipSettings);
+  return Hash_FNV1a64(DAC5687_Fingerprint(map), &chipPrint, sizeof(chipPrint));
+}
+
+// writes every row of the DAC config in file order, then the chip settings
+static bool Host_ColdConfigure(hid_device *handle, CSVFile *dacConfigFile) {
+  // configure the DAC first
+  if (!DAC5687_Configure(dacConfigFile, handle)) {
+    return false;
+  }
+
+  MCP2210ChipSettings chipSettings;
+  Host_DesiredChipSettings(&chipSettings);
+
+  return MCP2210_WriteChipSettings(handle, &chipSettings, true) >= 0;
+}
+
+// applies a precompiled profile's frames, then the chip settings
+static bool Host_ColdConfigureProfile(hid_device *handle, const DACProfile *profile) {
+  if (!DACProfile_Apply(handle, profile)) {
+    return false;
+  }
+
+  MCP2210ChipSettings chipSettings;
+  Host_DesiredChipSettings(&chipSettings);
+
+  return MCP2210_WriteChipSettings(handle, &chipSettings, true) >= 0;
+}
+
+// reads the board's current state back and only writes what differs from 'desired'
+static bool Host_WarmConfigureMap(hid_device *handle, const DAC5687RegisterMap *desired) {
+  MCP2210ChipSettings desiredChip, currentChip;
+  Host_DesiredChipSettings(&desiredChip);
+
+  // the chip settings have to be read before the DAC readback changes them
+  if (MCP2210_ReadChipSettings(handle, &currentChip, true) != 0x00) {
+    fprintf(stderr, "WarmConfigure()->ReadChipSettings() failed\n");
+    return false;
+  }
+
+  DAC5687Shadow shadow;
+  DAC5687_InitShadow(&shadow);
+
+  if (!DAC5687_Resync(handle, &shadow, desired->mask)) {
+    return false;
+  }
+
+  uint64_t desiredPrint = Host_Fingerprint(desired, &desiredChip);
+  uint64_t currentPrint = Host_Fingerprint(&shadow.known, &currentChip);
+
+  if (desiredPrint == currentPrint) {
+    fprintf(stderr, "board already configured (fingerprint %016llx)\n", (unsigned long long)desiredPrint);
+  } else {
+    // only rewrite the registers that differ
+    unsigned int addr;
+    for (addr = 0; addr < DAC5687_NUM_REGISTERS; addr++) {
+      if ((desired->mask & (1UL << addr)) && !DAC5687_UpdateBits(&shadow, addr, 0xFF, desired->values[addr])) {
+        return false;
+      }
+    }
+
+    if (!DAC5687_Flush(handle, &shadow)) {
+      return false;
+    }
+  }
+
+  // the readback pointed the MCP2210 at the DAC, so the chip settings always go back
+  return MCP2210_WriteChipSettings(handle, &desiredChip, true) >= 0;
+}
+
+static bool Host_WarmConfigure(hid_device *handle, CSVFile *dacConfigFile) {
+  DAC5687RegisterMap desired;
+  uint32_t repeated;
+
+  if (!DAC5687_ParseConfig(dacConfigFile, &desired, &repeated)) {
+    return false;
+  }
+
+  // a register written twice may depend on the order of its writes, which the map can't keep
+  if (repeated != 0) {
+    fprintf(stderr, "config writes register %#x more than once, applying it in file order\n",
+            (unsigned int)__builtin_ctz(repeated));
+    return Host_ColdConfigure(handle, dacConfigFile);
+  }
+  return Host_WarmConfigureMap(handle, &desired);
+}
+
+// configures the board from a precompiled DAC profile instead of a CSV
+static bool Host_ConfigureFromProfile(hid_device *handle, const char *profileFileName, bool cold) {
+  DACProfile profile;
+
+  if (!DACProfile_Load(profileFileName, &profile)) {
+    return false;
+  }
+  return cold ? Host_ColdConfigureProfile(handle, &profile) : Host_WarmConfigureMap(handle, &profile.map);
+}
+
+bool Host_ConfigureDevices(hid_device *handle, const char *dacFileName, const char *mcpFileName, bool cold) {
+  if (DACProfile_IsProfile(dacFileName)) {
+    CSVFile *mcpConfigFile = CSV_Open(mcpFileName);
+    if (mcpConfigFile == NULL) {
+      return false;
+    }
+    CSV_Close(mcpConfigFile);
+    return Host_ConfigureFromProfile(handle, dacFileName, cold);
+  }
+
+  CSVFile *dacConfigFile = CSV_Open(dacFileName);
+  CSVFile *mcpConfigFile = CSV_Open(mcpFileName);
+
+  if (dacConfigFile == NULL) {
+    if (mcpConfigFile != NULL) {
+      CSV_Close(mcpConfigFile);
+    }
+    return false;
+  }
+
+  if (mcpConfigFile == NULL) {
+    CSV_Close(dacConfigFile);
+    return false;
+  }
+
+  bool ok = cold ? Host_ColdConfigure(handle, dacConfigFile) : Host_WarmConfigure(handle, dacConfigFile);
+
+  // clean up
+  CSV_Close(mcpConfigFile);
+  CSV_Close(dacConfigFile);
+  return ok;
+}
+
+unsigned int Host_WriteWords(hid_device *handle, unsigned int startAddr,
+                              const unsigned int *words, unsigned int count) {
+  return CPLD_WriteSRAM(handle, startAddr, words, count);
+}
+
+unsigned int Host_UploadImage(hid_device *handle, const SRAMImage *image, Progress *progress) {
+  if (image == NULL) {
+    fprintf(stderr, "image can't be null\n");
+    return 1;
+  }
+  return Host_UploadRange(handle, 0, image->words, image->numWords, progress);
+}
+
+unsigned int Host_UploadRange(hid_device *handle, unsigned int startAddr,
+                              const unsigned int *words, unsigned int count, Progress *progress) {
+  if (progress == NULL) {
+    return Host_WriteWords(handle, startAddr, words, count);
+  }
+
+  // report in chunks so progress costs one update per chunk rather than per word
+  unsigned int failed = 0;
+  unsigned int i;
+  for (i = 0; i < count; i += PROGRESS_CHUNK_WORDS) {
+    unsigned int chunk = count - i;
+    if (chunk > PROGRESS_CHUNK_WORDS) {
+      chunk = PROGRESS_CHUNK_WORDS;
+    }
+    unsigned int chunkFailed = Host_WriteWords(handle, startAddr + i, &words[i], chunk);
+    Progress_Add(progress, chunk, chunkFailed);
+    failed += chunkFailed;
+  }
+  return failed;
+}
+
+// set by Host_RequestCancel(), possibly from a signal handler
+static volatile sig_atomic_t cancelRequested = 0;
+
+void Host_RequestCancel(void) {
+  cancelRequested = 1;
+}
+
+bool Host_CancelRequested(void) {
+  return cancelRequested != 0;
+}
+
+// closes a handle that stopped answering and waits for the device to come back,
+// then puts the configuration back the way it was
+static bool Host_Reconnect(hid_device **handle, const UploadJob *job) {
+  MCP2210_Close(*handle);
+  *handle = NULL;
+
+  struct timespec delay;
+  delay.tv_sec = HOST_REOPEN_DELAY_MS / 1000;
+  delay.tv_nsec = (HOST_REOPEN_DELAY_MS % 1000) * 1000000L;
+
+  unsigned int attempts = (job->reopenAttempts > 0) ? job->reopenAttempts : HOST_REOPEN_ATTEMPTS;
+  unsigned int attempt;
+  for (attempt = 0; attempt < attempts && *handle == NULL && !Host_CancelRequested(); attempt++) {
+    if (attempt > 0) {
+      nanosleep(&delay, NULL);
+    }
+    *handle = (job->reopen != NULL) ? job->reopen(job->reopenCtx) : MCP2210_Init();
+  }
+
+  if (*handle == NULL) {
+    fprintf(stderr, "device didn't come back after %u attempts\n", attempt);
+    return false;
+  }
+
+  // the chip came back with its power-up settings; the SRAM bus is set up again by
+  // every write, but the DAC may need its registers back
+  if (job->dacFileName != NULL && !Host_ConfigureDevices(*handle, job->dacFileName, job->mcpFileName, false)) {
+    fprintf(stderr, "couldn't reconfigure the board after reconnecting\n");
+    return false;
+  }
+  return true;
+}
+
+unsigned int Host_UploadResumable(hid_device **handle, const UploadJob *job) {
+  if (handle == NULL || *handle == NULL || job == NULL || job->words == NULL) {
+    fprintf(stderr, "handle and job can't be null\n");
+    return job != NULL ? job->count : 1;
+  }
+
+  unsigned int done = 0;
+  Journal *journal = NULL;
+
+  if (job->journalFileName != NULL) {
+    ImageTag tag;
+    Cache_TagWords(job->words, job->startAddr, job->count, &tag);
+
+    journal = Journal_Open(job->journalFileName, &tag, &done);
+    if (journal == NULL) {
+      return job->count;
+    }
+
+    // the board may have been power cycled since, so make sure the last word the
+    // journal vouches for is really there
+    if (done > 0) {
+      unsigned int word;
+      if (CPLD_ReadSRAMAddress(*handle, job->startAddr + done - 1, &word) && word == job->words[done - 1]) {
+        fprintf(stderr, "resuming upload at word %u of %u\n", done, job->count);
+      } else {
+        fprintf(stderr, "SRAM no longer holds the journaled words, starting over\n");
+        done = 0;
+      }
+    }
+  }
+
+  unsigned int retries = 0;
+  while (done < job->count && !Host_CancelRequested()) {
+    unsigned int chunk = job->count - done;
+    if (chunk > HOST_CHECKPOINT_WORDS) {
+      chunk = HOST_CHECKPOINT_WORDS;
+    }
+
+    MCP2210Counters before, after;
+    MCP2210_GetCounters(&before);
+    unsigned int failed = Host_WriteWords(*handle, job->startAddr + done, &job->words[done], chunk);
+    MCP2210_GetCounters(&after);
+
+    if (failed == 0) {
+      done += chunk;
+      retries = 0;
+      if (job->progress != NULL) {
+        Progress_Add(job->progress, chunk, 0);
+      }
+      if (journal != NULL && !Journal_Checkpoint(journal, done)) {
+        break;
+      }
+      continue;
+    }
+
+    if (++retries > HOST_MAX_RETRIES) {
+      fprintf(stderr, "giving up on SRAM address %05x after %u attempts\n", job->startAddr + done, retries);
+      break;
+    }
+
+    if (after.linkErrors != before.linkErrors) {
+      fprintf(stderr, "device stopped answering at SRAM address %05x, reconnecting\n", job->startAddr + done);
+      if (!Host_Reconnect(handle, job)) {
+        break;
+      }
+    }
+  }
+
+  if (Host_CancelRequested() && *handle != NULL) {
+    // don't leave the chip halfway through a transfer the next run doesn't know about
+    MCP2210_CancelSpiDataTransfer(*handle);
+  }
+
+  if (done < job->count) {
+    fprintf(stderr, "upload stopped after %u of %u words%s\n", done, job->count,
+            journal != NULL ? ", run again with the same journal to resume" : "");
+  }
+
+  Journal_Close(journal, done == job->count);
+  return job->count - done;
+}
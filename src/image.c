@@ -0,0 +1,289 @@
+/*
+ * MIT License
+ * 
+ * Copyright (c) 2020 Eli Reed
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <stdio.h>    // for fprintf()
+#include <stdlib.h>   // for malloc(), free(), strtoul()
+#include <stdbool.h>  // for bool type
+#include <string.h>   // for strtok(), strchr()
+
+// project libraries
+#include "dds-host/cpld.h"
+#include "dds-host/image.h"
+#include "dds-host/util/csv.h"
+
+// parses one row of a data CSV into a word
+static bool Image_ParseRow(char *line, unsigned long long numCols, unsigned int bitsPerCol, unsigned int *word) {
+  const unsigned long long colMask = (1ULL << bitsPerCol) - 1;
+  unsigned long long col;
+  char *tok = strtok(line, ",");
+
+  *word = 0;
+  for (col = 0; col < numCols; col++) {
+    if (tok == NULL || *tok == '\0' || *tok == '\n') {
+      return false;
+    }
+    unsigned long long value = strtoull(tok, NULL, 16);
+    *word |= (unsigned int)((value & colMask) << (col * bitsPerCol));
+    tok = strtok(NULL, ",\n");
+  }
+  return true;
+}
+
+// each column holds (4 / numCols) bytes of the word; returns 0 for a bad layout
+static unsigned int Image_BitsPerCol(unsigned long long numCols) {
+  switch (numCols) {
+    case (4):
+      return 8;
+    case (2):
+      return 16;
+    case (1):
+      return 32;
+    default:
+      fprintf(stderr, "Data in the csv isn't formatted correctly. Check README for formatting notes.\n");
+      return 0;
+  }
+}
+
+SRAMImage * Image_FromCSVRange(CSVFile *file, unsigned long long firstRow, unsigned int count) {
+  if (file == NULL) {
+    fprintf(stderr, "file can't be null\n");
+    return NULL;
+  }
+
+  unsigned int bitsPerCol = Image_BitsPerCol(file->numCols);
+  if (bitsPerCol == 0) {
+    return NULL;
+  }
+
+  if (firstRow > file->numRows || count > file->numRows - firstRow) {
+    fprintf(stderr, "Image_FromCSVRange()->rows %llu-%llu are past the end of the data (%llu rows)\n",
+            firstRow, firstRow + count, file->numRows);
+    return NULL;
+  }
+
+  if (count > SRAM_MAX_ADDRESS + 1) {
+    fprintf(stderr, "Image_FromCSVRange()->data has more rows than the SRAM has addresses\n");
+    return NULL;
+  }
+
+  SRAMImage *image = (SRAMImage *)malloc(sizeof(SRAMImage));
+
+  if (image == NULL) {
+    fprintf(stderr, "Failed to allocate SRAMImage\n");
+    return NULL;
+  }
+
+  image->numWords = count;
+  image->words = (unsigned int *)calloc(image->numWords ? image->numWords : 1, sizeof(unsigned int));
+
+  if (image->words == NULL) {
+    fprintf(stderr, "Failed to allocate SRAMImage words\n");
+    free(image);
+    return NULL;
+  }
+
+  // one pass over the file: skip the rows before the range without parsing them,
+  // then parse the rows in it
+  char line[MAX_CELL_LENGTH + 1];
+  unsigned long long row = 0;
+
+  fseek(file->fp, 0, SEEK_SET);
+  while (row < firstRow + count && fgets(line, sizeof(line), file->fp) != NULL) {
+    // a line longer than the buffer comes back in pieces; only the last one ends the row
+    bool endOfRow = strchr(line, '\n') != NULL || feof(file->fp);
+
+    if (row >= firstRow && !Image_ParseRow(line, file->numCols, bitsPerCol, &image->words[row - firstRow])) {
+      fprintf(stderr, "Image_FromCSVRange()->missing element in row %llu\n", row + 1);
+      Image_Free(image);
+      return NULL;
+    }
+
+    if (endOfRow) {
+      row++;
+    } else if (row >= firstRow) {
+      fprintf(stderr, "Image_FromCSVRange()->row %llu is too long\n", row + 1);
+      Image_Free(image);
+      return NULL;
+    }
+  }
+  fseek(file->fp, 0, SEEK_SET);
+
+  if (row < firstRow + count) {
+    fprintf(stderr, "Image_FromCSVRange()->missing element in row %llu\n", row + 1);
+    Image_Free(image);
+    return NULL;
+  }
+  return image;
+}
+
+SRAMImage * Image_FromCSV(CSVFile *file) {
+  if (file == NULL) {
+    fprintf(stderr, "file can't be null\n");
+    return NULL;
+  }
+
+  if (file->numRows > SRAM_MAX_ADDRESS + 1) {
+    fprintf(stderr, "Image_FromCSV()->data has more rows than the SRAM has addresses\n");
+    return NULL;
+  }
+  return Image_FromCSVRange(file, 0, (unsigned int)file->numRows);
+}
+
+SRAMImage * Image_Load(const char *fileName) {
+  return Image_LoadRange(fileName, 0, 0);
+}
+
+SRAMImage * Image_LoadRange(const char *fileName, unsigned long long firstRow, unsigned int count) {
+  CSVFile *file = CSV_Open(fileName);
+
+  if (file == NULL) {
+    return NULL;
+  }
+
+  if (count == 0 && firstRow < file->numRows) {
+    count = (unsigned int)(file->numRows - firstRow);
+  }
+
+  SRAMImage *image = Image_FromCSVRange(file, firstRow, count);
+  CSV_Close(file);
+  return image;
+}
+
+struct image_reader_st {
+  CSVFile *file;
+  unsigned int bitsPerCol;
+  // rows of the file read so far, and the rows the range starts and ends at. A range
+  // read to the end of the file has no end row, since the file's rows aren't counted.
+  unsigned long long row;
+  unsigned long long firstRow;
+  unsigned long long endRow;
+  bool toEnd;
+};
+
+ImageReader * Image_OpenReader(const char *fileName, unsigned long long firstRow, unsigned int count) {
+  CSVFile *file = CSV_OpenStream(fileName);
+
+  if (file == NULL) {
+    return NULL;
+  }
+
+  unsigned int bitsPerCol = Image_BitsPerCol(file->numCols);
+  if (bitsPerCol == 0) {
+    CSV_Close(file);
+    return NULL;
+  }
+
+  ImageReader *reader = (ImageReader *)malloc(sizeof(ImageReader));
+
+  if (reader == NULL) {
+    fprintf(stderr, "Failed to allocate ImageReader\n");
+    CSV_Close(file);
+    return NULL;
+  }
+
+  reader->file = file;
+  reader->bitsPerCol = bitsPerCol;
+  reader->row = 0;
+  reader->firstRow = firstRow;
+  reader->endRow = firstRow + count;
+  reader->toEnd = count == 0;
+
+  // skip the rows before the range without parsing them
+  char line[MAX_CELL_LENGTH + 1];
+  while (reader->row < firstRow && fgets(line, sizeof(line), file->fp) != NULL) {
+    if (strchr(line, '\n') != NULL || feof(file->fp)) {
+      reader->row++;
+    }
+  }
+
+  if (reader->row < firstRow) {
+    fprintf(stderr, "Image_OpenReader()->row %llu is past the end of the data (%llu rows)\n",
+            firstRow + 1, reader->row);
+    Image_CloseReader(reader);
+    return NULL;
+  }
+  return reader;
+}
+
+// returns true if nothing but line endings are left in the file
+static bool Image_AtEnd(FILE *fp) {
+  int c;
+  while ((c = fgetc(fp)) == '\n' || c == '\r') {
+  }
+  if (c == EOF) {
+    return true;
+  }
+  ungetc(c, fp);
+  return false;
+}
+
+bool Image_Read(ImageReader *reader, unsigned int *words, unsigned int max, unsigned int *got) {
+  char line[MAX_CELL_LENGTH + 1];
+  *got = 0;
+
+  while (*got < max && (reader->toEnd || reader->row < reader->endRow)) {
+    // without a row count, the data ends where the file does
+    if (reader->toEnd && Image_AtEnd(reader->file->fp)) {
+      break;
+    }
+
+    if (fgets(line, sizeof(line), reader->file->fp) == NULL) {
+      fprintf(stderr, "Image_Read()->missing element in row %llu\n", reader->row + 1);
+      return false;
+    }
+
+    if (strchr(line, '\n') == NULL && !feof(reader->file->fp)) {
+      fprintf(stderr, "Image_Read()->row %llu is too long\n", reader->row + 1);
+      return false;
+    }
+
+    if (!Image_ParseRow(line, reader->file->numCols, reader->bitsPerCol, &words[*got])) {
+      fprintf(stderr, "Image_Read()->missing element in row %llu\n", reader->row + 1);
+      return false;
+    }
+    reader->row++;
+    (*got)++;
+  }
+  return true;
+}
+
+unsigned int Image_ReaderRows(const ImageReader *reader) {
+  return reader->toEnd ? 0 : (unsigned int)(reader->endRow - reader->firstRow);
+}
+
+void Image_CloseReader(ImageReader *reader) {
+  if (reader == NULL) {
+    return;
+  }
+  CSV_Close(reader->file);
+  free(reader);
+}
+
+void Image_Free(SRAMImage *image) {
+  if (image == NULL) {
+    return;
+  }
+  free(image->words);
+  free(image);
+}
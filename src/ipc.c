@@ -0,0 +1,289 @@
+/*
+ * MIT License
+ * 
+ * Copyright (c) 2020 Eli Reed
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <stdio.h>      // for fprintf(), perror()
+#include <stdlib.h>     // for malloc(), free()
+#include <stdbool.h>    // for bool type
+#include <stdint.h>     // for fixed-width integer types
+#include <string.h>     // for memset(), strlen(), strerror()
+#include <errno.h>      // for errno
+#include <unistd.h>     // for read(), write(), close(), unlink()
+#include <sys/socket.h> // for socket(), bind(), listen(), connect()
+#include <sys/un.h>     // for struct sockaddr_un
+#include <sys/stat.h>   // for chmod()
+
+// project libraries
+#include "dds-host/ipc.h"
+#include "dds-host/util/bytes.h"
+
+static bool IPC_FillAddress(struct sockaddr_un *addr, const char *path) {
+  if (path == NULL) {
+    fprintf(stderr, "socket path can't be null\n");
+    return false;
+  }
+
+  memset(addr, 0, sizeof(*addr));
+  addr->sun_family = AF_UNIX;
+
+  if (strlen(path) >= sizeof(addr->sun_path)) {
+    fprintf(stderr, "socket path is too long: %s\n", path);
+    return false;
+  }
+  strcpy(addr->sun_path, path);
+  return true;
+}
+
+// writes exactly 'len' bytes
+static bool IPC_WriteAll(int fd, const uint8_t *buf, size_t len) {
+  while (len > 0) {
+    ssize_t res = write(fd, buf, len);
+    if (res < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      perror("IPC_WriteAll()->write() failed");
+      return false;
+    }
+    buf += res;
+    len -= res;
+  }
+  return true;
+}
+
+// reads exactly 'len' bytes. A clean EOF before any byte is read isn't reported.
+static bool IPC_ReadAll(int fd, uint8_t *buf, size_t len) {
+  size_t total = 0;
+  while (total < len) {
+    ssize_t res = read(fd, buf + total, len - total);
+    if (res < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      perror("IPC_ReadAll()->read() failed");
+      return false;
+    }
+    if (res == 0) {
+      if (total != 0) {
+        fprintf(stderr, "IPC_ReadAll()->connection closed mid-message\n");
+      }
+      return false;
+    }
+    total += res;
+  }
+  return true;
+}
+
+int IPC_Listen(const char *path) {
+  struct sockaddr_un addr;
+  if (!IPC_FillAddress(&addr, path)) {
+    return -1;
+  }
+
+  // a daemon that still answers owns the socket; only one that's gone can have its
+  // socket file replaced
+  int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+  if (fd < 0) {
+    perror("IPC_Listen()->socket() failed");
+    return -1;
+  }
+
+  if (connect(fd, (struct sockaddr *)&addr, sizeof(addr)) == 0) {
+    fprintf(stderr, "another daemon is already listening on %s\n", path);
+    close(fd);
+    return -1;
+  }
+
+  int err = errno;
+  close(fd);
+  if (err != ECONNREFUSED && err != ENOENT) {
+    fprintf(stderr, "IPC_Listen()->couldn't tell whether %s is in use: %s\n", path, strerror(err));
+    return -1;
+  }
+
+  if (err == ECONNREFUSED && unlink(path) < 0) {
+    perror("IPC_Listen()->unlink() failed");
+    return -1;
+  }
+
+  fd = socket(AF_UNIX, SOCK_STREAM, 0);
+  if (fd < 0) {
+    perror("IPC_Listen()->socket() failed");
+    return -1;
+  }
+
+  if (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+    perror("IPC_Listen()->bind() failed");
+    close(fd);
+    return -1;
+  }
+
+  // the socket file starts out with the umask's permissions; nobody can connect
+  // before listen(), so tightening them here leaves no window
+  if (chmod(path, IPC_SOCKET_MODE) < 0) {
+    perror("IPC_Listen()->chmod() failed");
+    close(fd);
+    unlink(path);
+    return -1;
+  }
+
+  if (listen(fd, 8) < 0) {
+    perror("IPC_Listen()->listen() failed");
+    close(fd);
+    return -1;
+  }
+  return fd;
+}
+
+int IPC_Connect(const char *path) {
+  struct sockaddr_un addr;
+  if (!IPC_FillAddress(&addr, path)) {
+    return -1;
+  }
+
+  int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+  if (fd < 0) {
+    perror("IPC_Connect()->socket() failed");
+    return -1;
+  }
+
+  if (connect(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+    perror("IPC_Connect()->connect() failed");
+    close(fd);
+    return -1;
+  }
+  return fd;
+}
+
+bool IPC_Send(int fd, const IPCHeader *header, const void *payload) {
+  if (header == NULL) {
+    fprintf(stderr, "header can't be null\n");
+    return false;
+  }
+
+  if (header->payloadLen > IPC_MAX_PAYLOAD) {
+    fprintf(stderr, "IPC_Send()->payload is too large: %u\n", header->payloadLen);
+    return false;
+  }
+
+  if (header->payloadLen > 0 && payload == NULL) {
+    fprintf(stderr, "payload can't be null\n");
+    return false;
+  }
+
+  uint8_t buf[IPC_HEADER_LEN];
+  buf[0] = (uint8_t)(IPC_MAGIC & 0xFF);
+  buf[1] = (uint8_t)((IPC_MAGIC & 0xFF00) >> 8);
+  buf[2] = header->op;
+  buf[3] = header->status;
+  Bytes_PutLE(&buf[4], header->arg0, 4);
+  Bytes_PutLE(&buf[8], header->arg1, 4);
+  Bytes_PutLE(&buf[12], header->payloadLen, 4);
+
+  if (!IPC_WriteAll(fd, buf, sizeof(buf))) {
+    return false;
+  }
+  return IPC_WriteAll(fd, (const uint8_t *)payload, header->payloadLen);
+}
+
+bool IPC_Receive(int fd, IPCHeader *header, uint8_t **payload) {
+  if (header == NULL || payload == NULL) {
+    fprintf(stderr, "header and payload can't be null\n");
+    return false;
+  }
+
+  *payload = NULL;
+
+  uint8_t buf[IPC_HEADER_LEN];
+  if (!IPC_ReadAll(fd, buf, sizeof(buf))) {
+    return false;
+  }
+
+  header->magic = buf[0] | (buf[1] << 8);
+  header->op = buf[2];
+  header->status = buf[3];
+  header->arg0 = (uint32_t)Bytes_GetLE(&buf[4], 4);
+  header->arg1 = (uint32_t)Bytes_GetLE(&buf[8], 4);
+  header->payloadLen = (uint32_t)Bytes_GetLE(&buf[12], 4);
+
+  if (header->magic != IPC_MAGIC) {
+    fprintf(stderr, "IPC_Receive()->bad magic %#x\n", header->magic);
+    return false;
+  }
+
+  if (header->payloadLen > IPC_MAX_PAYLOAD) {
+    fprintf(stderr, "IPC_Receive()->payload is too large: %u\n", header->payloadLen);
+    return false;
+  }
+
+  if (header->payloadLen == 0) {
+    return true;
+  }
+
+  *payload = (uint8_t *)malloc(header->payloadLen);
+  if (*payload == NULL) {
+    fprintf(stderr, "Failed to allocate IPC payload\n");
+    return false;
+  }
+
+  if (!IPC_ReadAll(fd, *payload, header->payloadLen)) {
+    free(*payload);
+    *payload = NULL;
+    return false;
+  }
+  return true;
+}
+
+bool IPC_Transact(int fd, const IPCHeader *request, const void *payload,
+                  IPCHeader *reply, uint8_t **replyPayload) {
+  if (!IPC_Send(fd, request, payload)) {
+    return false;
+  }
+
+  if (!IPC_Receive(fd, reply, replyPayload)) {
+    fprintf(stderr, "IPC_Transact()->no reply from daemon\n");
+    return false;
+  }
+
+  if (reply->op != request->op) {
+    fprintf(stderr, "IPC_Transact()->reply is for op %#x, expected %#x\n", reply->op, request->op);
+    free(*replyPayload);
+    *replyPayload = NULL;
+    return false;
+  }
+  return true;
+}
+
+void IPC_PackWords(uint8_t *out, const unsigned int *words, unsigned int count) {
+  unsigned int i;
+  for (i = 0; i < count; i++) {
+    Bytes_PutLE(&out[i * SRAM_DATA_SIZE], words[i], 4);
+  }
+}
+
+void IPC_UnpackWords(unsigned int *out, const uint8_t *in, unsigned int count) {
+  unsigned int i;
+  for (i = 0; i < count; i++) {
+    out[i] = (uint32_t)Bytes_GetLE(&in[i * SRAM_DATA_SIZE], 4);
+  }
+}
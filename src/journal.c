@@ -0,0 +1,147 @@
+/*
+ * MIT License
+ * 
+ * Copyright (c) 2020 Eli Reed
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <stdio.h>    // for fopen(), fprintf(), fscanf(), remove()
+#include <stdlib.h>   // for malloc(), free()
+#include <stdbool.h>  // for bool type
+#include <string.h>   // for strcmp(), strdup()
+
+// project libraries
+#include "dds-host/journal.h"
+#include "dds-host/cache.h"
+
+#define JOURNAL_MAGIC     "ddsjournal"
+#define JOURNAL_VERSION   1
+
+struct journal_st {
+  FILE *file;
+  char *fileName;
+  ImageTag tag;
+};
+
+// reads the journal left by a previous run. Returns false if there isn't a usable one.
+static bool Journal_Read(const char *fileName, ImageTag *tag, unsigned int *done) {
+  FILE *file = fopen(fileName, "r");
+
+  if (file == NULL) {
+    return false;
+  }
+
+  char magic[16];
+  unsigned int version;
+  unsigned long long hash;
+  unsigned int journaled;
+  int fields = fscanf(file, "%15s %u %x %u %llx %u", magic, &version, &tag->startAddr,
+                      &tag->numWords, &hash, &journaled);
+  fclose(file);
+
+  tag->hash = hash;
+  if (fields != 6 || strcmp(magic, JOURNAL_MAGIC) != 0 || version != JOURNAL_VERSION ||
+      journaled > tag->numWords) {
+    return false;
+  }
+
+  // only a journal we accept gets to say how far the last run got
+  *done = journaled;
+  return true;
+}
+
+static bool Journal_Write(Journal *journal, unsigned int done) {
+  // fixed-width fields, so every checkpoint overwrites the last one exactly
+  rewind(journal->file);
+  fprintf(journal->file, "%s %u %05x %6u %016llx %6u\n", JOURNAL_MAGIC, JOURNAL_VERSION,
+          journal->tag.startAddr, journal->tag.numWords, (unsigned long long)journal->tag.hash, done);
+
+  if (fflush(journal->file) != 0 || ferror(journal->file)) {
+    fprintf(stderr, "Failed to write journal %s\n", journal->fileName);
+    return false;
+  }
+  return true;
+}
+
+Journal * Journal_Open(const char *fileName, const ImageTag *tag, unsigned int *done) {
+  if (fileName == NULL || tag == NULL || done == NULL) {
+    fprintf(stderr, "fileName, tag and done can't be null\n");
+    return NULL;
+  }
+
+  ImageTag old;
+  unsigned int journaled = 0;
+  *done = 0;
+  if (Journal_Read(fileName, &old, &journaled)) {
+    if (old.startAddr != tag->startAddr || old.numWords != tag->numWords || old.hash != tag->hash) {
+      fprintf(stderr, "journal %s is for a different upload, starting over\n", fileName);
+    } else {
+      *done = journaled;
+    }
+  }
+
+  Journal *journal = (Journal *)malloc(sizeof(Journal));
+
+  if (journal == NULL) {
+    fprintf(stderr, "Failed to allocate Journal\n");
+    return NULL;
+  }
+
+  journal->tag = *tag;
+  journal->fileName = strdup(fileName);
+  journal->file = fopen(fileName, "w");
+
+  if (journal->fileName == NULL || journal->file == NULL) {
+    fprintf(stderr, "Failed to open journal %s\n", fileName);
+    if (journal->file != NULL) {
+      fclose(journal->file);
+    }
+    free(journal->fileName);
+    free(journal);
+    return NULL;
+  }
+
+  if (!Journal_Write(journal, *done)) {
+    Journal_Close(journal, false);
+    return NULL;
+  }
+  return journal;
+}
+
+bool Journal_Checkpoint(Journal *journal, unsigned int done) {
+  if (journal == NULL) {
+    fprintf(stderr, "journal can't be null\n");
+    return false;
+  }
+  return Journal_Write(journal, done);
+}
+
+void Journal_Close(Journal *journal, bool finished) {
+  if (journal == NULL) {
+    return;
+  }
+
+  fclose(journal->file);
+  if (finished && remove(journal->fileName) != 0) {
+    fprintf(stderr, "Failed to remove journal %s\n", journal->fileName);
+  }
+  free(journal->fileName);
+  free(journal);
+}
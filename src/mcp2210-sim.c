@@ -0,0 +1,540 @@
+/*
+ * MIT License
+ * 
+ * Copyright (c) 2020 Eli Reed
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <stdio.h>    // for fprintf()
+#include <stdlib.h>   // for malloc(), free()
+#include <stdbool.h>  // for bool type
+#include <stdint.h>   // for fixed-width integer types
+#include <string.h>   // for memset(), memcpy()
+#include <time.h>     // for nanosleep()
+
+// HIDAPI
+#include "hidapi/hidapi.h"
+
+// project libraries
+#include "dds-host/mcp2210.h"
+#include "dds-host/mcp2210-sim.h"
+#include "dds-host/cpld.h"
+#include "dds-host/dac5687.h"
+
+// SPI engine status codes reported in byte 3 of a SpiDataTransfer reply
+#define SPI_FINISHED            0x10
+#define SPI_STARTED_NO_DATA     0x20
+#define SPI_DATA_AVAILABLE      0x30
+
+// replies to commands the simulator doesn't understand
+#define SIM_UNSUPPORTED         0xFF
+
+// MCP2210 delays are counted in 100 us steps
+#define DELAY_STEP_NS           100000ULL
+
+// the chip's own reset defaults (see the MCP2210 datasheet)
+#define DEFAULT_BIT_RATE        12000000
+
+#define EEPROM_SIZE             256
+#define NVRAM_SLOT_SIZE         60
+
+// what a saved board starts with; the last byte is the version
+#define STATE_MAGIC             "DDSSIMS\x01"
+#define STATE_MAGIC_LEN         8
+
+typedef enum spi_target_t {
+  NoTarget,
+  SRAMTarget,
+  DACTarget,
+} SPITarget;
+
+struct mcp2210_sim_st {
+  MCP2210SPITransferSettings spi;
+  MCP2210ChipSettings chip;
+  uint16_t gpioValues;
+  uint16_t gpioDirections;
+  unsigned char eeprom[EEPROM_SIZE];
+
+  // power-up settings, stored as the raw report payloads, indexed by sub-command
+  unsigned char nvram[5][NVRAM_SLOT_SIZE];
+
+  // the SPI transaction in flight
+  bool inTransaction;
+  SPITarget target;
+  unsigned char txBytes[MAX_TRANSACTION_BYTES];
+  unsigned char rxBytes[MAX_TRANSACTION_BYTES];
+  unsigned int bytesReceived;
+  unsigned int bytesReturned;
+  unsigned long long doneAtNs;
+
+  // device models
+  unsigned int sram[SRAM_MAX_ADDRESS + 1];
+  unsigned char dac[32];
+
+  unsigned long long latencyNs;
+  bool realtime;
+  hid_device *handle;
+  MCP2210SimStats stats;
+
+  // set by MCP2210Sim_DropLinkAfter(): the link goes down once stats.reports reaches
+  // dropAtReport (if not 0) and stays down until the simulator is opened again
+  unsigned long long dropAtReport;
+  bool linkDown;
+};
+
+static unsigned int MCP2210Sim_NVRAMSlot(uint8_t subCommand) {
+  switch (subCommand) {
+    case (SpiSettings):
+      return 0;
+    case (ChipSettings):
+      return 1;
+    case (USBSettings):
+      return 2;
+    case (ProductName):
+      return 3;
+    default:
+      return 4;
+  }
+}
+
+// works out which device a transaction with the current settings would select.
+// a GP pin selects its device if it's a chip select that idles high and goes low.
+static SPITarget MCP2210Sim_Target(const MCP2210Sim *sim) {
+  bool memSelected = sim->chip.gp1Designation == CS &&
+                     (sim->spi.idleCSValue & 0x02) && !(sim->spi.activeCSValue & 0x02);
+  bool dacSelected = sim->chip.gp0Designation == CS &&
+                     (sim->spi.idleCSValue & 0x01) && !(sim->spi.activeCSValue & 0x01);
+
+  if (memSelected) {
+    return SRAMTarget;
+  }
+  return dacSelected ? DACTarget : NoTarget;
+}
+
+// runs a complete transaction against the selected device model
+static void MCP2210Sim_Clock(MCP2210Sim *sim) {
+  unsigned int len = sim->spi.bytesPerTransaction;
+  memset(sim->rxBytes, 0, len);
+
+  if (sim->target == SRAMTarget && len == SRAM_PACKET_SIZE) {
+    // same layout as CPLD_EncodePacket()
+    unsigned int addr = ((sim->txBytes[0] >> 6) & 0x03) |
+                        ((sim->txBytes[1] & 0x7F) << 2) |
+                        ((unsigned int)(sim->txBytes[2] & 0x3F) << 10);
+    if (sim->txBytes[0] & 0x01) {
+      memcpy(&sim->rxBytes[3], &sim->sram[addr], SRAM_DATA_SIZE);
+    } else {
+      memcpy(&sim->sram[addr], &sim->txBytes[3], SRAM_DATA_SIZE);
+    }
+  } else if (sim->target == DACTarget && len >= 2) {
+    unsigned char instr = sim->txBytes[0];
+    unsigned int addr = instr & 0x1F;
+    unsigned int count = ((instr >> 5) & 0x03) + 1;
+    unsigned int i;
+    for (i = 0; i < count && i + 1 < len; i++) {
+      if (instr & 0x80) {
+        sim->rxBytes[i + 1] = sim->dac[(addr + i) & 0x1F];
+      } else {
+        sim->dac[(addr + i) & 0x1F] = sim->txBytes[i + 1];
+      }
+    }
+  }
+}
+
+static void MCP2210Sim_SpiTransfer(MCP2210Sim *sim, const uint8_t *txBuf, uint8_t *rxBuf) {
+  unsigned int chunk = txBuf[1];
+  sim->stats.spiReports++;
+
+  if (chunk > 60) {
+    rxBuf[1] = SIM_UNSUPPORTED;
+    return;
+  }
+
+  if (!sim->inTransaction) {
+    if (chunk == 0) {
+      // nothing to start, and nothing to report
+      rxBuf[1] = 0x00;
+      rxBuf[3] = SPI_FINISHED;
+      return;
+    }
+    sim->inTransaction = true;
+    sim->target = MCP2210Sim_Target(sim);
+    sim->bytesReceived = 0;
+    sim->bytesReturned = 0;
+  }
+
+  unsigned int len = sim->spi.bytesPerTransaction;
+  if (sim->bytesReceived + chunk > len) {
+    // more data than the transaction is long
+    rxBuf[1] = SIM_UNSUPPORTED;
+    return;
+  }
+
+  memcpy(&sim->txBytes[sim->bytesReceived], &txBuf[4], chunk);
+  sim->bytesReceived += chunk;
+  rxBuf[1] = 0x00;
+
+  if (chunk > 0 && sim->bytesReceived == len) {
+    // the whole transaction is in: schedule when it will have been clocked out
+    unsigned long long bitRate = sim->spi.bitRate ? sim->spi.bitRate : DEFAULT_BIT_RATE;
+    unsigned long long clockNs = (len * 8ULL * 1000000000ULL) / bitRate;
+    unsigned long long delayNs = (sim->spi.csToDataDelay + sim->spi.lastDataToCSDelay) * DELAY_STEP_NS +
+                                 (len - 1) * sim->spi.dataToDataDelay * DELAY_STEP_NS;
+    sim->doneAtNs = sim->stats.elapsedNs + clockNs + delayNs;
+    sim->stats.spiBytes += len;
+    MCP2210Sim_Clock(sim);
+  }
+
+  // with no report latency the clock would never reach the end of the transfer, so
+  // the host is taken to have waited exactly as long as the transfer took
+  if (sim->latencyNs == 0 && sim->bytesReceived == len && sim->stats.elapsedNs < sim->doneAtNs) {
+    sim->stats.elapsedNs = sim->doneAtNs;
+  }
+
+  if (sim->bytesReceived < len || sim->stats.elapsedNs < sim->doneAtNs) {
+    sim->stats.busyPolls++;
+    rxBuf[2] = 0;
+    rxBuf[3] = SPI_STARTED_NO_DATA;
+    return;
+  }
+
+  // finished: hand back everything we received in one go
+  unsigned int rxLen = len - sim->bytesReturned;
+  if (rxLen > 60) {
+    rxLen = 60;
+  }
+  memcpy(&rxBuf[4], &sim->rxBytes[sim->bytesReturned], rxLen);
+  sim->bytesReturned += rxLen;
+  rxBuf[2] = rxLen;
+
+  if (sim->bytesReturned == len) {
+    rxBuf[3] = SPI_FINISHED;
+    sim->inTransaction = false;
+    sim->stats.spiTransactions++;
+  } else {
+    rxBuf[3] = SPI_DATA_AVAILABLE;
+  }
+}
+
+static void MCP2210Sim_PutSpiSettings(const MCP2210SPITransferSettings *spi, uint8_t *buf) {
+  buf[0] = (uint8_t)(spi->bitRate & 0xFF);
+  buf[1] = (uint8_t)((spi->bitRate & 0xFF00) >> 8);
+  buf[2] = (uint8_t)((spi->bitRate & 0xFF0000) >> 16);
+  buf[3] = (uint8_t)((spi->bitRate & 0xFF000000) >> 24);
+  buf[4] = (uint8_t)(spi->idleCSValue & 0xFF);
+  buf[5] = (uint8_t)((spi->idleCSValue & 0xFF00) >> 8);
+  buf[6] = (uint8_t)(spi->activeCSValue & 0xFF);
+  buf[7] = (uint8_t)((spi->activeCSValue & 0xFF00) >> 8);
+  buf[8] = (uint8_t)(spi->csToDataDelay & 0xFF);
+  buf[9] = (uint8_t)((spi->csToDataDelay & 0xFF00) >> 8);
+  buf[10] = (uint8_t)(spi->lastDataToCSDelay & 0xFF);
+  buf[11] = (uint8_t)((spi->lastDataToCSDelay & 0xFF00) >> 8);
+  buf[12] = (uint8_t)(spi->dataToDataDelay & 0xFF);
+  buf[13] = (uint8_t)((spi->dataToDataDelay & 0xFF00) >> 8);
+  buf[14] = (uint8_t)(spi->bytesPerTransaction & 0xFF);
+  buf[15] = (uint8_t)((spi->bytesPerTransaction & 0xFF00) >> 8);
+  buf[16] = spi->SPIMode;
+}
+
+static void MCP2210Sim_GetSpiSettings(const uint8_t *buf, MCP2210SPITransferSettings *spi) {
+  spi->bitRate = buf[0] | (buf[1] << 8) | (buf[2] << 16) | ((uint32_t)buf[3] << 24);
+  spi->idleCSValue = buf[4] | (buf[5] << 8);
+  spi->activeCSValue = buf[6] | (buf[7] << 8);
+  spi->csToDataDelay = buf[8] | (buf[9] << 8);
+  spi->lastDataToCSDelay = buf[10] | (buf[11] << 8);
+  spi->dataToDataDelay = buf[12] | (buf[13] << 8);
+  spi->bytesPerTransaction = buf[14] | (buf[15] << 8);
+  spi->SPIMode = buf[16];
+}
+
+static void MCP2210Sim_PutChipSettings(const MCP2210ChipSettings *chip, uint8_t *buf) {
+  buf[0] = chip->gp0Designation;
+  buf[1] = chip->gp1Designation;
+  buf[2] = chip->gp2Designation;
+  buf[3] = chip->gp3Designation;
+  buf[4] = chip->gp4Designation;
+  buf[5] = chip->gp5Designation;
+  buf[6] = chip->gp6Designation;
+  buf[7] = chip->gp7Designation;
+  buf[8] = chip->gp8Designation;
+  buf[9] = (uint8_t)(chip->defaultGPIOValue & 0xFF);
+  buf[10] = (uint8_t)((chip->defaultGPIOValue & 0xFF00) >> 8);
+  buf[11] = (uint8_t)(chip->defaultGPIODirection & 0xFF);
+  buf[12] = (uint8_t)((chip->defaultGPIODirection & 0xFF00) >> 8);
+  buf[13] = chip->chipSettings;
+  buf[14] = chip->chipAccessControl;
+}
+
+static void MCP2210Sim_GetChipSettings(const uint8_t *buf, MCP2210ChipSettings *chip) {
+  chip->gp0Designation = buf[0];
+  chip->gp1Designation = buf[1];
+  chip->gp2Designation = buf[2];
+  chip->gp3Designation = buf[3];
+  chip->gp4Designation = buf[4];
+  chip->gp5Designation = buf[5];
+  chip->gp6Designation = buf[6];
+  chip->gp7Designation = buf[7];
+  chip->gp8Designation = buf[8];
+  chip->defaultGPIOValue = buf[9] | (buf[10] << 8);
+  chip->defaultGPIODirection = buf[11] | (buf[12] << 8);
+  chip->chipSettings = buf[13];
+  chip->chipAccessControl = buf[14];
+}
+
+int MCP2210Sim_Transact(void *ctx, const uint8_t *txBuf, uint8_t *rxBuf) {
+  MCP2210Sim *sim = (MCP2210Sim *)ctx;
+
+  if (sim == NULL || txBuf == NULL || rxBuf == NULL) {
+    return -1;
+  }
+
+  if (sim->dropAtReport != 0 && sim->stats.reports >= sim->dropAtReport) {
+    // like a real unplug, whatever transfer was in flight is lost
+    sim->linkDown = true;
+    sim->dropAtReport = 0;
+    sim->inTransaction = false;
+  }
+
+  if (sim->linkDown) {
+    return -1;
+  }
+
+  memset(rxBuf, 0, MCP2210_REPORT_LEN);
+  rxBuf[0] = txBuf[0];
+  rxBuf[1] = 0x00;
+
+  sim->stats.reports++;
+
+  switch (txBuf[0]) {
+    case (GetCurrentSpiSettings):
+      sim->stats.settingsReports++;
+      rxBuf[2] = 17;
+      MCP2210Sim_PutSpiSettings(&sim->spi, &rxBuf[4]);
+      break;
+    case (SetCurrentSpiSettings):
+      sim->stats.settingsReports++;
+      MCP2210Sim_GetSpiSettings(&txBuf[4], &sim->spi);
+      break;
+    case (GetCurrentChipSettings):
+      sim->stats.settingsReports++;
+      MCP2210Sim_PutChipSettings(&sim->chip, &rxBuf[4]);
+      break;
+    case (SetCurrentChipSettings):
+      sim->stats.settingsReports++;
+      MCP2210Sim_GetChipSettings(&txBuf[4], &sim->chip);
+      break;
+    case (GetNVRAMSettings):
+      sim->stats.settingsReports++;
+      rxBuf[2] = txBuf[1];
+      memcpy(&rxBuf[4], sim->nvram[MCP2210Sim_NVRAMSlot(txBuf[1])], NVRAM_SLOT_SIZE);
+      break;
+    case (SetNVRAMSettings):
+      sim->stats.settingsReports++;
+      rxBuf[2] = txBuf[1];
+      memcpy(sim->nvram[MCP2210Sim_NVRAMSlot(txBuf[1])], &txBuf[4], NVRAM_SLOT_SIZE);
+      break;
+    case (GetCurrentGPIOPinVal):
+      rxBuf[4] = (uint8_t)(sim->gpioValues & 0xFF);
+      rxBuf[5] = (uint8_t)((sim->gpioValues & 0xFF00) >> 8);
+      break;
+    case (SetCurrentGPIOPinVal):
+      sim->gpioValues = txBuf[4] | (txBuf[5] << 8);
+      rxBuf[4] = txBuf[4];
+      rxBuf[5] = txBuf[5];
+      break;
+    case (GetCurrentGPIOPinDir):
+      rxBuf[4] = (uint8_t)(sim->gpioDirections & 0xFF);
+      rxBuf[5] = (uint8_t)((sim->gpioDirections & 0xFF00) >> 8);
+      break;
+    case (SetCurrentGPIOPinDir):
+      sim->gpioDirections = txBuf[4] | (txBuf[5] << 8);
+      break;
+    case (ReadEEPROM):
+      rxBuf[2] = txBuf[1];
+      rxBuf[3] = sim->eeprom[txBuf[1]];
+      break;
+    case (WriteEEPROM):
+      sim->eeprom[txBuf[1]] = txBuf[2];
+      break;
+    case (GetCurrentInterruptCount):
+      break;
+    case (SpiDataTransfer):
+      MCP2210Sim_SpiTransfer(sim, txBuf, rxBuf);
+      break;
+    case (CancelSpiDataTransfer):
+      sim->inTransaction = false;
+      break;
+    case (ReleaseSpiBus):
+    case (GetChipStatus):
+    case (SendPassword):
+      break;
+    default:
+      rxBuf[1] = SIM_UNSUPPORTED;
+      break;
+  }
+
+  sim->stats.elapsedNs += sim->latencyNs;
+
+  if (sim->realtime && sim->latencyNs > 0) {
+    struct timespec delay;
+    delay.tv_sec = sim->latencyNs / 1000000000ULL;
+    delay.tv_nsec = sim->latencyNs % 1000000000ULL;
+    nanosleep(&delay, NULL);
+  }
+  return MCP2210_REPORT_LEN;
+}
+
+MCP2210Sim * MCP2210Sim_Create(unsigned int reportLatencyUs) {
+  MCP2210Sim *sim = (MCP2210Sim *)malloc(sizeof(MCP2210Sim));
+
+  if (sim == NULL) {
+    fprintf(stderr, "Failed to allocate MCP2210Sim\n");
+    return NULL;
+  }
+
+  memset(sim, 0, sizeof(*sim));
+  sim->latencyNs = reportLatencyUs * 1000ULL;
+
+  // power-up defaults: every pin a GPIO input, 12 MHz, mode 0
+  sim->spi.bitRate = DEFAULT_BIT_RATE;
+  sim->spi.idleCSValue = 0x01FF;
+  sim->spi.bytesPerTransaction = 4;
+  sim->gpioDirections = 0x01FF;
+  sim->chip.defaultGPIODirection = 0x01FF;
+  memset(sim->eeprom, 0xFF, sizeof(sim->eeprom));
+
+  // the handle is just a unique pointer for MCP2210_SetTransport() to match
+  sim->handle = (hid_device *)sim;
+  return sim;
+}
+
+void MCP2210Sim_Destroy(MCP2210Sim *sim) {
+  free(sim);
+}
+
+hid_device * MCP2210Sim_Open(MCP2210Sim *sim) {
+  if (sim == NULL) {
+    fprintf(stderr, "sim can't be null\n");
+    return NULL;
+  }
+
+  sim->linkDown = false;
+  if (!MCP2210_SetTransport(sim->handle, MCP2210Sim_Transact, sim)) {
+    return NULL;
+  }
+  return sim->handle;
+}
+
+void MCP2210Sim_DropLinkAfter(MCP2210Sim *sim, unsigned long long reports) {
+  sim->dropAtReport = sim->stats.reports + reports;
+}
+
+void MCP2210Sim_SetRealtime(MCP2210Sim *sim, bool realtime) {
+  sim->realtime = realtime;
+}
+
+void MCP2210Sim_GetStats(const MCP2210Sim *sim, MCP2210SimStats *stats) {
+  *stats = sim->stats;
+}
+
+// the parts of the board that keep their contents while it stays powered
+#define STATE_FIELDS(sim) { \
+    {(sim)->sram, sizeof((sim)->sram)}, \
+    {(sim)->dac, sizeof((sim)->dac)}, \
+    {(sim)->eeprom, sizeof((sim)->eeprom)}, \
+    {(sim)->nvram, sizeof((sim)->nvram)}, \
+  }
+
+typedef struct state_field_st {
+  void *data;
+  size_t size;
+} StateField;
+
+bool MCP2210Sim_SaveState(const MCP2210Sim *sim, const char *fileName) {
+  FILE *file = fopen(fileName, "wb");
+
+  if (file == NULL) {
+    fprintf(stderr, "Failed to open %s\n", fileName);
+    return false;
+  }
+
+  StateField fields[] = STATE_FIELDS((MCP2210Sim *)sim);
+  bool ok = fwrite(STATE_MAGIC, 1, STATE_MAGIC_LEN, file) == STATE_MAGIC_LEN;
+  unsigned int i;
+  for (i = 0; ok && i < sizeof(fields) / sizeof(fields[0]); i++) {
+    ok = fwrite(fields[i].data, 1, fields[i].size, file) == fields[i].size;
+  }
+
+  if (fclose(file) != 0 || !ok) {
+    fprintf(stderr, "Failed to write %s\n", fileName);
+    return false;
+  }
+  return true;
+}
+
+bool MCP2210Sim_LoadState(MCP2210Sim *sim, const char *fileName) {
+  FILE *file = fopen(fileName, "rb");
+
+  if (file == NULL) {
+    fprintf(stderr, "Failed to open %s\n", fileName);
+    return false;
+  }
+
+  char magic[STATE_MAGIC_LEN];
+  bool ok = fread(magic, 1, STATE_MAGIC_LEN, file) == STATE_MAGIC_LEN &&
+            memcmp(magic, STATE_MAGIC, STATE_MAGIC_LEN) == 0;
+
+  // read into a copy so a short file leaves the board as it was
+  MCP2210Sim *loaded = ok ? (MCP2210Sim *)malloc(sizeof(MCP2210Sim)) : NULL;
+  ok = loaded != NULL;
+
+  if (ok) {
+    StateField fields[] = STATE_FIELDS(loaded);
+    unsigned int i;
+    for (i = 0; ok && i < sizeof(fields) / sizeof(fields[0]); i++) {
+      ok = fread(fields[i].data, 1, fields[i].size, file) == fields[i].size;
+    }
+  }
+
+  if (ok) {
+    memcpy(sim->sram, loaded->sram, sizeof(sim->sram));
+    memcpy(sim->dac, loaded->dac, sizeof(sim->dac));
+    memcpy(sim->eeprom, loaded->eeprom, sizeof(sim->eeprom));
+    memcpy(sim->nvram, loaded->nvram, sizeof(sim->nvram));
+  } else {
+    fprintf(stderr, "%s isn't a saved simulator state\n", fileName);
+  }
+
+  free(loaded);
+  fclose(file);
+  return ok;
+}
+
+unsigned int * MCP2210Sim_SRAM(MCP2210Sim *sim) {
+  return sim->sram;
+}
+
+unsigned char * MCP2210Sim_DACRegisters(MCP2210Sim *sim) {
+  return sim->dac;
+}
+
+unsigned char * MCP2210Sim_EEPROM(MCP2210Sim *sim) {
+  return sim->eeprom;
+}
@@ -31,33 +31,128 @@
 #include <stdio.h>    // for fprintf(), stderr
 #include <stdbool.h>  // for bool type and true/false macros
 #include <unistd.h>   // for usleep()
+#include <time.h>     // for clock_gettime()
+#include <stdlib.h>   // for mbstowcs()
+#include <wchar.h>    // for wchar_t
+#include <pthread.h>  // for pthread_mutex_t
 
 // HIDAPI
 #include "hidapi/hidapi.h"
 
 // MCP2210
 #include "dds-host/mcp2210.h"
+#include "dds-host/trace.h"
+#include "dds-host/realtime.h"
+
+// set by MCP2210_SetTransport(), e.g. to talk to simulated devices. Reports look their
+// handle up here, so the count is checked first to keep hidapi handles off the lock.
+typedef struct transport_route_st {
+  hid_device *handle;
+  MCP2210Transport transport;
+  void *ctx;
+} TransportRoute;
+
+static pthread_mutex_t routeLock = PTHREAD_MUTEX_INITIALIZER;
+static TransportRoute routes[MCP2210_MAX_TRANSPORTS];
+static unsigned int numRoutes = 0;
+
+bool MCP2210_SetTransport(hid_device *handle, MCP2210Transport newTransport, void *ctx) {
+  pthread_mutex_lock(&routeLock);
+
+  unsigned int i;
+  for (i = 0; i < numRoutes && routes[i].handle != handle; i++) {
+  }
+
+  bool ok = true;
+  if (newTransport == NULL) {
+    // move the last route into the hole
+    if (i < numRoutes) {
+      routes[i] = routes[numRoutes - 1];
+      __atomic_store_n(&numRoutes, numRoutes - 1, __ATOMIC_RELEASE);
+    }
+  } else if (i < numRoutes) {
+    routes[i].transport = newTransport;
+    routes[i].ctx = ctx;
+  } else if (numRoutes < MCP2210_MAX_TRANSPORTS) {
+    routes[i].handle = handle;
+    routes[i].transport = newTransport;
+    routes[i].ctx = ctx;
+    __atomic_store_n(&numRoutes, numRoutes + 1, __ATOMIC_RELEASE);
+  } else {
+    fprintf(stderr, "can't reroute more than %d handles\n", MCP2210_MAX_TRANSPORTS);
+    ok = false;
+  }
 
-static int MCP2210_GenericWriteRead(hid_device *handle, uint8_t *txBuf, uint8_t *rxBuf) {
-  if (handle == NULL) {
-    fprintf(stderr, "GenericWriteRead()-> handle can't be null\n");
-    return -1;
+  pthread_mutex_unlock(&routeLock);
+  return ok;
+}
+
+// finds the route for 'handle', returning false if it goes through hidapi
+static bool MCP2210_FindRoute(hid_device *handle, TransportRoute *route) {
+  if (__atomic_load_n(&numRoutes, __ATOMIC_ACQUIRE) == 0) {
+    return false;
   }
 
-  if (txBuf == NULL) {
-    fprintf(stderr, "GenericWriteRead()-> txBuf can't be null\n");
-    return -1;
+  pthread_mutex_lock(&routeLock);
+  bool found = false;
+  unsigned int i;
+  for (i = 0; i < numRoutes && !found; i++) {
+    if (routes[i].handle == handle) {
+      *route = routes[i];
+      found = true;
+    }
   }
+  pthread_mutex_unlock(&routeLock);
+  return found;
+}
 
-  if (rxBuf == NULL) {
-    fprintf(stderr, "GenericWriteRead()-> rxBuf can't be null\n");
-    return -1;
+// updated with relaxed atomics so progress reporting can read them from another thread
+static MCP2210Counters counters;
+
+void MCP2210_GetCounters(MCP2210Counters *out) {
+  out->reports = __atomic_load_n(&counters.reports, __ATOMIC_RELAXED);
+  out->busyRetries = __atomic_load_n(&counters.busyRetries, __ATOMIC_RELAXED);
+  out->linkErrors = __atomic_load_n(&counters.linkErrors, __ATOMIC_RELAXED);
+  out->chipSettingsWrites = __atomic_load_n(&counters.chipSettingsWrites, __ATOMIC_RELAXED);
+}
+
+// set by MCP2210_SetTrace()
+static TraceFile *trace = NULL;
+
+void MCP2210_SetTrace(TraceFile *newTrace) {
+  trace = newTrace;
+}
+
+// set by MCP2210_SetJitter()
+static Jitter *jitter = NULL;
+
+void MCP2210_SetJitter(Jitter *newJitter) {
+  jitter = newJitter;
+}
+
+static unsigned long long MCP2210_Now(void) {
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (unsigned long long)now.tv_sec * 1000000000ULL + (unsigned long long)now.tv_nsec;
+}
+
+// one report round trip, over hidapi or the installed transport
+static int MCP2210_Exchange(hid_device *handle, uint8_t *txBuf, uint8_t *rxBuf) {
+  TransportRoute route;
+  if (MCP2210_FindRoute(handle, &route)) {
+    if (route.transport(route.ctx, txBuf, rxBuf) < 0) {
+      fprintf(stderr, "GenericWriteRead()->transport failed\n");
+      __atomic_fetch_add(&counters.linkErrors, 1, __ATOMIC_RELAXED);
+      return -1;
+    }
+    return rxBuf[1];
   }
 
   int res = hid_write(handle, txBuf, MCP2210_REPORT_LEN);
 
   if (res < 0) {
     fprintf(stderr, "GenericWriteRead()->hid_write() failed\n");
+    __atomic_fetch_add(&counters.linkErrors, 1, __ATOMIC_RELAXED);
     return -1;
   }
 
@@ -65,6 +160,7 @@ static int MCP2210_GenericWriteRead(hid_device *handle, uint8_t *txBuf, uint8_t
 
   if (res < 0) {
     fprintf(stderr, "GenericWriteRead()->hid_read() failed\n");
+    __atomic_fetch_add(&counters.linkErrors, 1, __ATOMIC_RELAXED);
     return -1;
   }
 
@@ -72,72 +168,166 @@ static int MCP2210_GenericWriteRead(hid_device *handle, uint8_t *txBuf, uint8_t
   return rxBuf[1];
 }
 
+static int MCP2210_GenericWriteRead(hid_device *handle, uint8_t *txBuf, uint8_t *rxBuf) {
+  if (handle == NULL) {
+    fprintf(stderr, "GenericWriteRead()-> handle can't be null\n");
+    return -1;
+  }
+
+  if (txBuf == NULL) {
+    fprintf(stderr, "GenericWriteRead()-> txBuf can't be null\n");
+    return -1;
+  }
+
+  if (rxBuf == NULL) {
+    fprintf(stderr, "GenericWriteRead()-> rxBuf can't be null\n");
+    return -1;
+  }
+
+  __atomic_fetch_add(&counters.reports, 1, __ATOMIC_RELAXED);
+
+  if (trace == NULL) {
+    if (jitter == NULL) {
+      return MCP2210_Exchange(handle, txBuf, rxBuf);
+    }
+    unsigned long long startNs = MCP2210_Now();
+    int res = MCP2210_Exchange(handle, txBuf, rxBuf);
+    Jitter_Record(jitter, MCP2210_Now() - startNs);
+    return res;
+  }
+
+  TraceRecord record;
+  record.startNs = Trace_Now(trace);
+  record.result = MCP2210_Exchange(handle, txBuf, rxBuf);
+  record.durationNs = (uint32_t)(Trace_Now(trace) - record.startNs);
+  if (jitter != NULL) {
+    Jitter_Record(jitter, record.durationNs);
+  }
+  memcpy(record.tx, txBuf, MCP2210_REPORT_LEN);
+  memcpy(record.rx, rxBuf, MCP2210_REPORT_LEN);
+
+  if (!Trace_Write(trace, &record)) {
+    fprintf(stderr, "GenericWriteRead()->Trace_Write() failed, tracing stopped\n");
+    trace = NULL;
+  }
+  return record.result;
+}
+
+int MCP2210_Transact(hid_device *handle, const uint8_t *txBuf, uint8_t *rxBuf) {
+  // nothing below writes to the report being sent
+  return MCP2210_GenericWriteRead(handle, (uint8_t *)txBuf, rxBuf);
+}
+
 hid_device * MCP2210_Init() {
+  return MCP2210_Open(NULL);
+}
+
+// hidapi's init, open, close and exit share one library context: it's only torn down
+// once the last handle is closed, so closing one board never pulls it out from under another
+static pthread_mutex_t hidLock = PTHREAD_MUTEX_INITIALIZER;
+static unsigned int hidHandles = 0;
+
+static hid_device * MCP2210_OpenLocked(const char *serial) {
   // initialize the underlying HID interface
   int res = hid_init();
 
   if (res < 0) {
     fprintf(stderr, "Failed to initialize HIDAPI\n");
-    return false;
+    return NULL;
+  }
+
+  if (serial == NULL) {
+    // attempt to open the attached MCP2210
+    hid_device *handle = hid_open(VID, PID, NULL);
+
+    if (handle == NULL) {
+      fprintf(stderr, "Failed to open specified device %#x:%#x\n", VID, PID);
+      return NULL;
+    }
+    return handle;
+  }
+
+  // hidapi matches serial numbers as wide strings
+  wchar_t wideSerial[MCP2210_MAX_SERIAL_LEN + 1];
+  size_t len = mbstowcs(wideSerial, serial, MCP2210_MAX_SERIAL_LEN + 1);
+  if (len == (size_t) -1 || len > MCP2210_MAX_SERIAL_LEN) {
+    fprintf(stderr, "invalid serial number %s\n", serial);
+    return NULL;
   }
 
-  // attempt to open the attached MCP2210
-  hid_device *handle = hid_open(VID, PID, NULL);
+  hid_device *handle = hid_open(VID, PID, wideSerial);
 
   if (handle == NULL) {
-    fprintf(stderr, "Failed to open specified device %#x:%#x\n", VID, PID);
+    fprintf(stderr, "Failed to open device %#x:%#x with serial number %s\n", VID, PID, serial);
     return NULL;
   }
   return handle;
 }
 
-int MCP2210_WriteSpiSettings(hid_device *handle, const MCP2210SPITransferSettings *newSettings, bool vm) {
-  if (handle == NULL) {
-    fprintf(stderr, "handle must not be null\n");
-    return -1;
-  }
+hid_device * MCP2210_Open(const char *serial) {
+  pthread_mutex_lock(&hidLock);
+  hid_device *handle = MCP2210_OpenLocked(serial);
 
-  uint8_t txBuf[MCP2210_REPORT_LEN];
-  uint8_t rxBuf[MCP2210_REPORT_LEN];
+  if (handle != NULL) {
+    hidHandles++;
+  } else if (hidHandles == 0) {
+    hid_exit();
+  }
+  pthread_mutex_unlock(&hidLock);
+  return handle;
+}
 
-  memset(txBuf, 0, MCP2210_REPORT_LEN);
-  memset(rxBuf, 0, MCP2210_REPORT_LEN);
+void MCP2210_EncodeSpiSettings(uint8_t *report, const MCP2210SPITransferSettings *newSettings, bool vm) {
+  memset(report, 0, MCP2210_REPORT_LEN);
 
   // determine if we're configuring power-up settings or current settings
   if (vm) {
-    txBuf[0] = SetCurrentSpiSettings;
-    txBuf[1] = 0x00;
+    report[0] = SetCurrentSpiSettings;
+    report[1] = 0x00;
   } else {
-    txBuf[0] = SetNVRAMSettings;
-    txBuf[1] = SpiSettings;
+    report[0] = SetNVRAMSettings;
+    report[1] = SpiSettings;
   }
 
-  txBuf[2] = txBuf[3] = 0x00;
+  report[2] = report[3] = 0x00;
+
+  report[4] = (uint8_t) (newSettings->bitRate & 0xFF);
+  report[5] = (uint8_t) ((newSettings->bitRate & 0xFF00) >> 8);
+  report[6] = (uint8_t) ((newSettings->bitRate & 0xFF0000) >> 16);
+  report[7] = (uint8_t) ((newSettings->bitRate & 0xFF000000) >> 24);
+
+  report[8] = (uint8_t) (newSettings->idleCSValue & 0xFF);
+  report[9] = (uint8_t) ((newSettings->idleCSValue & 0xFF00) >> 8);
 
-  txBuf[4] = (uint8_t) (newSettings->bitRate & 0xFF);
-  txBuf[5] = (uint8_t) ((newSettings->bitRate & 0xFF00) >> 8);
-  txBuf[6] = (uint8_t) ((newSettings->bitRate & 0xFF0000) >> 16);
-  txBuf[7] = (uint8_t) ((newSettings->bitRate & 0xFF000000) >> 24);
+  report[10] = (uint8_t) (newSettings->activeCSValue & 0xFF);
+  report[11] = (uint8_t) ((newSettings->activeCSValue & 0xFF00) >> 8);
 
-  txBuf[8] = (uint8_t) (newSettings->idleCSValue & 0xFF);
-  txBuf[9] = (uint8_t) ((newSettings->idleCSValue & 0xFF00) >> 8);
+  report[12] = (uint8_t) (newSettings->csToDataDelay & 0xFF);
+  report[13] = (uint8_t) ((newSettings->csToDataDelay & 0xFF00) >> 8);
 
-  txBuf[10] = (uint8_t) (newSettings->activeCSValue & 0xFF);
-  txBuf[11] = (uint8_t) ((newSettings->activeCSValue & 0xFF00) >> 8);
+  report[14] = (uint8_t) (newSettings->lastDataToCSDelay & 0xFF);
+  report[15] = (uint8_t) ((newSettings->lastDataToCSDelay & 0xFF00) >> 8);
 
-  txBuf[12] = (uint8_t) (newSettings->csToDataDelay & 0xFF);
-  txBuf[13] = (uint8_t) ((newSettings->csToDataDelay & 0xFF00) >> 8);
+  report[16] = (uint8_t) (newSettings->dataToDataDelay & 0xFF);
+  report[17] = (uint8_t) ((newSettings->dataToDataDelay & 0xFF00) >> 8);
 
-  txBuf[14] = (uint8_t) (newSettings->lastDataToCSDelay & 0xFF);
-  txBuf[15] = (uint8_t) ((newSettings->lastDataToCSDelay & 0xFF00) >> 8);
+  report[18] = (uint8_t) (newSettings->bytesPerTransaction & 0xFF);
+  report[19] = (uint8_t) ((newSettings->bytesPerTransaction & 0xFF00) >> 8);
 
-  txBuf[16] = (uint8_t) (newSettings->dataToDataDelay & 0xFF);
-  txBuf[17] = (uint8_t) ((newSettings->dataToDataDelay & 0xFF00) >> 8);
+  report[20] = newSettings->SPIMode;
+}
+
+int MCP2210_WriteSpiSettings(hid_device *handle, const MCP2210SPITransferSettings *newSettings, bool vm) {
+  if (handle == NULL) {
+    fprintf(stderr, "handle must not be null\n");
+    return -1;
+  }
 
-  txBuf[18] = (uint8_t) (newSettings->bytesPerTransaction & 0xFF);
-  txBuf[19] = (uint8_t) ((newSettings->bytesPerTransaction & 0xFF00) >> 8);
+  uint8_t txBuf[MCP2210_REPORT_LEN];
+  uint8_t rxBuf[MCP2210_REPORT_LEN];
 
-  txBuf[20] = newSettings->SPIMode;
+  memset(rxBuf, 0, MCP2210_REPORT_LEN);
+  MCP2210_EncodeSpiSettings(txBuf, newSettings, vm);
 
   return MCP2210_GenericWriteRead(handle, txBuf, rxBuf);
 }
@@ -224,6 +414,9 @@ int MCP2210_WriteChipSettings(hid_device *handle, const MCP2210ChipSettings *new
 
   txBuf[18] = newSettings->chipAccessControl;
 
+  if (vm) {
+    __atomic_fetch_add(&counters.chipSettingsWrites, 1, __ATOMIC_RELAXED);
+  }
   return MCP2210_GenericWriteRead(handle, txBuf, rxBuf);
 }
 
@@ -445,7 +638,7 @@ int MCP2210_WriteGPIOValues(hid_device *handle, uint16_t newGPIOValues) {
   memset(txBuf, 0, MCP2210_REPORT_LEN);
   memset(rxBuf, 0, MCP2210_REPORT_LEN);
 
-  txBuf[0] = GetCurrentGPIOPinVal;
+  txBuf[0] = SetCurrentGPIOPinVal;
 
   txBuf[4] = (uint8_t) (newGPIOValues & 0xFF);
   txBuf[5] = (uint8_t) ((newGPIOValues & 0xFF00) >> 8);
@@ -517,7 +710,7 @@ int MCP2210_ReadGPIODirections(hid_device *handle, uint16_t *currentGPIODirectio
   memset(txBuf, 0, MCP2210_REPORT_LEN);
   memset(rxBuf, 0, MCP2210_REPORT_LEN);
 
-  txBuf[0] = GetCurrentGPIOPinVal;
+  txBuf[0] = GetCurrentGPIOPinDir;
 
   int res = MCP2210_GenericWriteRead(handle, txBuf, rxBuf);
 
@@ -669,34 +862,40 @@ int MCP2210_SpiDataTransfer(hid_device *handle,
   memset(rxBuf, 0, MCP2210_REPORT_LEN);
 
   // start writing
-  // each loop is a new attempt to transfer a packet
+  // each loop is a new attempt to transfer a packet. once everything has been
+  // sent we keep sending empty packets to poll for the rest of the received data
   txBuf[0] = SpiDataTransfer;
+  uint8_t engineStatus = 0x00;
   int count = 0;
   do { 
-    if (bytesLeft >= 60) {
-      txBuf[1] = 60;
-      memcpy(&txBuf[4], (txData + txBytes - bytesLeft), 60);
-    } else {
-      txBuf[1] = bytesLeft;
-      memcpy(&txBuf[4], (txData + txBytes - bytesLeft), bytesLeft);
-    }
+    unsigned int chunk = (bytesLeft >= 60) ? 60 : bytesLeft;
+    txBuf[1] = chunk;
+    memcpy(&txBuf[4], (txData + txBytes - bytesLeft), chunk);
 
     int res = MCP2210_GenericWriteRead(handle, txBuf, rxBuf);
 
-    if (res == 0x00 && rxBuf[3] == 0x10) {
-      bytesLeft -= txBuf[1];
-    } else if (res == 0xF7) {
-      return -1;
+    if (res == 0x00) {
+      // the chip accepted the packet
+      bytesLeft -= chunk;
+      engineStatus = rxBuf[3];
+
+      if ((engineStatus == 0x30 || engineStatus == 0x10) && rxBuf[2] > 0) {
+        if (rxBytes + rxBuf[2] > txBytes || rxBuf[2] > 60) {
+          fprintf(stderr, "SPI transfer returned more data than was sent\n");
+          return -1;
+        }
+        memcpy(&rxData[rxBytes], &rxBuf[4], rxBuf[2]);
+        rxBytes += rxBuf[2];
+      }
     } else if (res == 0xF8) {
+      // the chip is still busy with the last packet, so we just send this one again
+      __atomic_fetch_add(&counters.busyRetries, 1, __ATOMIC_RELAXED);
+    } else {
+      // anything else (e.g. 0xF7, bus not available) is fatal
       return -1;
     }
-    
-    if (rxBuf[3] == 0x30 || rxBuf[3] == 0x10) {
-      memcpy(&rxData[rxBytes], &rxBuf[4], rxBuf[2]);
-      rxBytes += rxBuf[2];
-    }
     count++;
-  } while (count < 1000 && (rxBuf[3] == 0x30 || rxBuf[3] == 0x20));
+  } while (count < 1000 && engineStatus != 0x10);
 
   if (count == 1000) {
     fprintf(stderr, "SPI transfer timed out\n");
@@ -762,6 +961,17 @@ void MCP2210_Close(hid_device *handle) {
     return;
   }
 
+  // a rerouted handle was never opened through hidapi
+  TransportRoute route;
+  if (MCP2210_FindRoute(handle, &route)) {
+    MCP2210_SetTransport(handle, NULL, NULL);
+    return;
+  }
+
+  pthread_mutex_lock(&hidLock);
   hid_close(handle);
-  hid_exit();
+  if (--hidHandles == 0) {
+    hid_exit();
+  }
+  pthread_mutex_unlock(&hidLock);
 }
\ No newline at end of file
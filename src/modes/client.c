@@ -0,0 +1,342 @@
+/*
+ * MIT License
+ * 
+ * Copyright (c) 2020 Eli Reed
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+// C
+#include <stdio.h>  // for printf()
+#include <stdbool.h>  // for bool type
+#include <stdlib.h> // for strtoul()
+#include <string.h> // for strlen()
+#include <unistd.h> // for close()
+
+// project libraries
+#include "dds-host/dds-host.h"
+#include "dds-host/cpld.h"
+#include "dds-host/image.h"
+#include "dds-host/ipc.h"
+
+static const struct option longOpts[] = {
+  {"socket", required_argument, NULL, 's'},
+  {"dac-write", required_argument, NULL, 'w'},
+  {"dac-read", required_argument, NULL, 'r'},
+  {"sram-read", required_argument, NULL, 'R'},
+  {"stats", no_argument, NULL, 'S'},
+  {NULL, 0, NULL, 0},
+};
+
+static const char * const usage[] = {
+  "       ./bin/dds-host --socket <path> [--data <filename>] [--dac-write <reg>:<byte>[,<byte>...]]",
+  "                      [--dac-read <reg>[:<count>]] [--sram-read <addr>[:<count>]] [--stats]",
+  NULL,
+};
+
+static bool ClientMode_ParseOption(int opt, const char *arg, Options *opts) {
+  ClientOptions *client = &opts->client;
+
+  switch (opt) {
+    case ('s'):
+      client->socketPath = arg;
+      break;
+    case ('w'):
+      client->dacWrite = arg;
+      break;
+    case ('r'):
+      client->dacRead = arg;
+      break;
+    case ('R'):
+      client->sramRead = arg;
+      break;
+    case ('S'):
+      client->stats = true;
+      break;
+    default:
+      return false;
+  }
+  return true;
+}
+
+static bool ClientMode_Check(const Options *opts) {
+  const ClientOptions *client = &opts->client;
+  bool hasJobs = client->dacWrite != NULL || client->dacRead != NULL || client->sramRead != NULL || client->stats;
+
+  if (client->socketPath == NULL) {
+    if (hasJobs) {
+      fprintf(stderr, "register, readback and stats jobs need --socket\n");
+      return false;
+    }
+    return true;
+  }
+
+  if (opts->dryRun.dryRun || opts->calibrateReports > 0 || opts->upload.progressMs > 0 ||
+      opts->traceFileName != NULL || opts->upload.journalFileName != NULL || opts->realtime) {
+    fprintf(stderr, "--dry-run, --calibrate, --progress, --trace, --journal and --realtime-io "
+            "don't work with --socket\n");
+    return false;
+  }
+
+  if (!UploadMode_HasData(opts) && opts->shm.shmName == NULL && !hasJobs) {
+    fprintf(stderr, "nothing to submit to the daemon\n");
+    return false;
+  }
+  return true;
+}
+
+const DDSHostMode ClientMode = {
+  longOpts,
+  usage,
+  NULL,
+  ClientMode_ParseOption,
+  ClientMode_Check,
+};
+
+// parses "<start>[:<count>]" (base-16 start, base-10 count)
+static bool ParseRange(const char *arg, unsigned int *start, unsigned int *count) {
+  char *end;
+  *start = (unsigned int)strtoul(arg, &end, 16);
+  *count = 1;
+
+  if (end == arg) {
+    return false;
+  }
+
+  if (*end == ':') {
+    const char *countStr = end + 1;
+    *count = (unsigned int)strtoul(countStr, &end, 10);
+    if (end == countStr) {
+      return false;
+    }
+  }
+  return *end == '\0' && *count > 0;
+}
+
+static bool ClientUpload(int fd, const Options *opts) {
+  SRAMImage *image = UploadMode_LoadData(opts);
+
+  if (image == NULL) {
+    return false;
+  }
+
+  uint8_t *payload = (uint8_t *)malloc(image->numWords * SRAM_DATA_SIZE + 1);
+  if (payload == NULL) {
+    fprintf(stderr, "Failed to allocate upload payload\n");
+    Image_Free(image);
+    return false;
+  }
+  IPC_PackWords(payload, image->words, image->numWords);
+
+  IPCHeader req = {0};
+  req.op = IPCUpload;
+  req.arg0 = opts->upload.sramOffset;
+  req.payloadLen = image->numWords * SRAM_DATA_SIZE;
+
+  IPCHeader reply;
+  uint8_t *replyPayload = NULL;
+  bool ok = IPC_Transact(fd, &req, payload, &reply, &replyPayload);
+
+  free(payload);
+  free(replyPayload);
+  Image_Free(image);
+
+  if (ok && reply.status != IPC_OK) {
+    fprintf(stderr, "upload failed: status %#x, %u words failed\n", reply.status, reply.arg0);
+    ok = false;
+  }
+  return ok;
+}
+
+// has the daemon upload from the --shm ring itself
+static bool ClientUploadShm(int fd, const Options *opts) {
+  IPCHeader req = {0};
+  req.op = IPCUploadShm;
+  req.arg0 = opts->upload.sramOffset;
+  req.payloadLen = (uint32_t)strlen(opts->shm.shmName);
+
+  IPCHeader reply;
+  uint8_t *replyPayload = NULL;
+  bool ok = IPC_Transact(fd, &req, opts->shm.shmName, &reply, &replyPayload);
+  free(replyPayload);
+
+  if (ok && reply.status != IPC_OK) {
+    fprintf(stderr, "shm upload failed: status %#x, %u words failed\n", reply.status, reply.arg0);
+    ok = false;
+  } else if (ok) {
+    printf("shm: %u words uploaded\n", reply.arg1);
+  }
+  return ok;
+}
+
+static bool ClientWriteDAC(int fd, const char *arg) {
+  // "<reg>:<byte>[,<byte>...]", all base-16
+  char *end;
+  unsigned long reg = strtoul(arg, &end, 16);
+
+  if (end == arg || *end != ':') {
+    fprintf(stderr, "bad --dac-write argument: %s\n", arg);
+    return false;
+  }
+
+  uint8_t bytes[4];
+  unsigned int numBytes = 0;
+  const char *cur = end + 1;
+  while (*cur != '\0') {
+    if (numBytes == sizeof(bytes)) {
+      fprintf(stderr, "can't write more than 4 registers at once\n");
+      return false;
+    }
+    unsigned long value = strtoul(cur, &end, 16);
+    if (end == cur || value > 0xFF || (*end != ',' && *end != '\0')) {
+      fprintf(stderr, "bad --dac-write argument: %s\n", arg);
+      return false;
+    }
+    bytes[numBytes++] = (uint8_t)value;
+    cur = (*end == ',') ? end + 1 : end;
+  }
+
+  if (numBytes == 0) {
+    fprintf(stderr, "bad --dac-write argument: %s\n", arg);
+    return false;
+  }
+
+  IPCHeader req = {0};
+  req.op = IPCWriteDAC;
+  req.arg0 = (uint32_t)reg;
+  req.payloadLen = numBytes;
+
+  IPCHeader reply;
+  uint8_t *replyPayload = NULL;
+  if (!IPC_Transact(fd, &req, bytes, &reply, &replyPayload)) {
+    return false;
+  }
+  free(replyPayload);
+
+  if (reply.status != IPC_OK) {
+    fprintf(stderr, "DAC write failed: status %#x\n", reply.status);
+    return false;
+  }
+  return true;
+}
+
+static bool ClientRead(int fd, IPCOp op, const char *arg) {
+  unsigned int start, count;
+  if (!ParseRange(arg, &start, &count)) {
+    fprintf(stderr, "bad read argument: %s\n", arg);
+    return false;
+  }
+
+  IPCHeader req = {0};
+  req.op = op;
+  req.arg0 = start;
+  req.arg1 = count;
+
+  IPCHeader reply;
+  uint8_t *replyPayload = NULL;
+  if (!IPC_Transact(fd, &req, NULL, &reply, &replyPayload)) {
+    return false;
+  }
+
+  if (reply.status != IPC_OK) {
+    fprintf(stderr, "read failed: status %#x\n", reply.status);
+    free(replyPayload);
+    return false;
+  }
+
+  // print in the same address,data CSV layout the config files use
+  unsigned int i;
+  if (op == IPCReadDAC) {
+    for (i = 0; i < reply.payloadLen; i++) {
+      printf("%02x,%02x\n", start + i, replyPayload[i]);
+    }
+  } else {
+    for (i = 0; i < reply.payloadLen / SRAM_DATA_SIZE; i++) {
+      unsigned int word;
+      IPC_UnpackWords(&word, &replyPayload[i * SRAM_DATA_SIZE], 1);
+      printf("%05x,%08x\n", start + i, word);
+    }
+  }
+  free(replyPayload);
+  return true;
+}
+
+static bool ClientStats(int fd) {
+  IPCHeader req = {0};
+  req.op = IPCStats;
+
+  IPCHeader reply;
+  uint8_t *replyPayload = NULL;
+  if (!IPC_Transact(fd, &req, NULL, &reply, &replyPayload)) {
+    return false;
+  }
+
+  if (reply.status != IPC_OK || reply.payloadLen != 8 * SRAM_DATA_SIZE) {
+    fprintf(stderr, "stats failed: status %#x\n", reply.status);
+    free(replyPayload);
+    return false;
+  }
+
+  unsigned int words[8];
+  IPC_UnpackWords(words, replyPayload, 8);
+  free(replyPayload);
+
+  printf("control: jobs %u mean wait %u us max wait %u us\n", words[0], words[1], words[2]);
+  printf("bulk:    jobs %u mean wait %u us max wait %u us preemptions %u\n",
+         words[4], words[5], words[6], words[7]);
+  return true;
+}
+
+int ClientMode_Run(const Options *opts) {
+  const ClientOptions *client = &opts->client;
+  int fd = IPC_Connect(client->socketPath);
+
+  if (fd < 0) {
+    return EXIT_FAILURE;
+  }
+
+  bool ok = true;
+
+  if (ok && client->dacWrite != NULL) {
+    ok = ClientWriteDAC(fd, client->dacWrite);
+  }
+
+  if (ok && UploadMode_HasData(opts)) {
+    ok = ClientUpload(fd, opts);
+  }
+
+  if (ok && opts->shm.shmName != NULL) {
+    ok = ClientUploadShm(fd, opts);
+  }
+
+  if (ok && client->dacRead != NULL) {
+    ok = ClientRead(fd, IPCReadDAC, client->dacRead);
+  }
+
+  if (ok && client->sramRead != NULL) {
+    ok = ClientRead(fd, IPCReadSRAM, client->sramRead);
+  }
+
+  if (ok && client->stats) {
+    ok = ClientStats(fd);
+  }
+
+  close(fd);
+  return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
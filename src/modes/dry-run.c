@@ -0,0 +1,210 @@
+/*
+ * MIT License
+ * 
+ * Copyright (c) 2020 Eli Reed
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+// C
+#include <stdio.h>  // for printf()
+#include <stdbool.h>  // for bool type
+#include <stdlib.h> // for strtoul()
+#include <unistd.h> // for access()
+
+// HIDAPI
+#include "hidapi/hidapi.h"
+
+// project libraries
+#include "dds-host/dds-host.h"
+#include "dds-host/host.h"
+#include "dds-host/image.h"
+#include "dds-host/script.h"
+#include "dds-host/mcp2210.h"
+#include "dds-host/mcp2210-sim.h"
+
+static const struct option longOpts[] = {
+  {"dry-run", no_argument, NULL, 'n'},
+  {"report-latency", required_argument, NULL, 'L'},
+  {"simulate-drop", required_argument, NULL, 'D'},
+  {"simulate-unplug", required_argument, NULL, 'U'},
+  {"sim-state", required_argument, NULL, 'V'},
+  {NULL, 0, NULL, 0},
+};
+
+static const char * const usage[] = {
+  "       ./bin/dds-host --dry-run [--report-latency <us>] [--simulate-drop | --simulate-unplug <reports>]",
+  "                      [--sim-state <filename>]",
+  "                      <any of the above without --socket>",
+  NULL,
+};
+
+static void DryRunMode_Defaults(Options *opts) {
+  opts->dryRun.reportLatencyUs = MCP2210SIM_DEFAULT_LATENCY_US;
+}
+
+static bool DryRunMode_ParseOption(int opt, const char *arg, Options *opts) {
+  DryRunOptions *dryRun = &opts->dryRun;
+  char *end;
+
+  switch (opt) {
+    case ('n'):
+      dryRun->dryRun = true;
+      break;
+    case ('L'):
+      dryRun->reportLatencyUs = (unsigned int)strtoul(arg, &end, 10);
+      if (*end != '\0') {
+        fprintf(stderr, "bad --report-latency: %s\n", arg);
+        return false;
+      }
+      break;
+    case ('D'):
+    case ('U'):
+      if (dryRun->simulateDrop != 0) {
+        fprintf(stderr, "--simulate-drop and --simulate-unplug can't be used together\n");
+        return false;
+      }
+      dryRun->simulateDrop = strtoull(arg, &end, 10);
+      dryRun->simulateUnplug = opt == 'U';
+      if (*end != '\0' || dryRun->simulateDrop == 0) {
+        fprintf(stderr, "bad --simulate-%s: %s\n", dryRun->simulateUnplug ? "unplug" : "drop", arg);
+        return false;
+      }
+      break;
+    case ('V'):
+      dryRun->simStateFileName = arg;
+      break;
+    default:
+      return false;
+  }
+  return true;
+}
+
+static bool DryRunMode_Check(const Options *opts) {
+  const DryRunOptions *dryRun = &opts->dryRun;
+
+  if ((dryRun->simulateDrop != 0 || dryRun->simStateFileName != NULL) && !dryRun->dryRun) {
+    fprintf(stderr, "--simulate-drop, --simulate-unplug and --sim-state need --dry-run\n");
+    return false;
+  }
+  return true;
+}
+
+const DDSHostMode DryRunMode = {
+  longOpts,
+  usage,
+  DryRunMode_Defaults,
+  DryRunMode_ParseOption,
+  DryRunMode_Check,
+};
+
+static void PrintDryRunPhase(const char *phase, const MCP2210SimStats *before,
+                             const MCP2210SimStats *after) {
+  unsigned long long ns = after->elapsedNs - before->elapsedNs;
+  printf("%-13s %8llu reports (%llu settings, %llu SPI, %llu busy polls), "
+         "%llu SPI bytes, %llu.%03llu s\n",
+         phase, after->reports - before->reports,
+         after->settingsReports - before->settingsReports,
+         after->spiReports - before->spiReports,
+         after->busyPolls - before->busyPolls,
+         after->spiBytes - before->spiBytes,
+         ns / 1000000000ULL, (ns / 1000000ULL) % 1000);
+}
+
+int DryRunMode_Run(const Options *opts) {
+  const DryRunOptions *dryRun = &opts->dryRun;
+  MCP2210Sim *sim = MCP2210Sim_Create(dryRun->reportLatencyUs);
+
+  if (sim == NULL) {
+    return EXIT_FAILURE;
+  }
+
+  // a board that isn't there yet starts out blank
+  if (dryRun->simStateFileName != NULL && access(dryRun->simStateFileName, F_OK) == 0 &&
+      !MCP2210Sim_LoadState(sim, dryRun->simStateFileName)) {
+    MCP2210Sim_Destroy(sim);
+    return EXIT_FAILURE;
+  }
+
+  hid_device *handle = MCP2210Sim_Open(sim);
+  bool ok = true;
+
+  if (dryRun->simulateDrop != 0) {
+    MCP2210Sim_DropLinkAfter(sim, dryRun->simulateDrop);
+  }
+
+  MCP2210SimStats start, configured, done;
+  MCP2210Sim_GetStats(sim, &start);
+
+  if (opts->dacFileName != NULL) {
+    ok = Host_ConfigureDevices(handle, opts->dacFileName, opts->mcpFileName, opts->cold);
+  }
+  MCP2210Sim_GetStats(sim, &configured);
+
+  if (ok && opts->script.scriptFileName != NULL) {
+    ok = Script_Run(handle, opts->script.scriptFileName);
+  } else if (ok && opts->replay.replayFileName != NULL) {
+    unsigned int failed = ReplayMode_Upload(handle, opts);
+    printf("replay: %u words failed\n", failed);
+    ok = failed == 0;
+  } else if (ok && opts->shm.shmName != NULL) {
+    unsigned int failed = ShmMode_Upload(handle, opts);
+    printf("upload: %u words failed\n", failed);
+    ok = failed == 0;
+  } else if (ok && opts->pipeline.pipeline) {
+    unsigned int failed = PipelineMode_Upload(handle, opts);
+    printf("upload: %u words failed\n", failed);
+    ok = failed == 0;
+  } else if (ok && UploadMode_HasData(opts)) {
+    SRAMImage *image = UploadMode_LoadData(opts);
+    ok = image != NULL;
+    if (ok) {
+      unsigned int failed = UploadMode_Upload(&handle, image, opts, sim);
+      printf("upload: %u words, %u failed\n", image->numWords, failed);
+      ok = failed == 0;
+      Image_Free(image);
+    }
+  }
+
+  if (ok && NCOMode_Requested(opts)) {
+    ok = handle != NULL && NCOMode_Run(handle, opts);
+  }
+
+  if (ok && SnapshotMode_Requested(opts)) {
+    ok = handle != NULL && SnapshotMode_Run(handle, opts);
+  }
+  MCP2210Sim_GetStats(sim, &done);
+
+  printf("dry run at %u us per report:\n", dryRun->reportLatencyUs);
+  PrintDryRunPhase("configuration", &start, &configured);
+  PrintDryRunPhase(opts->script.scriptFileName != NULL ? "script" : UploadMode_HasUpload(opts) ? "upload" :
+                   NCOMode_Requested(opts) ? "nco" : "registers", &configured, &done);
+  PrintDryRunPhase("total", &start, &done);
+
+  if (handle != NULL) {
+    MCP2210_Close(handle);
+  }
+
+  // even a failed run leaves the board as it was, for the next run to resume on
+  if (dryRun->simStateFileName != NULL && !MCP2210Sim_SaveState(sim, dryRun->simStateFileName)) {
+    ok = false;
+  }
+  MCP2210Sim_Destroy(sim);
+  return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,274 @@
+/*
+ * MIT License
+ * 
+ * Copyright (c) 2020 Eli Reed
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+// C
+#include <stdio.h>  // for printf()
+#include <stdbool.h>  // for bool type
+#include <stdlib.h> // for strtod()
+#include <time.h>   // for clock_gettime()
+#include <math.h>   // for M_PI
+
+// HIDAPI
+#include "hidapi/hidapi.h"
+
+// project libraries
+#include "dds-host/dds-host.h"
+#include "dds-host/mcp2210.h"
+#include "dds-host/dac5687.h"
+#include "dds-host/hop.h"
+#include "dds-host/realtime.h"
+
+static const struct option longOpts[] = {
+  {"nco", required_argument, NULL, 'q'},
+  {"ref-clock", required_argument, NULL, 'K'},
+  {"nco-sync", required_argument, NULL, 'Y'},
+  {"hop", required_argument, NULL, 'h'},
+  {"sweep", required_argument, NULL, 'W'},
+  {"hop-log", required_argument, NULL, 'l'},
+  {NULL, 0, NULL, 0},
+};
+
+static const char * const usage[] = {
+  "       ./bin/dds-host ... --nco <Hz>[@<degrees>][,...] --ref-clock <Hz> [--nco-sync <byte>]",
+  "       ./bin/dds-host ... --hop <filename> | --sweep <Hz>:<Hz>:<steps>:<dwell us>",
+  "                      --ref-clock <Hz> [--nco-sync <byte>] [--hop-log <filename>]",
+  "                      NCO options go with or instead of --data",
+  NULL,
+};
+
+// parses "<Hz>[@<degrees>][,...]" into the retune list
+static bool ParseRetunes(const char *arg, NCOOptions *nco) {
+  const char *cur = arg;
+  char *end;
+
+  nco->numRetunes = 0;
+  while (*cur != '\0') {
+    if (nco->numRetunes == MAX_RETUNES) {
+      return false;
+    }
+    double freq = strtod(cur, &end);
+    double phase = 0;
+    if (end == cur) {
+      return false;
+    }
+    if (*end == '@') {
+      cur = end + 1;
+      phase = strtod(cur, &end) * M_PI / 180.0;
+      if (end == cur) {
+        return false;
+      }
+    }
+    if (*end != ',' && *end != '\0') {
+      return false;
+    }
+    nco->retuneFreqs[nco->numRetunes] = freq;
+    nco->retunePhases[nco->numRetunes] = phase;
+    nco->numRetunes++;
+    cur = (*end == ',') ? end + 1 : end;
+  }
+  return nco->numRetunes > 0;
+}
+
+static bool NCOMode_ParseOption(int opt, const char *arg, Options *opts) {
+  NCOOptions *nco = &opts->nco;
+  char *end;
+
+  switch (opt) {
+    case ('q'):
+      if (!ParseRetunes(arg, nco)) {
+        fprintf(stderr, "bad --nco: %s\n", arg);
+        return false;
+      }
+      break;
+    case ('K'):
+      nco->refClockHz = strtod(arg, &end);
+      if (*end != '\0' || !(nco->refClockHz > 0)) {
+        fprintf(stderr, "bad --ref-clock: %s\n", arg);
+        return false;
+      }
+      break;
+    case ('Y'): {
+      unsigned long value = strtoul(arg, &end, 16);
+      if (end == arg || *end != '\0' || value > 0xFF) {
+        fprintf(stderr, "bad --nco-sync: %s\n", arg);
+        return false;
+      }
+      nco->ncoLatch = true;
+      nco->ncoSyncCntl = (unsigned char)value;
+      break;
+    }
+    case ('h'):
+      nco->hopFileName = arg;
+      break;
+    case ('W'):
+      nco->sweepSpec = arg;
+      break;
+    case ('l'):
+      nco->hopLogFileName = arg;
+      break;
+    default:
+      return false;
+  }
+  return true;
+}
+
+static bool NCOMode_Check(const Options *opts) {
+  const NCOOptions *nco = &opts->nco;
+
+  if ((nco->refClockHz > 0 || nco->ncoLatch) && !NCOMode_Requested(opts)) {
+    fprintf(stderr, "--ref-clock and --nco-sync need --nco, --hop or --sweep\n");
+    return false;
+  }
+
+  if (nco->hopFileName != NULL && nco->sweepSpec != NULL) {
+    fprintf(stderr, "--hop and --sweep can't be used together\n");
+    return false;
+  }
+
+  if (nco->hopLogFileName != NULL && nco->hopFileName == NULL && nco->sweepSpec == NULL) {
+    fprintf(stderr, "--hop-log needs --hop or --sweep\n");
+    return false;
+  }
+
+  if (NCOMode_Requested(opts) && !(nco->refClockHz > 0)) {
+    fprintf(stderr, "--nco, --hop and --sweep need --ref-clock\n");
+    return false;
+  }
+
+  if (NCOMode_Requested(opts) && (opts->client.socketPath != NULL || opts->script.scriptFileName != NULL)) {
+    fprintf(stderr, "--nco, --hop and --sweep don't work with --socket or --script\n");
+    return false;
+  }
+  return true;
+}
+
+const DDSHostMode NCOMode = {
+  longOpts,
+  usage,
+  NULL,
+  NCOMode_ParseOption,
+  NCOMode_Check,
+};
+
+bool NCOMode_Requested(const Options *opts) {
+  return opts->nco.numRetunes > 0 || opts->nco.hopFileName != NULL || opts->nco.sweepSpec != NULL;
+}
+
+// steps the NCO through every --nco frequency, printing what each retune took from
+// the call to the last report's answer
+static bool RetuneNCO(hid_device *handle, DAC5687NCO *nco, const NCOOptions *opts) {
+  unsigned int i;
+  for (i = 0; i < opts->numRetunes; i++) {
+    MCP2210Counters before, after;
+    struct timespec start, end;
+    DAC5687Frame frames[DAC5687_NCO_MAX_FRAMES];
+
+    MCP2210_GetCounters(&before);
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    unsigned int numFrames = DAC5687_EncodeNCO(nco, opts->retuneFreqs[i], opts->retunePhases[i], frames);
+    if (!DAC5687_SendNCO(handle, nco, frames, numFrames)) {
+      return false;
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    MCP2210_GetCounters(&after);
+
+    unsigned long long ns = DDSHost_ElapsedNs(&start, &end);
+    printf("nco: %.3f Hz @ %.2f deg (word %08x, phase %04x): %u frames, %llu reports, %llu.%03llu ms\n",
+           opts->retuneFreqs[i], opts->retunePhases[i] * 180.0 / M_PI,
+           DAC5687_NCOFrequencyWord(nco, opts->retuneFreqs[i]), DAC5687_NCOPhaseWord(opts->retunePhases[i]),
+           numFrames, after.reports - before.reports, ns / 1000000ULL, (ns / 1000ULL) % 1000);
+  }
+  return true;
+}
+
+// loads the --hop plan or builds the --sweep one. Returns NULL on failure.
+static HopPlan * LoadHopPlan(const NCOOptions *opts) {
+  if (opts->hopFileName != NULL) {
+    return Hop_Load(opts->hopFileName);
+  }
+
+  // "<start Hz>:<end Hz>:<steps>:<dwell us>"
+  double startHz, endHz, dwellUs;
+  unsigned int numSteps;
+  char extra;
+  if (sscanf(opts->sweepSpec, "%lf:%lf:%u:%lf%c", &startHz, &endHz, &numSteps, &dwellUs, &extra) != 4 ||
+      numSteps == 0 || !(dwellUs >= 0)) {
+    fprintf(stderr, "bad --sweep: %s\n", opts->sweepSpec);
+    return NULL;
+  }
+  return Hop_CreateSweep(startHz, endHz, numSteps, (unsigned long long)(dwellUs * 1000.0 + 0.5));
+}
+
+// plays the --hop or --sweep plan on 'nco' and reports how closely it kept to time
+static bool PlayHopPlan(hid_device *handle, DAC5687NCO *nco, const NCOOptions *opts) {
+  HopPlan *plan = LoadHopPlan(opts);
+
+  if (plan == NULL) {
+    return false;
+  }
+
+  FILE *log = NULL;
+  if (opts->hopLogFileName != NULL) {
+    log = fopen(opts->hopLogFileName, "w");
+    if (log == NULL) {
+      perror("couldn't open --hop-log");
+      Hop_Free(plan);
+      return false;
+    }
+  }
+
+  // static so the histograms are never on the stack of the timed loop
+  static HopStats stats;
+  Hop_Encode(plan, nco);
+  bool ok = Hop_Run(handle, nco, plan, &stats);
+
+  printf("hop: %u of %u steps sent, %u overran the next step\n", stats.stepsSent, plan->numSteps, stats.overruns);
+  Jitter_Print(&stats.startLate, "hop start late", stdout);
+  Jitter_Print(&stats.doneLate, "hop done late", stdout);
+
+  if (log != NULL) {
+    Hop_PrintSteps(plan, &stats, log);
+    fclose(log);
+  }
+  Hop_Free(plan);
+  return ok;
+}
+
+bool NCOMode_Run(hid_device *handle, const Options *opts) {
+  DAC5687NCO nco;
+  DAC5687_InitNCO(&nco, opts->nco.refClockHz);
+  nco.latch = opts->nco.ncoLatch;
+  nco.syncCntl = opts->nco.ncoSyncCntl;
+
+  if (!RetuneNCO(handle, &nco, &opts->nco)) {
+    return false;
+  }
+
+  if (opts->nco.hopFileName != NULL || opts->nco.sweepSpec != NULL) {
+    return PlayHopPlan(handle, &nco, &opts->nco);
+  }
+  return true;
+}
@@ -0,0 +1,192 @@
+/*
+ * MIT License
+ * 
+ * Copyright (c) 2020 Eli Reed
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+// C
+#include <stdio.h>  // for printf()
+#include <stdbool.h>  // for bool type
+#include <stdlib.h> // for strtoull()
+#include <string.h> // for memcpy()
+#include <sys/resource.h> // for getrusage()
+
+// HIDAPI
+#include "hidapi/hidapi.h"
+
+// project libraries
+#include "dds-host/dds-host.h"
+#include "dds-host/cache.h"
+#include "dds-host/cpld.h"
+#include "dds-host/image.h"
+#include "dds-host/pipeline.h"
+#include "dds-host/progress.h"
+#include "dds-host/synth.h"
+
+static const struct option longOpts[] = {
+  {"pipeline", no_argument, NULL, 'i'},
+  {"memory-budget", required_argument, NULL, 'M'},
+  {NULL, 0, NULL, 0},
+};
+
+static const char * const usage[] = {
+  "       ./bin/dds-host ... --data <filename> | --synth <waveform> --pipeline [--memory-budget <bytes>[k|m]]",
+  NULL,
+};
+
+static bool PipelineMode_ParseOption(int opt, const char *arg, Options *opts) {
+  PipelineOptions *pipeline = &opts->pipeline;
+  char *end;
+
+  switch (opt) {
+    case ('i'):
+      pipeline->pipeline = true;
+      break;
+    case ('M'): {
+      unsigned long long budget = strtoull(arg, &end, 10);
+      if (*end == 'k' || *end == 'K') {
+        budget *= 1024;
+        end++;
+      } else if (*end == 'm' || *end == 'M') {
+        budget *= 1024 * 1024;
+        end++;
+      }
+      if (*end != '\0' || budget == 0) {
+        fprintf(stderr, "bad --memory-budget: %s\n", arg);
+        return false;
+      }
+      // a budget only means anything to the pipeline
+      pipeline->memoryBudget = (size_t)budget;
+      pipeline->pipeline = true;
+      break;
+    }
+    default:
+      return false;
+  }
+  return true;
+}
+
+static bool PipelineMode_Check(const Options *opts) {
+  // the pipeline streams straight to the bus, with nothing to checkpoint or hand over
+  if (opts->pipeline.pipeline &&
+      (!UploadMode_HasData(opts) || opts->upload.journalFileName != NULL || opts->client.socketPath != NULL ||
+       opts->script.scriptFileName != NULL)) {
+    fprintf(stderr, "--pipeline needs --data or --synth, and can't be used with --journal, --socket or --script\n");
+    return false;
+  }
+  return true;
+}
+
+const DDSHostMode PipelineMode = {
+  longOpts,
+  usage,
+  NULL,
+  PipelineMode_ParseOption,
+  PipelineMode_Check,
+};
+
+// a PipelineRead over the rows of an ImageReader
+static bool ReadRows(void *ctx, unsigned int *words, unsigned int max, unsigned int *got) {
+  return Image_Read((ImageReader *)ctx, words, max, got);
+}
+
+// what's left of a synthesized image, for the pipeline
+typedef struct image_source_st {
+  const SRAMImage *image;
+  unsigned int next;
+} ImageSource;
+
+// a PipelineRead over an ImageSource
+static bool ReadImage(void *ctx, unsigned int *words, unsigned int max, unsigned int *got) {
+  ImageSource *source = (ImageSource *)ctx;
+  unsigned int left = source->image->numWords - source->next;
+
+  *got = left < max ? left : max;
+  memcpy(words, &source->image->words[source->next], *got * sizeof(unsigned int));
+  source->next += *got;
+  return true;
+}
+
+unsigned int PipelineMode_Upload(hid_device *handle, const Options *opts) {
+  const UploadOptions *upload = &opts->upload;
+  size_t memoryBudget = opts->pipeline.memoryBudget;
+  ImageReader *reader = NULL;
+  SRAMImage *image = NULL;
+  ImageSource source = {0};
+  unsigned int count;
+
+  if (upload->synthSpec != NULL) {
+    image = Synth_CreateImage(&upload->synth);
+    if (image == NULL) {
+      return 1;
+    }
+    source.image = image;
+    count = image->numWords;
+  } else {
+    reader = Image_OpenReader(upload->dataFileName, upload->sourceOffset, upload->count);
+    if (reader == NULL) {
+      return 1;
+    }
+    count = Image_ReaderRows(reader);
+  }
+
+  // a data file read to the end has no count until it's been read
+  unsigned int failed = count > 0 ? count : 1;
+  if (count > SRAM_MAX_ADDRESS + 1 - upload->sramOffset) {
+    fprintf(stderr, "%u words don't fit in SRAM from %05x\n", count, upload->sramOffset);
+  } else if (Cache_Invalidate(handle)) {
+    Progress *progress = NULL;
+    if (upload->progressMs > 0) {
+      progress = Progress_Start(count, upload->progressMs);
+    }
+
+    PipelineStats stats;
+    bool ok = reader != NULL ?
+              Pipeline_Upload(handle, upload->sramOffset, ReadRows, reader, memoryBudget, progress, &stats) :
+              Pipeline_Upload(handle, upload->sramOffset, ReadImage, &source, memoryBudget, progress, &stats);
+
+    if (progress != NULL) {
+      Progress_Finish(progress, stdout);
+    }
+    // the stats are empty if the pipeline never started
+    struct rusage self;
+    if (stats.batchWords > 0) {
+      Pipeline_PrintStats(&stats, stdout);
+      if (getrusage(RUSAGE_SELF, &self) == 0) {
+        printf("peak RSS: %ld KiB\n", self.ru_maxrss);
+      }
+    }
+
+    // words that never made it to the bus failed too
+    failed = 0;
+    if (!ok) {
+      failed = stats.failed + (count > stats.usb.words ? count - (unsigned int)stats.usb.words : 0);
+      failed = failed > 0 ? failed : 1;
+    }
+    if (ok && !UploadMode_IsPatch(opts) && !Cache_WriteTag(handle, &stats.tag)) {
+      fprintf(stderr, "couldn't tag the upload, the next run won't be able to skip it\n");
+    }
+  }
+
+  Image_CloseReader(reader);
+  Image_Free(image);
+  return failed;
+}
@@ -0,0 +1,141 @@
+/*
+ * MIT License
+ * 
+ * Copyright (c) 2020 Eli Reed
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+// C
+#include <stdio.h>  // for printf()
+#include <stdbool.h>  // for bool type
+#include <stdlib.h> // for EXIT_SUCCESS
+
+// HIDAPI
+#include "hidapi/hidapi.h"
+
+// project libraries
+#include "dds-host/dds-host.h"
+#include "dds-host/cache.h"
+#include "dds-host/image.h"
+#include "dds-host/progress.h"
+#include "dds-host/report-stream.h"
+
+static const struct option longOpts[] = {
+  {"compile-upload", required_argument, NULL, 'b'},
+  {"replay", required_argument, NULL, 'e'},
+  {NULL, 0, NULL, 0},
+};
+
+static const char * const usage[] = {
+  "       ./bin/dds-host --data <filename> | --synth <waveform> [--offset ...] --compile-upload <filename>",
+  "       ./bin/dds-host ... --replay <filename> instead of --data",
+  NULL,
+};
+
+static bool ReplayMode_ParseOption(int opt, const char *arg, Options *opts) {
+  switch (opt) {
+    case ('b'):
+      opts->replay.compileUploadFileName = arg;
+      break;
+    case ('e'):
+      opts->replay.replayFileName = arg;
+      break;
+    default:
+      return false;
+  }
+  return true;
+}
+
+static bool ReplayMode_Check(const Options *opts) {
+  const ReplayOptions *replay = &opts->replay;
+
+  // compiling an upload doesn't touch the board
+  if (replay->compileUploadFileName != NULL && !UploadMode_HasData(opts)) {
+    fprintf(stderr, "--compile-upload needs --data or --synth\n");
+    return false;
+  }
+
+  // the stream already says what goes where
+  if (replay->replayFileName != NULL &&
+      (UploadMode_HasData(opts) || opts->upload.journalFileName != NULL || opts->client.socketPath != NULL ||
+       opts->script.scriptFileName != NULL)) {
+    fprintf(stderr, "--replay can't be used with --data, --synth, --journal, --socket or --script\n");
+    return false;
+  }
+  return true;
+}
+
+const DDSHostMode ReplayMode = {
+  longOpts,
+  usage,
+  NULL,
+  ReplayMode_ParseOption,
+  ReplayMode_Check,
+};
+
+unsigned int ReplayMode_Upload(hid_device *handle, const Options *opts) {
+  ReportStream *stream = ReportStream_Open(opts->replay.replayFileName);
+
+  if (stream == NULL) {
+    return 1;
+  }
+
+  unsigned int count = stream->tag.numWords;
+  if (!Cache_Invalidate(handle)) {
+    ReportStream_Close(stream);
+    return count;
+  }
+
+  Progress *progress = NULL;
+  if (opts->upload.progressMs > 0) {
+    progress = Progress_Start(count, opts->upload.progressMs);
+  }
+
+  unsigned int failed = ReportStream_Replay(handle, stream, progress);
+
+  if (progress != NULL) {
+    Progress_Finish(progress, stdout);
+  }
+
+  // only whole images from address 0 are tagged, as with --data
+  if (failed == 0 && stream->tag.startAddr == 0 && !Cache_WriteTag(handle, &stream->tag)) {
+    fprintf(stderr, "couldn't tag the upload, the next run won't be able to skip it\n");
+  }
+  ReportStream_Close(stream);
+  return failed;
+}
+
+int ReplayMode_Compile(const Options *opts) {
+  const char *fileName = opts->replay.compileUploadFileName;
+  unsigned int startAddr = opts->upload.sramOffset;
+  SRAMImage *image = UploadMode_LoadData(opts);
+
+  if (image == NULL) {
+    return EXIT_FAILURE;
+  }
+
+  bool ok = ReportStream_Compile(fileName, startAddr, image->words, image->numWords);
+  if (ok) {
+    printf("%s: %u words from %05x in %u reports\n", fileName, image->numWords,
+           startAddr, image->numWords * REPORTSTREAM_REPORTS_PER_WORD);
+  }
+  Image_Free(image);
+  return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,77 @@
+/*
+ * MIT License
+ * 
+ * Copyright (c) 2020 Eli Reed
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+// C
+#include <stdio.h>  // for fprintf()
+#include <stdbool.h>  // for bool type
+
+// project libraries
+#include "dds-host/dds-host.h"
+
+static const struct option longOpts[] = {
+  {"script", required_argument, NULL, 'x'},
+  {NULL, 0, NULL, 0},
+};
+
+static const char * const usage[] = {
+  "       ./bin/dds-host [--dac-config <filename> --mcp-config <filename> [--cold]] --script <filename>",
+  NULL,
+};
+
+static bool ScriptMode_ParseOption(int opt, const char *arg, Options *opts) {
+  switch (opt) {
+    case ('x'):
+      opts->script.scriptFileName = arg;
+      break;
+    default:
+      return false;
+  }
+  return true;
+}
+
+static bool ScriptMode_Check(const Options *opts) {
+  if (opts->script.scriptFileName == NULL) {
+    return true;
+  }
+
+  if (UploadMode_HasData(opts)) {
+    fprintf(stderr, "--script can't be used with --data or --synth\n");
+    return false;
+  }
+
+  // configuration is optional in script mode, but it's all or nothing
+  if ((opts->dacFileName == NULL) != (opts->mcpFileName == NULL)) {
+    fprintf(stderr, "--dac-config and --mcp-config must be given together\n");
+    return false;
+  }
+  return true;
+}
+
+const DDSHostMode ScriptMode = {
+  longOpts,
+  usage,
+  NULL,
+  ScriptMode_ParseOption,
+  ScriptMode_Check,
+};
@@ -0,0 +1,150 @@
+/*
+ * MIT License
+ * 
+ * Copyright (c) 2020 Eli Reed
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+// C
+#include <stdio.h>  // for printf()
+#include <stdbool.h>  // for bool type
+
+// HIDAPI
+#include "hidapi/hidapi.h"
+
+// project libraries
+#include "dds-host/dds-host.h"
+#include "dds-host/host.h"
+#include "dds-host/cache.h"
+#include "dds-host/cpld.h"
+#include "dds-host/progress.h"
+#include "dds-host/shm-ring.h"
+#include "dds-host/util/hash.h"
+
+// how long a --shm upload waits for the producer between checks for Ctrl-C
+#define SHM_WAIT_US   100000
+
+static const struct option longOpts[] = {
+  {"shm", required_argument, NULL, 'z'},
+  {NULL, 0, NULL, 0},
+};
+
+static const char * const usage[] = {
+  "       ./bin/dds-host ... --shm <name> [--offset <addr>] instead of --data",
+  NULL,
+};
+
+static bool ShmMode_ParseOption(int opt, const char *arg, Options *opts) {
+  switch (opt) {
+    case ('z'):
+      opts->shm.shmName = arg;
+      break;
+    default:
+      return false;
+  }
+  return true;
+}
+
+static bool ShmMode_Check(const Options *opts) {
+  // the ring decides what and how much gets uploaded
+  if (opts->shm.shmName != NULL &&
+      (UploadMode_HasData(opts) || opts->replay.replayFileName != NULL || opts->pipeline.pipeline ||
+       opts->upload.journalFileName != NULL || opts->script.scriptFileName != NULL)) {
+    fprintf(stderr, "--shm can't be used with --data, --synth, --replay, --pipeline, --journal or --script\n");
+    return false;
+  }
+  return true;
+}
+
+const DDSHostMode ShmMode = {
+  longOpts,
+  usage,
+  NULL,
+  ShmMode_ParseOption,
+  ShmMode_Check,
+};
+
+unsigned int ShmMode_Upload(hid_device *handle, const Options *opts) {
+  const char *shmName = opts->shm.shmName;
+  unsigned int sramOffset = opts->upload.sramOffset;
+  ShmRing *ring = ShmRing_Open(shmName);
+
+  if (ring == NULL) {
+    return 1;
+  }
+
+  if (!Cache_Invalidate(handle)) {
+    ShmRing_Close(ring);
+    return 1;
+  }
+
+  // the producer may not know how much it'll write either
+  Progress *progress = NULL;
+  if (opts->upload.progressMs > 0) {
+    progress = Progress_Start(0, opts->upload.progressMs);
+  }
+
+  ImageTag tag = {sramOffset, 0, HASH_FNV1A64_INIT};
+  unsigned int failed = 0;
+  bool ok = true;
+
+  while (ok && !ShmRing_Drained(ring)) {
+    if (Host_CancelRequested()) {
+      fprintf(stderr, "shm upload cancelled after %u words\n", tag.numWords);
+      ok = false;
+      break;
+    }
+
+    const unsigned int *words;
+    unsigned int count;
+    ok = ShmRing_Peek(ring, SHM_WAIT_US, &words, &count);
+    if (!ok || count == 0) {
+      continue;
+    }
+
+    // chunks keep progress and Ctrl-C responsive however far ahead the producer is
+    if (count > PROGRESS_CHUNK_WORDS) {
+      count = PROGRESS_CHUNK_WORDS;
+    }
+    if (count > SRAM_MAX_ADDRESS + 1 - sramOffset - tag.numWords) {
+      fprintf(stderr, "the ring holds more words than fit in SRAM from %05x\n", sramOffset);
+      ok = false;
+      break;
+    }
+
+    tag.hash = Hash_FNV1a64(tag.hash, words, count * sizeof(unsigned int));
+    unsigned int chunkFailed = Host_WriteWords(handle, sramOffset + tag.numWords, words, count);
+    ShmRing_Consume(ring, count);
+    Progress_Add(progress, count, chunkFailed);
+    failed += chunkFailed;
+    tag.numWords += count;
+  }
+
+  if (progress != NULL) {
+    Progress_Finish(progress, stdout);
+  }
+  printf("shm: %u words from %s\n", tag.numWords, shmName);
+
+  if (ok && failed == 0 && sramOffset == 0 && !Cache_WriteTag(handle, &tag)) {
+    fprintf(stderr, "couldn't tag the upload, the next run won't be able to skip it\n");
+  }
+  ShmRing_Close(ring);
+  return failed + (ok ? 0 : 1);
+}
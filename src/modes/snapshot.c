@@ -0,0 +1,136 @@
+/*
+ * MIT License
+ * 
+ * Copyright (c) 2020 Eli Reed
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+// C
+#include <stdio.h>  // for printf()
+#include <stdbool.h>  // for bool type
+#include <time.h>   // for time()
+
+// HIDAPI
+#include "hidapi/hidapi.h"
+
+// project libraries
+#include "dds-host/dds-host.h"
+#include "dds-host/mcp2210.h"
+#include "dds-host/dac5687.h"
+#include "dds-host/dac-snapshot.h"
+
+static const struct option longOpts[] = {
+  {"dac-dump", required_argument, NULL, 'u'},
+  {"dac-diff", required_argument, NULL, 'g'},
+  {"from-snapshot", required_argument, NULL, 'a'},
+  {NULL, 0, NULL, 0},
+};
+
+static const char * const usage[] = {
+  "       ./bin/dds-host [...] --dac-dump <filename> and/or --dac-diff <filename>",
+  "       ./bin/dds-host --from-snapshot <filename> --dac-diff <filename>",
+  NULL,
+};
+
+static bool SnapshotMode_ParseOption(int opt, const char *arg, Options *opts) {
+  switch (opt) {
+    case ('u'):
+      opts->snapshot.dumpFileName = arg;
+      break;
+    case ('g'):
+      opts->snapshot.diffFileName = arg;
+      break;
+    case ('a'):
+      opts->snapshot.fromSnapshotFileName = arg;
+      break;
+    default:
+      return false;
+  }
+  return true;
+}
+
+static bool SnapshotMode_Check(const Options *opts) {
+  const SnapshotOptions *snapshot = &opts->snapshot;
+
+  // comparing a saved snapshot doesn't touch the board
+  if (snapshot->fromSnapshotFileName != NULL &&
+      (snapshot->diffFileName == NULL || snapshot->dumpFileName != NULL)) {
+    fprintf(stderr, "--from-snapshot needs --dac-diff and can't be used with --dac-dump\n");
+    return false;
+  }
+
+  if (SnapshotMode_Requested(opts) && (opts->client.socketPath != NULL || opts->script.scriptFileName != NULL)) {
+    fprintf(stderr, "--dac-dump and --dac-diff don't work with --socket or --script\n");
+    return false;
+  }
+  return true;
+}
+
+const DDSHostMode SnapshotMode = {
+  longOpts,
+  usage,
+  NULL,
+  SnapshotMode_ParseOption,
+  SnapshotMode_Check,
+};
+
+bool SnapshotMode_Requested(const Options *opts) {
+  return opts->snapshot.dumpFileName != NULL || opts->snapshot.diffFileName != NULL;
+}
+
+bool SnapshotMode_Run(hid_device *handle, const Options *opts) {
+  const SnapshotOptions *snapshot = &opts->snapshot;
+  DAC5687RegisterMap actual;
+
+  if (handle == NULL) {
+    if (!DACSnapshot_Load(snapshot->fromSnapshotFileName, &actual, NULL)) {
+      return false;
+    }
+  } else {
+    MCP2210Counters before, after;
+    MCP2210_GetCounters(&before);
+    if (!DACSnapshot_Take(handle, &actual)) {
+      return false;
+    }
+    MCP2210_GetCounters(&after);
+    printf("dac: read %u registers in %llu reports\n", (unsigned int)__builtin_popcount(actual.mask),
+           after.reports - before.reports);
+  }
+
+  if (snapshot->dumpFileName != NULL) {
+    if (!DACSnapshot_Save(snapshot->dumpFileName, &actual, time(NULL))) {
+      return false;
+    }
+    printf("dac: snapshot written to %s\n", snapshot->dumpFileName);
+  }
+
+  if (snapshot->diffFileName != NULL) {
+    DAC5687RegisterMap expected;
+    if (!DACSnapshot_LoadAny(snapshot->diffFileName, &expected)) {
+      return false;
+    }
+
+    unsigned int differences = DACSnapshot_Diff(&expected, &actual, stdout);
+    printf("dac: %u of %u registers differ from %s\n", differences,
+           (unsigned int)__builtin_popcount(expected.mask), snapshot->diffFileName);
+    return differences == 0;
+  }
+  return true;
+}
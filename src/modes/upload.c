@@ -0,0 +1,280 @@
+/*
+ * MIT License
+ * 
+ * Copyright (c) 2020 Eli Reed
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+// C
+#include <stdio.h>  // for printf()
+#include <stdbool.h>  // for bool type
+#include <stdlib.h> // for strtoul()
+#include <math.h>   // for M_PI
+
+// HIDAPI
+#include "hidapi/hidapi.h"
+
+// project libraries
+#include "dds-host/dds-host.h"
+#include "dds-host/host.h"
+#include "dds-host/cache.h"
+#include "dds-host/cpld.h"
+#include "dds-host/image.h"
+#include "dds-host/mcp2210-sim.h"
+#include "dds-host/progress.h"
+#include "dds-host/synth.h"
+
+static const struct option longOpts[] = {
+  {"data", required_argument, NULL, 'f'},
+  {"synth", required_argument, NULL, 'y'},
+  {"samples", required_argument, NULL, 'N'},
+  {"sample-rate", required_argument, NULL, 'H'},
+  {"amplitude", required_argument, NULL, 'A'},
+  {"iq-phase", required_argument, NULL, 'Q'},
+  {"offset", required_argument, NULL, 'o'},
+  {"count", required_argument, NULL, 'k'},
+  {"source-offset", required_argument, NULL, 'O'},
+  {"force", no_argument, NULL, 'F'},
+  {"journal", required_argument, NULL, 'J'},
+  {"progress", optional_argument, NULL, 'P'},
+  {NULL, 0, NULL, 0},
+};
+
+static const char * const usage[] = {
+  "       ./bin/dds-host ... --synth <waveform> [--samples <n>] [--sample-rate <Hz>]",
+  "                      [--amplitude <0..1>] [--iq-phase <degrees>] instead of --data",
+  NULL,
+};
+
+static void UploadMode_Defaults(Options *opts) {
+  Synth_Defaults(&opts->upload.synth);
+}
+
+static bool UploadMode_ParseOption(int opt, const char *arg, Options *opts) {
+  UploadOptions *upload = &opts->upload;
+  char *end;
+
+  switch (opt) {
+    case ('f'):
+      upload->dataFileName = arg;
+      break;
+    case ('y'):
+      upload->synthSpec = arg;
+      if (!Synth_ParseSpec(arg, &upload->synth)) {
+        return false;
+      }
+      break;
+    case ('N'):
+      upload->synth.numSamples = (unsigned int)strtoul(arg, &end, 10);
+      if (*end != '\0' || upload->synth.numSamples == 0 || upload->synth.numSamples > SRAM_MAX_ADDRESS + 1) {
+        fprintf(stderr, "bad --samples: %s\n", arg);
+        return false;
+      }
+      break;
+    case ('H'):
+      upload->synth.sampleRate = strtod(arg, &end);
+      if (*end != '\0' || !(upload->synth.sampleRate > 0)) {
+        fprintf(stderr, "bad --sample-rate: %s\n", arg);
+        return false;
+      }
+      break;
+    case ('A'):
+      upload->synth.amplitude = strtod(arg, &end);
+      if (*end != '\0' || !(upload->synth.amplitude >= 0 && upload->synth.amplitude <= 1)) {
+        fprintf(stderr, "bad --amplitude: %s\n", arg);
+        return false;
+      }
+      break;
+    case ('Q'):
+      upload->synth.iqPhase = strtod(arg, &end) * M_PI / 180.0;
+      if (*end != '\0') {
+        fprintf(stderr, "bad --iq-phase: %s\n", arg);
+        return false;
+      }
+      break;
+    case ('o'):
+      upload->sramOffset = (unsigned int)strtoul(arg, &end, 16);
+      if (*end != '\0' || upload->sramOffset > SRAM_MAX_ADDRESS) {
+        fprintf(stderr, "bad --offset: %s\n", arg);
+        return false;
+      }
+      break;
+    case ('k'):
+      upload->count = (unsigned int)strtoul(arg, &end, 10);
+      if (*end != '\0' || upload->count == 0 || upload->count > SRAM_MAX_ADDRESS + 1) {
+        fprintf(stderr, "bad --count: %s\n", arg);
+        return false;
+      }
+      break;
+    case ('O'):
+      upload->sourceOffset = (unsigned int)strtoul(arg, &end, 10);
+      if (*end != '\0') {
+        fprintf(stderr, "bad --source-offset: %s\n", arg);
+        return false;
+      }
+      break;
+    case ('F'):
+      upload->force = true;
+      break;
+    case ('J'):
+      upload->journalFileName = arg;
+      break;
+    case ('P'):
+      upload->progressMs = PROGRESS_DEFAULT_INTERVAL_MS;
+      if (arg != NULL) {
+        upload->progressMs = (unsigned int)strtoul(arg, &end, 10);
+        if (*end != '\0' || upload->progressMs == 0) {
+          fprintf(stderr, "bad --progress: %s\n", arg);
+          return false;
+        }
+      }
+      break;
+    default:
+      return false;
+  }
+  return true;
+}
+
+static bool UploadMode_Check(const Options *opts) {
+  const UploadOptions *upload = &opts->upload;
+
+  if (upload->synthSpec != NULL && upload->dataFileName != NULL) {
+    fprintf(stderr, "--synth and --data can't be used together\n");
+    return false;
+  }
+
+  // a synthesized waveform can be placed anywhere, but has no rows to pick from
+  if (upload->synthSpec != NULL && (upload->sourceOffset != 0 || upload->count != 0)) {
+    fprintf(stderr, "--count and --source-offset don't work with --synth, use --samples\n");
+    return false;
+  }
+
+  if (upload->sramOffset != 0 && !UploadMode_HasData(opts) && opts->shm.shmName == NULL) {
+    fprintf(stderr, "--offset needs --data, --synth or --shm\n");
+    return false;
+  }
+
+  if ((upload->sourceOffset != 0 || upload->count != 0) && !UploadMode_HasData(opts)) {
+    fprintf(stderr, "--count and --source-offset need --data\n");
+    return false;
+  }
+
+  if (upload->journalFileName != NULL && !UploadMode_HasData(opts)) {
+    fprintf(stderr, "--journal needs --data or --synth\n");
+    return false;
+  }
+  return true;
+}
+
+const DDSHostMode UploadMode = {
+  longOpts,
+  usage,
+  UploadMode_Defaults,
+  UploadMode_ParseOption,
+  UploadMode_Check,
+};
+
+bool UploadMode_HasData(const Options *opts) {
+  return opts->upload.dataFileName != NULL || opts->upload.synthSpec != NULL;
+}
+
+bool UploadMode_HasUpload(const Options *opts) {
+  return UploadMode_HasData(opts) || opts->replay.replayFileName != NULL || opts->shm.shmName != NULL;
+}
+
+bool UploadMode_IsPatch(const Options *opts) {
+  return opts->upload.sramOffset != 0 || opts->upload.sourceOffset != 0 || opts->upload.count != 0;
+}
+
+SRAMImage * UploadMode_LoadData(const Options *opts) {
+  const UploadOptions *upload = &opts->upload;
+  SRAMImage *image;
+
+  if (upload->synthSpec != NULL) {
+    image = Synth_CreateImage(&upload->synth);
+  } else {
+    image = Image_LoadRange(upload->dataFileName, upload->sourceOffset, upload->count);
+  }
+
+  if (image != NULL && image->numWords > SRAM_MAX_ADDRESS + 1 - upload->sramOffset) {
+    fprintf(stderr, "%u words don't fit in SRAM from %05x\n", image->numWords, upload->sramOffset);
+    Image_Free(image);
+    return NULL;
+  }
+  return image;
+}
+
+static hid_device * ReopenSim(void *sim) {
+  return MCP2210Sim_Open((MCP2210Sim *)sim);
+}
+
+// --simulate-unplug: the board never comes back
+static hid_device * ReopenUnplugged(void *sim) {
+  return NULL;
+}
+
+unsigned int UploadMode_Upload(hid_device **handle, const SRAMImage *image, const Options *opts, MCP2210Sim *sim) {
+  bool patch = UploadMode_IsPatch(opts);
+  ImageTag tag;
+  Cache_TagWords(image->words, 0, image->numWords, &tag);
+
+  if (!patch && !opts->upload.force && Cache_HoldsImage(*handle, image)) {
+    printf("SRAM already holds this image (%u words, hash %016llx), skipping upload\n",
+           image->numWords, (unsigned long long)tag.hash);
+    return 0;
+  }
+
+  // an interrupted upload mustn't leave the old tag behind, and a patch can't be
+  // tagged at all since it only describes part of the SRAM
+  if (!Cache_Invalidate(*handle)) {
+    return image->numWords;
+  }
+
+  UploadJob job = {0};
+  job.startAddr = opts->upload.sramOffset;
+  job.words = image->words;
+  job.count = image->numWords;
+  job.journalFileName = opts->upload.journalFileName;
+  job.dacFileName = opts->dacFileName;
+  job.mcpFileName = opts->mcpFileName;
+  if (sim != NULL) {
+    job.reopen = opts->dryRun.simulateUnplug ? ReopenUnplugged : ReopenSim;
+    job.reopenCtx = sim;
+    // there's nothing to wait for
+    job.reopenAttempts = opts->dryRun.simulateUnplug ? 1 : 0;
+  }
+
+  Progress *progress = NULL;
+  if (opts->upload.progressMs > 0) {
+    progress = Progress_Start(image->numWords, opts->upload.progressMs);
+    job.progress = progress;
+  }
+
+  unsigned int failed = Host_UploadResumable(handle, &job);
+
+  if (progress != NULL) {
+    Progress_Finish(progress, stdout);
+  }
+
+  if (!patch && failed == 0 && !Cache_WriteTag(*handle, &tag)) {
+    fprintf(stderr, "couldn't tag the upload, the next run won't be able to skip it\n");
+  }
+  return failed;
+}
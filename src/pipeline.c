@@ -0,0 +1,420 @@
+/*
+ * MIT License
+ * 
+ * Copyright (c) 2020 Eli Reed
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <stdio.h>    // for fprintf()
+#include <stdlib.h>   // for malloc(), free()
+#include <stdbool.h>  // for bool type
+#include <stdint.h>   // for fixed-width integer types
+#include <string.h>   // for memset()
+#include <pthread.h>  // for pthread_create(), pthread_join()
+#include <sched.h>    // for sched_yield()
+#include <time.h>     // for clock_gettime(), nanosleep()
+
+// HIDAPI
+#include "hidapi/hidapi.h"
+
+// project libraries
+#include "dds-host/pipeline.h"
+#include "dds-host/cache.h"
+#include "dds-host/cpld.h"
+#include "dds-host/host.h"
+#include "dds-host/mcp2210.h"
+#include "dds-host/progress.h"
+#include "dds-host/realtime.h"
+#include "dds-host/report-stream.h"
+#include "dds-host/util/hash.h"
+
+// how many times a waiting stage yields before it starts sleeping between checks
+#define PIPELINE_SPINS          64
+#define PIPELINE_SLEEP_NS       20000
+
+#define PIPELINE_SLOT(index)    ((index) & (PIPELINE_RING_SLOTS - 1))
+
+typedef struct word_batch_st {
+  unsigned int addr;
+  unsigned int count;
+  // set on the (empty) batch that ends the upload
+  bool last;
+  unsigned int *words;
+} WordBatch;
+
+typedef struct report_batch_st {
+  unsigned int addr;
+  unsigned int count;
+  bool last;
+  uint8_t *reports;
+} ReportBatch;
+
+// only the producer writes 'head' and only the consumer writes 'tail', each on its own
+// cache line so the two stages don't keep stealing it from each other
+typedef struct pipeline_ring_st {
+  // batches published so far
+  unsigned int head __attribute__((aligned(64)));
+  // batches consumed so far
+  unsigned int tail __attribute__((aligned(64)));
+} PipelineRing;
+
+typedef struct pipeline_st {
+  PipelineRing wordRing;
+  WordBatch wordSlots[PIPELINE_RING_SLOTS];
+  PipelineRing reportRing;
+  ReportBatch reportSlots[PIPELINE_RING_SLOTS];
+
+  // the words and reports the slots point into, batchWords per slot
+  unsigned int batchWords;
+  void *buffers;
+
+  unsigned int startAddr;
+  PipelineRead read;
+  void *ctx;
+
+  // set by whichever stage gives up, so the others stop waiting on it
+  bool abort;
+  bool sourceFailed;
+  PipelineStats *stats;
+} Pipeline;
+
+static uint64_t Pipeline_Now() {
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (uint64_t)now.tv_sec * 1000000000ULL + (uint64_t)now.tv_nsec;
+}
+
+static void Pipeline_Abort(Pipeline *pipeline) {
+  __atomic_store_n(&pipeline->abort, true, __ATOMIC_RELEASE);
+}
+
+static bool Pipeline_Aborted(Pipeline *pipeline) {
+  return __atomic_load_n(&pipeline->abort, __ATOMIC_ACQUIRE);
+}
+
+// yields for the first few checks, then sleeps so a long wait doesn't burn a core
+static void Pipeline_Backoff(unsigned int *spins) {
+  if (++*spins < PIPELINE_SPINS) {
+    sched_yield();
+  } else {
+    struct timespec pause = {0, PIPELINE_SLEEP_NS};
+    nanosleep(&pause, NULL);
+  }
+}
+
+// waits until the producer of 'ring' has a free slot, adding the time waited to
+// 'blockedNs'. Returns false if the pipeline was aborted, true otherwise.
+static bool Pipeline_WaitForSpace(Pipeline *pipeline, PipelineRing *ring, uint64_t *blockedNs) {
+  unsigned int head = __atomic_load_n(&ring->head, __ATOMIC_RELAXED);
+  if (head - __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE) < PIPELINE_RING_SLOTS) {
+    return true;
+  }
+
+  uint64_t start = Pipeline_Now();
+  unsigned int spins = 0;
+  bool ok = true;
+  while (head - __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE) >= PIPELINE_RING_SLOTS) {
+    if (Pipeline_Aborted(pipeline)) {
+      ok = false;
+      break;
+    }
+    Pipeline_Backoff(&spins);
+  }
+  *blockedNs += Pipeline_Now() - start;
+  return ok;
+}
+
+// waits until the consumer of 'ring' has a batch to take, adding the time waited to
+// 'starvedNs'. Returns false if the pipeline was aborted, true otherwise.
+static bool Pipeline_WaitForData(Pipeline *pipeline, PipelineRing *ring, uint64_t *starvedNs) {
+  unsigned int tail = __atomic_load_n(&ring->tail, __ATOMIC_RELAXED);
+  if (__atomic_load_n(&ring->head, __ATOMIC_ACQUIRE) != tail) {
+    return true;
+  }
+
+  uint64_t start = Pipeline_Now();
+  unsigned int spins = 0;
+  bool ok = true;
+  while (__atomic_load_n(&ring->head, __ATOMIC_ACQUIRE) == tail) {
+    if (Pipeline_Aborted(pipeline)) {
+      ok = false;
+      break;
+    }
+    Pipeline_Backoff(&spins);
+  }
+  *starvedNs += Pipeline_Now() - start;
+  return ok;
+}
+
+static void Pipeline_Publish(PipelineRing *ring) {
+  __atomic_store_n(&ring->head, ring->head + 1, __ATOMIC_RELEASE);
+}
+
+static void Pipeline_Release(PipelineRing *ring) {
+  __atomic_store_n(&ring->tail, ring->tail + 1, __ATOMIC_RELEASE);
+}
+
+static void * Pipeline_ParseStage(void *arg) {
+  Pipeline *pipeline = (Pipeline *)arg;
+  PipelineStageStats *stats = &pipeline->stats->parse;
+  unsigned int room = SRAM_MAX_ADDRESS + 1 - pipeline->startAddr;
+  unsigned int numWords = 0;
+  uint64_t hash = HASH_FNV1A64_INIT;
+
+  // parsing and hashing don't need the bus thread's priority or core
+  Realtime_ResetThread();
+
+  while (Pipeline_WaitForSpace(pipeline, &pipeline->wordRing, &stats->blockedNs)) {
+    WordBatch *batch = &pipeline->wordSlots[PIPELINE_SLOT(pipeline->wordRing.head)];
+    uint64_t start = Pipeline_Now();
+
+    unsigned int got = 0;
+    if (!pipeline->read(pipeline->ctx, batch->words, pipeline->batchWords, &got)) {
+      pipeline->sourceFailed = true;
+      Pipeline_Abort(pipeline);
+      break;
+    }
+    if (got > room - numWords) {
+      fprintf(stderr, "Pipeline_Upload()->data runs past the end of the SRAM\n");
+      pipeline->sourceFailed = true;
+      Pipeline_Abort(pipeline);
+      break;
+    }
+
+    hash = Hash_FNV1a64(hash, batch->words, got * sizeof(unsigned int));
+    batch->addr = pipeline->startAddr + numWords;
+    batch->count = got;
+    batch->last = got == 0;
+    numWords += got;
+
+    stats->busyNs += Pipeline_Now() - start;
+    stats->batches++;
+    stats->words += got;
+    Pipeline_Publish(&pipeline->wordRing);
+
+    if (batch->last) {
+      break;
+    }
+  }
+
+  pipeline->stats->tag.startAddr = pipeline->startAddr;
+  pipeline->stats->tag.numWords = numWords;
+  pipeline->stats->tag.hash = hash;
+  return NULL;
+}
+
+static void * Pipeline_EncodeStage(void *arg) {
+  Pipeline *pipeline = (Pipeline *)arg;
+  PipelineStageStats *stats = &pipeline->stats->encode;
+
+  Realtime_ResetThread();
+
+  while (Pipeline_WaitForData(pipeline, &pipeline->wordRing, &stats->starvedNs) &&
+         Pipeline_WaitForSpace(pipeline, &pipeline->reportRing, &stats->blockedNs)) {
+    const WordBatch *in = &pipeline->wordSlots[PIPELINE_SLOT(pipeline->wordRing.tail)];
+    ReportBatch *out = &pipeline->reportSlots[PIPELINE_SLOT(pipeline->reportRing.head)];
+    uint64_t start = Pipeline_Now();
+
+    unsigned int i;
+    for (i = 0; i < in->count; i++) {
+      ReportStream_EncodeWord(&out->reports[i * REPORTSTREAM_WORD_LEN], in->addr + i, in->words[i]);
+    }
+    out->addr = in->addr;
+    out->count = in->count;
+    out->last = in->last;
+
+    stats->busyNs += Pipeline_Now() - start;
+    stats->batches++;
+    stats->words += in->count;
+    Pipeline_Release(&pipeline->wordRing);
+    Pipeline_Publish(&pipeline->reportRing);
+
+    if (out->last) {
+      break;
+    }
+  }
+  return NULL;
+}
+
+size_t Pipeline_BufferBytes(unsigned int batchWords) {
+  return (size_t)PIPELINE_RING_SLOTS * batchWords * (sizeof(unsigned int) + REPORTSTREAM_WORD_LEN);
+}
+
+// the biggest batches whose buffers fit in 'memoryBudget' bytes, or 0 if none do
+static unsigned int Pipeline_BatchWords(size_t memoryBudget) {
+  if (memoryBudget == 0) {
+    return PIPELINE_BATCH_WORDS;
+  }
+
+  size_t batchWords = memoryBudget / Pipeline_BufferBytes(1);
+  return batchWords < PIPELINE_MAX_BATCH_WORDS ? (unsigned int)batchWords : PIPELINE_MAX_BATCH_WORDS;
+}
+
+// allocates the buffers for every slot of both rings and points the slots into them
+static bool Pipeline_AllocBuffers(Pipeline *pipeline, unsigned int batchWords) {
+  size_t wordBytes = (size_t)batchWords * sizeof(unsigned int);
+  size_t reportBytes = (size_t)batchWords * REPORTSTREAM_WORD_LEN;
+  uint8_t *buffers = (uint8_t *)malloc(Pipeline_BufferBytes(batchWords));
+
+  if (buffers == NULL) {
+    fprintf(stderr, "Failed to allocate pipeline buffers\n");
+    return false;
+  }
+
+  unsigned int i;
+  for (i = 0; i < PIPELINE_RING_SLOTS; i++) {
+    pipeline->reportSlots[i].reports = buffers + i * reportBytes;
+    pipeline->wordSlots[i].words = (unsigned int *)(buffers + PIPELINE_RING_SLOTS * reportBytes + i * wordBytes);
+  }
+  pipeline->batchWords = batchWords;
+  pipeline->buffers = buffers;
+  return true;
+}
+
+bool Pipeline_Upload(hid_device *handle, unsigned int startAddr, PipelineRead read, void *ctx,
+                     size_t memoryBudget, Progress *progress, PipelineStats *stats) {
+  if (handle == NULL || read == NULL || stats == NULL) {
+    fprintf(stderr, "handle, read and stats can't be null\n");
+    return false;
+  }
+  memset(stats, 0, sizeof(PipelineStats));
+
+  if (startAddr > SRAM_MAX_ADDRESS) {
+    fprintf(stderr, "Pipeline_Upload()->start address %u is past the end of the SRAM\n", startAddr);
+    return false;
+  }
+
+  unsigned int batchWords = Pipeline_BatchWords(memoryBudget);
+  if (batchWords == 0) {
+    fprintf(stderr, "Pipeline_Upload()->a %zu byte budget is too small, the pipeline needs at least %zu\n",
+            memoryBudget, Pipeline_BufferBytes(1));
+    return false;
+  }
+
+  // every word after this is a single SpiDataTransfer report
+  MCP2210SPITransferSettings spiSettings;
+  uint8_t settings[MCP2210_REPORT_LEN];
+  if (!CPLD_SetupBus(handle, &spiSettings)) {
+    return false;
+  }
+  ReportStream_SettingsReport(settings, spiSettings.SPIMode);
+  if (!ReportStream_SendSettings(handle, settings)) {
+    return false;
+  }
+
+  Pipeline *pipeline = (Pipeline *)malloc(sizeof(Pipeline));
+  if (pipeline == NULL) {
+    fprintf(stderr, "Failed to allocate Pipeline\n");
+    return false;
+  }
+  memset(pipeline, 0, sizeof(Pipeline));
+  if (!Pipeline_AllocBuffers(pipeline, batchWords)) {
+    free(pipeline);
+    return false;
+  }
+  stats->batchWords = batchWords;
+  stats->bufferBytes = Pipeline_BufferBytes(batchWords);
+  pipeline->startAddr = startAddr;
+  pipeline->read = read;
+  pipeline->ctx = ctx;
+  pipeline->stats = stats;
+
+  uint64_t started = Pipeline_Now();
+
+  pthread_t parser, encoder;
+  if (pthread_create(&parser, NULL, Pipeline_ParseStage, pipeline) != 0) {
+    fprintf(stderr, "Failed to start the parse stage\n");
+    free(pipeline->buffers);
+    free(pipeline);
+    return false;
+  }
+  if (pthread_create(&encoder, NULL, Pipeline_EncodeStage, pipeline) != 0) {
+    fprintf(stderr, "Failed to start the encode stage\n");
+    Pipeline_Abort(pipeline);
+    pthread_join(parser, NULL);
+    free(pipeline->buffers);
+    free(pipeline);
+    return false;
+  }
+
+  // the bus stage runs here, keeping whatever priority and core the caller was given
+  PipelineStageStats *usb = &stats->usb;
+  bool finished = false;
+  while (!Host_CancelRequested() &&
+         Pipeline_WaitForData(pipeline, &pipeline->reportRing, &usb->starvedNs)) {
+    const ReportBatch *batch = &pipeline->reportSlots[PIPELINE_SLOT(pipeline->reportRing.tail)];
+    uint64_t start = Pipeline_Now();
+
+    unsigned int i;
+    unsigned int failures = 0;
+    for (i = 0; i < batch->count; i++) {
+      if (!ReportStream_SendWord(handle, &batch->reports[i * REPORTSTREAM_WORD_LEN])) {
+        fprintf(stderr, "Pipeline_Upload() failed for addr: %u\n", batch->addr + i);
+        failures++;
+      }
+    }
+    stats->failed += failures;
+
+    usb->busyNs += Pipeline_Now() - start;
+    usb->batches++;
+    usb->words += batch->count;
+    if (progress != NULL && batch->count > 0) {
+      Progress_Add(progress, batch->count, failures);
+    }
+
+    finished = batch->last;
+    Pipeline_Release(&pipeline->reportRing);
+    if (finished) {
+      break;
+    }
+  }
+
+  if (!finished) {
+    Pipeline_Abort(pipeline);
+  }
+  pthread_join(encoder, NULL);
+  pthread_join(parser, NULL);
+  stats->elapsedNs = Pipeline_Now() - started;
+
+  if (!finished && !pipeline->sourceFailed) {
+    fprintf(stderr, "pipelined upload cancelled after %llu words\n", usb->words);
+  }
+
+  free(pipeline->buffers);
+  free(pipeline);
+  return finished && stats->failed == 0;
+}
+
+static void Pipeline_PrintStage(const char *name, const PipelineStageStats *stage, uint64_t elapsedNs, FILE *out) {
+  double elapsed = elapsedNs > 0 ? (double)elapsedNs : 1.0;
+  fprintf(out, "  %-6s  busy %5.1f%%  starved %5.1f%%  blocked %5.1f%%  (%llu batches, %llu words)\n",
+          name, 100.0 * stage->busyNs / elapsed, 100.0 * stage->starvedNs / elapsed,
+          100.0 * stage->blockedNs / elapsed, stage->batches, stage->words);
+}
+
+void Pipeline_PrintStats(const PipelineStats *stats, FILE *out) {
+  double seconds = stats->elapsedNs / 1e9;
+  fprintf(out, "pipeline: %llu words in %.3f s (%.0f words/s), %u errors\n",
+          stats->usb.words, seconds, seconds > 0 ? stats->usb.words / seconds : 0.0, stats->failed);
+  fprintf(out, "  %zu KiB of buffers, %u words per batch\n", stats->bufferBytes / 1024, stats->batchWords);
+  Pipeline_PrintStage("parse", &stats->parse, stats->elapsedNs, out);
+  Pipeline_PrintStage("encode", &stats->encode, stats->elapsedNs, out);
+  Pipeline_PrintStage("usb", &stats->usb, stats->elapsedNs, out);
+}
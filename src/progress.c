@@ -0,0 +1,187 @@
+/*
+ * MIT License
+ * 
+ * Copyright (c) 2020 Eli Reed
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <stdio.h>    // for fprintf()
+#include <stdlib.h>   // for malloc(), free()
+#include <stdbool.h>  // for bool type
+#include <string.h>   // for memset()
+#include <pthread.h>  // for pthread_*()
+#include <time.h>     // for clock_gettime()
+
+// HIDAPI
+#include "hidapi/hidapi.h"
+
+// project libraries
+#include "dds-host/progress.h"
+#include "dds-host/realtime.h"
+#include "dds-host/mcp2210.h"
+
+struct progress_st {
+  unsigned int totalWords;
+  unsigned int intervalMs;
+
+  // written by the uploader, read by the reporter with relaxed atomics
+  unsigned int words;
+  unsigned int failed;
+
+  struct timespec started;
+  MCP2210Counters startCounters;
+
+  pthread_t reporter;
+  pthread_mutex_t lock;
+  // signalled when the upload finishes so the reporter doesn't sleep out its interval
+  pthread_cond_t done;
+  bool finished;
+};
+
+static double Progress_Seconds(const struct timespec *since) {
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (double)(now.tv_sec - since->tv_sec) + (now.tv_nsec - since->tv_nsec) / 1e9;
+}
+
+static void Progress_Print(Progress *progress) {
+  unsigned int words = __atomic_load_n(&progress->words, __ATOMIC_RELAXED);
+  unsigned int failed = __atomic_load_n(&progress->failed, __ATOMIC_RELAXED);
+  double seconds = Progress_Seconds(&progress->started);
+
+  MCP2210Counters counters;
+  MCP2210_GetCounters(&counters);
+
+  double wordRate = seconds > 0 ? words / seconds : 0;
+  double reportRate = seconds > 0 ? (counters.reports - progress->startCounters.reports) / seconds : 0;
+
+  // a streamed upload may not know where it ends
+  if (progress->totalWords == 0) {
+    fprintf(stderr, "progress: %u words, %.0f words/s, %.0f reports/s, %u errors, %llu retries\n",
+            words, wordRate, reportRate, failed,
+            counters.busyRetries - progress->startCounters.busyRetries);
+    return;
+  }
+
+  double eta = wordRate > 0 ? (progress->totalWords - words) / wordRate : 0;
+
+  fprintf(stderr, "progress: %u/%u words (%.1f%%), %.0f words/s, %.0f reports/s, ETA %.0f s, "
+          "%u errors, %llu retries\n",
+          words, progress->totalWords,
+          progress->totalWords > 0 ? 100.0 * words / progress->totalWords : 100.0,
+          wordRate, reportRate, eta, failed,
+          counters.busyRetries - progress->startCounters.busyRetries);
+}
+
+static void * Progress_Reporter(void *arg) {
+  Progress *progress = (Progress *)arg;
+
+  // printing is the opposite of what a real-time uploader wants on its core
+  Realtime_ResetThread();
+
+  pthread_mutex_lock(&progress->lock);
+  while (!progress->finished) {
+    struct timespec wake;
+    clock_gettime(CLOCK_MONOTONIC, &wake);
+    wake.tv_sec += progress->intervalMs / 1000;
+    wake.tv_nsec += (progress->intervalMs % 1000) * 1000000L;
+    if (wake.tv_nsec >= 1000000000L) {
+      wake.tv_sec++;
+      wake.tv_nsec -= 1000000000L;
+    }
+
+    if (pthread_cond_timedwait(&progress->done, &progress->lock, &wake) != 0 && !progress->finished) {
+      Progress_Print(progress);
+    }
+  }
+  pthread_mutex_unlock(&progress->lock);
+  return NULL;
+}
+
+Progress * Progress_Start(unsigned int totalWords, unsigned int intervalMs) {
+  Progress *progress = (Progress *)malloc(sizeof(Progress));
+
+  if (progress == NULL) {
+    fprintf(stderr, "Failed to allocate Progress\n");
+    return NULL;
+  }
+
+  memset(progress, 0, sizeof(*progress));
+  progress->totalWords = totalWords;
+  progress->intervalMs = intervalMs > 0 ? intervalMs : PROGRESS_DEFAULT_INTERVAL_MS;
+  clock_gettime(CLOCK_MONOTONIC, &progress->started);
+  MCP2210_GetCounters(&progress->startCounters);
+
+  // the reporter's deadlines are on the monotonic clock too
+  pthread_condattr_t attr;
+  pthread_condattr_init(&attr);
+  pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+  pthread_cond_init(&progress->done, &attr);
+  pthread_condattr_destroy(&attr);
+  pthread_mutex_init(&progress->lock, NULL);
+
+  if (pthread_create(&progress->reporter, NULL, Progress_Reporter, progress) != 0) {
+    fprintf(stderr, "Failed to start progress thread\n");
+    pthread_cond_destroy(&progress->done);
+    pthread_mutex_destroy(&progress->lock);
+    free(progress);
+    return NULL;
+  }
+  return progress;
+}
+
+void Progress_Add(Progress *progress, unsigned int words, unsigned int failed) {
+  if (progress == NULL) {
+    return;
+  }
+  __atomic_fetch_add(&progress->words, words, __ATOMIC_RELAXED);
+  __atomic_fetch_add(&progress->failed, failed, __ATOMIC_RELAXED);
+}
+
+void Progress_Finish(Progress *progress, FILE *summary) {
+  if (progress == NULL) {
+    return;
+  }
+
+  pthread_mutex_lock(&progress->lock);
+  progress->finished = true;
+  pthread_cond_signal(&progress->done);
+  pthread_mutex_unlock(&progress->lock);
+  pthread_join(progress->reporter, NULL);
+
+  double seconds = Progress_Seconds(&progress->started);
+  MCP2210Counters counters;
+  MCP2210_GetCounters(&counters);
+  unsigned long long reports = counters.reports - progress->startCounters.reports;
+
+  if (summary != NULL) {
+    fprintf(summary, "{\"words\": %u, \"total_words\": %u, \"errors\": %u, \"retries\": %llu, "
+            "\"reports\": %llu, \"seconds\": %.3f, \"words_per_second\": %.1f, "
+            "\"reports_per_second\": %.1f}\n",
+            progress->words, progress->totalWords, progress->failed,
+            counters.busyRetries - progress->startCounters.busyRetries, reports, seconds,
+            seconds > 0 ? progress->words / seconds : 0.0,
+            seconds > 0 ? reports / seconds : 0.0);
+  }
+
+  pthread_cond_destroy(&progress->done);
+  pthread_mutex_destroy(&progress->lock);
+  free(progress);
+}
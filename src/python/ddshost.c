@@ -0,0 +1,408 @@
+/*
+ * MIT License
+ * 
+ * Copyright (c) 2020 Eli Reed
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/*
+ * The ddshost Python extension: uploads waveforms straight from Python buffers, such as
+ * numpy arrays, without going through data files.
+ *
+ *   import ddshost, numpy as np
+ *   with ddshost.open() as dev:
+ *     dev.configure("dac.csv", "mcp.csv")
+ *     dev.upload(np.asarray(words, dtype=np.uint32))       # packed SRAM words
+ *     dev.upload(np.stack([i, q], axis=1).astype(np.int16))  # I/Q pairs
+ *
+ * uint32 buffers are written to the SRAM where they lie. int16 (two's complement) and
+ * uint16 (offset binary, as gen_dac_data.py makes them) buffers hold interleaved I/Q
+ * samples and are packed into words first. Each Device is a DDSDevice (see
+ * dds-host/device.h), so any number of Python threads can share one: the GIL is released
+ * while calls go over USB and the device context's lock keeps them apart. Ctrl-C is
+ * checked between chunks of an upload.
+ */
+
+#define PY_SSIZE_T_CLEAN
+#include <Python.h>
+
+#include <stdbool.h>  // for bool type
+#include <stdint.h>   // for fixed-width integer types
+
+// project libraries
+#include "dds-host/device.h"
+#include "dds-host/cpld.h"
+#include "dds-host/mcp2210-sim.h"
+#include "dds-host/synth.h"
+
+// words written between checks for Ctrl-C
+#define DDSHOST_CHUNK_WORDS     4096
+
+// how the samples in an upload's buffer are laid out
+typedef enum sample_format_t {
+  WordSamples,
+  SignedIQSamples,
+  OffsetIQSamples,
+} SampleFormat;
+
+typedef struct {
+  PyObject_HEAD
+  DDSDevice *dev;
+  // calls in progress with the GIL released, which the device can't be closed under
+  unsigned int users;
+} Device;
+
+static PyObject *DDSHostError;
+
+// checks the device is open and counts a call in. Returns false with an exception set otherwise.
+static bool Device_Claim(Device *self) {
+  if (self->dev == NULL) {
+    PyErr_SetString(DDSHostError, "the device is closed");
+    return false;
+  }
+  self->users++;
+  return true;
+}
+
+static void Device_Release(Device *self) {
+  self->users--;
+}
+
+static void Device_CloseHandle(Device *self) {
+  if (self->dev != NULL) {
+    DDSDevice_Close(self->dev);
+    self->dev = NULL;
+  }
+}
+
+static void Device_Dealloc(Device *self) {
+  Device_CloseHandle(self);
+  Py_TYPE(self)->tp_free((PyObject *)self);
+}
+
+// works out what a buffer holds from its struct-module format. Returns false with an
+// exception set if it's nothing we can upload.
+static bool Device_SampleFormat(const Py_buffer *view, SampleFormat *format) {
+  const char *f = view->format != NULL ? view->format : "B";
+
+  // native and little-endian standard sizes are the same thing here
+  if (*f == '@' || *f == '=' || *f == '<') {
+    f++;
+  }
+
+  if (view->itemsize == 4 && (strcmp(f, "I") == 0 || strcmp(f, "i") == 0 ||
+                              strcmp(f, "L") == 0 || strcmp(f, "l") == 0)) {
+    *format = WordSamples;
+  } else if (view->itemsize == 2 && strcmp(f, "h") == 0) {
+    *format = SignedIQSamples;
+  } else if (view->itemsize == 2 && strcmp(f, "H") == 0) {
+    *format = OffsetIQSamples;
+  } else {
+    PyErr_Format(PyExc_TypeError, "can't upload a buffer of '%s', expected uint32 words or int16/uint16 I/Q",
+                 view->format != NULL ? view->format : "B");
+    return false;
+  }
+
+  if (*format != WordSamples && (view->len / view->itemsize) % 2 != 0) {
+    PyErr_SetString(PyExc_ValueError, "I/Q buffers need an even number of samples");
+    return false;
+  }
+  return true;
+}
+
+// packs 'count' words of interleaved I/Q samples into 'words'
+static void Device_PackIQ(const void *samples, SampleFormat format, unsigned int *words, unsigned int count) {
+  unsigned int k;
+  if (format == SignedIQSamples) {
+    const int16_t *iq = (const int16_t *)samples;
+    for (k = 0; k < count; k++) {
+      words[k] = Synth_Pack((uint16_t)iq[2 * k] ^ 0x8000, (uint16_t)iq[2 * k + 1] ^ 0x8000);
+    }
+  } else {
+    const uint16_t *iq = (const uint16_t *)samples;
+    for (k = 0; k < count; k++) {
+      words[k] = Synth_Pack(iq[2 * k], iq[2 * k + 1]);
+    }
+  }
+}
+
+// asks for Ctrl-C between upload chunks, taking the GIL back every DDSHOST_CHUNK_WORDS
+// words to do it
+static bool Device_KeepGoing(void *ctx, unsigned int done) {
+  unsigned int *lastCheck = (unsigned int *)ctx;
+  if (done - *lastCheck < DDSHOST_CHUNK_WORDS) {
+    return true;
+  }
+  *lastCheck = done;
+
+  PyGILState_STATE state = PyGILState_Ensure();
+  bool keepGoing = PyErr_CheckSignals() == 0;
+  PyGILState_Release(state);
+  return keepGoing;
+}
+
+static PyObject * Device_Upload(Device *self, PyObject *args, PyObject *kwargs) {
+  static char *keywords[] = {"data", "offset", NULL};
+  PyObject *data;
+  unsigned int offset = 0;
+
+  if (!PyArg_ParseTupleAndKeywords(args, kwargs, "O|I", keywords, &data, &offset)) {
+    return NULL;
+  }
+
+  Py_buffer view;
+  if (PyObject_GetBuffer(data, &view, PyBUF_C_CONTIGUOUS | PyBUF_FORMAT) != 0) {
+    return NULL;
+  }
+
+  SampleFormat format;
+  if (!Device_SampleFormat(&view, &format)) {
+    PyBuffer_Release(&view);
+    return NULL;
+  }
+
+  // either way, every 4 bytes of the buffer make one word
+  unsigned long long count = view.len / 4;
+  if (offset > SRAM_MAX_ADDRESS || count > SRAM_MAX_ADDRESS + 1 - offset) {
+    PyErr_Format(PyExc_ValueError, "%llu words don't fit in SRAM from %05x", count, offset);
+    PyBuffer_Release(&view);
+    return NULL;
+  }
+
+  // packed I/Q is at most one SRAM's worth of words
+  unsigned int *packed = NULL;
+  if (format != WordSamples && count > 0) {
+    packed = (unsigned int *)PyMem_Malloc(count * sizeof(unsigned int));
+    if (packed == NULL) {
+      PyBuffer_Release(&view);
+      return PyErr_NoMemory();
+    }
+  }
+
+  if (!Device_Claim(self)) {
+    PyMem_Free(packed);
+    PyBuffer_Release(&view);
+    return NULL;
+  }
+
+  const unsigned int *words = format == WordSamples ? (const unsigned int *)view.buf : packed;
+  unsigned int lastCheck = 0;
+  unsigned int failed;
+
+  // the device context tags whole images from address 0, as dds-host --data does
+  Py_BEGIN_ALLOW_THREADS
+  if (format != WordSamples) {
+    Device_PackIQ(view.buf, format, packed, (unsigned int)count);
+  }
+  failed = DDSDevice_UploadUntil(self->dev, offset, words, (unsigned int)count, NULL,
+                                 Device_KeepGoing, &lastCheck);
+  Py_END_ALLOW_THREADS
+
+  Device_Release(self);
+  PyMem_Free(packed);
+  PyBuffer_Release(&view);
+
+  if (PyErr_Occurred()) {
+    return NULL;
+  }
+  if (failed != 0) {
+    PyErr_Format(DDSHostError, "%u of %llu words failed to write", failed, count);
+    return NULL;
+  }
+  return PyLong_FromUnsignedLongLong(count);
+}
+
+static PyObject * Device_ReadSRAM(Device *self, PyObject *args, PyObject *kwargs) {
+  static char *keywords[] = {"addr", "count", NULL};
+  unsigned int addr, count;
+
+  if (!PyArg_ParseTupleAndKeywords(args, kwargs, "II", keywords, &addr, &count)) {
+    return NULL;
+  }
+
+  if (count == 0 || addr > SRAM_MAX_ADDRESS || count > SRAM_MAX_ADDRESS + 1 - addr) {
+    PyErr_Format(PyExc_ValueError, "can't read %u words from %05x", count, addr);
+    return NULL;
+  }
+
+  // read straight into the bytes object that's returned
+  PyObject *out = PyBytes_FromStringAndSize(NULL, (Py_ssize_t)count * sizeof(unsigned int));
+  if (out == NULL) {
+    return NULL;
+  }
+
+  if (!Device_Claim(self)) {
+    Py_DECREF(out);
+    return NULL;
+  }
+
+  bool ok;
+  unsigned int *words = (unsigned int *)PyBytes_AS_STRING(out);
+  Py_BEGIN_ALLOW_THREADS
+  ok = DDSDevice_ReadSRAM(self->dev, addr, words, count);
+  Py_END_ALLOW_THREADS
+  Device_Release(self);
+
+  if (!ok) {
+    Py_DECREF(out);
+    PyErr_SetString(DDSHostError, "SRAM readback failed");
+    return NULL;
+  }
+  return out;
+}
+
+static PyObject * Device_Configure(Device *self, PyObject *args, PyObject *kwargs) {
+  static char *keywords[] = {"dac_config", "mcp_config", "cold", NULL};
+  const char *dacFileName, *mcpFileName;
+  int cold = 0;
+
+  if (!PyArg_ParseTupleAndKeywords(args, kwargs, "ss|p", keywords, &dacFileName, &mcpFileName, &cold)) {
+    return NULL;
+  }
+
+  if (!Device_Claim(self)) {
+    return NULL;
+  }
+
+  bool ok;
+  Py_BEGIN_ALLOW_THREADS
+  ok = DDSDevice_Configure(self->dev, dacFileName, mcpFileName, cold);
+  Py_END_ALLOW_THREADS
+  Device_Release(self);
+
+  if (!ok) {
+    PyErr_SetString(DDSHostError, "configuring the board failed");
+    return NULL;
+  }
+  Py_RETURN_NONE;
+}
+
+static PyObject * Device_Close(Device *self, PyObject *unused) {
+  if (self->users > 0) {
+    PyErr_SetString(DDSHostError, "the device is in use by another thread");
+    return NULL;
+  }
+  Device_CloseHandle(self);
+  Py_RETURN_NONE;
+}
+
+static PyObject * Device_Enter(Device *self, PyObject *unused) {
+  Py_INCREF(self);
+  return (PyObject *)self;
+}
+
+static PyObject * Device_Exit(Device *self, PyObject *args) {
+  return Device_Close(self, NULL);
+}
+
+static PyMethodDef Device_Methods[] = {
+  {"configure", (PyCFunction)(void (*)(void))Device_Configure, METH_VARARGS | METH_KEYWORDS,
+   "configure(dac_config, mcp_config, cold=False)\n--\n\n"
+   "Configures the DAC and MCP2210 from their config files, as dds-host does."},
+  {"upload", (PyCFunction)(void (*)(void))Device_Upload, METH_VARARGS | METH_KEYWORDS,
+   "upload(data, offset=0)\n--\n\n"
+   "Writes a buffer of uint32 SRAM words, or of interleaved int16/uint16 I/Q samples, to the\n"
+   "SRAM from 'offset' on. Returns the number of words written."},
+  {"read_sram", (PyCFunction)(void (*)(void))Device_ReadSRAM, METH_VARARGS | METH_KEYWORDS,
+   "read_sram(addr, count)\n--\n\n"
+   "Reads 'count' SRAM words from 'addr', as bytes of native uint32s."},
+  {"close", (PyCFunction)Device_Close, METH_NOARGS, "Closes the device."},
+  {"__enter__", (PyCFunction)Device_Enter, METH_NOARGS, NULL},
+  {"__exit__", (PyCFunction)Device_Exit, METH_VARARGS, NULL},
+  {NULL, NULL, 0, NULL},
+};
+
+static PyTypeObject DeviceType = {
+  PyVarObject_HEAD_INIT(NULL, 0)
+  .tp_name = "ddshost.Device",
+  .tp_doc = "An open DDS-AWG board, from ddshost.open().",
+  .tp_basicsize = sizeof(Device),
+  .tp_flags = Py_TPFLAGS_DEFAULT,
+  .tp_dealloc = (destructor)Device_Dealloc,
+  .tp_methods = Device_Methods,
+};
+
+static PyObject * DDSHost_Open(PyObject *module, PyObject *args, PyObject *kwargs) {
+  static char *keywords[] = {"serial", "sim", "report_latency_us", NULL};
+  const char *serial = NULL;
+  int sim = 0;
+  unsigned int reportLatencyUs = MCP2210SIM_DEFAULT_LATENCY_US;
+
+  if (!PyArg_ParseTupleAndKeywords(args, kwargs, "|zpI", keywords, &serial, &sim, &reportLatencyUs)) {
+    return NULL;
+  }
+
+  Device *self = PyObject_New(Device, &DeviceType);
+  if (self == NULL) {
+    return NULL;
+  }
+  self->dev = NULL;
+  self->users = 0;
+
+  Py_BEGIN_ALLOW_THREADS
+  self->dev = sim ? DDSDevice_OpenSim(reportLatencyUs) : DDSDevice_Open(serial);
+  Py_END_ALLOW_THREADS
+
+  if (self->dev == NULL) {
+    Py_DECREF(self);
+    PyErr_SetString(DDSHostError, "couldn't open the MCP2210");
+    return NULL;
+  }
+  return (PyObject *)self;
+}
+
+static PyMethodDef DDSHost_Methods[] = {
+  {"open", (PyCFunction)(void (*)(void))DDSHost_Open, METH_VARARGS | METH_KEYWORDS,
+   "open(serial=None, sim=False, report_latency_us=...)\n--\n\n"
+   "Opens the attached board with the given USB serial number (the first one found if\n"
+   "None), or with sim=True a new simulated one, and returns a Device."},
+  {NULL, NULL, 0, NULL},
+};
+
+static struct PyModuleDef DDSHost_Module = {
+  PyModuleDef_HEAD_INIT,
+  .m_name = "ddshost",
+  .m_doc = "Uploads waveforms to the DDS-AWG straight from Python buffers.",
+  .m_size = -1,
+  .m_methods = DDSHost_Methods,
+};
+
+PyMODINIT_FUNC PyInit_ddshost(void) {
+  if (PyType_Ready(&DeviceType) < 0) {
+    return NULL;
+  }
+
+  PyObject *module = PyModule_Create(&DDSHost_Module);
+  if (module == NULL) {
+    return NULL;
+  }
+
+  DDSHostError = PyErr_NewException("ddshost.Error", PyExc_RuntimeError, NULL);
+  Py_INCREF(DDSHostError);
+  Py_INCREF(&DeviceType);
+  if (PyModule_AddObject(module, "Error", DDSHostError) < 0 ||
+      PyModule_AddObject(module, "Device", (PyObject *)&DeviceType) < 0) {
+    Py_DECREF(DDSHostError);
+    Py_DECREF(&DeviceType);
+    Py_DECREF(module);
+    return NULL;
+  }
+  return module;
+}
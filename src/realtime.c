@@ -0,0 +1,154 @@
+/*
+ * MIT License
+ * 
+ * Copyright (c) 2020 Eli Reed
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE   // for pthread_setaffinity_np() and CPU_SET()
+#endif
+
+#include <stdio.h>    // for fprintf()
+#include <stdbool.h>  // for bool type
+#include <string.h>   // for memset(), strerror()
+#include <errno.h>    // for errno
+#include <math.h>     // for sqrt()
+#include <pthread.h>  // for pthread_setschedparam()
+#include <sched.h>    // for SCHED_FIFO, cpu_set_t
+#include <sys/mman.h> // for mlockall()
+
+// project libraries
+#include "dds-host/realtime.h"
+
+bool Realtime_LockMemory(void) {
+  if (mlockall(MCL_CURRENT | MCL_FUTURE) != 0) {
+    fprintf(stderr, "Realtime_LockMemory()->mlockall() failed: %s\n", strerror(errno));
+    return false;
+  }
+  return true;
+}
+
+bool Realtime_SetThread(pthread_t thread, int cpu, int priority) {
+  if (cpu != REALTIME_NO_CPU) {
+    cpu_set_t cpus;
+    CPU_ZERO(&cpus);
+    CPU_SET(cpu, &cpus);
+
+    int res = pthread_setaffinity_np(thread, sizeof(cpus), &cpus);
+    if (res != 0) {
+      fprintf(stderr, "Realtime_SetThread()->pthread_setaffinity_np() failed for cpu %d: %s\n",
+              cpu, strerror(res));
+      return false;
+    }
+  }
+
+  struct sched_param param;
+  memset(&param, 0, sizeof(param));
+  param.sched_priority = priority;
+
+  int res = pthread_setschedparam(thread, SCHED_FIFO, &param);
+  if (res != 0) {
+    fprintf(stderr, "Realtime_SetThread()->pthread_setschedparam() failed: %s\n", strerror(res));
+    return false;
+  }
+  return true;
+}
+
+void Realtime_ResetThread(void) {
+  int policy;
+  struct sched_param param;
+
+  // leave threads that were never made real-time (or pinned with taskset) alone
+  if (pthread_getschedparam(pthread_self(), &policy, &param) != 0 || policy != SCHED_FIFO) {
+    return;
+  }
+
+  memset(&param, 0, sizeof(param));
+  pthread_setschedparam(pthread_self(), SCHED_OTHER, &param);
+
+  cpu_set_t cpus;
+  CPU_ZERO(&cpus);
+  int cpu;
+  for (cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+    CPU_SET(cpu, &cpus);
+  }
+  pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus);
+}
+
+void Jitter_Reset(Jitter *jitter) {
+  memset(jitter, 0, sizeof(*jitter));
+  jitter->minNs = ~0ULL;
+}
+
+void Jitter_Record(Jitter *jitter, unsigned long long ns) {
+  unsigned long long us = ns / 1000;
+  jitter->buckets[us < JITTER_BUCKETS ? us : JITTER_BUCKETS - 1]++;
+
+  jitter->count++;
+  jitter->totalNs += ns;
+  jitter->sumSquaresUs += (double)ns * (double)ns / 1e6;
+  if (ns < jitter->minNs) {
+    jitter->minNs = ns;
+  }
+  if (ns > jitter->maxNs) {
+    jitter->maxNs = ns;
+  }
+}
+
+// the smallest bucket (in us) at or below which 'fraction' of the round trips fall
+static unsigned int Jitter_Percentile(const Jitter *jitter, double fraction) {
+  unsigned long long target = (unsigned long long)(fraction * jitter->count);
+  unsigned long long seen = 0;
+  unsigned int us;
+
+  for (us = 0; us < JITTER_BUCKETS - 1; us++) {
+    seen += jitter->buckets[us];
+    if (seen > target) {
+      break;
+    }
+  }
+  return us;
+}
+
+void Jitter_Print(const Jitter *jitter, const char *label, FILE *out) {
+  if (jitter->count == 0) {
+    fprintf(out, "%s: nothing recorded\n", label);
+    return;
+  }
+
+  double meanUs = (double)jitter->totalNs / jitter->count / 1000.0;
+  double variance = jitter->sumSquaresUs / jitter->count - meanUs * meanUs;
+
+  fprintf(out, "%s: %llu samples, min %llu us, mean %.1f us, max %llu us, stddev %.1f us\n",
+          label, jitter->count, jitter->minNs / 1000, meanUs, jitter->maxNs / 1000,
+          variance > 0 ? sqrt(variance) : 0.0);
+
+  // percentiles past the last bucket are only known to be at least that slow
+  const double fractions[] = {0.5, 0.9, 0.99, 0.999};
+  const char *names[] = {"p50", "p90", "p99", "p99.9"};
+  unsigned int i;
+  fprintf(out, "%s:", label);
+  for (i = 0; i < sizeof(fractions) / sizeof(fractions[0]); i++) {
+    unsigned int us = Jitter_Percentile(jitter, fractions[i]);
+    fprintf(out, " %s %s%u us", names[i], us == JITTER_BUCKETS - 1 ? ">=" : "", us);
+  }
+  fprintf(out, "\n");
+}
@@ -0,0 +1,311 @@
+/*
+ * MIT License
+ * 
+ * Copyright (c) 2020 Eli Reed
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <stdio.h>      // for fopen(), fwrite(), fprintf()
+#include <stdlib.h>     // for malloc(), free()
+#include <stdbool.h>    // for bool type
+#include <stdint.h>     // for fixed-width integer types
+#include <string.h>     // for memcmp(), memcpy(), memset()
+#include <fcntl.h>      // for open()
+#include <unistd.h>     // for close()
+#include <sys/mman.h>   // for mmap()
+#include <sys/stat.h>   // for fstat()
+
+// HIDAPI
+#include "hidapi/hidapi.h"
+
+// project libraries
+#include "dds-host/report-stream.h"
+#include "dds-host/cache.h"
+#include "dds-host/cpld.h"
+#include "dds-host/host.h"
+#include "dds-host/mcp2210.h"
+#include "dds-host/progress.h"
+#include "dds-host/util/bytes.h"
+#include "dds-host/util/hash.h"
+
+
+// words compiled per write
+#define REPORTSTREAM_CHUNK_WORDS    256
+
+// SPI engine status once a transfer has finished
+#define SPI_ENGINE_FINISHED         0x10
+
+// status of a SpiDataTransfer the chip was too busy to take
+#define MCP2210_BUSY                0xF8
+
+// same limit on attempts per transfer as MCP2210_SpiDataTransfer()
+#define REPORTSTREAM_MAX_ATTEMPTS   1000
+
+void ReportStream_SettingsReport(uint8_t *report, uint8_t spiMode) {
+  MCP2210SPITransferSettings spiSettings;
+  memset(&spiSettings, 0, sizeof(spiSettings));
+  spiSettings.SPIMode = spiMode;
+  CPLD_SRAMSpiSettings(&spiSettings);
+  MCP2210_EncodeSpiSettings(report, &spiSettings, true);
+}
+
+void ReportStream_EncodeWord(uint8_t *reports, unsigned int addr, unsigned int word) {
+  memset(reports, 0, MCP2210_REPORT_LEN);
+  reports[0] = SpiDataTransfer;
+  reports[1] = SRAM_PACKET_SIZE;
+  CPLD_EncodePacket(&reports[4], addr, false, word);
+}
+
+bool ReportStream_Compile(const char *fileName, unsigned int startAddr, const unsigned int *words, unsigned int count) {
+  if (fileName == NULL || words == NULL) {
+    fprintf(stderr, "fileName and words can't be null\n");
+    return false;
+  }
+
+  if (startAddr > SRAM_MAX_ADDRESS || count > SRAM_MAX_ADDRESS + 1 - startAddr) {
+    fprintf(stderr, "range is out of range\n");
+    return false;
+  }
+
+  FILE *file = fopen(fileName, "wb");
+
+  if (file == NULL) {
+    fprintf(stderr, "Failed to create report stream %s\n", fileName);
+    return false;
+  }
+
+  uint8_t *chunk = (uint8_t *)malloc(REPORTSTREAM_CHUNK_WORDS * REPORTSTREAM_WORD_LEN);
+  if (chunk == NULL) {
+    fprintf(stderr, "Failed to allocate report stream buffer\n");
+    fclose(file);
+    return false;
+  }
+
+  // the header is rewritten once the report hash is known
+  uint8_t header[REPORTSTREAM_HEADER_LEN];
+  memset(header, 0, sizeof(header));
+  bool ok = fwrite(header, 1, sizeof(header), file) == sizeof(header);
+
+  uint8_t settings[MCP2210_REPORT_LEN];
+  ReportStream_SettingsReport(settings, 0);
+  ok = ok && fwrite(settings, 1, sizeof(settings), file) == sizeof(settings);
+
+  uint64_t reportHash = Hash_FNV1a64(HASH_FNV1A64_INIT, settings, sizeof(settings));
+  unsigned int done = 0;
+  while (ok && done < count) {
+    unsigned int n = count - done < REPORTSTREAM_CHUNK_WORDS ? count - done : REPORTSTREAM_CHUNK_WORDS;
+    unsigned int i;
+    for (i = 0; i < n; i++) {
+      ReportStream_EncodeWord(&chunk[i * REPORTSTREAM_WORD_LEN], startAddr + done + i, words[done + i]);
+    }
+    reportHash = Hash_FNV1a64(reportHash, chunk, n * REPORTSTREAM_WORD_LEN);
+    ok = fwrite(chunk, REPORTSTREAM_WORD_LEN, n, file) == n;
+    done += n;
+  }
+  free(chunk);
+
+  ImageTag tag;
+  Cache_TagWords(words, startAddr, count, &tag);
+
+  memcpy(header, REPORTSTREAM_MAGIC, REPORTSTREAM_MAGIC_LEN);
+  Bytes_PutLE(&header[8], tag.startAddr, 4);
+  Bytes_PutLE(&header[12], tag.numWords, 4);
+  Bytes_PutLE(&header[16], tag.hash, 8);
+  Bytes_PutLE(&header[24], reportHash, 8);
+  Bytes_PutLE(&header[32], Hash_FNV1a64(HASH_FNV1A64_INIT, header, 32), 8);
+
+  ok = ok && fseek(file, 0, SEEK_SET) == 0 && fwrite(header, 1, sizeof(header), file) == sizeof(header);
+  ok = (fclose(file) == 0) && ok;
+
+  if (!ok) {
+    fprintf(stderr, "Failed to write report stream %s\n", fileName);
+  }
+  return ok;
+}
+
+ReportStream * ReportStream_Open(const char *fileName) {
+  int fd = open(fileName, O_RDONLY);
+
+  if (fd < 0) {
+    fprintf(stderr, "Failed to open report stream %s\n", fileName);
+    return NULL;
+  }
+
+  struct stat st;
+  if (fstat(fd, &st) != 0 || (size_t)st.st_size < REPORTSTREAM_HEADER_LEN + MCP2210_REPORT_LEN) {
+    fprintf(stderr, "%s isn't a report stream\n", fileName);
+    close(fd);
+    return NULL;
+  }
+
+  void *mapping = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+
+  if (mapping == MAP_FAILED) {
+    fprintf(stderr, "Failed to map report stream %s\n", fileName);
+    return NULL;
+  }
+
+  const uint8_t *header = (const uint8_t *)mapping;
+  size_t len = (size_t)st.st_size;
+
+  // the last byte of the magic is the version
+  if (memcmp(header, REPORTSTREAM_MAGIC, REPORTSTREAM_MAGIC_LEN - 1) == 0 &&
+      header[REPORTSTREAM_MAGIC_LEN - 1] != (uint8_t)REPORTSTREAM_MAGIC[REPORTSTREAM_MAGIC_LEN - 1]) {
+    fprintf(stderr, "%s is a version %u report stream, compile it again\n", fileName,
+            header[REPORTSTREAM_MAGIC_LEN - 1]);
+    munmap(mapping, len);
+    return NULL;
+  }
+
+  if (memcmp(header, REPORTSTREAM_MAGIC, REPORTSTREAM_MAGIC_LEN) != 0) {
+    fprintf(stderr, "%s isn't a report stream\n", fileName);
+    munmap(mapping, len);
+    return NULL;
+  }
+
+  ImageTag tag;
+  tag.startAddr = (unsigned int)Bytes_GetLE(&header[8], 4);
+  tag.numWords = (unsigned int)Bytes_GetLE(&header[12], 4);
+  tag.hash = Bytes_GetLE(&header[16], 8);
+
+  if (Bytes_GetLE(&header[32], 8) != Hash_FNV1a64(HASH_FNV1A64_INIT, header, 32) ||
+      tag.startAddr > SRAM_MAX_ADDRESS || tag.numWords > SRAM_MAX_ADDRESS + 1 - tag.startAddr ||
+      len != REPORTSTREAM_HEADER_LEN + MCP2210_REPORT_LEN + (size_t)tag.numWords * REPORTSTREAM_WORD_LEN ||
+      Bytes_GetLE(&header[24], 8) !=
+          Hash_FNV1a64(HASH_FNV1A64_INIT, header + REPORTSTREAM_HEADER_LEN, len - REPORTSTREAM_HEADER_LEN)) {
+    fprintf(stderr, "report stream %s is corrupt\n", fileName);
+    munmap(mapping, len);
+    return NULL;
+  }
+
+  ReportStream *stream = (ReportStream *)malloc(sizeof(ReportStream));
+  if (stream == NULL) {
+    fprintf(stderr, "Failed to allocate report stream\n");
+    munmap(mapping, len);
+    return NULL;
+  }
+
+  stream->tag = tag;
+  stream->settings = header + REPORTSTREAM_HEADER_LEN;
+  stream->reports = stream->settings + MCP2210_REPORT_LEN;
+  stream->mapping = mapping;
+  stream->mappingLen = len;
+
+  // replay reads it front to back exactly once
+  madvise(mapping, len, MADV_SEQUENTIAL);
+  return stream;
+}
+
+// sends one SpiDataTransfer report, resending it while the chip is busy and polling
+// until the SPI engine finishes. Returns false on failure, true otherwise.
+static bool ReportStream_Transfer(hid_device *handle, const uint8_t *transfer) {
+  // once the packet is accepted the rest of the transfer is polled for with empty ones
+  static const uint8_t poll[MCP2210_REPORT_LEN] = {SpiDataTransfer};
+  uint8_t rxBuf[MCP2210_REPORT_LEN];
+  const uint8_t *txBuf = transfer;
+
+  unsigned int attempts;
+  for (attempts = 0; attempts < REPORTSTREAM_MAX_ATTEMPTS; attempts++) {
+    int res = MCP2210_Transact(handle, txBuf, rxBuf);
+
+    if (res == 0x00) {
+      if (rxBuf[3] == SPI_ENGINE_FINISHED) {
+        return true;
+      }
+      txBuf = poll;
+    } else if (res != MCP2210_BUSY) {
+      return false;
+    }
+  }
+  fprintf(stderr, "SPI transfer timed out\n");
+  return false;
+}
+
+bool ReportStream_SendSettings(hid_device *handle, const uint8_t *settings) {
+  uint8_t rxBuf[MCP2210_REPORT_LEN];
+  if (MCP2210_Transact(handle, settings, rxBuf) != 0x00) {
+    fprintf(stderr, "Failed to write the report stream's SPI settings\n");
+    return false;
+  }
+  return true;
+}
+
+bool ReportStream_SendWord(hid_device *handle, const uint8_t *reports) {
+  return ReportStream_Transfer(handle, reports);
+}
+
+unsigned int ReportStream_Replay(hid_device *handle, const ReportStream *stream, Progress *progress) {
+  if (handle == NULL || stream == NULL) {
+    fprintf(stderr, "handle and stream can't be null\n");
+    return stream == NULL ? 0 : stream->tag.numWords;
+  }
+
+  unsigned int count = stream->tag.numWords;
+
+  if (count == 0) {
+    return 0;
+  }
+
+  MCP2210SPITransferSettings spiSettings;
+  if (!CPLD_SetupBus(handle, &spiSettings)) {
+    return count;
+  }
+
+  // the stream only works if the board would have been sent the same settings
+  uint8_t expected[MCP2210_REPORT_LEN];
+  ReportStream_SettingsReport(expected, spiSettings.SPIMode);
+  if (memcmp(expected, stream->settings, MCP2210_REPORT_LEN) != 0) {
+    fprintf(stderr, "the board is in SPI mode %u, which this report stream wasn't compiled for\n",
+            spiSettings.SPIMode);
+    return count;
+  }
+
+  if (!ReportStream_SendSettings(handle, stream->settings)) {
+    return count;
+  }
+
+  unsigned int i;
+  unsigned int failures = 0;
+  for (i = 0; i < count; i++) {
+    if (Host_CancelRequested()) {
+      fprintf(stderr, "replay cancelled after %u of %u words\n", i, count);
+      return failures + count - i;
+    }
+
+    bool ok = ReportStream_SendWord(handle, &stream->reports[(size_t)i * REPORTSTREAM_WORD_LEN]);
+    if (!ok) {
+      fprintf(stderr, "Replay() failed for addr: %u\n", stream->tag.startAddr + i);
+      failures++;
+    }
+
+    if (progress != NULL) {
+      Progress_Add(progress, 1, ok ? 0 : 1);
+    }
+  }
+  return failures;
+}
+
+void ReportStream_Close(ReportStream *stream) {
+  if (stream != NULL) {
+    munmap(stream->mapping, stream->mappingLen);
+    free(stream);
+  }
+}
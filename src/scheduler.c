@@ -0,0 +1,246 @@
+/*
+ * MIT License
+ * 
+ * Copyright (c) 2020 Eli Reed
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <stdio.h>    // for fprintf()
+#include <stdlib.h>   // for malloc(), free()
+#include <stdbool.h>  // for bool type
+#include <string.h>   // for memset()
+#include <pthread.h>  // for pthread_*()
+#include <time.h>     // for clock_gettime()
+
+// HIDAPI
+#include "hidapi/hidapi.h"
+
+// project libraries
+#include "dds-host/scheduler.h"
+#include "dds-host/realtime.h"
+
+struct scheduler_st {
+  hid_device *handle;
+  unsigned int sliceRecords;
+
+  pthread_t worker;
+  pthread_mutex_t lock;
+  // signalled when a job is queued or the scheduler stops
+  pthread_cond_t queued;
+  // broadcast whenever a job finishes
+  pthread_cond_t finished;
+  bool running;
+  bool stopping;
+
+  // FIFO queues, one per class
+  TransferJob *head[NUM_TRANSFER_CLASSES];
+  TransferJob *tail[NUM_TRANSFER_CLASSES];
+
+  SchedulerStats stats[NUM_TRANSFER_CLASSES];
+};
+
+static unsigned long long Scheduler_ElapsedNs(const struct timespec *since) {
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  long long ns = (now.tv_sec - since->tv_sec) * 1000000000LL + (now.tv_nsec - since->tv_nsec);
+  return ns > 0 ? (unsigned long long)ns : 0;
+}
+
+// must be called with the lock held
+static void Scheduler_Finish(Scheduler *sched, TransferClass cls, bool ok) {
+  TransferJob *job = sched->head[cls];
+  sched->head[cls] = job->next;
+  if (sched->head[cls] == NULL) {
+    sched->tail[cls] = NULL;
+  }
+  job->ok = ok;
+  job->finished = true;
+  pthread_cond_broadcast(&sched->finished);
+}
+
+static void * Scheduler_Worker(void *arg) {
+  Scheduler *sched = (Scheduler *)arg;
+
+  pthread_mutex_lock(&sched->lock);
+  while (!sched->stopping) {
+    // control jobs always go first
+    TransferClass cls;
+    if (sched->head[ControlClass] != NULL) {
+      cls = ControlClass;
+    } else if (sched->head[BulkClass] != NULL) {
+      cls = BulkClass;
+    } else {
+      pthread_cond_wait(&sched->queued, &sched->lock);
+      continue;
+    }
+
+    TransferJob *job = sched->head[cls];
+    if (!job->started) {
+      unsigned long long waitNs = Scheduler_ElapsedNs(&job->submitted);
+      job->started = true;
+      sched->stats[cls].jobs++;
+      sched->stats[cls].totalQueueNs += waitNs;
+      if (waitNs > sched->stats[cls].maxQueueNs) {
+        sched->stats[cls].maxQueueNs = waitNs;
+      }
+      if (cls == ControlClass && sched->head[BulkClass] != NULL && sched->head[BulkClass]->started) {
+        sched->stats[BulkClass].preemptions++;
+      }
+    }
+    pthread_mutex_unlock(&sched->lock);
+
+    // the device is only ever touched here, outside the lock
+    bool done = false;
+    bool ok = job->step(sched->handle, job->arg, sched->sliceRecords, &done);
+
+    pthread_mutex_lock(&sched->lock);
+    if (!ok || done) {
+      Scheduler_Finish(sched, cls, ok);
+    }
+  }
+
+  // fail anything still queued
+  TransferClass cls;
+  for (cls = ControlClass; cls < NUM_TRANSFER_CLASSES; cls++) {
+    while (sched->head[cls] != NULL) {
+      Scheduler_Finish(sched, cls, false);
+    }
+  }
+  pthread_mutex_unlock(&sched->lock);
+  return NULL;
+}
+
+Scheduler * Scheduler_Create(hid_device *handle, unsigned int sliceRecords) {
+  if (handle == NULL) {
+    fprintf(stderr, "handle can't be null\n");
+    return NULL;
+  }
+
+  Scheduler *sched = (Scheduler *)malloc(sizeof(Scheduler));
+
+  if (sched == NULL) {
+    fprintf(stderr, "Failed to allocate Scheduler\n");
+    return NULL;
+  }
+
+  memset(sched, 0, sizeof(*sched));
+  sched->handle = handle;
+  sched->sliceRecords = sliceRecords ? sliceRecords : SCHEDULER_DEFAULT_SLICE;
+
+  pthread_mutex_init(&sched->lock, NULL);
+  pthread_cond_init(&sched->queued, NULL);
+  pthread_cond_init(&sched->finished, NULL);
+
+  if (pthread_create(&sched->worker, NULL, Scheduler_Worker, sched) != 0) {
+    fprintf(stderr, "Scheduler_Create()->pthread_create() failed\n");
+    pthread_cond_destroy(&sched->finished);
+    pthread_cond_destroy(&sched->queued);
+    pthread_mutex_destroy(&sched->lock);
+    free(sched);
+    return NULL;
+  }
+  sched->running = true;
+  return sched;
+}
+
+bool Scheduler_SetRealtime(Scheduler *sched, int cpu, int priority) {
+  if (sched == NULL || !sched->running) {
+    fprintf(stderr, "scheduler isn't running\n");
+    return false;
+  }
+  return Realtime_SetThread(sched->worker, cpu, priority);
+}
+
+bool Scheduler_Run(Scheduler *sched, TransferJob *job) {
+  if (sched == NULL || job == NULL || job->step == NULL) {
+    fprintf(stderr, "scheduler, job and step can't be null\n");
+    return false;
+  }
+
+  if (job->cls != ControlClass && job->cls != BulkClass) {
+    fprintf(stderr, "unknown transfer class %d\n", job->cls);
+    return false;
+  }
+
+  job->ok = false;
+  job->finished = false;
+  job->started = false;
+  job->next = NULL;
+  clock_gettime(CLOCK_MONOTONIC, &job->submitted);
+
+  pthread_mutex_lock(&sched->lock);
+  if (sched->stopping) {
+    pthread_mutex_unlock(&sched->lock);
+    return false;
+  }
+
+  if (sched->tail[job->cls] == NULL) {
+    sched->head[job->cls] = job;
+  } else {
+    sched->tail[job->cls]->next = job;
+  }
+  sched->tail[job->cls] = job;
+  pthread_cond_signal(&sched->queued);
+
+  while (!job->finished) {
+    pthread_cond_wait(&sched->finished, &sched->lock);
+  }
+  pthread_mutex_unlock(&sched->lock);
+  return job->ok;
+}
+
+void Scheduler_GetStats(Scheduler *sched, TransferClass cls, SchedulerStats *stats) {
+  if (sched == NULL || stats == NULL || (cls != ControlClass && cls != BulkClass)) {
+    return;
+  }
+
+  pthread_mutex_lock(&sched->lock);
+  *stats = sched->stats[cls];
+  pthread_mutex_unlock(&sched->lock);
+}
+
+void Scheduler_Stop(Scheduler *sched) {
+  if (sched == NULL) {
+    return;
+  }
+
+  pthread_mutex_lock(&sched->lock);
+  bool join = sched->running;
+  sched->running = false;
+  sched->stopping = true;
+  pthread_cond_signal(&sched->queued);
+  pthread_mutex_unlock(&sched->lock);
+
+  if (join) {
+    pthread_join(sched->worker, NULL);
+  }
+}
+
+void Scheduler_Destroy(Scheduler *sched) {
+  if (sched == NULL) {
+    return;
+  }
+
+  Scheduler_Stop(sched);
+  pthread_cond_destroy(&sched->finished);
+  pthread_cond_destroy(&sched->queued);
+  pthread_mutex_destroy(&sched->lock);
+  free(sched);
+}
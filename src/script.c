@@ -0,0 +1,406 @@
+/*
+ * MIT License
+ * 
+ * Copyright (c) 2020 Eli Reed
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <stdio.h>    // for fopen(), fgets(), printf()
+#include <stdlib.h>   // for malloc(), free(), strtoul()
+#include <stdbool.h>  // for bool type
+#include <string.h>   // for strtok(), strcmp(), memcpy()
+#include <unistd.h>   // for usleep()
+
+// HIDAPI
+#include "hidapi/hidapi.h"
+
+// project libraries
+#include "dds-host/script.h"
+#include "dds-host/cache.h"
+#include "dds-host/mcp2210.h"
+#include "dds-host/dac5687.h"
+#include "dds-host/cpld.h"
+#include "dds-host/image.h"
+
+#define MAX_SCRIPT_LINE       1024
+
+// how many SRAM mismatches verify prints before it just counts them
+#define MAX_REPORTED_MISMATCHES   8
+
+typedef enum script_op_type_t {
+  DACWriteOp,
+  DACReadOp,
+  LoadOp,
+  VerifyOp,
+  GPIOOp,
+  SleepOp,
+} ScriptOpType;
+
+typedef struct script_op_st {
+  ScriptOpType type;
+  unsigned int line;
+  // register, SRAM address, GPIO value or sleep time
+  unsigned int arg;
+  // register count for dac-read
+  unsigned int count;
+  // register bytes for dac-write
+  unsigned char bytes[DAC5687_NUM_REGISTERS];
+  // data for load and verify
+  SRAMImage *image;
+} ScriptOp;
+
+typedef struct script_st {
+  ScriptOp *ops;
+  unsigned int numOps;
+} Script;
+
+static bool Script_ParseNumber(const char *tok, int base, unsigned int max, unsigned int *out) {
+  if (tok == NULL) {
+    return false;
+  }
+
+  char *end;
+  unsigned long value = strtoul(tok, &end, base);
+  if (end == tok || *end != '\0' || value > max) {
+    return false;
+  }
+  *out = (unsigned int)value;
+  return true;
+}
+
+// parses the tokens after the op name. 'op->type' and 'op->line' are already set.
+static bool Script_ParseOp(ScriptOp *op) {
+  const char *tok;
+  unsigned int value;
+
+  switch (op->type) {
+    case (DACWriteOp):
+      if (!Script_ParseNumber(strtok(NULL, " \t\r\n"), 16, DAC5687_NUM_REGISTERS - 1, &op->arg)) {
+        return false;
+      }
+      while ((tok = strtok(NULL, " \t\r\n")) != NULL) {
+        if (op->arg + op->count >= DAC5687_NUM_REGISTERS || !Script_ParseNumber(tok, 16, 0xFF, &value)) {
+          return false;
+        }
+        op->bytes[op->count++] = (unsigned char)value;
+      }
+      return op->count > 0;
+    case (DACReadOp):
+      if (!Script_ParseNumber(strtok(NULL, " \t\r\n"), 16, DAC5687_NUM_REGISTERS - 1, &op->arg)) {
+        return false;
+      }
+      op->count = 1;
+      tok = strtok(NULL, " \t\r\n");
+      if (tok != NULL && !Script_ParseNumber(tok, 10, DAC5687_NUM_REGISTERS - op->arg, &op->count)) {
+        return false;
+      }
+      return op->count > 0;
+    case (LoadOp):
+    case (VerifyOp):
+      tok = strtok(NULL, " \t\r\n");
+      if (tok == NULL) {
+        return false;
+      }
+      op->image = Image_Load(tok);
+      if (op->image == NULL) {
+        return false;
+      }
+      tok = strtok(NULL, " \t\r\n");
+      if (tok != NULL && !Script_ParseNumber(tok, 16, SRAM_MAX_ADDRESS, &op->arg)) {
+        return false;
+      }
+      if (op->image->numWords > SRAM_MAX_ADDRESS + 1 - op->arg) {
+        fprintf(stderr, "data doesn't fit in SRAM starting at %#x\n", op->arg);
+        return false;
+      }
+      break;
+    case (GPIOOp):
+      if (!Script_ParseNumber(strtok(NULL, " \t\r\n"), 16, 0xFFFF, &op->arg)) {
+        return false;
+      }
+      break;
+    case (SleepOp):
+      if (!Script_ParseNumber(strtok(NULL, " \t\r\n"), 10, 3600000, &op->arg)) {
+        return false;
+      }
+      break;
+  }
+  return strtok(NULL, " \t\r\n") == NULL;
+}
+
+static void Script_Free(Script *script) {
+  unsigned int i;
+  for (i = 0; i < script->numOps; i++) {
+    Image_Free(script->ops[i].image);
+  }
+  free(script->ops);
+}
+
+static bool Script_Parse(const char *fileName, Script *script) {
+  static const struct {
+    const char *name;
+    ScriptOpType type;
+  } opNames[] = {
+    {"dac-write", DACWriteOp},
+    {"dac-read", DACReadOp},
+    {"load", LoadOp},
+    {"verify", VerifyOp},
+    {"gpio", GPIOOp},
+    {"sleep", SleepOp},
+  };
+
+  script->ops = NULL;
+  script->numOps = 0;
+
+  FILE *fp = fopen(fileName, "r");
+
+  if (fp == NULL) {
+    perror("Script_Parse() failed");
+    return false;
+  }
+
+  unsigned int capacity = 0;
+  unsigned int lineNum = 0;
+  char buf[MAX_SCRIPT_LINE];
+
+  while (fgets(buf, sizeof(buf), fp) != NULL) {
+    lineNum++;
+
+    // everything after a '#' is a comment
+    char *comment = strchr(buf, '#');
+    if (comment != NULL) {
+      *comment = '\0';
+    }
+
+    const char *name = strtok(buf, " \t\r\n");
+    if (name == NULL) {
+      continue;
+    }
+
+    if (script->numOps == capacity) {
+      capacity = capacity ? capacity * 2 : 16;
+      ScriptOp *ops = (ScriptOp *)realloc(script->ops, capacity * sizeof(ScriptOp));
+      if (ops == NULL) {
+        fprintf(stderr, "Failed to allocate script\n");
+        fclose(fp);
+        Script_Free(script);
+        return false;
+      }
+      script->ops = ops;
+    }
+
+    ScriptOp *op = &script->ops[script->numOps];
+    memset(op, 0, sizeof(*op));
+    op->line = lineNum;
+
+    unsigned int i;
+    for (i = 0; i < sizeof(opNames) / sizeof(opNames[0]); i++) {
+      if (strcmp(name, opNames[i].name) == 0) {
+        break;
+      }
+    }
+
+    if (i == sizeof(opNames) / sizeof(opNames[0])) {
+      fprintf(stderr, "%s:%u: unknown operation '%s'\n", fileName, lineNum, name);
+      fclose(fp);
+      Script_Free(script);
+      return false;
+    }
+    op->type = opNames[i].type;
+
+    // count the op before parsing it so Script_Free() sees any image it loaded
+    script->numOps++;
+
+    if (!Script_ParseOp(op)) {
+      fprintf(stderr, "%s:%u: bad arguments for '%s'\n", fileName, lineNum, name);
+      fclose(fp);
+      Script_Free(script);
+      return false;
+    }
+  }
+
+  fclose(fp);
+  return true;
+}
+
+// returns true if ops[i + 1] can be folded into the same transfer as ops[i]
+static bool Script_Adjacent(const ScriptOp *cur, const ScriptOp *next, unsigned int end) {
+  if (cur->type != next->type) {
+    return false;
+  }
+
+  switch (cur->type) {
+    case (DACWriteOp):
+      return next->arg == end;
+    case (LoadOp):
+      return next->arg == end;
+    default:
+      return false;
+  }
+}
+
+// writes ops[first, last] as one run of consecutive DAC registers
+static bool Script_RunDACWrites(hid_device *handle, const ScriptOp *ops, unsigned int first, unsigned int last) {
+  unsigned char bytes[DAC5687_NUM_REGISTERS];
+  unsigned int count = 0;
+  unsigned int i;
+  for (i = first; i <= last; i++) {
+    memcpy(&bytes[count], ops[i].bytes, ops[i].count);
+    count += ops[i].count;
+  }
+  return DAC5687_WriteRegisterRange(handle, (DAC5687Address)ops[first].arg, bytes, count);
+}
+
+// writes ops[first, last] as one contiguous SRAM range
+static bool Script_RunLoads(hid_device *handle, const ScriptOp *ops, unsigned int first, unsigned int last) {
+  unsigned int total = 0;
+  unsigned int i;
+  for (i = first; i <= last; i++) {
+    total += ops[i].image->numWords;
+  }
+
+  const unsigned int *words = ops[first].image->words;
+  unsigned int *merged = NULL;
+
+  if (first != last) {
+    merged = (unsigned int *)malloc(total * sizeof(unsigned int));
+    if (merged == NULL) {
+      fprintf(stderr, "Failed to allocate merged load\n");
+      return false;
+    }
+    unsigned int offset = 0;
+    for (i = first; i <= last; i++) {
+      memcpy(&merged[offset], ops[i].image->words, ops[i].image->numWords * sizeof(unsigned int));
+      offset += ops[i].image->numWords;
+    }
+    words = merged;
+  }
+
+  // whatever the cache tag says the SRAM holds is about to stop being true
+  if (!Cache_Invalidate(handle)) {
+    free(merged);
+    return false;
+  }
+
+  unsigned int failures = CPLD_WriteSRAM(handle, ops[first].arg, words, total);
+  free(merged);
+
+  if (failures != 0) {
+    fprintf(stderr, "%u of %u words failed to write\n", failures, total);
+    return false;
+  }
+  return true;
+}
+
+static bool Script_RunVerify(hid_device *handle, const ScriptOp *op) {
+  unsigned int count = op->image->numWords;
+  unsigned int *readBack = (unsigned int *)malloc((count ? count : 1) * sizeof(unsigned int));
+
+  if (readBack == NULL) {
+    fprintf(stderr, "Failed to allocate verify buffer\n");
+    return false;
+  }
+
+  if (!CPLD_ReadSRAM(handle, op->arg, readBack, count)) {
+    free(readBack);
+    return false;
+  }
+
+  unsigned int i;
+  unsigned int mismatches = 0;
+  for (i = 0; i < count; i++) {
+    if (readBack[i] != op->image->words[i]) {
+      if (mismatches < MAX_REPORTED_MISMATCHES) {
+        fprintf(stderr, "verify: addr %#x expected %08x read %08x\n",
+                op->arg + i, op->image->words[i], readBack[i]);
+      }
+      mismatches++;
+    }
+  }
+  free(readBack);
+
+  if (mismatches != 0) {
+    fprintf(stderr, "verify: %u of %u words differ\n", mismatches, count);
+    return false;
+  }
+  return true;
+}
+
+bool Script_Run(hid_device *handle, const char *fileName) {
+  if (handle == NULL) {
+    fprintf(stderr, "handle can't be null\n");
+    return false;
+  }
+
+  Script script;
+  if (!Script_Parse(fileName, &script)) {
+    return false;
+  }
+
+  bool ok = true;
+  unsigned int i = 0;
+  while (ok && i < script.numOps) {
+    const ScriptOp *op = &script.ops[i];
+
+    // fold runs of adjacent writes into a single transfer
+    unsigned int last = i;
+    unsigned int end = op->arg + (op->type == LoadOp ? op->image->numWords : op->count);
+    while (last + 1 < script.numOps && Script_Adjacent(op, &script.ops[last + 1], end)) {
+      last++;
+      end += (op->type == LoadOp) ? script.ops[last].image->numWords : script.ops[last].count;
+    }
+
+    switch (op->type) {
+      case (DACWriteOp):
+        ok = Script_RunDACWrites(handle, script.ops, i, last);
+        break;
+      case (DACReadOp):
+      {
+        unsigned char bytes[DAC5687_NUM_REGISTERS];
+        ok = DAC5687_ReadRegisterRange(handle, (DAC5687Address)op->arg, bytes, op->count);
+        unsigned int reg;
+        for (reg = 0; ok && reg < op->count; reg++) {
+          printf("%02x,%02x\n", op->arg + reg, bytes[reg]);
+        }
+        break;
+      }
+      case (LoadOp):
+        ok = Script_RunLoads(handle, script.ops, i, last);
+        break;
+      case (VerifyOp):
+        ok = Script_RunVerify(handle, op);
+        break;
+      case (GPIOOp):
+        ok = (MCP2210_WriteGPIOValues(handle, (uint16_t)op->arg) == 0x00);
+        break;
+      case (SleepOp):
+        usleep(op->arg * 1000);
+        break;
+    }
+
+    if (!ok) {
+      fprintf(stderr, "%s:%u: operation failed\n", fileName, op->line);
+    }
+    i = last + 1;
+  }
+
+  Script_Free(&script);
+  return ok;
+}
@@ -0,0 +1,312 @@
+/*
+ * MIT License
+ * 
+ * Copyright (c) 2020 Eli Reed
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <stdio.h>      // for fprintf(), perror()
+#include <stdlib.h>     // for malloc(), free()
+#include <stdbool.h>    // for bool type
+#include <stdint.h>     // for fixed-width integer types
+#include <string.h>     // for memcmp(), memcpy(), memset(), strchr()
+#include <errno.h>      // for errno, ENOENT
+#include <time.h>       // for clock_gettime(), nanosleep()
+#include <sched.h>      // for sched_yield()
+#include <fcntl.h>      // for open(), O_* constants
+#include <unistd.h>     // for close(), ftruncate(), unlink()
+#include <sys/mman.h>   // for mmap(), shm_open(), shm_unlink()
+#include <sys/stat.h>   // for fstat()
+
+// project libraries
+#include "dds-host/shm-ring.h"
+
+// how many times a waiting side yields before it starts sleeping between checks
+#define SHMRING_SPINS           64
+#define SHMRING_SLEEP_NS        20000
+
+// the header as it sits in the mapping, each index on its own cache line
+typedef struct shm_ring_header_st {
+  char magic[SHMRING_MAGIC_LEN];
+  uint32_t capacity;
+  uint32_t flags;
+  uint64_t head __attribute__((aligned(64)));
+  uint64_t tail __attribute__((aligned(64)));
+} ShmRingHeader;
+
+struct shm_ring_st {
+  ShmRingHeader *header;
+  // read once when mapped, so the other side can't move the ring under us
+  unsigned int capacity;
+  unsigned int *words;
+  size_t mappingLen;
+};
+
+// names with a '/' past the first character are paths rather than shm names
+static int ShmRing_OpenFd(const char *name, int flags) {
+  if (strchr(name + 1, '/') != NULL) {
+    return open(name, flags, 0600);
+  }
+  return shm_open(name, flags, 0600);
+}
+
+static int ShmRing_UnlinkName(const char *name) {
+  if (strchr(name + 1, '/') != NULL) {
+    return unlink(name);
+  }
+  return shm_unlink(name);
+}
+
+static ShmRing * ShmRing_Map(int fd, size_t mappingLen) {
+  void *mapping = mmap(NULL, mappingLen, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+
+  if (mapping == MAP_FAILED) {
+    perror("ShmRing_Map() failed");
+    return NULL;
+  }
+
+  ShmRing *ring = (ShmRing *)malloc(sizeof(ShmRing));
+
+  if (ring == NULL) {
+    fprintf(stderr, "Failed to allocate ShmRing\n");
+    munmap(mapping, mappingLen);
+    return NULL;
+  }
+
+  ring->header = (ShmRingHeader *)mapping;
+  ring->words = (unsigned int *)((uint8_t *)mapping + SHMRING_HEADER_LEN);
+  ring->mappingLen = mappingLen;
+  return ring;
+}
+
+static size_t ShmRing_Size(unsigned int capacity) {
+  return SHMRING_HEADER_LEN + (size_t)capacity * sizeof(uint32_t);
+}
+
+static bool ShmRing_ValidCapacity(unsigned int capacity) {
+  return capacity != 0 && capacity <= SHMRING_MAX_CAPACITY && (capacity & (capacity - 1)) == 0;
+}
+
+static void ShmRing_Backoff(unsigned int *spins) {
+  if (++*spins < SHMRING_SPINS) {
+    sched_yield();
+  } else {
+    struct timespec pause = {0, SHMRING_SLEEP_NS};
+    nanosleep(&pause, NULL);
+  }
+}
+
+ShmRing * ShmRing_Create(const char *name, unsigned int capacity) {
+  if (name == NULL) {
+    fprintf(stderr, "name can't be null\n");
+    return NULL;
+  }
+
+  if (!ShmRing_ValidCapacity(capacity)) {
+    fprintf(stderr, "ShmRing_Create()->capacity must be a power of two up to %u words\n",
+            SHMRING_MAX_CAPACITY);
+    return NULL;
+  }
+
+  // truncating a ring someone still maps would fault their next access, so the old one
+  // goes away whole and a fresh object takes its name
+  if (ShmRing_UnlinkName(name) != 0 && errno != ENOENT) {
+    perror("ShmRing_Create() failed");
+    return NULL;
+  }
+
+  int fd = ShmRing_OpenFd(name, O_RDWR | O_CREAT | O_EXCL);
+  if (fd < 0) {
+    perror("ShmRing_Create() failed");
+    return NULL;
+  }
+
+  size_t mappingLen = ShmRing_Size(capacity);
+  if (ftruncate(fd, (off_t)mappingLen) != 0) {
+    perror("ShmRing_Create() failed");
+    close(fd);
+    return NULL;
+  }
+
+  ShmRing *ring = ShmRing_Map(fd, mappingLen);
+  close(fd);
+
+  if (ring == NULL) {
+    return NULL;
+  }
+
+  // the magic goes in last so a consumer never maps a half-made header
+  ring->capacity = capacity;
+  ring->header->capacity = capacity;
+  ring->header->flags = 0;
+  ring->header->head = 0;
+  ring->header->tail = 0;
+  __atomic_thread_fence(__ATOMIC_RELEASE);
+  memcpy(ring->header->magic, SHMRING_MAGIC, SHMRING_MAGIC_LEN);
+  return ring;
+}
+
+ShmRing * ShmRing_Open(const char *name) {
+  if (name == NULL) {
+    fprintf(stderr, "name can't be null\n");
+    return NULL;
+  }
+
+  int fd = ShmRing_OpenFd(name, O_RDWR);
+  if (fd < 0) {
+    perror("ShmRing_Open() failed");
+    return NULL;
+  }
+
+  struct stat st;
+  if (fstat(fd, &st) != 0 || st.st_size < SHMRING_HEADER_LEN) {
+    fprintf(stderr, "ShmRing_Open()->%s isn't a waveform ring\n", name);
+    close(fd);
+    return NULL;
+  }
+
+  ShmRing *ring = ShmRing_Map(fd, (size_t)st.st_size);
+  close(fd);
+
+  if (ring == NULL) {
+    return NULL;
+  }
+
+  unsigned int capacity = ring->header->capacity;
+  if (memcmp(ring->header->magic, SHMRING_MAGIC, SHMRING_MAGIC_LEN) != 0 ||
+      !ShmRing_ValidCapacity(capacity) || ShmRing_Size(capacity) > ring->mappingLen) {
+    fprintf(stderr, "ShmRing_Open()->%s isn't a waveform ring\n", name);
+    ShmRing_Close(ring);
+    return NULL;
+  }
+  ring->capacity = capacity;
+  return ring;
+}
+
+bool ShmRing_Write(ShmRing *ring, const unsigned int *words, unsigned int count) {
+  ShmRingHeader *header = ring->header;
+  uint64_t head = __atomic_load_n(&header->head, __ATOMIC_RELAXED);
+  unsigned int capacity = ring->capacity;
+
+  if (__atomic_load_n(&header->flags, __ATOMIC_ACQUIRE) & SHMRING_FINISHED) {
+    fprintf(stderr, "ShmRing_Write()->the ring is already finished\n");
+    return false;
+  }
+
+  while (count > 0) {
+    unsigned int spins = 0;
+    uint64_t room;
+    while ((room = capacity - (head - __atomic_load_n(&header->tail, __ATOMIC_ACQUIRE))) == 0) {
+      ShmRing_Backoff(&spins);
+    }
+
+    // up to the end of the ring at most; the rest goes round on the next pass
+    unsigned int index = (unsigned int)(head & (capacity - 1));
+    unsigned int n = count;
+    if (n > room) {
+      n = (unsigned int)room;
+    }
+    if (n > capacity - index) {
+      n = capacity - index;
+    }
+
+    memcpy(&ring->words[index], words, n * sizeof(unsigned int));
+    head += n;
+    __atomic_store_n(&header->head, head, __ATOMIC_RELEASE);
+    words += n;
+    count -= n;
+  }
+  return true;
+}
+
+void ShmRing_Finish(ShmRing *ring) {
+  __atomic_fetch_or(&ring->header->flags, SHMRING_FINISHED, __ATOMIC_RELEASE);
+}
+
+bool ShmRing_Peek(ShmRing *ring, unsigned int timeoutUs, const unsigned int **words, unsigned int *count) {
+  ShmRingHeader *header = ring->header;
+  uint64_t tail = __atomic_load_n(&header->tail, __ATOMIC_RELAXED);
+  uint64_t head = __atomic_load_n(&header->head, __ATOMIC_ACQUIRE);
+
+  if (head == tail && timeoutUs > 0) {
+    struct timespec start, now;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    unsigned int spins = 0;
+
+    while ((head = __atomic_load_n(&header->head, __ATOMIC_ACQUIRE)) == tail) {
+      if (__atomic_load_n(&header->flags, __ATOMIC_ACQUIRE) & SHMRING_FINISHED) {
+        break;
+      }
+      clock_gettime(CLOCK_MONOTONIC, &now);
+      if ((now.tv_sec - start.tv_sec) * 1000000LL + (now.tv_nsec - start.tv_nsec) / 1000 >= timeoutUs) {
+        break;
+      }
+      ShmRing_Backoff(&spins);
+    }
+  }
+
+  // a head the producer can't have written means the ring's been trampled on
+  unsigned int capacity = ring->capacity;
+  if (head - tail > capacity) {
+    fprintf(stderr, "ShmRing_Peek()->the ring's indices are corrupt\n");
+    return false;
+  }
+
+  unsigned int index = (unsigned int)(tail & (capacity - 1));
+  *count = (unsigned int)(head - tail);
+  if (*count > capacity - index) {
+    *count = capacity - index;
+  }
+  *words = &ring->words[index];
+  return true;
+}
+
+void ShmRing_Consume(ShmRing *ring, unsigned int count) {
+  uint64_t tail = __atomic_load_n(&ring->header->tail, __ATOMIC_RELAXED);
+  __atomic_store_n(&ring->header->tail, tail + count, __ATOMIC_RELEASE);
+}
+
+bool ShmRing_Drained(const ShmRing *ring) {
+  // the flag is set after the last head store, so check it first
+  bool finished = __atomic_load_n(&ring->header->flags, __ATOMIC_ACQUIRE) & SHMRING_FINISHED;
+  return finished && __atomic_load_n(&ring->header->head, __ATOMIC_ACQUIRE) ==
+                     __atomic_load_n(&ring->header->tail, __ATOMIC_RELAXED);
+}
+
+void ShmRing_Close(ShmRing *ring) {
+  if (ring == NULL) {
+    return;
+  }
+  munmap(ring->header, ring->mappingLen);
+  free(ring);
+}
+
+bool ShmRing_Unlink(const char *name) {
+  if (name == NULL) {
+    fprintf(stderr, "name can't be null\n");
+    return false;
+  }
+
+  if (ShmRing_UnlinkName(name) != 0) {
+    perror("ShmRing_Unlink() failed");
+    return false;
+  }
+  return true;
+}
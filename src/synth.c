@@ -0,0 +1,303 @@
+/*
+ * MIT License
+ * 
+ * Copyright (c) 2020 Eli Reed
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <stdio.h>    // for fprintf()
+#include <stdlib.h>   // for malloc(), free(), strtod()
+#include <stdbool.h>  // for bool type
+#include <string.h>   // for memset(), strncmp()
+#include <math.h>     // for sin(), log(), pow()
+
+// project libraries
+#include "dds-host/synth.h"
+#include "dds-host/cpld.h"
+#include "dds-host/image.h"
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+// samples are computed this many at a time into a scratch buffer of phases, so the
+// phase loops are simple enough for the compiler to vectorize (the Makefile builds this
+// file with the vectorizer on); the sin() calls over them stay scalar
+#define SYNTH_BLOCK           1024
+
+void Synth_Defaults(SynthParams *params) {
+  memset(params, 0, sizeof(*params));
+  params->kind = SynthTone;
+  params->numSamples = SRAM_MAX_ADDRESS + 1;
+  params->sampleRate = 1.0;
+  params->amplitude = 1.0;
+  params->iqPhase = M_PI / 2;
+}
+
+// parses "<freq>[*<weight>][@<phase degrees>]"
+static const char * Synth_ParseTone(const char *str, SynthParams *params) {
+  char *end;
+  unsigned int i = params->numTones;
+
+  if (i == SYNTH_MAX_TONES) {
+    fprintf(stderr, "can't synthesize more than %d tones\n", SYNTH_MAX_TONES);
+    return NULL;
+  }
+
+  params->freqs[i] = strtod(str, &end);
+  params->weights[i] = 1.0;
+  params->phases[i] = 0.0;
+  if (end == str) {
+    return NULL;
+  }
+
+  if (*end == '*') {
+    str = end + 1;
+    params->weights[i] = strtod(str, &end);
+    if (end == str) {
+      return NULL;
+    }
+  }
+
+  if (*end == '@') {
+    str = end + 1;
+    params->phases[i] = strtod(str, &end) * M_PI / 180.0;
+    if (end == str) {
+      return NULL;
+    }
+  }
+
+  params->numTones++;
+  return end;
+}
+
+bool Synth_ParseSpec(const char *spec, SynthParams *params) {
+  const char *cur;
+  char *end;
+
+  params->numTones = 0;
+
+  if (strncmp(spec, "tone:", 5) == 0) {
+    params->kind = SynthTone;
+    cur = Synth_ParseTone(spec + 5, params);
+    if (cur == NULL || *cur != '\0') {
+      fprintf(stderr, "bad tone: %s\n", spec);
+      return false;
+    }
+    return true;
+  }
+
+  if (strncmp(spec, "multitone:", 10) == 0) {
+    params->kind = SynthMultitone;
+    cur = spec + 10;
+    while (true) {
+      cur = Synth_ParseTone(cur, params);
+      if (cur == NULL || (*cur != ',' && *cur != '\0')) {
+        fprintf(stderr, "bad multitone: %s\n", spec);
+        return false;
+      }
+      if (*cur == '\0') {
+        return true;
+      }
+      cur++;
+    }
+  }
+
+  bool linear = strncmp(spec, "chirp:", 6) == 0;
+  if (linear || strncmp(spec, "logchirp:", 9) == 0) {
+    params->kind = linear ? SynthLinearChirp : SynthLogChirp;
+    cur = spec + (linear ? 6 : 9);
+    params->startFreq = strtod(cur, &end);
+    if (end == cur || *end != ':') {
+      fprintf(stderr, "bad chirp: %s\n", spec);
+      return false;
+    }
+    cur = end + 1;
+    params->endFreq = strtod(cur, &end);
+    if (end == cur || *end != '\0') {
+      fprintf(stderr, "bad chirp: %s\n", spec);
+      return false;
+    }
+    return true;
+  }
+
+  fprintf(stderr, "unknown waveform: %s\n", spec);
+  return false;
+}
+
+// 16-bit offset binary, as gen_dac_data.py scales it
+static unsigned int Synth_Quantize(double x) {
+  double v = 0x7FFF * (x + 1.0) + 0.5;
+  if (v < 0) {
+    return 0;
+  }
+  return v > 0xFFFF ? 0xFFFF : (unsigned int)v;
+}
+
+unsigned int Synth_Pack(unsigned int i, unsigned int q) {
+  return ((i >> 8) & 0xFF) | ((i & 0xFF) << 8) | (((q >> 8) & 0xFF) << 16) | ((q & 0xFF) << 24);
+}
+
+static bool Synth_Validate(const SynthParams *params) {
+  if (params->numSamples == 0 || params->numSamples > SRAM_MAX_ADDRESS + 1) {
+    fprintf(stderr, "can't synthesize %u samples\n", params->numSamples);
+    return false;
+  }
+  if (!(params->sampleRate > 0)) {
+    fprintf(stderr, "the sample rate must be positive\n");
+    return false;
+  }
+  if (!(params->amplitude >= 0 && params->amplitude <= 1)) {
+    fprintf(stderr, "the amplitude must be between 0 and 1\n");
+    return false;
+  }
+
+  switch (params->kind) {
+    case (SynthTone):
+    case (SynthMultitone):
+      if (params->numTones == 0) {
+        fprintf(stderr, "no tones to synthesize\n");
+        return false;
+      }
+      return true;
+    case (SynthLogChirp):
+      if (!(params->startFreq > 0 && params->endFreq > 0)) {
+        fprintf(stderr, "log chirps need positive frequencies\n");
+        return false;
+      }
+      return true;
+    case (SynthLinearChirp):
+      return true;
+    default:
+      fprintf(stderr, "unknown waveform kind\n");
+      return false;
+  }
+}
+
+bool Synth_Generate(const SynthParams *params, unsigned int *words) {
+  if (params == NULL || words == NULL) {
+    fprintf(stderr, "params and words can't be null\n");
+    return false;
+  }
+
+  if (!Synth_Validate(params)) {
+    return false;
+  }
+
+  const double dt = 1.0 / params->sampleRate;
+  const double duration = params->numSamples * dt;
+
+  // tones are scaled so their peaks can't add up past full scale
+  double weightSum = 0;
+  unsigned int t;
+  for (t = 0; t < params->numTones; t++) {
+    weightSum += fabs(params->weights[t]);
+  }
+  const double toneScale = weightSum > 0 ? params->amplitude / weightSum : 0;
+
+  double phase[SYNTH_BLOCK];
+  double iSum[SYNTH_BLOCK];
+  double qSum[SYNTH_BLOCK];
+
+  unsigned int base;
+  for (base = 0; base < params->numSamples; base += SYNTH_BLOCK) {
+    unsigned int n = params->numSamples - base;
+    if (n > SYNTH_BLOCK) {
+      n = SYNTH_BLOCK;
+    }
+    unsigned int k;
+
+    if (params->kind == SynthTone || params->kind == SynthMultitone) {
+      for (k = 0; k < n; k++) {
+        iSum[k] = 0;
+        qSum[k] = 0;
+      }
+      for (t = 0; t < params->numTones; t++) {
+        const double w = 2 * M_PI * params->freqs[t] * dt;
+        const double weight = params->weights[t] * toneScale;
+        for (k = 0; k < n; k++) {
+          phase[k] = w * (double)(base + k) + params->phases[t];
+        }
+        for (k = 0; k < n; k++) {
+          iSum[k] += weight * sin(phase[k]);
+          qSum[k] += weight * sin(phase[k] + params->iqPhase);
+        }
+      }
+    } else {
+      const double f0 = params->startFreq, f1 = params->endFreq;
+      if (params->kind == SynthLinearChirp) {
+        // phase = 2 pi (f0 t + (f1 - f0) t^2 / 2T)
+        const double rate = (f1 - f0) / duration;
+        for (k = 0; k < n; k++) {
+          double time = (double)(base + k) * dt;
+          phase[k] = 2 * M_PI * (f0 * time + 0.5 * rate * time * time);
+        }
+      } else if (f0 == f1) {
+        for (k = 0; k < n; k++) {
+          phase[k] = 2 * M_PI * f0 * (double)(base + k) * dt;
+        }
+      } else {
+        // f(t) = f0 (f1/f0)^(t/T), so phase = 2 pi f0 T (ratio^(t/T) - 1) / ln(ratio)
+        const double lnRatio = log(f1 / f0);
+        for (k = 0; k < n; k++) {
+          double time = (double)(base + k) * dt;
+          phase[k] = 2 * M_PI * f0 * duration * (exp(lnRatio * time / duration) - 1) / lnRatio;
+        }
+      }
+      for (k = 0; k < n; k++) {
+        iSum[k] = params->amplitude * sin(phase[k]);
+        qSum[k] = params->amplitude * sin(phase[k] + params->iqPhase);
+      }
+    }
+
+    for (k = 0; k < n; k++) {
+      words[base + k] = Synth_Pack(Synth_Quantize(iSum[k]), Synth_Quantize(qSum[k]));
+    }
+  }
+  return true;
+}
+
+SRAMImage * Synth_CreateImage(const SynthParams *params) {
+  if (params == NULL || !Synth_Validate(params)) {
+    return NULL;
+  }
+
+  SRAMImage *image = (SRAMImage *)malloc(sizeof(SRAMImage));
+
+  if (image == NULL) {
+    fprintf(stderr, "Failed to allocate SRAMImage\n");
+    return NULL;
+  }
+
+  image->numWords = params->numSamples;
+  image->words = (unsigned int *)malloc(image->numWords * sizeof(unsigned int));
+
+  if (image->words == NULL) {
+    fprintf(stderr, "Failed to allocate SRAMImage words\n");
+    free(image);
+    return NULL;
+  }
+
+  if (!Synth_Generate(params, image->words)) {
+    Image_Free(image);
+    return NULL;
+  }
+  return image;
+}
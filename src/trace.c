@@ -0,0 +1,154 @@
+/*
+ * MIT License
+ * 
+ * Copyright (c) 2020 Eli Reed
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <stdio.h>    // for fopen(), fwrite(), fread()
+#include <stdlib.h>   // for malloc(), free()
+#include <stdbool.h>  // for bool type
+#include <stdint.h>   // for fixed-width integer types
+#include <string.h>   // for memcmp(), memcpy()
+#include <time.h>     // for clock_gettime()
+
+// project libraries
+#include "dds-host/trace.h"
+#include "dds-host/util/bytes.h"
+
+static const char kTraceMagic[8] = {'D', 'D', 'S', 'T', 'R', 'A', 'C', 'E'};
+
+struct trace_file_st {
+  FILE *fp;
+  // CLOCK_MONOTONIC when the trace was created
+  uint64_t epochNs;
+};
+
+static uint64_t Trace_Monotonic() {
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (uint64_t)now.tv_sec * 1000000000ULL + (uint64_t)now.tv_nsec;
+}
+
+TraceFile * Trace_Create(const char *fileName) {
+  TraceFile *trace = (TraceFile *)malloc(sizeof(TraceFile));
+
+  if (trace == NULL) {
+    fprintf(stderr, "Failed to allocate TraceFile\n");
+    return NULL;
+  }
+
+  trace->fp = fopen(fileName, "wb");
+  if (trace->fp == NULL) {
+    perror("Trace_Create() failed");
+    free(trace);
+    return NULL;
+  }
+
+  uint8_t header[TRACE_HEADER_SIZE];
+  memcpy(header, kTraceMagic, sizeof(kTraceMagic));
+  Bytes_PutLE(&header[8], TRACE_VERSION, 4);
+  Bytes_PutLE(&header[12], TRACE_RECORD_SIZE, 4);
+
+  if (fwrite(header, sizeof(header), 1, trace->fp) != 1) {
+    perror("Trace_Create() failed");
+    fclose(trace->fp);
+    free(trace);
+    return NULL;
+  }
+
+  trace->epochNs = Trace_Monotonic();
+  return trace;
+}
+
+TraceFile * Trace_Open(const char *fileName) {
+  TraceFile *trace = (TraceFile *)malloc(sizeof(TraceFile));
+
+  if (trace == NULL) {
+    fprintf(stderr, "Failed to allocate TraceFile\n");
+    return NULL;
+  }
+
+  trace->fp = fopen(fileName, "rb");
+  if (trace->fp == NULL) {
+    perror("Trace_Open() failed");
+    free(trace);
+    return NULL;
+  }
+
+  uint8_t header[TRACE_HEADER_SIZE];
+  if (fread(header, sizeof(header), 1, trace->fp) != 1 ||
+      memcmp(header, kTraceMagic, sizeof(kTraceMagic)) != 0) {
+    fprintf(stderr, "%s isn't a trace file\n", fileName);
+    fclose(trace->fp);
+    free(trace);
+    return NULL;
+  }
+
+  unsigned int version = (unsigned int)Bytes_GetLE(&header[8], 4);
+  if (version != TRACE_VERSION || Bytes_GetLE(&header[12], 4) != TRACE_RECORD_SIZE) {
+    fprintf(stderr, "%s is trace version %u, expected %u\n", fileName, version, TRACE_VERSION);
+    fclose(trace->fp);
+    free(trace);
+    return NULL;
+  }
+
+  trace->epochNs = 0;
+  return trace;
+}
+
+uint64_t Trace_Now(const TraceFile *trace) {
+  return Trace_Monotonic() - trace->epochNs;
+}
+
+bool Trace_Write(TraceFile *trace, const TraceRecord *record) {
+  uint8_t buf[TRACE_RECORD_SIZE];
+
+  Bytes_PutLE(&buf[0], record->startNs, 8);
+  Bytes_PutLE(&buf[8], record->durationNs, 4);
+  Bytes_PutLE(&buf[12], (uint32_t)record->result, 4);
+  memcpy(&buf[16], record->tx, MCP2210_REPORT_LEN);
+  memcpy(&buf[16 + MCP2210_REPORT_LEN], record->rx, MCP2210_REPORT_LEN);
+
+  return fwrite(buf, sizeof(buf), 1, trace->fp) == 1;
+}
+
+bool Trace_Read(TraceFile *trace, TraceRecord *record) {
+  uint8_t buf[TRACE_RECORD_SIZE];
+
+  if (fread(buf, sizeof(buf), 1, trace->fp) != 1) {
+    return false;
+  }
+
+  record->startNs = Bytes_GetLE(&buf[0], 8);
+  record->durationNs = (uint32_t)Bytes_GetLE(&buf[8], 4);
+  record->result = (int32_t)Bytes_GetLE(&buf[12], 4);
+  memcpy(record->tx, &buf[16], MCP2210_REPORT_LEN);
+  memcpy(record->rx, &buf[16 + MCP2210_REPORT_LEN], MCP2210_REPORT_LEN);
+  return true;
+}
+
+void Trace_Close(TraceFile *trace) {
+  if (trace == NULL) {
+    return;
+  }
+  fclose(trace->fp);
+  free(trace);
+}
@@ -0,0 +1,155 @@
+#!/bin/bash
+# MIT License
+#
+# Copyright (c) 2020 Eli Reed
+# 
+# Permission is hereby granted, free of charge, to any person obtaining a copy
+# of this software and associated documentation files (the "Software"), to deal
+# in the Software without restriction, including without limitation the rights
+# to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+# copies of the Software, and to permit persons to whom the Software is
+# furnished to do so, subject to the following conditions:
+# 
+# The above copyright notice and this permission notice shall be included in all
+# copies or substantial portions of the Software.
+# 
+# THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+# IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+# FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+# AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+# LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+# OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+# SOFTWARE.
+
+# Run by 'make check': dry-run uploads against the simulated board, each followed by a
+# readback of the SRAM it left behind (saved with --sim-state) against the data file.
+#
+# usage: tests/check.sh <dds-host> <directory holding sram-check and two-devices>
+
+set -u
+
+HOST=$1
+HELPERS=$2
+WORK=$(mktemp -d)
+trap 'rm -rf "$WORK"' EXIT
+
+passed=0
+failed=0
+
+# Every image stays in the first 512 words of SRAM. CPLD_EncodePacket doesn't send
+# address bit 9 or bit 16, and the simulator decodes the same bits, so longer images
+# would overwrite themselves until that layout is checked against the CPLD firmware.
+WORDS=512
+
+# writes 'rows' 32-bit words, each different, to a one-column data file
+MakeData() {
+  awk -v rows="$2" -v seed="$3" 'BEGIN { for (i = 0; i < rows; i++) printf "%08x\n", (i * 2654435761 + seed) % 4294967296 }' > "$1"
+}
+
+# a dry run against the board saved in $WORK/<state>, which is created if it's missing
+Upload() {
+  local state=$1
+  shift
+  "$HOST" --dry-run --report-latency 0 --dac-config "$WORK/dac.csv" --mcp-config "$WORK/mcp.csv" \
+    --sim-state "$WORK/$state" "$@"
+}
+
+# like Upload, but also keeps the run's output in $WORK/<log> to look through afterwards
+UploadLogged() {
+  local log=$1
+  shift
+  Upload "$@" > "$WORK/$log" 2>&1
+  local status=$?
+  cat "$WORK/$log"
+  return $status
+}
+
+SRAMCheck() {
+  local state=$1
+  shift
+  "$HELPERS/sram-check" "$WORK/$state" "$@"
+}
+
+# runs one check with its output kept aside, and only shows that output if it fails
+Check() {
+  local name=$1
+  shift
+  if "$@" > "$WORK/log" 2>&1; then
+    echo "PASS  $name"
+    passed=$((passed + 1))
+  else
+    echo "FAIL  $name"
+    sed 's/^/      /' "$WORK/log" | tail -n 20
+    failed=$((failed + 1))
+  fi
+}
+
+FullUpload() {
+  Upload full.sim --data "$WORK/a.csv" && SRAMCheck full.sim "$WORK/a.csv"
+}
+
+# 100 rows of b.csv from row 10 on over the middle of a.csv; the rest of a.csv stays
+PatchUpload() {
+  Upload patch.sim --data "$WORK/a.csv" &&
+    Upload patch.sim --data "$WORK/b.csv" --offset 0x100 --source-offset 10 --count 100 &&
+    SRAMCheck patch.sim "$WORK/b.csv" 0x100 10 100 &&
+    SRAMCheck patch.sim "$WORK/a.csv" 0 0 0x100 &&
+    SRAMCheck patch.sim "$WORK/a.csv" 0x164 0x164
+}
+
+PipelineUpload() {
+  Upload pipeline.sim --data "$WORK/a.csv" --pipeline && SRAMCheck pipeline.sim "$WORK/a.csv"
+}
+
+# compiled once, then replayed from the stream alone
+ReplayUpload() {
+  "$HOST" --data "$WORK/a.csv" --compile-upload "$WORK/a.stream" &&
+    Upload replay.sim --replay "$WORK/a.stream" && SRAMCheck replay.sim "$WORK/a.csv"
+}
+
+# the last row has no newline after it, and still has to reach the SRAM
+NoTrailingNewline() {
+  printf '00000001\n00000002\n00000003' > "$WORK/short.csv"
+  UploadLogged short.log short.sim --data "$WORK/short.csv" &&
+    grep -q "upload: 3 words, 0 failed" "$WORK/short.log" &&
+    SRAMCheck short.sim "$WORK/short.csv" 0 0 3
+}
+
+# the link drops part way through and the same run reconnects and carries on
+ResumeAfterDrop() {
+  Upload drop.sim --data "$WORK/a.csv" --simulate-drop 500 && SRAMCheck drop.sim "$WORK/a.csv"
+}
+
+# the board goes away part way through; the next run picks up where the journal left off
+ResumeAfterUnplug() {
+  if Upload unplug.sim --data "$WORK/a.csv" --journal "$WORK/unplug.journal" --simulate-unplug 500; then
+    echo "the unplugged upload succeeded"
+    return 1
+  fi
+  [ -f "$WORK/unplug.journal" ] &&
+    UploadLogged unplug.log unplug.sim --data "$WORK/a.csv" --journal "$WORK/unplug.journal" &&
+    grep -q "resuming upload at word" "$WORK/unplug.log" &&
+    [ ! -f "$WORK/unplug.journal" ] &&
+    SRAMCheck unplug.sim "$WORK/a.csv"
+}
+
+TwoDevices() {
+  "$HELPERS/two-devices" "$WORDS"
+}
+
+printf '01,02\n03,04\n05,06\n' > "$WORK/dac.csv"
+printf '00,00\n' > "$WORK/mcp.csv"
+MakeData "$WORK/a.csv" "$WORDS" 0
+MakeData "$WORK/b.csv" 200 12345
+
+Check "full upload" FullUpload
+Check "patch upload" PatchUpload
+Check "pipelined upload" PipelineUpload
+Check "compiled upload replayed" ReplayUpload
+Check "data file without a trailing newline" NoTrailingNewline
+Check "resume after --simulate-drop" ResumeAfterDrop
+Check "resume after --simulate-unplug with --journal" ResumeAfterUnplug
+Check "two devices open at once" TwoDevices
+
+echo "$passed passed, $failed failed"
+[ "$failed" -eq 0 ]
@@ -0,0 +1,97 @@
+/*
+ * MIT License
+ * 
+ * Copyright (c) 2020 Eli Reed
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/*
+ * Checks what a dry run left in the simulated SRAM. Loads a --sim-state file and
+ * compares 'count' words from 'addr' on with the data file's rows from 'firstRow' on.
+ *
+ * usage: sram-check <state file> <data file> [<addr> [<first row> [<count>]]]
+ * A count of 0 (the default) means every row from 'firstRow' to the end.
+ */
+
+#include <stdio.h>    // for printf(), fprintf()
+#include <stdlib.h>   // for strtoul()
+#include <stdbool.h>  // for bool type
+
+// project libraries
+#include "dds-host/cpld.h"
+#include "dds-host/image.h"
+#include "dds-host/mcp2210-sim.h"
+
+int main(int argc, char **argv) {
+  if (argc < 3 || argc > 6) {
+    fprintf(stderr, "Usage: %s <state file> <data file> [<addr> [<first row> [<count>]]]\n", argv[0]);
+    return 2;
+  }
+
+  unsigned int addr = argc > 3 ? (unsigned int)strtoul(argv[3], NULL, 0) : 0;
+  unsigned long long firstRow = argc > 4 ? strtoull(argv[4], NULL, 0) : 0;
+  unsigned int count = argc > 5 ? (unsigned int)strtoul(argv[5], NULL, 0) : 0;
+
+  MCP2210Sim *sim = MCP2210Sim_Create(0);
+  if (sim == NULL) {
+    return 2;
+  }
+
+  if (!MCP2210Sim_LoadState(sim, argv[1])) {
+    MCP2210Sim_Destroy(sim);
+    return 2;
+  }
+
+  SRAMImage *image = Image_LoadRange(argv[2], firstRow, count);
+  if (image == NULL) {
+    MCP2210Sim_Destroy(sim);
+    return 2;
+  }
+
+  if (image->numWords > SRAM_MAX_ADDRESS + 1 - addr) {
+    fprintf(stderr, "%u words don't fit in SRAM from %05x\n", image->numWords, addr);
+    Image_Free(image);
+    MCP2210Sim_Destroy(sim);
+    return 2;
+  }
+
+  const unsigned int *sram = MCP2210Sim_SRAM(sim);
+  unsigned int mismatches = 0;
+  unsigned int i;
+
+  for (i = 0; i < image->numWords; i++) {
+    if (sram[addr + i] != image->words[i]) {
+      if (mismatches++ == 0) {
+        fprintf(stderr, "SRAM %05x holds %08x, row %llu is %08x\n",
+                addr + i, sram[addr + i], firstRow + i, image->words[i]);
+      }
+    }
+  }
+
+  if (mismatches != 0) {
+    fprintf(stderr, "%u of %u words differ\n", mismatches, image->numWords);
+  } else {
+    printf("%u words from %05x match\n", image->numWords, addr);
+  }
+
+  Image_Free(image);
+  MCP2210Sim_Destroy(sim);
+  return mismatches != 0;
+}
@@ -0,0 +1,137 @@
+/*
+ * MIT License
+ * 
+ * Copyright (c) 2020 Eli Reed
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/*
+ * Opens two simulated boards through the host library at once, uploads a different
+ * image to each from its own thread and reads both back, to check neither upload
+ * reaches the other board.
+ *
+ * usage: two-devices [<words>]
+ */
+
+#include <stdio.h>    // for printf(), fprintf()
+#include <stdlib.h>   // for malloc(), free(), strtoul()
+#include <stdbool.h>  // for bool type
+#include <pthread.h>  // for pthread_create(), pthread_join()
+
+// project libraries
+#include "dds-host/cpld.h"
+#include "dds-host/device.h"
+
+// check.sh keeps to the first 512 words, whose addresses CPLD_EncodePacket sends in full
+#define TWO_DEVICES_DEFAULT_WORDS   512
+
+typedef struct board_st {
+  DDSDevice *dev;
+  unsigned int *words;
+  unsigned int count;
+  unsigned int failed;
+} Board;
+
+static void * UploadThread(void *arg) {
+  Board *board = (Board *)arg;
+  board->failed = DDSDevice_Upload(board->dev, 0, board->words, board->count, NULL);
+  return NULL;
+}
+
+// reads the board back and counts the words that don't match what was sent to it
+static unsigned int Mismatches(Board *board, unsigned int *readback) {
+  if (!DDSDevice_ReadSRAM(board->dev, 0, readback, board->count)) {
+    return board->count;
+  }
+
+  unsigned int mismatches = 0;
+  unsigned int i;
+  for (i = 0; i < board->count; i++) {
+    mismatches += readback[i] != board->words[i];
+  }
+  return mismatches;
+}
+
+// uploads to both boards at once, then checks each one. Returns 0 if both hold their own
+// image, 1 otherwise.
+static int UploadBoth(Board *boards, unsigned int *readback) {
+  pthread_t threads[2];
+  unsigned int b;
+
+  for (b = 0; b < 2; b++) {
+    if (pthread_create(&threads[b], NULL, UploadThread, &boards[b]) != 0) {
+      fprintf(stderr, "two-devices: couldn't start upload thread\n");
+      while (b-- > 0) {
+        pthread_join(threads[b], NULL);
+      }
+      return 1;
+    }
+  }
+  for (b = 0; b < 2; b++) {
+    pthread_join(threads[b], NULL);
+  }
+
+  int status = 0;
+  for (b = 0; b < 2; b++) {
+    unsigned int mismatches = Mismatches(&boards[b], readback);
+    printf("board %u: %u words, %u failed, %u differ on readback\n", b, boards[b].count, boards[b].failed, mismatches);
+    if (boards[b].failed != 0 || mismatches != 0) {
+      status = 1;
+    }
+  }
+  return status;
+}
+
+int main(int argc, char **argv) {
+  unsigned int count = argc > 1 ? (unsigned int)strtoul(argv[1], NULL, 0) : TWO_DEVICES_DEFAULT_WORDS;
+
+  if (count == 0 || count > SRAM_MAX_ADDRESS + 1) {
+    fprintf(stderr, "Usage: %s [<words>], 1 to %u\n", argv[0], SRAM_MAX_ADDRESS + 1);
+    return 2;
+  }
+
+  Board boards[2] = {{0}};
+  unsigned int *readback = (unsigned int *)malloc(count * sizeof(unsigned int));
+  bool ready = readback != NULL;
+  unsigned int b, i;
+
+  for (b = 0; b < 2 && ready; b++) {
+    boards[b].dev = DDSDevice_OpenSim(0);
+    boards[b].words = (unsigned int *)malloc(count * sizeof(unsigned int));
+    boards[b].count = count;
+    ready = boards[b].dev != NULL && boards[b].words != NULL;
+
+    // different on every word, and different between the boards
+    for (i = 0; i < count && ready; i++) {
+      boards[b].words[i] = (i * 2654435761U) ^ (b ? 0xFFFFFFFF : 0);
+    }
+  }
+
+  int status = ready ? UploadBoth(boards, readback) : 2;
+
+  for (b = 0; b < 2; b++) {
+    if (boards[b].dev != NULL) {
+      DDSDevice_Close(boards[b].dev);
+    }
+    free(boards[b].words);
+  }
+  free(readback);
+  return status;
+}